@@ -3,6 +3,11 @@ if [ "$#" -ne 1 ]; then
     exit 1
 fi
 
+# Map through a running mapping server (see the 'serve' command), if there is one
+if [ -n "$MIDAS_SOCKET" ] && [ -S "$MIDAS_SOCKET" ]; then
+    exec python3 src/midas_client.py --socket "$MIDAS_SOCKET" map "$1" --cgra design.cmpa --mapper 1 -o res
+fi
+
 python3 src/dfg_parser.py "$1"
 
 ./midas scripts/default.mcl
\ No newline at end of file
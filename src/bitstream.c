@@ -0,0 +1,658 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "dfg.h"
+#include "cgra.h"
+#include "ops.h"
+#include "bitstream.h"
+#include "mapcache.h"
+
+#define BS_ALIGN(x) (((x) + 7) & ~((uint64_t)7))
+#define BS_MAX_PE_RESOURCES (1 << 16) // bound on n_or / rf_size / cu_size read from a file
+
+// Configuration helpers, shared with the JSON exporter (export-mapping.c)
+int getInputDirection(cgra *c, int i, int j, int k, int *directions, int **placed);
+int getRecDirection(cgra *c, int i, int j, int rid, int recDist, int *directions, int **placed);
+int getOutputDirection(cgra *c, int i, int j, int **placed, int idx);
+int getOutPortSels(cgra *c, int i, int j, int **placed, int *outPortSel, int *or_lut);
+int getLRFAccessDirection(cgra *c, int i, int j);
+int *getInputRecArr(cgra *c, dfg *d, dfg_instr *target);
+
+struct _bitstream
+{
+    int fd;
+    size_t size;
+    const unsigned char *base;
+    const bs_header *h;
+};
+
+uint64_t fnv1a_hash(const void *data, size_t size, uint64_t seed)
+{
+    const unsigned char *p = (const unsigned char *)data;
+    uint64_t hash = seed;
+    size_t k;
+
+    for (k = 0; k < size; k++)
+    {
+        hash ^= p[k];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+/**************************************************************************************
+ * Inputs: Device Slice, dfg, target PE coordinates and the placement info array
+ * Fills the fixed-width configuration record of PE (i, j) for the slice's context.
+ * Follows the same conventions as the JSON export (create_pe_object), including the
+ * output register renaming that prioritizes registers fed by the LRF read ports.
+ *************************************************************************************/
+void fill_pe_config(cgra *c, dfg *d, int i, int j, int **placed, bs_pe_config *cfg)
+{
+    dfg_instr *target = get_cgra_tile(c, i, j);
+    int k, n, n_i = 0, id, dist, addr_time, cnt_id = 0, n_or = getNumOutputRegisters(c, i, j);
+    int directions[6] = {0}, outPortSel[4] = {-1, -1, -1, -1}, *recArr;
+    int *or_lut = (int *)malloc(n_or * sizeof(int)), *or_src = (int *)malloc(n_or * sizeof(int));
+
+    memset(cfg, 0, sizeof(bs_pe_config));
+    cfg->fu_op = BS_OP_NONE;
+    cfg->power = get_pe_power_mode(c, i, j);
+    cfg->lrf_wr_addr = BS_NO_ADDR;
+    for (k = 0; k < BS_MAX_FU_INPUTS; k++)
+        cfg->in_addr[k] = BS_NO_ADDR;
+    for (k = 0; k < BS_MAX_OR; k++)
+        cfg->or_addr[k] = BS_NO_ADDR;
+
+    if (target != NULL)
+    {
+        id = get_instr_id(target);
+        cfg->fu_op = get_operation_index(get_instr_op(target));
+        cfg->op_id = id;
+
+        // Inputs
+        for (n = 0; n < get_n_inputs(target) && n_i < BS_MAX_FU_INPUTS; n++)
+        {
+            getInputDirection(c, i, j, n, directions, placed);
+            for (k = 0; k < 6; k++)
+            {
+                if (directions[k] > 0)
+                {
+                    cfg->in_sel[n_i] = k + 1;
+                    if (k + 1 == BS_SRC_LRF)
+                        cfg->in_addr[n_i] = getAddress(getPrevModuloSlice(c), i, j, placed[id - 1][2] - 1, get_instr_id(get_input(target, n)));
+                    n_i++;
+                    directions[k] = 0;
+                    break;
+                }
+            }
+        }
+
+        // Recurrences
+        recArr = getInputRecArr(c, d, target);
+        for (n = 0; n < recArr[0] && n_i < BS_MAX_FU_INPUTS; n++)
+        {
+            dist = get_rec_dist_from_instr(get_instr_by_op_id(d, recArr[n + 1]), target);
+            getRecDirection(c, i, j, recArr[n + 1], dist, directions, placed);
+            for (k = 0; k < 6; k++)
+            {
+                if (directions[k] > 0)
+                {
+                    cfg->in_sel[n_i] = k + 1;
+                    if (k + 1 == BS_SRC_LRF)
+                    {
+                        addr_time = placed[id - 1][2] - 1 + get_n_cgra_slices(getFirstSlice(c)) * dist;
+                        cfg->in_addr[n_i] = getAddress(getPrevModuloSlice(c), i, j, addr_time, recArr[n + 1]);
+                    }
+                    n_i++;
+                    directions[k] = 0;
+                    break;
+                }
+            }
+        }
+        free(recArr);
+
+        // Constants
+        for (n = 0; n < get_n_consts(target) && n_i < BS_MAX_FU_INPUTS; n++, n_i++)
+        {
+            cfg->in_sel[n_i] = BS_SRC_CONST;
+            cfg->consts[n_i] = get_const_val(get_const(target, n));
+            if (getCUsize(c, i, j) > 0)
+                cfg->in_addr[n_i] = getCnstAddress(c, i, j, get_instr_id(get_const(target, n)));
+            else
+                cfg->in_addr[n_i] = getAddress(c, i, j, 0, get_instr_id(get_const(target, n)));
+        }
+        cfg->n_inputs = n_i;
+    }
+
+    // Output registers, renamed so that the ones fed by the LRF come first
+    for (k = 0; k < n_or; k++)
+    {
+        or_src[k] = getOutputDirection(c, i, j, placed, k);
+        or_lut[k] = or_src[k] == BS_SRC_LRF ? cnt_id++ : -1;
+    }
+    for (k = 0; k < n_or; k++)
+    {
+        if (or_lut[k] == -1)
+            or_lut[k] = cnt_id++;
+    }
+    cfg->n_or = n_or < BS_MAX_OR ? n_or : BS_MAX_OR;
+    for (k = 0; k < n_or; k++)
+    {
+        if (or_lut[k] >= BS_MAX_OR)
+            continue;
+        cfg->or_sel[or_lut[k]] = or_src[k] > 0 ? or_src[k] : BS_SRC_NONE;
+        if (or_src[k] == BS_SRC_LRF)
+            cfg->or_addr[or_lut[k]] = getAddressNoTime(getPrevModuloSlice(c), i, j, getOutputRegister(c, i, j, k));
+    }
+
+    getOutPortSels(c, i, j, placed, outPortSel, or_lut);
+    for (k = 0; k < 4; k++)
+        cfg->out_port_sel[k] = outPortSel[k];
+
+    // LRF write
+    if (getRFAccess(c, i, j) > 0)
+    {
+        k = getLRFAccessDirection(c, i, j);
+        cfg->lrf_wr_port = k > 0 ? k : BS_SRC_NONE;
+        cfg->lrf_wr_addr = getAddressNoTime(c, i, j, getRFAccess(c, i, j));
+    }
+
+    free(or_lut);
+    free(or_src);
+}
+
+void fill_io_entry(cgra *c, int i, int j, int **placed, bs_io_entry *io)
+{
+    dfg_instr *target = get_cgra_tile(c, i, j);
+
+    memset(io, 0, sizeof(bs_io_entry));
+    io->row = i;
+    io->col = j;
+    io->connects_to = -1;
+    io->cycle_start = -1;
+
+    if (target == NULL || !isIO(target))
+        return;
+
+    io->op_id = get_instr_id(target);
+    if (!strcmp(get_instr_op(target), "STREAM_IN"))
+    {
+        io->type = BS_IO_INPUT;
+        io->connects_to = hasConnectedPEs(c, i, j);
+        io->cycle_start = placed[io->op_id - 1][2];
+    }
+    else if (!strcmp(get_instr_op(target), "STREAM_OUT"))
+    {
+        io->type = BS_IO_OUTPUT;
+        io->connects_to = ioConnectsToPE(c, i, j);
+    }
+}
+
+/**************************************************************************************
+ * write_bitstream
+ * Inputs: mapped device, dfg, placement info array, output path, vector width and the
+ * content hashes recorded in the header (0 if unused)
+ * Writes the binary configuration bitstream of the mapped device to <path>.
+ * Return values: success ? 0 : -1
+ *************************************************************************************/
+int write_bitstream(cgra *fs, dfg *d, int **placed, const char *path, int vectorWidth, uint64_t dfg_hash, uint64_t device_hash)
+{
+    bs_header h;
+    cgra *c;
+    FILE *f;
+    unsigned char *buf;
+    int i, j, s, k, II, L, C, n_or, rf, cu, pe_idx, io_idx, *conn_counts, *words;
+
+    fs = getFirstSlice(fs);
+    II = get_n_cgra_slices(fs);
+    L = get_cgra_L(fs);
+    C = get_cgra_C(fs);
+
+    memset(&h, 0, sizeof(bs_header));
+    memcpy(h.magic, BS_MAGIC, sizeof(BS_MAGIC));
+    h.version = BS_VERSION;
+    h.endian_tag = BS_ENDIAN_TAG;
+    h.header_size = sizeof(bs_header);
+    h.pe_rec_size = sizeof(bs_pe_config);
+    h.io_rec_size = sizeof(bs_io_entry);
+    h.L = L;
+    h.C = C;
+    h.II = II;
+    h.MII = getDeviceMII(fs);
+    h.dfg_size = get_dfg_size(d);
+    h.vector_width = vectorWidth;
+    h.data_width = getDataWidth(fs);
+    h.exec_time = get_execution_time(fs);
+    h.mapping_flag = get_mapping(fs);
+    h.dfg_hash = dfg_hash;
+    h.device_hash = device_hash;
+
+    for (i = 0; i < L; i++)
+    {
+        for (j = 0; j < C; j++)
+        {
+            if (isPE(fs, i, j))
+                h.n_pes++;
+            else if (isStreamPort(fs, i, j))
+                h.n_ios++;
+        }
+    }
+
+    get_max_pe_resources(fs, &n_or, &rf, &cu);
+    h.n_or = n_or;
+    h.rf_size = rf;
+    h.cu_size = cu;
+    h.state_words = get_pe_state_words(n_or, rf, cu);
+
+    conn_counts = (int *)calloc(II, sizeof(int));
+    for (s = 0, c = fs; s < II; s++, c = get_next_slice(c))
+    {
+        conn_counts[s] = pack_conn_states(c, NULL);
+        h.n_conns += conn_counts[s];
+    }
+
+    // Section offsets
+    h.pe_index_off = BS_ALIGN(sizeof(bs_header));
+    h.config_off = BS_ALIGN(h.pe_index_off + h.n_pes * sizeof(int32_t));
+    h.io_off = BS_ALIGN(h.config_off + (uint64_t)II * h.n_pes * sizeof(bs_pe_config));
+    h.placement_off = BS_ALIGN(h.io_off + (uint64_t)II * h.n_ios * sizeof(bs_io_entry));
+    h.state_off = BS_ALIGN(h.placement_off + (uint64_t)h.dfg_size * BS_PLACED_WORDS * sizeof(int32_t));
+    h.conn_off = BS_ALIGN(h.state_off + (uint64_t)II * L * C * h.state_words * sizeof(int32_t));
+    h.file_size = BS_ALIGN(h.conn_off + (uint64_t)(II + h.n_conns * BS_CONN_WORDS) * sizeof(int32_t));
+
+    buf = (unsigned char *)calloc(h.file_size, 1);
+    if (buf == NULL)
+    {
+        printf("ERROR: Could not allocate the bitstream buffer.\n");
+        free(conn_counts);
+        return -1;
+    }
+
+    // PE index, configuration records and IO tables
+    for (s = 0, c = fs; s < II; s++, c = get_next_slice(c))
+    {
+        pe_idx = 0;
+        io_idx = 0;
+        for (i = 0; i < L; i++)
+        {
+            for (j = 0; j < C; j++)
+            {
+                if (isPE(fs, i, j))
+                {
+                    if (s == 0)
+                        ((int32_t *)(buf + h.pe_index_off))[pe_idx] = i * C + j;
+                    fill_pe_config(c, d, i, j, placed, (bs_pe_config *)(buf + h.config_off) + (s * h.n_pes + pe_idx));
+                    pe_idx++;
+                }
+                else if (isStreamPort(fs, i, j))
+                {
+                    fill_io_entry(c, i, j, placed, (bs_io_entry *)(buf + h.io_off) + (s * h.n_ios + io_idx));
+                    io_idx++;
+                }
+            }
+        }
+    }
+
+    // Placement info
+    words = (int *)(buf + h.placement_off);
+    for (k = 0; k < h.dfg_size; k++)
+        for (i = 0; i < BS_PLACED_WORDS; i++)
+            words[k * BS_PLACED_WORDS + i] = placed[k][i];
+
+    // Mapping state
+    words = (int *)(buf + h.state_off);
+    for (s = 0, c = fs; s < II; s++, c = get_next_slice(c))
+        for (i = 0; i < L; i++)
+            for (j = 0; j < C; j++)
+                pack_pe_state(c, i, j, words + ((s * L + i) * C + j) * h.state_words, n_or, rf, cu);
+
+    words = (int *)(buf + h.conn_off);
+    for (s = 0; s < II; s++)
+        words[s] = conn_counts[s];
+    words += II;
+    for (s = 0, c = fs; s < II; s++, c = get_next_slice(c))
+        words += pack_conn_states(c, words) * BS_CONN_WORDS;
+
+    h.checksum = fnv1a_hash(buf + sizeof(bs_header), h.file_size - sizeof(bs_header), FNV_OFFSET_BASIS);
+    memcpy(buf, &h, sizeof(bs_header));
+
+    f = fopen(path, "wb");
+    if (f == NULL || fwrite(buf, 1, h.file_size, f) != h.file_size)
+    {
+        printf("ERROR: Could not write the bitstream file '%s'.\n", path);
+        if (f != NULL)
+            fclose(f);
+        free(buf);
+        free(conn_counts);
+        return -1;
+    }
+    fclose(f);
+
+    free(buf);
+    free(conn_counts);
+    return 0;
+}
+
+/**************************************************************************************
+ * exportBitstream
+ * Inputs: mapped device, dfg, placement info array, output file name and vector width
+ * Exports the mapping results to a binary configuration bitstream (<filename>.mbs).
+ * Return values: success ? 0 : -1
+ *************************************************************************************/
+int exportBitstream(cgra *fs, dfg *d, int ***placed, char *filename, int vectorWidth)
+{
+    char *bsFilename = (char *)calloc(strlen(filename) + 5, sizeof(char));
+    int status;
+
+    sprintf(bsFilename, "%s.mbs", filename);
+    status = write_bitstream(fs, d, *placed, bsFilename, vectorWidth, hash_dfg(d), 0);
+    free(bsFilename);
+
+    if (status == 0)
+        printf("Bitstream file generated!\n");
+    return status;
+}
+
+/**
+ * Returns 1 (true) if a section of n x m records of rec_size bytes, starting at off, lies
+ * after prev_end and inside the file. Sets *end to the first byte after the section.
+ */
+static int section_fits(uint64_t off, uint64_t prev_end, uint64_t file_size, uint64_t n, uint64_t m, uint64_t rec_size,
+                        uint64_t *end)
+{
+    uint64_t avail;
+
+    if (off < prev_end || off > file_size)
+        return 0;
+    avail = (file_size - off) / rec_size;
+    if (m != 0 && n > avail / m)
+        return 0;
+    *end = off + n * m * rec_size;
+    return 1;
+}
+
+/**
+ * Returns 1 (true) if the counts and section table of the header describe a well-formed
+ * file of the given size: every section in layout order and inside the file.
+ */
+static int valid_section_table(const bs_header *h, uint64_t file_size)
+{
+    uint64_t end;
+
+    if (h->file_size != file_size || h->L <= 0 || h->C <= 0 || h->II <= 0 || h->n_pes < 0 || h->n_ios < 0 ||
+        (uint64_t)h->n_pes + h->n_ios > (uint64_t)h->L * h->C || h->dfg_size < 0 || h->n_conns < 0 ||
+        h->n_or < 0 || h->n_or > BS_MAX_PE_RESOURCES || h->rf_size < 0 || h->rf_size > BS_MAX_PE_RESOURCES ||
+        h->cu_size < 0 || h->cu_size > BS_MAX_PE_RESOURCES ||
+        h->state_words != get_pe_state_words(h->n_or, h->rf_size, h->cu_size))
+        return 0;
+
+    return section_fits(h->pe_index_off, sizeof(bs_header), file_size, h->n_pes, 1, sizeof(int32_t), &end) &&
+           section_fits(h->config_off, end, file_size, h->II, h->n_pes, sizeof(bs_pe_config), &end) &&
+           section_fits(h->io_off, end, file_size, h->II, h->n_ios, sizeof(bs_io_entry), &end) &&
+           section_fits(h->placement_off, end, file_size, h->dfg_size, BS_PLACED_WORDS, sizeof(int32_t), &end) &&
+           section_fits(h->state_off, end, file_size, h->II, (uint64_t)h->L * h->C, h->state_words * sizeof(int32_t), &end) &&
+           section_fits(h->conn_off, end, file_size, 1, (uint64_t)h->II + (uint64_t)h->n_conns * BS_CONN_WORDS, sizeof(int32_t), &end);
+}
+
+/**
+ * Returns 1 (true) if the PE index holds valid grid positions and the per context record
+ * counts of the connection section add up to n_conns.
+ */
+static int valid_section_contents(const unsigned char *base, const bs_header *h)
+{
+    const int32_t *pe_index = (const int32_t *)(base + h->pe_index_off), *conns = (const int32_t *)(base + h->conn_off);
+    int64_t total = 0;
+    int k;
+
+    for (k = 0; k < h->n_pes; k++)
+        if (pe_index[k] < 0 || pe_index[k] >= h->L * h->C)
+            return 0;
+    for (k = 0; k < h->II; k++)
+    {
+        if (conns[k] < 0)
+            return 0;
+        total += conns[k];
+    }
+    return total == h->n_conns;
+}
+
+/**************************************************************************************
+ * open_bitstream
+ * Maps a bitstream file into memory (read-only) and validates its header, section
+ * bounds and contents, and checksum.
+ * Return values: bitstream handle, or NULL if the file is missing or invalid
+ *************************************************************************************/
+bitstream *open_bitstream(const char *filename)
+{
+    struct stat st;
+    const bs_header *h;
+    bitstream *bs;
+    void *base;
+    int fd = open(filename, O_RDONLY);
+
+    if (fd < 0)
+    {
+        printf("Could not open bitstream file '%s'.\n", filename);
+        return NULL;
+    }
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(bs_header))
+    {
+        printf("ERROR: '%s' is not a valid bitstream file.\n", filename);
+        close(fd);
+        return NULL;
+    }
+
+    base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (base == MAP_FAILED)
+    {
+        printf("ERROR: Could not map bitstream file '%s'.\n", filename);
+        close(fd);
+        return NULL;
+    }
+
+    h = (const bs_header *)base;
+    if (memcmp(h->magic, BS_MAGIC, sizeof(BS_MAGIC)) != 0 || h->endian_tag != BS_ENDIAN_TAG)
+    {
+        printf("ERROR: '%s' is not a valid bitstream file.\n", filename);
+        goto invalid;
+    }
+    if (h->version != BS_VERSION || h->header_size != sizeof(bs_header) ||
+        h->pe_rec_size != sizeof(bs_pe_config) || h->io_rec_size != sizeof(bs_io_entry))
+    {
+        printf("ERROR: Unsupported bitstream version (%u) in '%s'.\n", h->version, filename);
+        goto invalid;
+    }
+    if (!valid_section_table(h, st.st_size))
+    {
+        printf("ERROR: Corrupted bitstream file '%s' (bad section table).\n", filename);
+        goto invalid;
+    }
+    if (fnv1a_hash((const unsigned char *)base + sizeof(bs_header), h->file_size - sizeof(bs_header), FNV_OFFSET_BASIS) != h->checksum)
+    {
+        printf("ERROR: Corrupted bitstream file '%s' (checksum mismatch).\n", filename);
+        goto invalid;
+    }
+    if (!valid_section_contents((const unsigned char *)base, h))
+    {
+        printf("ERROR: Corrupted bitstream file '%s' (bad section contents).\n", filename);
+        goto invalid;
+    }
+
+    bs = (bitstream *)malloc(sizeof(bitstream));
+    bs->fd = fd;
+    bs->size = st.st_size;
+    bs->base = (const unsigned char *)base;
+    bs->h = h;
+    return bs;
+
+invalid:
+    munmap(base, st.st_size);
+    close(fd);
+    return NULL;
+}
+
+void close_bitstream(bitstream *bs)
+{
+    if (bs == NULL)
+        return;
+    munmap((void *)bs->base, bs->size);
+    close(bs->fd);
+    free(bs);
+}
+
+const bs_header *bitstream_header(bitstream *bs)
+{
+    return bs->h;
+}
+
+const bs_pe_config *bitstream_pe_config(bitstream *bs, int ctx, int pe_idx)
+{
+    if (ctx < 0 || ctx >= bs->h->II || pe_idx < 0 || pe_idx >= bs->h->n_pes)
+        return NULL;
+    return (const bs_pe_config *)(bs->base + bs->h->config_off) + (ctx * bs->h->n_pes + pe_idx);
+}
+
+const bs_io_entry *bitstream_io_entry(bitstream *bs, int ctx, int io_idx)
+{
+    if (ctx < 0 || ctx >= bs->h->II || io_idx < 0 || io_idx >= bs->h->n_ios)
+        return NULL;
+    return (const bs_io_entry *)(bs->base + bs->h->io_off) + (ctx * bs->h->n_ios + io_idx);
+}
+
+/**************************************************************************************
+ * bitstream_to_cgra
+ * Inputs: bitstream handle, device template, the mapped dfg and a placement info array
+ * Rebuilds the mapped device on top of the template (as load_mapping does for devices
+ * in the result FIFO). The placement info array is restored if not NULL.
+ * Return values: mapped device, or NULL if the mapping does not fit the template/dfg
+ *************************************************************************************/
+cgra *bitstream_to_cgra(bitstream *bs, cgra *template, dfg *d, int **placed)
+{
+    const bs_header *h = bs->h;
+    const int *states = (const int *)(bs->base + h->state_off), *conns = (const int *)(bs->base + h->conn_off);
+    const int *rec = conns + h->II, *words;
+    int s, i, j, k, invalid = 0;
+    cgra *load, *c;
+
+    if (get_cgra_L(template) != h->L || get_cgra_C(template) != h->C)
+    {
+        printf("ERROR: Bitstream was generated for a %dx%d device, but the template is %dx%d.\n",
+               h->L, h->C, get_cgra_L(template), get_cgra_C(template));
+        return NULL;
+    }
+    if (d == NULL || get_dfg_size(d) != h->dfg_size || hash_dfg(d) != h->dfg_hash)
+    {
+        printf("ERROR: Bitstream does not match the imported DFG.\n");
+        return NULL;
+    }
+
+    load = buildBaseCGRA(template, h->II);
+    for (s = 0, c = load; s < h->II && !invalid; s++, c = get_next_slice(c))
+    {
+        for (i = 0; i < h->L && !invalid; i++)
+            for (j = 0; j < h->C && !invalid; j++)
+                invalid = !unpack_pe_state(c, d, i, j, states + ((s * h->L + i) * h->C + j) * h->state_words,
+                                           h->n_or, h->rf_size, h->cu_size);
+
+        for (k = 0; k < conns[s] && !invalid; k++, rec += BS_CONN_WORDS)
+            invalid = !unpack_conn_state(c, rec);
+
+        set_mapping(c, h->mapping_flag);
+        set_execution_time(c, h->exec_time);
+        setDeviceMII(c, h->MII);
+    }
+
+    if (invalid)
+    {
+        printf("ERROR: The mapping in the bitstream cannot be loaded onto the current device template.\n");
+        delete_cgra(load);
+        return NULL;
+    }
+
+    if (placed != NULL)
+    {
+        words = (const int *)(bs->base + h->placement_off);
+        for (k = 0; k < h->dfg_size; k++)
+            for (i = 0; i < BS_PLACED_WORDS; i++)
+                placed[k][i] = words[k * BS_PLACED_WORDS + i];
+    }
+
+    return load;
+}
+
+cgra *importBitstream(cgra *template, dfg *d, int **placed, char *filename)
+{
+    bitstream *bs = open_bitstream(filename);
+    cgra *c;
+
+    if (bs == NULL)
+        return NULL;
+    c = bitstream_to_cgra(bs, template, d, placed);
+    if (c != NULL)
+        printf("Loaded mapping with II = %d from '%s'.\n", bs->h->II, filename);
+    close_bitstream(bs);
+    return c;
+}
+
+/**************************************************************************************
+ * diffBitstreams
+ * Compares the configuration records of two bitstreams, context by context.
+ * Return values: number of differing PE/IO records, or -1 if they are not comparable
+ *************************************************************************************/
+int diffBitstreams(char *filename1, char *filename2, int verbose)
+{
+    bitstream *a = open_bitstream(filename1), *b = open_bitstream(filename2);
+    const bs_pe_config *ca, *cb;
+    int s, k, pos, n_diff = 0;
+
+    if (a == NULL || b == NULL)
+    {
+        close_bitstream(a);
+        close_bitstream(b);
+        return -1;
+    }
+
+    if (a->h->L != b->h->L || a->h->C != b->h->C || a->h->n_pes != b->h->n_pes || a->h->n_ios != b->h->n_ios ||
+        memcmp(a->base + a->h->pe_index_off, b->base + b->h->pe_index_off, a->h->n_pes * sizeof(int32_t)) != 0)
+    {
+        printf("Bitstreams target different devices.\n");
+        close_bitstream(a);
+        close_bitstream(b);
+        return -1;
+    }
+
+    if (a->h->II != b->h->II)
+        printf("II differs: %d vs %d.\n", a->h->II, b->h->II);
+
+    for (s = 0; s < a->h->II && s < b->h->II; s++)
+    {
+        for (k = 0; k < a->h->n_pes; k++)
+        {
+            ca = bitstream_pe_config(a, s, k);
+            cb = bitstream_pe_config(b, s, k);
+            if (memcmp(ca, cb, sizeof(bs_pe_config)) == 0)
+                continue;
+            n_diff++;
+            if (verbose)
+            {
+                pos = ((const int32_t *)(a->base + a->h->pe_index_off))[k];
+                printf("\tContext %d, PE [%d,%d]: %s -> %s\n", s, pos / a->h->C, pos % a->h->C,
+                       ca->fu_op == BS_OP_NONE ? "None" : get_operation(ca->fu_op),
+                       cb->fu_op == BS_OP_NONE ? "None" : get_operation(cb->fu_op));
+            }
+        }
+        for (k = 0; k < a->h->n_ios; k++)
+        {
+            if (memcmp(bitstream_io_entry(a, s, k), bitstream_io_entry(b, s, k), sizeof(bs_io_entry)) != 0)
+                n_diff++;
+        }
+    }
+
+    printf("\033[1;33mBitstream Diff:\033[0;0m %d differing configuration records.\n", n_diff);
+    close_bitstream(a);
+    close_bitstream(b);
+    return n_diff;
+}
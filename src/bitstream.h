@@ -0,0 +1,128 @@
+#ifndef BITSTREAM_H
+#define BITSTREAM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "cgra.h"
+
+/**********************************************************************************************
+ * MIDAS Binary Configuration Bitstream (.mbs)
+ * Layout (native byte order, checked through the endianness tag):
+ *  [header]
+ *  [PE index]      n_pes x int32 (i * C + j)
+ *  [PE configs]    II x n_pes x bs_pe_config (fixed width, one record per PE per context)
+ *  [IO tables]     II x n_ios x bs_io_entry
+ *  [placement]     dfg_size x BS_PLACED_WORDS int32 (placed array)
+ *  [PE states]     II x L x C x state_words int32 (mapping state, see pack_pe_state)
+ *  [connections]   II x int32 (records per context) + n_conns x BS_CONN_WORDS int32
+ * The checksum (FNV-1a) covers every byte after the header.
+ *********************************************************************************************/
+
+#define BS_MAGIC "MIDASBS"
+#define BS_VERSION 3
+#define BS_ENDIAN_TAG 0x01020304
+
+#define BS_MAX_FU_INPUTS 4
+#define BS_MAX_OR 8
+#define BS_PLACED_WORDS 5
+#define BS_CONN_WORDS 12
+
+#define BS_OP_NONE 0xFFFF
+#define BS_NO_ADDR -1
+
+#define FNV_OFFSET_BASIS 0xcbf29ce484222325ULL
+#define FNV_PRIME 0x100000001b3ULL
+
+// Source selects (same encoding as the JSON export's direction strings)
+#define BS_SRC_NONE 0
+#define BS_SRC_NORTH 1
+#define BS_SRC_WEST 2
+#define BS_SRC_SOUTH 3
+#define BS_SRC_EAST 4
+#define BS_SRC_FU 5
+#define BS_SRC_LRF 6
+#define BS_SRC_CONST 7
+
+// IO types
+#define BS_IO_NONE 0
+#define BS_IO_INPUT 1
+#define BS_IO_OUTPUT 2
+#define BS_IO_INOUT 3
+
+typedef struct _bs_header
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t endian_tag;
+    uint32_t header_size;
+    uint32_t pe_rec_size;
+    uint32_t io_rec_size;
+    int32_t L;
+    int32_t C;
+    int32_t II;
+    int32_t MII;
+    int32_t n_pes;
+    int32_t n_ios;
+    int32_t dfg_size;
+    int32_t vector_width;
+    int32_t data_width;
+    int32_t exec_time;
+    int32_t mapping_flag;
+    int32_t n_or;
+    int32_t rf_size;
+    int32_t cu_size;
+    int32_t state_words;
+    int32_t n_conns;
+    int32_t reserved;
+    uint64_t pe_index_off;
+    uint64_t config_off;
+    uint64_t io_off;
+    uint64_t placement_off;
+    uint64_t state_off;
+    uint64_t conn_off;
+    uint64_t file_size;
+    uint64_t checksum;
+    uint64_t dfg_hash;    // content hash of the mapped dfg (hash_dfg)
+    uint64_t device_hash; // content hash of the device template, set by the mapping cache (0 for plain exports)
+} bs_header;
+
+typedef struct _bs_pe_config
+{
+    uint16_t fu_op;                     // operation index, BS_OP_NONE when the FU is idle
+    uint16_t op_id;                     // DFG node id
+    uint8_t power;                      // POWER_ON / POWER_OFF
+    uint8_t n_inputs;                   // inputs used (incl. recurrences and constants)
+    uint8_t lrf_wr_port;                // source written to the LRF in this context
+    uint8_t n_or;                       // output registers described
+    uint8_t in_sel[BS_MAX_FU_INPUTS];   // FU input mux selects
+    int16_t in_addr[BS_MAX_FU_INPUTS];  // LRF/CU read address per input
+    int16_t lrf_wr_addr;                // LRF write address
+    int8_t out_port_sel[4];             // N, W, S, E output port selects (output register index)
+    uint8_t or_sel[BS_MAX_OR];          // output register mux selects
+    int16_t or_addr[BS_MAX_OR];         // LRF read address feeding each output register
+    int32_t consts[BS_MAX_FU_INPUTS];   // constant values, per input
+} bs_pe_config;
+
+typedef struct _bs_io_entry
+{
+    int16_t row;
+    int16_t col;
+    uint8_t type;
+    uint8_t pad;
+    uint16_t op_id;
+    int32_t connects_to; // i * C + j of the linked PE, -1 if none
+    int32_t cycle_start;
+} bs_io_entry;
+
+typedef struct _bitstream bitstream;
+
+bitstream *open_bitstream(const char *filename);
+void close_bitstream(bitstream *bs);
+const bs_header *bitstream_header(bitstream *bs);
+const bs_pe_config *bitstream_pe_config(bitstream *bs, int ctx, int pe_idx);
+const bs_io_entry *bitstream_io_entry(bitstream *bs, int ctx, int io_idx);
+cgra *bitstream_to_cgra(bitstream *bs, cgra *template, dfg *d, int **placed);
+int write_bitstream(cgra *fs, dfg *d, int **placed, const char *path, int vectorWidth, uint64_t dfg_hash, uint64_t device_hash);
+uint64_t fnv1a_hash(const void *data, size_t size, uint64_t seed);
+
+#endif
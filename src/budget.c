@@ -0,0 +1,156 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <omp.h>
+#include "budget.h"
+
+// Budget of the mapping run executed by this thread (NULL: unbounded)
+mapping_budget *current_budget = NULL;
+
+/**************************************************************************************
+ * parse_mapping_budget
+ * Parses the budget options of a mapping command (space separated):
+ *      budget=<time>[us|ms|s]  wall-clock limit (milliseconds if no unit is given)
+ *      expansions=<n>          limit on the routing search nodes expanded
+ * Unset limits are returned as 0 (no limit). A NULL/empty string sets no limits.
+ * Return values: success ? 0 : -1
+ *************************************************************************************/
+int parse_mapping_budget(const char *args, double *seconds, uint64_t *max_expansions)
+{
+    char buf[256], *tok, *end, *save = NULL;
+    double v;
+
+    *seconds = 0;
+    *max_expansions = 0;
+    if (args == NULL)
+        return 0;
+    strncpy(buf, args, sizeof(buf) - 1);
+    buf[sizeof(buf) - 1] = '\0';
+
+    for (tok = strtok_r(buf, " \t", &save); tok != NULL; tok = strtok_r(NULL, " \t", &save))
+    {
+        if (!strncmp(tok, "budget=", 7))
+        {
+            v = strtod(tok + 7, &end);
+            if (end == tok + 7 || v <= 0)
+                return -1;
+            if (!strcmp(end, "us"))
+                v *= 1e-6;
+            else if (!strcmp(end, "ms") || *end == '\0')
+                v *= 1e-3;
+            else if (strcmp(end, "s"))
+                return -1;
+            *seconds = v;
+        }
+        else if (!strncmp(tok, "expansions=", 11))
+        {
+            *max_expansions = strtoull(tok + 11, &end, 10);
+            if (end == tok + 11 || *end != '\0' || *max_expansions == 0)
+                return -1;
+        }
+        else
+            return -1;
+    }
+    return 0;
+}
+
+/**************************************************************************************
+ * start_mapping_budget
+ * Arms the budget b from this moment on and attaches it to the calling thread. A limit
+ * of 0 disables the corresponding check; if both are 0, the budget is inactive.
+ *************************************************************************************/
+void start_mapping_budget(mapping_budget *b, double seconds, uint64_t max_expansions)
+{
+    memset(b, 0, sizeof(mapping_budget));
+    b->seconds = seconds;
+    b->max_expansions = max_expansions;
+    b->start = omp_get_wtime();
+    b->active = seconds > 0 || max_expansions > 0;
+    current_budget = b;
+}
+
+// Detaches the budget from the calling thread
+void stop_mapping_budget(void)
+{
+    current_budget = NULL;
+}
+
+mapping_budget *get_mapping_budget(void)
+{
+    return current_budget;
+}
+
+/**
+ * Attaches b (which may be NULL) to the calling thread, e.g. a worker of a parallel mapper
+ * Return values: budget attached before, to be restored when the worker is done
+ */
+mapping_budget *attach_mapping_budget(mapping_budget *b)
+{
+    mapping_budget *prev = current_budget;
+
+    current_budget = b;
+    return prev;
+}
+
+int mapping_budget_active(void)
+{
+    return current_budget != NULL && current_budget->active;
+}
+
+int mapping_budget_expired(void)
+{
+    mapping_budget *b = current_budget;
+
+    if (b == NULL || !b->active)
+        return 0;
+    if (__atomic_load_n(&b->expired, __ATOMIC_RELAXED))
+        return 1;
+    if ((b->seconds > 0 && omp_get_wtime() - b->start >= b->seconds) ||
+        (b->max_expansions > 0 && __atomic_load_n(&b->expansions, __ATOMIC_RELAXED) >= b->max_expansions))
+    {
+        __atomic_store_n(&b->expired, 1, __ATOMIC_RELAXED);
+        return 1;
+    }
+    return 0;
+}
+
+/**************************************************************************************
+ * budget_note_progress
+ * Records how far the mapper got: the current II and the most nodes mapped with it.
+ *************************************************************************************/
+void budget_note_progress(int II, int mapped, int total)
+{
+    mapping_budget *b = current_budget;
+
+    if (b == NULL || !b->active)
+        return;
+    // The workers of a parallel mapper report to the same budget
+#pragma omp critical(budget_progress)
+    {
+        if (II != b->progress_II)
+        {
+            b->progress_II = II;
+            b->progress_mapped = 0;
+            b->progress_total = total;
+        }
+        // The count and the size are kept from the same dfg (parallel mappers may map dfgs of different sizes)
+        if (mapped > b->progress_mapped)
+        {
+            b->progress_mapped = mapped;
+            b->progress_total = total;
+        }
+    }
+}
+
+void print_budget_report(void)
+{
+    mapping_budget *b = current_budget;
+
+    if (b == NULL || !b->active)
+        return;
+    printf("Mapping budget %s after %.1lf ms and %llu routing expansions.", b->expired ? "expired" : "not exhausted",
+           (omp_get_wtime() - b->start) * 1e3, (unsigned long long)b->expansions);
+    if (b->expired && b->progress_total > 0)
+        printf(" Reached II = %d, with up to %d of %d nodes mapped.", b->progress_II, b->progress_mapped, b->progress_total);
+    printf("\n");
+}
@@ -0,0 +1,46 @@
+#ifndef BUDGET_H
+#define BUDGET_H
+
+#include <stdint.h>
+
+/**********************************************************************************************
+ * Mapping Budget
+ * Bounds the runtime of a mapping run, in wall-clock time and/or in effort (routing search
+ * nodes expanded by routeInTime). The mappers poll mapping_budget_expired() in their main
+ * loops and, once it expires, stop and return the best legal mapping found so far (or NULL).
+ * Expiration is sticky until the budget is stopped or restarted.
+ * Each mapping run owns its budget, which is attached to the thread that starts it; the
+ * parallel regions of a run attach it to their threads (attach_mapping_budget), so that
+ * concurrent runs (e.g. mapping server requests) never share limits or counters. A thread
+ * without a budget is unbounded.
+ *********************************************************************************************/
+
+typedef struct
+{
+    int active, expired;
+    double start, seconds;
+    uint64_t max_expansions, expansions;
+    int progress_II, progress_mapped, progress_total;
+} mapping_budget;
+
+extern mapping_budget *current_budget;
+#pragma omp threadprivate(current_budget)
+
+#define BUDGET_EXPAND()                                                                  \
+    do                                                                                   \
+    {                                                                                    \
+        if (current_budget != NULL)                                                      \
+            __atomic_fetch_add(&current_budget->expansions, 1, __ATOMIC_RELAXED);        \
+    } while (0)
+
+int parse_mapping_budget(const char *args, double *seconds, uint64_t *max_expansions);
+void start_mapping_budget(mapping_budget *b, double seconds, uint64_t max_expansions);
+void stop_mapping_budget(void);
+mapping_budget *get_mapping_budget(void);
+mapping_budget *attach_mapping_budget(mapping_budget *b);
+int mapping_budget_active(void);
+int mapping_budget_expired(void);
+void budget_note_progress(int II, int mapped, int total);
+void print_budget_report(void);
+
+#endif
@@ -8,6 +8,7 @@
 #include "dfg.h"
 #include "pqueue.h"
 #include "ops.h"
+#include "stats.h"
 
 #define FUNCTS ((MAX_OPS + 63) / 64) // number of possible PE functions (different "PE types")
 #define SET_FUNCT(fu, op_index) ((fu)->functs[(op_index) / 64] |= (1ULL << ((op_index) % 64)))
@@ -25,6 +26,42 @@
 
 #define INFINITY __INT_MAX__
 
+// Neighbour directions (must match cgra.h)
+#define NBR_DIR_N 0
+#define NBR_DIR_NE 1
+#define NBR_DIR_E 2
+#define NBR_DIR_SE 3
+#define NBR_DIR_S 4
+#define NBR_DIR_SW 5
+#define NBR_DIR_W 6
+#define NBR_DIR_NW 7
+#define NBR_DIR_SELF 8
+#define NBR_DIR_FAR 9
+
+// interconnect neighbour (must match cgra.h)
+typedef struct
+{
+    int pos; // i * C + j
+    int lat; // connection latency
+    int dir; // NBR_DIR_*
+} pe_neighbour;
+
+// proposed changes to a PE (must match cgra.h)
+#define PRUNE_KEEP -1
+
+typedef struct
+{
+    int remove;
+    int rf_size;
+    int n_output_registers;
+    int rf_ports_to_fu;
+    int rf_ports_to_ors;
+    int fu_inputs;
+    int n_rmv_links;
+    const int *rmv_ops;
+    int n_rmv_ops;
+} pe_prune;
+
 // space-time point
 typedef struct _stp
 {
@@ -64,14 +101,64 @@ typedef struct _pe
 
     rfReadPorts rfPortsToOutputRegisters; // defines the RF output ports linked to output registers
     rfReadPorts rfPortsToInputMuxes;      // defines the RF output ports linked to the FU (FU's input muxes)
+
+    // Cached area/power estimates (see PE Cost Cache). Dropped whenever the functs, RF, ports or inputs change
+    int costValid;
+    float areaCost;
+    float powerCost;
 } pe;
 
+/**
+ * Checks if a PE can execute an operation. Route-through nodes (OP_ROUTE) only forward a value through the FU,
+ * so every compute PE (one with some FU operation) supports them, without listing them among its functs.
+ */
+static int pe_can_exec(pe *p, int op)
+{
+    int k;
+
+    if (op != OP_ROUTE)
+        return HAS_FUNCT(p, op);
+    for (k = OP_ADD; k < OP_ROUTE; k++)
+        if (HAS_FUNCT(p, k))
+            return 1;
+    return 0;
+}
+
+/**
+ * Packed (CSR) neighbour lists of every PE, built once from the adjacency matrix (lats):
+ * in[in_offsets[p] .. in_offsets[p + 1]) are the PEs that drive PE p (lats[p][k] < INFINITY),
+ * out[out_offsets[p] .. out_offsets[p + 1]) are the PEs driven by PE p. Ordered by position.
+ * Copies of a device share the table (reference counted); changing lats drops it.
+ */
+typedef struct _nbr_table
+{
+    int refs;
+    int *in_offsets;
+    int *out_offsets;
+    pe_neighbour *in;
+    pe_neighbour *out;
+} nbr_table;
+
+/**
+ * Packed (CSR) lists of the PEs that support each operation, built once from the PE functs:
+ * pes[offsets[op] .. offsets[op + 1]) are the positions (i * C + j) of the PEs with the op, in position
+ * order. Copies of a device share the table (reference counted); changing the functs drops it.
+ */
+typedef struct _op_pe_table
+{
+    int refs;
+    int offsets[MAX_OPS + 1];
+    int *pes;
+} op_pe_table;
+
 typedef struct _cgra
 {
     pe ***grid; // PE Tile grid
 
     // Interconnects
     int **lats;        // PE interconnect adjacency matrix
+    struct _nbr_table *nbrs; // packed neighbour lists, built from lats (shared between copies, read-only)
+    struct _op_pe_table *op_pes; // PEs capable of each operation, built from the functs (shared between copies, read-only)
     int ***new_states; // states matrix. stores the operations that are using the connection (can only be used to route 1 value at a time)
 
     // PE shell multiplexers, essentially
@@ -92,6 +179,13 @@ typedef struct _cgra
     int se_ld;                // Streaming Engine Load Bandwidth (in Bytes/cycle)
     int se_st;                // Streaming Engine Store Bandwidth (in Bytes/cycle)
     int data_width;           // Data Width (in Bytes)
+
+    // Device area/power totals, kept up to date from the per-PE cost caches
+    double area_total;
+    double power_total;
+    int costs_summed; // 1 if the totals hold the cost of every PE with a valid cache
+    int costs_stale;  // 1 if some PE cache was dropped after the totals were summed
+
     struct _cgra *next_slice; // next slice (in time)
     struct _cgra *prev_slice; // previous slice (in time)
 } cgra;
@@ -132,6 +226,10 @@ pe *create_pe()
     new->rfPortsToInputMuxes.val = NULL;
     new->rfPortsToInputMuxes.t = NULL;
 
+    new->costValid = 0;
+    new->areaCost = 0;
+    new->powerCost = 0;
+
     int i;
 
     for (i = 0; i < FUNCTS; i++)
@@ -317,6 +415,11 @@ pe *copy_pe_params(pe *target)
         copy->rfPortsToOutputRegisters.t = NULL;
     }
 
+    // The cost depends on the neighbours at the new position
+    copy->costValid = 0;
+    copy->areaCost = 0;
+    copy->powerCost = 0;
+
     return copy;
 }
 
@@ -362,6 +465,140 @@ void delete_pe(pe *p)
         free(p);
 }
 
+/**************************************************
+ * PE Cost Cache
+ * Each PE caches its area/power estimates, and the device keeps their totals. Changing a PE's
+ * functs, RF, output registers, ports or input links drops its cache and takes its old cost out of
+ * the totals; get_cgra_area_estimate/get_cgra_power_estimate then only recompute the dropped PEs.
+ *************************************************/
+
+/**
+ * Must be called before the cost parameters of PE (i, j) change
+ */
+static void invalidate_pe_cost(cgra *c, int i, int j)
+{
+    pe *p = c->grid[i][j];
+
+    if (p == NULL || !p->costValid)
+        return;
+    if (c->costs_summed)
+    {
+        c->area_total -= p->areaCost * 1.05;
+        c->power_total -= p->powerCost;
+    }
+    p->costValid = 0;
+    c->costs_stale = 1;
+}
+
+/**
+ * Must be called when the cost of every PE may have changed (e.g. the whole interconnect was rebuilt)
+ */
+static void invalidate_cgra_costs(cgra *c)
+{
+    int i, j;
+
+    for (i = 0; i < c->L; i++)
+        for (j = 0; j < c->C; j++)
+            if (c->grid[i][j] != NULL)
+                c->grid[i][j]->costValid = 0;
+    c->costs_summed = 0;
+    c->costs_stale = 0;
+}
+
+/**************************************************
+ * Operation Capability Tables
+ * Placement only considers the PEs that support the operation being placed; on heterogeneous
+ * devices (e.g. a few LSUs, or a MUL column) this is a small fraction of the grid.
+ *************************************************/
+static op_pe_table *build_op_pe_table(cgra *c)
+{
+    int i, j, op, n = 0, *fill;
+    op_pe_table *t = (op_pe_table *)calloc(1, sizeof(op_pe_table));
+
+    t->refs = 1;
+    for (i = 0; i < c->L; i++)
+        for (j = 0; j < c->C; j++)
+            if (c->grid[i][j] != NULL)
+                for (op = 0; op < MAX_OPS; op++)
+                    if (pe_can_exec(c->grid[i][j], op))
+                    {
+                        t->offsets[op + 1]++;
+                        n++;
+                    }
+    for (op = 0; op < MAX_OPS; op++)
+        t->offsets[op + 1] += t->offsets[op];
+
+    t->pes = (int *)malloc((n + 1) * sizeof(int));
+    fill = (int *)malloc(MAX_OPS * sizeof(int));
+    for (op = 0; op < MAX_OPS; op++)
+        fill[op] = t->offsets[op];
+    for (i = 0; i < c->L; i++)
+        for (j = 0; j < c->C; j++)
+            if (c->grid[i][j] != NULL)
+                for (op = 0; op < MAX_OPS; op++)
+                    if (pe_can_exec(c->grid[i][j], op))
+                        t->pes[fill[op]++] = i * c->C + j;
+    free(fill);
+    return t;
+}
+
+static void release_op_pe_table(op_pe_table *t)
+{
+    if (t == NULL || __atomic_sub_fetch(&t->refs, 1, __ATOMIC_ACQ_REL) > 0)
+        return;
+    free(t->pes);
+    free(t);
+}
+
+/**
+ * Returns the operation capability table of the device, building it on first use (thread safe)
+ */
+static op_pe_table *get_op_pe_table(cgra *c)
+{
+    op_pe_table *t = __atomic_load_n(&c->op_pes, __ATOMIC_ACQUIRE);
+
+    if (t != NULL)
+        return t;
+#pragma omp critical(cgra_op_pe_table)
+    {
+        t = c->op_pes;
+        if (t == NULL)
+        {
+            t = build_op_pe_table(c);
+            __atomic_store_n(&c->op_pes, t, __ATOMIC_RELEASE);
+        }
+    }
+    return t;
+}
+
+/**
+ * Must be called whenever the functs of a PE of the device change (or a PE is removed)
+ */
+static void invalidate_op_pe_table(cgra *c)
+{
+    release_op_pe_table(c->op_pes);
+    c->op_pes = NULL;
+}
+
+/**
+ * Returns the positions (i * C + j) of the PEs that support operation op (an operation index), in position
+ * order. Power modes and occupancy are not considered. The list is owned by the device (do not free/modify)
+ * and stays valid until the functs of the device are changed.
+ */
+const int *getOpCapablePEs(cgra *c, int op, int *n)
+{
+    op_pe_table *t;
+
+    if (op < 0 || op >= MAX_OPS)
+    {
+        *n = 0;
+        return NULL;
+    }
+    t = get_op_pe_table(c);
+    *n = t->offsets[op + 1] - t->offsets[op];
+    return t->pes + t->offsets[op];
+}
+
 /**************************************************
  * CGRA Functions
  *************************************************/
@@ -401,7 +638,14 @@ cgra *create_cgra(int L, int C, int se_ld, int se_st, int dw)
     new->num_contexts_for_one_iteration = 0;
     new->mapping_flag = 0; // Not yet mapped
 
+    new->area_total = 0;
+    new->power_total = 0;
+    new->costs_summed = 0;
+    new->costs_stale = 0;
+
     // IC Grid
+    new->nbrs = NULL;
+    new->op_pes = NULL;
     new->lats = (int **)malloc(L * C * sizeof(int *));
     new->new_states = (int ***)malloc(L * C * sizeof(int **));
 
@@ -476,6 +720,8 @@ int rmvStreamFuncts(cgra *c, int i, int j)
 {
     if (c->grid[i][j] == NULL)
         return 0;
+    invalidate_pe_cost(c, i, j);
+    invalidate_op_pe_table(c);
     if (HAS_FUNCT(c->grid[i][j], OP_STREAM_IN))
         RMV_FUNCT(c->grid[i][j], OP_STREAM_IN);
     if (HAS_FUNCT(c->grid[i][j], OP_STREAM_OUT))
@@ -499,10 +745,13 @@ int isPE(cgra *c, int i, int j)
 void set_cgra_tile_funct(cgra *nc, int l, int c, int funct)
 {
     int i;
+
+    invalidate_pe_cost(nc, l, c);
+    invalidate_op_pe_table(nc);
     if (funct == OP_FULL)
     {
         SET_FUNCT(nc->grid[l][c], OP_FULL);
-        for (i = OP_ADD; i < OP_MAX; i++)
+        for (i = OP_ADD; i < OP_SHL; i++)
             SET_FUNCT(nc->grid[l][c], i);
     }
     else if (funct == OP_STREAM_IN)
@@ -530,41 +779,163 @@ void set_cgra_tile_funct(cgra *nc, int l, int c, int funct)
         for (i = OP_LOAD; i < OP_ICMP; i++)
             SET_FUNCT(nc->grid[l][c], i);
     }
-    else
+    else if (funct != OP_ROUTE) // route-through is implicit (see pe_can_exec)
     {
         SET_FUNCT(nc->grid[l][c], funct);
     }
     // nc->grid[l][c]->functs[funct] = 1;
 }
 
-int *getPENeighbours(cgra *c, int i, int j)
+/**************************************************
+ * Interconnect Neighbour Tables
+ *************************************************/
+static int nbr_direction(cgra *c, int from, int to)
 {
+    int di = to / c->C - from / c->C, dj = to % c->C - from % c->C;
 
-    int k, pos = i * c->C + j, N = 0, *neighbours = (int *)malloc((c->L * c->C + 1) * sizeof(int));
+    if (di < -1 || di > 1 || dj < -1 || dj > 1)
+        return NBR_DIR_FAR;
+    if (di == -1)
+        return dj == -1 ? NBR_DIR_NW : (dj == 0 ? NBR_DIR_N : NBR_DIR_NE);
+    if (di == 1)
+        return dj == -1 ? NBR_DIR_SW : (dj == 0 ? NBR_DIR_S : NBR_DIR_SE);
+    return dj == -1 ? NBR_DIR_W : (dj == 0 ? NBR_DIR_SELF : NBR_DIR_E);
+}
 
-    for (k = 0; k < c->L * c->C; k++)
+static nbr_table *build_nbr_table(cgra *c)
+{
+    int p, k, n = c->L * c->C, n_links = 0, *fill;
+    nbr_table *t = (nbr_table *)malloc(sizeof(nbr_table));
+
+    t->refs = 1;
+    t->in_offsets = (int *)calloc(n + 1, sizeof(int));
+    t->out_offsets = (int *)calloc(n + 1, sizeof(int));
+    for (p = 0; p < n; p++)
     {
-        if (c->lats[pos][k] < INFINITY)
+        for (k = 0; k < n; k++)
         {
-            neighbours[++N] = k;
+            if (c->lats[p][k] < INFINITY)
+            {
+                t->in_offsets[p + 1]++;
+                t->out_offsets[k + 1]++;
+                n_links++;
+            }
         }
     }
-    neighbours[0] = N;
-    return neighbours;
+    for (p = 0; p < n; p++)
+    {
+        t->in_offsets[p + 1] += t->in_offsets[p];
+        t->out_offsets[p + 1] += t->out_offsets[p];
+    }
+
+    t->in = (pe_neighbour *)malloc((n_links + 1) * sizeof(pe_neighbour));
+    t->out = (pe_neighbour *)malloc((n_links + 1) * sizeof(pe_neighbour));
+    fill = (int *)malloc(n * sizeof(int));
+    for (p = 0; p < n; p++)
+        fill[p] = t->out_offsets[p];
+    for (p = 0; p < n; p++)
+    {
+        int w = t->in_offsets[p];
+        for (k = 0; k < n; k++)
+        {
+            if (c->lats[p][k] == INFINITY)
+                continue;
+            t->in[w].pos = k;
+            t->in[w].lat = c->lats[p][k];
+            t->in[w++].dir = nbr_direction(c, p, k);
+            t->out[fill[k]].pos = p;
+            t->out[fill[k]].lat = c->lats[p][k];
+            t->out[fill[k]++].dir = nbr_direction(c, k, p);
+        }
+    }
+    free(fill);
+    return t;
 }
 
-int getNNeighboursforPE(cgra *c, int i, int j)
+static void release_nbr_table(nbr_table *t)
 {
+    if (t == NULL || __atomic_sub_fetch(&t->refs, 1, __ATOMIC_ACQ_REL) > 0)
+        return;
+    free(t->in_offsets);
+    free(t->out_offsets);
+    free(t->in);
+    free(t->out);
+    free(t);
+}
 
-    int k, pos = i * c->C + j, N = 0;
+/**
+ * Returns the neighbour table of the device, building it on first use (thread safe)
+ */
+static nbr_table *get_nbr_table(cgra *c)
+{
+    nbr_table *t = __atomic_load_n(&c->nbrs, __ATOMIC_ACQUIRE);
 
-    for (k = 0; k < c->L * c->C; k++)
+    if (t != NULL)
+        return t;
+#pragma omp critical(cgra_nbr_table)
     {
-        if (c->lats[pos][k] < INFINITY)
+        t = c->nbrs;
+        if (t == NULL)
         {
-            ++N;
+            t = build_nbr_table(c);
+            __atomic_store_n(&c->nbrs, t, __ATOMIC_RELEASE);
         }
     }
+    return t;
+}
+
+/**
+ * Must be called whenever the adjacency matrix (lats) of the device changes
+ */
+static void invalidate_nbr_table(cgra *c)
+{
+    release_nbr_table(c->nbrs);
+    c->nbrs = NULL;
+}
+
+/**
+ * Returns the PEs that drive PE (i, j), i.e. its possible sources when routing. The list is owned by the
+ * device (do not free/modify) and stays valid until the interconnect of the device is changed.
+ */
+const pe_neighbour *getPENeighbourList(cgra *c, int i, int j, int *n)
+{
+    nbr_table *t = get_nbr_table(c);
+    int pos = i * c->C + j;
+
+    *n = t->in_offsets[pos + 1] - t->in_offsets[pos];
+    return t->in + t->in_offsets[pos];
+}
+
+/**
+ * Returns the PEs driven by PE (i, j). Same ownership rules as getPENeighbourList.
+ */
+const pe_neighbour *getPEFanoutList(cgra *c, int i, int j, int *n)
+{
+    nbr_table *t = get_nbr_table(c);
+    int pos = i * c->C + j;
+
+    *n = t->out_offsets[pos + 1] - t->out_offsets[pos];
+    return t->out + t->out_offsets[pos];
+}
+
+int *getPENeighbours(cgra *c, int i, int j)
+{
+
+    int k, N;
+    const pe_neighbour *nb = getPENeighbourList(c, i, j, &N);
+    int *neighbours = (int *)malloc((N + 1) * sizeof(int));
+
+    for (k = 0; k < N; k++)
+        neighbours[k + 1] = nb[k].pos;
+    neighbours[0] = N;
+    return neighbours;
+}
+
+int getNNeighboursforPE(cgra *c, int i, int j)
+{
+    int N;
+
+    getPENeighbourList(c, i, j, &N);
     return N;
 }
 
@@ -727,16 +1098,19 @@ int getOutputRegisterTime(cgra *c, int i, int j, int idx)
 
 void initOutputRegisters(cgra *c, int i, int j, int n, int rfrp)
 {
+    invalidate_pe_cost(c, i, j);
     init_pe_n_output_registers(c->grid[i][j], n, rfrp);
 }
 
 void initLocalRegisterFile(cgra *c, int i, int j, int rfsize, int rfrp)
 {
+    invalidate_pe_cost(c, i, j);
     init_pe_registerFile(c->grid[i][j], rfsize, rfrp);
 }
 
 void initConstantUnits(cgra *c, int i, int j, int cusize)
 {
+    invalidate_pe_cost(c, i, j);
     init_pe_constantUnits(c->grid[i][j], cusize);
 }
 
@@ -1343,16 +1717,15 @@ int reserveRFReadPort(cgra *c, int i, int j, int targetStructure, int val, int t
     {
         cnt = c->grid[i][j]->rfPortsToOutputRegisters.counter;
         lmt = c->grid[i][j]->rfPortsToOutputRegisters.limit;
-        // No more ports to reserve
-        if (cnt >= lmt)
-            return 0;
-
-        // Verify that it hasn't been reserved yet
+        // Verify that it hasn't been reserved yet (routes of the same value share the port)
         for (int k = 0; k < cnt; k++)
         {
             if (c->grid[i][j]->rfPortsToOutputRegisters.val[k] == val && c->grid[i][j]->rfPortsToOutputRegisters.t[k] == t)
                 return 1;
         }
+        // No more ports to reserve
+        if (cnt >= lmt)
+            return 0;
         c->grid[i][j]->rfPortsToOutputRegisters.val[cnt] = val;
         c->grid[i][j]->rfPortsToOutputRegisters.t[cnt] = t;
         c->grid[i][j]->rfPortsToOutputRegisters.counter = cnt + 1;
@@ -1561,6 +1934,8 @@ void set_cgra_interconnect(cgra *nc, int i1, int j1, int i2, int j2, int lat)
     if (lat == -1)
         lat = INFINITY;
     nc->lats[i2 * nc->C + j2][i1 * nc->C + j1] = lat;
+    invalidate_nbr_table(nc);
+    invalidate_pe_cost(nc, i2, j2); // the input muxes of the destination PE change
 }
 
 int get_cgra_interconnect(cgra *nc, int i1, int j1, int i2, int j2)
@@ -1579,6 +1954,9 @@ void set_cgra_interconnects(cgra *nc, int side, int lat)
 
     int i, j, ij_input = 0, nij_input = 0, ij_output = 0, nij_output = 0;
 
+    invalidate_nbr_table(nc);
+    invalidate_cgra_costs(nc);
+
     if (side < 0 || side > 16)
         return;
 
@@ -2012,11 +2390,12 @@ int getconnLat(cgra *c, int i1, int j1, int i2, int j2)
 
 int getNConnections(cgra *c, int i1, int j1)
 {
-    int conn = 0, pos = i1 * c->C + j1;
-    for (int i = 0; i < c->L; i++)
-        for (int j = 0; j < c->C; j++)
-            if (c->lats[pos][i * c->C + j] > 0 && c->lats[pos][i * c->C + j] < INFINITY)
-                conn++;
+    int k, n, conn = 0;
+    const pe_neighbour *nb = getPENeighbourList(c, i1, j1, &n);
+
+    for (k = 0; k < n; k++)
+        if (nb[k].lat > 0)
+            conn++;
     return conn;
 }
 
@@ -2028,18 +2407,16 @@ int getNConnections(cgra *c, int i1, int j1)
 int hasConnectedPEs(cgra *c, int i, int j)
 {
 
-    int m, n;
+    int k, n;
     cgra *next = getNextModuloSlice(c);
+    const pe_neighbour *nb = getPEFanoutList(next, i, j, &n);
 
-    // Search through all (m, n) positions
-    for (m = 0; m < c->L; m++)
+    // Search through the PEs driven by (i, j)
+    for (k = 0; k < n; k++)
     {
-        for (n = 0; n < c->C; n++)
+        if (connInUse(next, nb[k].pos / c->C, nb[k].pos % c->C, i, j))
         {
-            if (connInUse(next, m, n, i, j))
-            {
-                return m * c->C + n;
-            }
+            return nb[k].pos;
         }
     }
     return -1;
@@ -2047,18 +2424,17 @@ int hasConnectedPEs(cgra *c, int i, int j)
 
 int hasConnectedPEsWithVal(cgra *c, int i, int j, int val, int time)
 {
-    int m, n;
+    int k, n, m;
     cgra *next = getNextModuloSlice(c);
+    const pe_neighbour *nb = getPEFanoutList(next, i, j, &n);
 
-    // Search through all (m, n) positions
-    for (m = 0; m < c->L; m++)
+    // Search through the PEs driven by (i, j)
+    for (k = 0; k < n; k++)
     {
-        for (n = 0; n < c->C; n++)
+        m = nb[k].pos;
+        if (connInUse(next, m / c->C, m % c->C, i, j) && checkConnValTime(next, m / c->C, m % c->C, i, j, val, time))
         {
-            if (connInUse(next, m, n, i, j) && checkConnValTime(next, m, n, i, j, val, time))
-            {
-                return m * c->C + n;
-            }
+            return m;
         }
     }
     return -1;
@@ -2067,18 +2443,16 @@ int hasConnectedPEsWithVal(cgra *c, int i, int j, int val, int time)
 int ioConnectsToPE(cgra *c, int i, int j)
 {
 
-    int m, n;
+    int k, n;
     cgra *next = getNextModuloSlice(c);
+    const pe_neighbour *nb = getPENeighbourList(next, i, j, &n);
 
-    // Search through all (m, n) positions
-    for (m = 0; m < c->L; m++)
+    // Search through the PEs that drive (i, j)
+    for (k = 0; k < n; k++)
     {
-        for (n = 0; n < c->C; n++)
+        if (connInUse(next, i, j, nb[k].pos / c->C, nb[k].pos % c->C))
         {
-            if (connInUse(next, i, j, m, n))
-            {
-                return m * c->C + n;
-            }
+            return nb[k].pos;
         }
     }
     return -1;
@@ -2088,7 +2462,7 @@ int peHasFunct(cgra *c, int i, int j, int op)
 {
     if (c->grid[i][j] == NULL)
         return 0;
-    return HAS_FUNCT(c->grid[i][j], op);
+    return pe_can_exec(c->grid[i][j], op);
 }
 
 void set_execution_time(cgra *c, int exec_time)
@@ -2166,7 +2540,7 @@ int setDirectionOpIDs(cgra *c, int i, int j, int *directions, int idx)
     }
     // LRF
     // if (hasLRFEntry(getPrevModuloSlice(c), i, j, c->grid[i][j]->outputRegisterTime - 1, c->grid[i][j]->outputRegister))
-    if (hasLRFEntry(getPrevModuloSlice(c), i, j, c->grid[i][j]->outputRegisterTimes[idx] - 1, c->grid[i][j]->outputRegisters[idx]))
+    if (t != -1 && hasLRFEntry(getPrevModuloSlice(c), i, j, t - 1, c->grid[i][j]->outputRegisters[idx]))
     {
         directions[5] = c->grid[i][j]->outputRegisters[idx];
     }
@@ -2342,6 +2716,8 @@ int get_n_stream_ports(cgra *nc, int type, int in_use_or_all)
 
 void remove_pe_from_cgra(cgra *nc, int l, int c)
 {
+    invalidate_pe_cost(nc, l, c);
+    invalidate_op_pe_table(nc);
     delete_pe(nc->grid[l][c]);
     nc->grid[l][c] = NULL;
 }
@@ -2353,6 +2729,7 @@ cgra *copy_cgra(cgra *target)
 {
 
     int i, j, k, r;
+    STAT_INC(STAT_DEVICE_COPIES);
     cgra *copy = create_cgra(target->L, target->C, target->se_ld, target->se_st, target->data_width);
     for (i = 0; i < target->L; i++)
     {
@@ -2365,10 +2742,14 @@ cgra *copy_cgra(cgra *target)
                 copy->grid[i][j]->instr = target->grid[i][j]->instr;
                 copy->grid[i][j]->powerOn = target->grid[i][j]->powerOn;
                 copy->grid[i][j]->pipelineStages = target->grid[i][j]->pipelineStages;
+                copy->grid[i][j]->fu_NInputs = target->grid[i][j]->fu_NInputs;
                 /*                 for (k = 0; k < 9; k++)
                                     copy->grid[i][j]->neighbours[k] = target->grid[i][j]->neighbours[k]; */
                 for (k = 0; k < FUNCTS; k++)
                     copy->grid[i][j]->functs[k] = target->grid[i][j]->functs[k];
+                copy->grid[i][j]->costValid = target->grid[i][j]->costValid;
+                copy->grid[i][j]->areaCost = target->grid[i][j]->areaCost;
+                copy->grid[i][j]->powerCost = target->grid[i][j]->powerCost;
 
                 copy->grid[i][j]->NumOutputRegisters = target->grid[i][j]->NumOutputRegisters;
                 copy->grid[i][j]->outputRegisters = (int *)calloc(copy->grid[i][j]->NumOutputRegisters, sizeof(int));
@@ -2441,10 +2822,22 @@ cgra *copy_cgra(cgra *target)
             for (k = 0; k < 8; k++)
                 copy->new_states[i][j][k] = target->new_states[i][j][k];
         }
+    // Same interconnect: share the neighbour table
+    copy->nbrs = get_nbr_table(target);
+    __atomic_add_fetch(&copy->nbrs->refs, 1, __ATOMIC_RELAXED);
+    // Same PEs: share the operation capability table
+    copy->op_pes = get_op_pe_table(target);
+    __atomic_add_fetch(&copy->op_pes->refs, 1, __ATOMIC_RELAXED);
 
     for (i = 0; i < 17; i++)
         copy->configs[i] = target->configs[i];
 
+    // Same PEs and interconnect: same costs
+    copy->area_total = target->area_total;
+    copy->power_total = target->power_total;
+    copy->costs_summed = target->costs_summed;
+    copy->costs_stale = target->costs_stale;
+
     copy->execution_time = target->execution_time;
     copy->mapping_flag = target->mapping_flag;
 
@@ -2501,6 +2894,8 @@ void delete_cgra(cgra *c)
             free(c->new_states[i]);
         }
         free(c->lats);
+        release_nbr_table(c->nbrs);
+        release_op_pe_table(c->op_pes);
         free(c->new_states);
         free(c->state_src);
         free(c);
@@ -3035,7 +3430,7 @@ int checkStructHazard(cgra *c, dfg_instr *target, int i, int j)
     if (c->grid[i][j]->powerOn == POWER_OFF)
         return 0;
 
-    if (HAS_FUNCT(c->grid[i][j], get_operation_index(op)))
+    if (pe_can_exec(c->grid[i][j], get_operation_index(op)))
         return 1;
     return 0;
 }
@@ -3471,117 +3866,142 @@ uint32_t next_pow2(uint32_t n) {
 }
 
 /*******
- * Computes a rough area estimate for the PE.
+ * Computes rough area and power estimates for a PE with the given parameters, driven by n_neighbours PEs.
  * It is done by estimating the different units that it should have in its internal architecture.
  */
-float get_pe_area_estimate(cgra *c, int i, int j)
+static void estimate_pe_cost(pe *pe, int n_neighbours, int data_width, float *pe_area, float *pe_power)
 {
-
-    pe* pe = c->grid[i][j];
-    int data_width = c->data_width;
     int n_registers, nbits = data_width * 8, n_ops = 0;
     uint32_t mux_size;
     float area = 0.0, ff_size = 2.1061;
+    float power = 0.0, ff_pow = 3.8741;
 
-    for (int i = OP_ADD; i < MAX_OPS; i++){
-        area += HAS_FUNCT(pe, i) * get_op_estimated_area_cost(i, nbits);
-        n_ops += HAS_FUNCT(pe, i);
+    for (int i = OP_ADD; i < MAX_OPS; i++)
+    {
+        if (!HAS_FUNCT(pe, i))
+            continue;
+        area += get_op_estimated_area_cost(i, nbits);
+        power += get_op_estimated_power_cost(i, nbits);
+        n_ops++;
     }
     area += get_estimated_mux_area(n_ops, nbits);
-
-    /* printf("fu area: %lf\n", area); */
+    power += get_estimated_mux_power(n_ops, nbits);
 
     n_registers = pe->RFsize + pe->NumOutputRegisters + pe->CUsize;
     // Add register area (for now ignore config memory)
     area += (float)n_registers * ff_size * nbits;
-    /* printf("register area: %lf\n", (float)n_registers * ff_size * nbits); */
+    power += (float)n_registers * ff_pow * nbits;
+
     // Crossbar area (several multiplexers)
     if (!HAS_FUNCT(pe, OP_STREAM_IN) && !HAS_FUNCT(pe, OP_STREAM_OUT))
     {
         // RF Read/Write port muxes
         mux_size = next_pow2(pe->RFsize);
         area += (pe->rfPortsToInputMuxes.limit + pe->rfPortsToOutputRegisters.limit + 1) * get_estimated_mux_area(mux_size, nbits);
-        /* printf("lrf area: %lf\n", (float)n_registers * ff_size * nbits + (pe->rfPortsToInputMuxes.limit + pe->rfPortsToOutputRegisters.limit + 1) * get_estimated_mux_area(mux_size, nbits)); */
-        
+        power += (pe->rfPortsToInputMuxes.limit + pe->rfPortsToOutputRegisters.limit + 1) * get_estimated_mux_power(mux_size, nbits);
+
         // FU Input muxes
-        mux_size = next_pow2(getNNeighboursforPE(c, i, j) + (pe->rfPortsToInputMuxes.limit > 0 ? 1 : 0));
+        mux_size = next_pow2(n_neighbours + (pe->rfPortsToInputMuxes.limit > 0 ? 1 : 0));
         area += pe->fu_NInputs * get_estimated_mux_area(mux_size, nbits);
-        
+        power += pe->fu_NInputs * get_estimated_mux_power(mux_size, nbits);
+
         // Output Muxes
         mux_size = next_pow2(pe->NumOutputRegisters);
-        area += 4 * get_estimated_mux_area(mux_size, nbits); 
+        area += 4 * get_estimated_mux_area(mux_size, nbits);
+        power += 4 * get_estimated_mux_power(mux_size, nbits);
     }
-    /* printf("total area: %lf\n", area); */
-    return area;
+    *pe_area = area;
+    *pe_power = power;
 }
-/***
- * Computes a rough area estimate for the PEA.
- * It is done by adding all area estimates for each PE.
+
+/**
+ * Fills the cost cache of PE (i, j), adding it to the device totals if these are being kept
  */
-float get_cgra_area_estimate(cgra *c)
+static void update_pe_cost(cgra *c, int i, int j)
 {
+    pe *p = c->grid[i][j];
 
+    if (p->costValid)
+        return;
+    estimate_pe_cost(p, getNNeighboursforPE(c, i, j), c->data_width, &p->areaCost, &p->powerCost);
+    p->costValid = 1;
+    if (c->costs_summed)
+    {
+        c->area_total += p->areaCost * 1.05;
+        c->power_total += p->powerCost;
+    }
+}
+
+static void refresh_pe_cost(cgra *c, int i, int j)
+{
+    if (c->grid[i][j]->costValid)
+        return;
+#pragma omp critical(cgra_cost_cache)
+    update_pe_cost(c, i, j);
+}
+
+/**
+ * Brings the device totals up to date: a full sum the first time, then only the PEs whose cache was dropped
+ */
+static void refresh_cgra_cost_totals(cgra *c)
+{
     int i, j;
-    float area = 0.0;
 
-    for (i = 0; i < c->L; i++)
+    if (c->costs_summed && !c->costs_stale)
+        return;
+#pragma omp critical(cgra_cost_cache)
     {
-        for (j = 0; j < c->C; j++)
+        if (!c->costs_summed)
         {
-            if (c->grid[i][j] != NULL)
-                area += get_pe_area_estimate(c, i, j) * 1.05; // Add 5% for pe routing overhead
+            c->area_total = 0;
+            c->power_total = 0;
+            for (i = 0; i < c->L; i++)
+                for (j = 0; j < c->C; j++)
+                    if (c->grid[i][j] != NULL && c->grid[i][j]->costValid)
+                    {
+                        c->area_total += c->grid[i][j]->areaCost * 1.05;
+                        c->power_total += c->grid[i][j]->powerCost;
+                    }
+            c->costs_summed = 1;
+            c->costs_stale = 1;
+        }
+        if (c->costs_stale)
+        {
+            for (i = 0; i < c->L; i++)
+                for (j = 0; j < c->C; j++)
+                    if (c->grid[i][j] != NULL)
+                        update_pe_cost(c, i, j);
+            c->costs_stale = 0;
         }
     }
+}
 
-    /* printf("array area: %lf\n", area); */
+/*******
+ * Rough area estimate for the PE (cached).
+ */
+float get_pe_area_estimate(cgra *c, int i, int j)
+{
+    refresh_pe_cost(c, i, j);
+    return c->grid[i][j]->areaCost;
+}
 
-    return area;
+/***
+ * Computes a rough area estimate for the PEA.
+ * It is the sum of the area estimates of each PE, plus 5% for pe routing overhead.
+ */
+float get_cgra_area_estimate(cgra *c)
+{
+    refresh_cgra_cost_totals(c);
+    return c->area_total;
 }
 
 /*******
- * Computes a rough power estimate for the PE.
- * It is done by estimating the different units that it should have in its internal architecture.
+ * Rough power estimate for the PE (cached).
  */
 float get_pe_power_estimate(cgra *c, int i, int j)
 {
-
-    pe* pe = c->grid[i][j];
-    int data_width = c->data_width;
-    int n_registers, nbits = data_width * 8, n_ops = 0;
-    uint32_t mux_size;
-    float power = 0.0, ff_pow = 3.8741;
-
-    for (int i = OP_ADD; i < MAX_OPS; i++){
-        power += HAS_FUNCT(pe, i) * get_op_estimated_power_cost(i, nbits);
-        n_ops += HAS_FUNCT(pe, i);
-    }
-    power += get_estimated_mux_power(n_ops, nbits);
-
-    //printf("fu power: %lf\n", power);
-
-    n_registers = pe->RFsize + pe->NumOutputRegisters + pe->CUsize;
-    // Add register area (for now ignore config memory)
-    power += (float)n_registers * ff_pow * nbits;
-    //printf("register power: %lf\n", (float)n_registers * ff_pow * nbits);
-
-    // Crossbar area (several multiplexers)
-    if (!HAS_FUNCT(pe, OP_STREAM_IN) && !HAS_FUNCT(pe, OP_STREAM_OUT))
-    {
-        // RF Read/Write port muxes
-        mux_size = next_pow2(pe->RFsize);
-        power += (pe->rfPortsToInputMuxes.limit + pe->rfPortsToOutputRegisters.limit + 1) * get_estimated_mux_power(mux_size, nbits);
-        //printf("lrf power: %lf\n", (float)n_registers * ff_pow * nbits + (pe->rfPortsToInputMuxes.limit + pe->rfPortsToOutputRegisters.limit + 1) * get_estimated_mux_power(mux_size, nbits));
-
-        // FU Input muxes
-        mux_size = next_pow2(getNNeighboursforPE(c, i, j) + (pe->rfPortsToInputMuxes.limit > 0 ? 1 : 0));
-        power += pe->fu_NInputs * get_estimated_mux_power(mux_size, nbits);
-        
-        // Output Muxes
-        mux_size = next_pow2(pe->NumOutputRegisters);
-        power += 4 * get_estimated_mux_power(mux_size, nbits); 
-    }
-    //printf("total power: %lf\n", power);
-    return power;
+    refresh_pe_cost(c, i, j);
+    return c->grid[i][j]->powerCost;
 }
 
 /***
@@ -3590,20 +4010,68 @@ float get_pe_power_estimate(cgra *c, int i, int j)
  */
 float get_cgra_power_estimate(cgra *c)
 {
+    refresh_cgra_cost_totals(c);
+    return c->power_total;
+}
 
-    int i, j;
-    float power = 0.0;
+/***
+ * Sets a pe_prune to leave every parameter of the PE unchanged.
+ */
+void init_pe_prune(pe_prune *p)
+{
+    p->remove = 0;
+    p->rf_size = PRUNE_KEEP;
+    p->n_output_registers = PRUNE_KEEP;
+    p->rf_ports_to_fu = PRUNE_KEEP;
+    p->rf_ports_to_ors = PRUNE_KEEP;
+    p->fu_inputs = PRUNE_KEEP;
+    p->n_rmv_links = 0;
+    p->rmv_ops = NULL;
+    p->n_rmv_ops = 0;
+}
 
-    for (i = 0; i < c->L; i++)
+/***
+ * Computes the change in the area and power estimates of the device if the proposed prune was applied
+ * to PE (i, j), without applying it. Only the cost of PE (i, j) is re-estimated.
+ * Return values: PE (i, j) exists ? 0 : -1
+ */
+int get_pe_prune_delta(cgra *c, int i, int j, const pe_prune *p, float *d_area, float *d_power)
+{
+    pe *cur, proposed;
+    float area, power;
+    int k;
+
+    if (i < 0 || j < 0 || i >= c->L || j >= c->C || c->grid[i][j] == NULL)
+        return -1;
+    cur = c->grid[i][j];
+    refresh_pe_cost(c, i, j);
+
+    if (p->remove)
     {
-        for (j = 0; j < c->C; j++)
-        {
-            if (c->grid[i][j] != NULL)
-                power += get_pe_power_estimate(c, i, j);
-        }
+        *d_area = -cur->areaCost * 1.05;
+        *d_power = -cur->powerCost;
+        return 0;
     }
 
-    return power;
+    // Only the cost parameters of the copy are changed (its arrays are still the ones of the PE)
+    proposed = *cur;
+    if (p->rf_size != PRUNE_KEEP)
+        proposed.RFsize = p->rf_size;
+    if (p->n_output_registers != PRUNE_KEEP)
+        proposed.NumOutputRegisters = p->n_output_registers;
+    if (p->rf_ports_to_fu != PRUNE_KEEP)
+        proposed.rfPortsToInputMuxes.limit = p->rf_ports_to_fu;
+    if (p->rf_ports_to_ors != PRUNE_KEEP)
+        proposed.rfPortsToOutputRegisters.limit = p->rf_ports_to_ors;
+    if (p->fu_inputs != PRUNE_KEEP)
+        proposed.fu_NInputs = p->fu_inputs;
+    for (k = 0; k < p->n_rmv_ops; k++)
+        RMV_FUNCT(&proposed, p->rmv_ops[k]);
+
+    estimate_pe_cost(&proposed, getNNeighboursforPE(c, i, j) - p->n_rmv_links, c->data_width, &area, &power);
+    *d_area = (area - cur->areaCost) * 1.05;
+    *d_power = power - cur->powerCost;
+    return 0;
 }
 
 /**
@@ -3726,90 +4194,182 @@ void display_animation(cgra *c, dfg *d, int **placed)
     }
 }
 
-void auto_prune(cgra **c, dfg **d, cgra *template, int N, int *prune_info)
+// Resources of a PE used by a set of mapped devices (auto_prune)
+typedef struct
 {
-    cgra *curr;
-    dfg *curr_dfg;
-    int i, j, k, unused, rf, f, n, or, rfrp[2] = {0};
-    int usedDirections[4]; // L, R, U, D
-    int fu_ops[OP_MAX - OP_ADD], fu_ins;
+    uint64_t functs[FUNCTS]; // FU operations used (same layout as the PE's functs)
+    uint8_t used;            // 1 if the FU, the LRF or an output register is used
+    uint8_t dirs;            // connections used, one bit per direction (L, R, U, D)
+    int rf;                  // LRF entries used
+    int or;                  // output registers used
+    int rfrp[2];             // RF read ports used (mux in, output registers)
+    int fu_ins;              // FU inputs used
+} pe_usage;
 
-    for (i = 0; i < template->L; i++)
-    {
-        for (j = 0; j < template->C; j++)
+/**
+ * Number of FU inputs of each node (indexed by id): inputs, constants and recurrences that target it
+ */
+static int *get_fu_inputs_by_id(dfg *d, int *max_id)
+{
+    int n, r, k, N = get_dfg_size(d), *fu_ins;
+    dfg_instr *instr, *rec;
+
+    *max_id = 0;
+    for (n = 0; n < N; n++)
+        if (get_instr_id(get_dfg_instr(d, n)) > *max_id)
+            *max_id = get_instr_id(get_dfg_instr(d, n));
+    fu_ins = (int *)calloc(*max_id + 1, sizeof(int));
+    for (n = 0; n < N; n++)
+    {
+        instr = get_dfg_instr(d, n);
+        fu_ins[get_instr_id(instr)] += get_n_inputs(instr) + get_n_consts(instr);
+        // A node counts once for each distinct node it recurs to
+        for (r = 0; r < get_n_recurrences(instr); r++)
         {
-            unused = 1;
-            for (k = 0; k < 4; k++)
-                usedDirections[k] = 1;
-
-            for (k = OP_ADD; k < OP_MAX; k++)
-                fu_ops[k - OP_ADD] = 0;
+            rec = get_recurrence(instr, r);
+            for (k = 0; k < r; k++)
+                if (get_instr_id(get_recurrence(instr, k)) == get_instr_id(rec))
+                    break;
+            if (k == r && get_instr_id(rec) <= *max_id)
+                fu_ins[get_instr_id(rec)]++;
+        }
+    }
+    return fu_ins;
+}
 
-            rf = 0;
-            or = 0;
-            rfrp[0] = 0; // mux in
-            rfrp[1] = 0; // output registers
-            fu_ins = 0;
+/**
+ * Adds the resources used by all slices of mapped device c (dfg d) to the per-PE summaries (L x C)
+ */
+static void collect_pe_usage(cgra *c, dfg *d, int L, int C, pe_usage *usage)
+{
+    int i, j, k, f, max_id, *fu_ins = get_fu_inputs_by_id(d, &max_id);
+    pe *p;
+    pe_usage *u;
 
-            for (n = 0; n < N; n++)
+    for (; c != NULL; c = c->next_slice)
+    {
+        for (i = 0; i < L; i++)
+        {
+            for (j = 0; j < C; j++)
             {
-                curr = c[n];
-                curr_dfg = d[n];
-
-                if (curr->grid[i][j] == NULL)
+                p = c->grid[i][j];
+                if (p == NULL)
                     continue;
+                u = &usage[i * C + j];
 
-                // Analyse for all slices of this result
-                while (curr != NULL)
+                // If the FU is used, or the LRF is accessed, then this PE must be in use
+                if (p->tile != 0 || p->registerFileAccess > 0)
+                    u->used = 1;
+                if (p->tile != 0)
                 {
-                    // If the FU is used, or the LRF is accessed, then this PE must be in use
-                    if (curr->grid[i][j]->tile != 0 || curr->grid[i][j]->registerFileAccess > 0)
-                    {
-                        unused = 0;
-
-                        if (curr->grid[i][j]->tile != 0)
-                        {
-                            fu_ops[get_operation_index(get_instr_op(curr->grid[i][j]->instr)) - OP_ADD] = 1;
-                            int ninputs = get_n_inputs(curr->grid[i][j]->instr) + get_n_consts(curr->grid[i][j]->instr);
-                            int *r = getInputRecArray(curr_dfg, curr->grid[i][j]->instr);
-                            ninputs += r[0];
-                            free(r);
-
-                            fu_ins = fu_ins < ninputs ? ninputs : fu_ins;
-                        }
-                    }
-                    // If any of the output registers is used, then this PE must be in use
-                    for (k = 0; k < curr->grid[i][j]->NumOutputRegisters; k++)
+                    f = get_operation_index(get_instr_op(p->instr));
+                    if (f >= OP_ADD && f < OP_MAX) // stream ports have no FU ops
+                        SET_FUNCT(u, f);
+                    f = get_instr_id(p->instr);
+                    if (f <= max_id && fu_ins[f] > u->fu_ins)
+                        u->fu_ins = fu_ins[f];
+                }
+                // If any of the output registers is used, then this PE must be in use
+                for (k = 0; k < p->NumOutputRegisters; k++)
+                {
+                    if (p->outputRegisters[k] > 0)
+                        u->used = 1;
+                    if (p->outputRegisters[k] != 0 && k + 1 > u->or)
+                        u->or = k + 1;
+                }
+                for (k = p->RFsize - 1; k >= u->rf; k--)
+                {
+                    if (p->registerFile[k] != 0)
                     {
-                        if (curr->grid[i][j]->outputRegisters[k] > 0)
-                            unused = 0;
+                        u->rf = k + 1;
+                        break;
                     }
-
-                    // RF Read Ports
-                    int cnt = curr->grid[i][j]->rfPortsToInputMuxes.counter;
-                    rfrp[0] = cnt > rfrp[0] ? cnt : rfrp[0];
-                    cnt = curr->grid[i][j]->rfPortsToOutputRegisters.counter;
-                    rfrp[1] = cnt > rfrp[1] ? cnt : rfrp[1];
-
-                    // Check for used connections
-                    if (j > 0 && connInUse(curr, i, j, i, j - 1))
-                        usedDirections[0] = 0;
-                    if (j < template->C - 1 && connInUse(curr, i, j, i, j + 1))
-                        usedDirections[1] = 0;
-                    if (i > 0 && connInUse(curr, i, j, i - 1, j))
-                        usedDirections[2] = 0;
-                    if (i < template->L - 1 && connInUse(curr, i, j, i + 1, j))
-                        usedDirections[3] = 0;
-
-                    f = getEffLRFSize(curr, i, j);
-                    rf = rf < f ? f : rf;
-                    f = getEffNumOutputRegisters(curr, i, j);
-                    or = or < f ? f : or;
-                    curr = curr->next_slice;
                 }
+
+                // RF Read Ports
+                if (p->rfPortsToInputMuxes.counter > u->rfrp[0])
+                    u->rfrp[0] = p->rfPortsToInputMuxes.counter;
+                if (p->rfPortsToOutputRegisters.counter > u->rfrp[1])
+                    u->rfrp[1] = p->rfPortsToOutputRegisters.counter;
+
+                // Check for used connections
+                if (connInUse(c, i, j, i, j - 1))
+                    u->dirs |= 1;
+                if (connInUse(c, i, j, i, j + 1))
+                    u->dirs |= 2;
+                if (connInUse(c, i, j, i - 1, j))
+                    u->dirs |= 4;
+                if (connInUse(c, i, j, i + 1, j))
+                    u->dirs |= 8;
             }
-            if (unused == 1)
+        }
+    }
+    free(fu_ins);
+}
+
+static void merge_pe_usage(pe_usage *dst, const pe_usage *src, int n)
+{
+    int p, k;
+
+    for (p = 0; p < n; p++)
+    {
+        for (k = 0; k < FUNCTS; k++)
+            dst[p].functs[k] |= src[p].functs[k];
+        dst[p].used |= src[p].used;
+        dst[p].dirs |= src[p].dirs;
+        dst[p].rf = dst[p].rf > src[p].rf ? dst[p].rf : src[p].rf;
+        dst[p].or = dst[p].or > src[p].or ? dst[p].or : src[p].or;
+        dst[p].rfrp[0] = dst[p].rfrp[0] > src[p].rfrp[0] ? dst[p].rfrp[0] : src[p].rfrp[0];
+        dst[p].rfrp[1] = dst[p].rfrp[1] > src[p].rfrp[1] ? dst[p].rfrp[1] : src[p].rfrp[1];
+        dst[p].fu_ins = dst[p].fu_ins > src[p].fu_ins ? dst[p].fu_ins : src[p].fu_ins;
+    }
+}
+
+/**
+ * Prunes the template device to the resources used by the N mapped devices.
+ * The usage of each PE is first summarized across the mappings (in parallel, one summary per thread, then
+ * merged), and the template is pruned in a single pass over those summaries.
+ * prune_savings receives the estimated area and power reduction, computed for each PE before it is pruned.
+ */
+void auto_prune(cgra **c, dfg **d, cgra *template, int N, int *prune_info, float *prune_savings)
+{
+    cgra *curr;
+    int i, j, k, n, n_pes = template->L * template->C;
+    int dir_i[4] = {0, 0, -1, 1}, dir_j[4] = {-1, 1, 0, 0}; // L, R, U, D
+    int rmv_ops[OP_MAX - OP_ADD];
+    float d_area, d_power;
+    pe_prune prune;
+    pe_usage *usage = (pe_usage *)calloc(n_pes, sizeof(pe_usage)), *u;
+
+    prune_savings[0] = 0;
+    prune_savings[1] = 0;
+
+#pragma omp parallel
+    {
+        pe_usage *local = (pe_usage *)calloc(n_pes, sizeof(pe_usage));
+
+#pragma omp for schedule(dynamic)
+        for (n = 0; n < N; n++)
+            collect_pe_usage(c[n], d[n], template->L, template->C, local);
+#pragma omp critical(auto_prune_usage)
+        merge_pe_usage(usage, local, n_pes);
+        free(local);
+    }
+
+    for (i = 0; i < template->L; i++)
+    {
+        for (j = 0; j < template->C; j++)
+        {
+            u = &usage[i * template->C + j];
+            init_pe_prune(&prune);
+            if (!u->used)
             {
+                prune.remove = 1;
+                if (get_pe_prune_delta(template, i, j, &prune, &d_area, &d_power) == 0)
+                {
+                    prune_savings[0] -= d_area;
+                    prune_savings[1] -= d_power;
+                }
                 if (template->grid[i][j] != NULL && isStreamPort(template, i, j))
                     prune_info[3]++;
                 else if (template->grid[i][j] != NULL)
@@ -3835,62 +4395,67 @@ void auto_prune(cgra **c, dfg **d, cgra *template, int N, int *prune_info)
                 set_cgra_interconnect(template, i - 1, j, i, j, INFINITY);
                 set_cgra_interconnect(template, i, j + 1, i, j, INFINITY);
                 set_cgra_interconnect(template, i, j - 1, i, j, INFINITY);
-                delete_pe(template->grid[i][j]);
-                template->grid[i][j] = NULL;
+                remove_pe_from_cgra(template, i, j);
             }
             else
             {
                 // Change the template device
                 curr = template;
-                prune_info[1] += curr->grid[i][j]->RFsize - rf;
+                prune.rf_size = u->rf;
+                prune.n_output_registers = u->or;
+                prune.rf_ports_to_fu = u->rfrp[0];
+                prune.rf_ports_to_ors = u->rfrp[1];
+                prune.fu_inputs = u->fu_ins;
+                prune.rmv_ops = rmv_ops;
+                for (k = OP_ADD; k < OP_MAX; k++)
+                    if (!HAS_FUNCT(u, k) && HAS_FUNCT(curr->grid[i][j], k))
+                        rmv_ops[prune.n_rmv_ops++] = k;
+                for (k = 0; k < 4; k++)
+                    if (!(u->dirs & (1 << k)) && get_cgra_interconnect(c[0], i + dir_i[k], j + dir_j[k], i, j) != INFINITY &&
+                        get_cgra_interconnect(curr, i + dir_i[k], j + dir_j[k], i, j) != INFINITY)
+                        prune.n_rmv_links++;
+                if (get_pe_prune_delta(curr, i, j, &prune, &d_area, &d_power) == 0)
+                {
+                    prune_savings[0] -= d_area;
+                    prune_savings[1] -= d_power;
+                }
+                invalidate_pe_cost(curr, i, j);
+
+                prune_info[1] += curr->grid[i][j]->RFsize - u->rf;
                 delete_pe_registerFile(curr->grid[i][j]);
-                init_pe_registerFile(curr->grid[i][j], rf, curr->grid[i][j]->rfPortsToInputMuxes.limit);
-                prune_info[4] += curr->grid[i][j]->NumOutputRegisters - or;
+                init_pe_registerFile(curr->grid[i][j], u->rf, curr->grid[i][j]->rfPortsToInputMuxes.limit);
+                prune_info[4] += curr->grid[i][j]->NumOutputRegisters - u->or;
                 delete_pe_output_registers(curr->grid[i][j]);
-                init_pe_n_output_registers(curr->grid[i][j], or, curr->grid[i][j]->rfPortsToOutputRegisters.limit);
+                init_pe_n_output_registers(curr->grid[i][j], u->or, curr->grid[i][j]->rfPortsToOutputRegisters.limit);
 
                 // Delete unused OPs
-                for (k = OP_ADD; k < OP_MAX; k++)
+                for (k = 0; k < prune.n_rmv_ops; k++)
+                    RMV_FUNCT(curr->grid[i][j], rmv_ops[k]);
+                if (prune.n_rmv_ops > 0)
+                    invalidate_op_pe_table(curr);
+                prune_info[5] += prune.n_rmv_ops;
+
+                // Remove the unused input links
+                for (k = 0; k < 4; k++)
                 {
-                    if (fu_ops[k - OP_ADD] == 0 && HAS_FUNCT(curr->grid[i][j], k))
+                    if (!(u->dirs & (1 << k)) && get_cgra_interconnect(c[0], i + dir_i[k], j + dir_j[k], i, j) != INFINITY)
                     {
-                        RMV_FUNCT(curr->grid[i][j], k);
-                        prune_info[5]++;
+                        set_cgra_interconnect(curr, i + dir_i[k], j + dir_j[k], i, j, INFINITY);
+                        prune_info[0]++;
                     }
                 }
-
-                // curr->grid[i][j]->RFsize = rf;
-                if (j > 0 && usedDirections[0] > 0 && get_cgra_interconnect(c[0], i, j - 1, i, j) != INFINITY)
-                {
-                    set_cgra_interconnect(curr, i, j - 1, i, j, INFINITY);
-                    prune_info[0]++;
-                }
-                if (j < template->C - 1 && usedDirections[1] > 0 && get_cgra_interconnect(c[0], i, j + 1, i, j) != INFINITY)
-                {
-                    set_cgra_interconnect(curr, i, j + 1, i, j, INFINITY);
-                    prune_info[0]++;
-                }
-                if (i > 0 && usedDirections[2] > 0 && get_cgra_interconnect(c[0], i - 1, j, i, j) != INFINITY)
-                {
-                    set_cgra_interconnect(curr, i - 1, j, i, j, INFINITY);
-                    prune_info[0]++;
-                }
-                if (i < template->L - 1 && usedDirections[3] > 0 && get_cgra_interconnect(c[0], i + 1, j, i, j) != INFINITY)
-                {
-                    set_cgra_interconnect(curr, i + 1, j, i, j, INFINITY);
-                    prune_info[0]++;
-                }
                 // Prune RF RW Ports
-                prune_info[6] += curr->grid[i][j]->rfPortsToInputMuxes.limit - rfrp[0];
-                prune_info[6] += curr->grid[i][j]->rfPortsToOutputRegisters.limit - rfrp[1];
-                curr->grid[i][j]->rfPortsToInputMuxes.limit = rfrp[0];
-                curr->grid[i][j]->rfPortsToOutputRegisters.limit = rfrp[1];
+                prune_info[6] += curr->grid[i][j]->rfPortsToInputMuxes.limit - u->rfrp[0];
+                prune_info[6] += curr->grid[i][j]->rfPortsToOutputRegisters.limit - u->rfrp[1];
+                curr->grid[i][j]->rfPortsToInputMuxes.limit = u->rfrp[0];
+                curr->grid[i][j]->rfPortsToOutputRegisters.limit = u->rfrp[1];
 
-                prune_info[7] += curr->grid[i][j]->fu_NInputs - fu_ins;
-                curr->grid[i][j]->fu_NInputs = fu_ins;
+                prune_info[7] += curr->grid[i][j]->fu_NInputs - u->fu_ins;
+                curr->grid[i][j]->fu_NInputs = u->fu_ins;
             }
         }
     }
+    free(usage);
 }
 
 cgra *load_mapping(cgra *template, cgra *target)
@@ -4001,6 +4566,9 @@ cgra *load_mapping(cgra *template, cgra *target)
                 for (k = 0; k < 8; k++)
                     load->new_states[i][j][k] = target->new_states[i][j][k];
             }
+        invalidate_nbr_table(load);
+        invalidate_op_pe_table(load);
+        invalidate_cgra_costs(load);
 
         for (i = 0; i < 15; i++)
             load->configs[i] = target->configs[i];
@@ -4012,6 +4580,257 @@ cgra *load_mapping(cgra *template, cgra *target)
     return load_base;
 }
 
+/**************************************************************************************
+ * Mapping State Records
+ * Fixed-width snapshots of the mapping state that load_mapping transfers between devices,
+ * used to store mapped devices outside the program (e.g. binary bitstreams).
+ * PE record (ints): [exists, tile, op id, powerOn, pipelineStages, RF access,
+ *                    n_or x {val, time}, rf x {val, time, reservations[8]}, cu x {val, reservations[8]}]
+ * Connection record (ints): [dst, src, val, time, states[8]]
+ *************************************************************************************/
+int get_pe_state_words(int n_or, int rf, int cu)
+{
+    return 6 + 2 * n_or + 10 * rf + 9 * cu;
+}
+
+void get_max_pe_resources(cgra *c, int *n_or, int *rf, int *cu)
+{
+    int i, j;
+    *n_or = 0;
+    *rf = 0;
+    *cu = 0;
+    for (i = 0; i < c->L; i++)
+    {
+        for (j = 0; j < c->C; j++)
+        {
+            if (c->grid[i][j] == NULL)
+                continue;
+            if (c->grid[i][j]->NumOutputRegisters > *n_or)
+                *n_or = c->grid[i][j]->NumOutputRegisters;
+            if (c->grid[i][j]->RFsize > *rf)
+                *rf = c->grid[i][j]->RFsize;
+            if (c->grid[i][j]->CUsize > *cu)
+                *cu = c->grid[i][j]->CUsize;
+        }
+    }
+}
+
+void pack_pe_state(cgra *c, int i, int j, int *rec, int n_or, int rf, int cu)
+{
+    int k, r, w = 6;
+    pe *p = c->grid[i][j];
+
+    memset(rec, 0, get_pe_state_words(n_or, rf, cu) * sizeof(int));
+    if (p == NULL)
+        return;
+
+    rec[0] = 1;
+    rec[1] = p->tile;
+    rec[2] = p->instr != NULL ? get_instr_id(p->instr) : 0;
+    rec[3] = p->powerOn;
+    rec[4] = p->pipelineStages;
+    rec[5] = p->registerFileAccess;
+
+    for (k = 0; k < n_or; k++, w += 2)
+    {
+        if (k >= p->NumOutputRegisters)
+            continue;
+        rec[w] = p->outputRegisters[k];
+        rec[w + 1] = p->outputRegisterTimes[k];
+    }
+    for (k = 0; k < rf; k++, w += 10)
+    {
+        if (k >= p->RFsize)
+            continue;
+        rec[w] = p->registerFile[k];
+        rec[w + 1] = p->registerFileTime[k];
+        for (r = 0; r < 8; r++)
+            rec[w + 2 + r] = p->registerFileReservations[k][r];
+    }
+    for (k = 0; k < cu; k++, w += 9)
+    {
+        if (k >= p->CUsize)
+            continue;
+        rec[w] = p->constantUnits[k];
+        for (r = 0; r < 8; r++)
+            rec[w + 1 + r] = p->constantUnitReservations[k][r];
+    }
+}
+
+/**
+ * Applies a PE state record onto a (template-based) slice.
+ * Return values: record fits the slice's PE ? 1 : 0
+ */
+int unpack_pe_state(cgra *c, dfg *d, int i, int j, const int *rec, int n_or, int rf, int cu)
+{
+    int k, r, w = 6;
+    pe *p = c->grid[i][j];
+
+    if (rec[0] == 0)
+        return 1;
+    // The mapping requires a PE which does not exist on this device
+    if (p == NULL)
+        return rec[1] == 0;
+
+    p->tile = rec[1];
+    p->instr = rec[2] > 0 ? get_instr_by_op_id(d, rec[2]) : NULL;
+    if (rec[2] > 0 && p->instr == NULL)
+        return 0;
+    p->powerOn = rec[3];
+    p->pipelineStages = rec[4];
+    p->registerFileAccess = rec[5];
+
+    for (k = 0; k < n_or; k++, w += 2)
+    {
+        if (k >= p->NumOutputRegisters)
+        {
+            if (rec[w] != 0)
+                return 0;
+            continue;
+        }
+        p->outputRegisters[k] = rec[w];
+        p->outputRegisterTimes[k] = rec[w + 1];
+    }
+    for (k = 0; k < rf; k++, w += 10)
+    {
+        if (k >= p->RFsize)
+        {
+            if (rec[w] != 0)
+                return 0;
+            continue;
+        }
+        p->registerFile[k] = rec[w];
+        p->registerFileTime[k] = rec[w + 1];
+        for (r = 0; r < 8; r++)
+            p->registerFileReservations[k][r] = rec[w + 2 + r];
+    }
+    for (k = 0; k < cu; k++, w += 9)
+    {
+        if (k >= p->CUsize)
+        {
+            if (rec[w] != 0)
+                return 0;
+            continue;
+        }
+        p->constantUnits[k] = rec[w];
+        for (r = 0; r < 8; r++)
+            p->constantUnitReservations[k][r] = rec[w + 1 + r];
+    }
+    return 1;
+}
+
+/**
+ * Stores the records of all connections in use on slice c. If buf is NULL, only counts them.
+ * Return values: number of connection records
+ */
+int pack_conn_states(cgra *c, int *buf)
+{
+    int dst, src, k, n = 0, used, *rec;
+
+    for (dst = 0; dst < c->L * c->C; dst++)
+    {
+        for (src = 0; src < c->L * c->C; src++)
+        {
+            used = c->state_src[dst][src].val != 0;
+            for (k = 0; k < 8 && !used; k++)
+                used = c->new_states[dst][src][k] != 0;
+            if (!used)
+                continue;
+
+            if (buf != NULL)
+            {
+                rec = buf + n * 12;
+                rec[0] = dst;
+                rec[1] = src;
+                rec[2] = c->state_src[dst][src].val;
+                rec[3] = c->state_src[dst][src].t;
+                for (k = 0; k < 8; k++)
+                    rec[4 + k] = c->new_states[dst][src][k];
+            }
+            n++;
+        }
+    }
+    return n;
+}
+
+/**
+ * Applies a connection record onto slice c.
+ * Return values: the connection exists on the device ? 1 : 0
+ */
+int unpack_conn_state(cgra *c, const int *rec)
+{
+    int k;
+    if (rec[0] < 0 || rec[1] < 0 || rec[0] >= c->L * c->C || rec[1] >= c->L * c->C)
+        return 0;
+    if (c->lats[rec[0]][rec[1]] == INFINITY)
+        return 0;
+
+    c->state_src[rec[0]][rec[1]].val = rec[2];
+    c->state_src[rec[0]][rec[1]].t = rec[3];
+    for (k = 0; k < 8; k++)
+        c->new_states[rec[0]][rec[1]][k] = rec[4 + k];
+    return 1;
+}
+
+/**************************************************************************************
+ * get_device_signature
+ * Serializes everything in a device template that constrains a mapping: geometry,
+ * streaming bandwidth, data width, interconnect flags, per-PE functions and resources
+ * (FU inputs, RF/CU/OR sizes, RF read ports, pipeline stages, power) and the interconnect
+ * latencies. The mapping state is ignored. Used to build content-addressed keys.
+ * Return values: allocated signature array (n_words ints)
+ *************************************************************************************/
+int *get_device_signature(cgra *c, int *n_words)
+{
+    int i, j, k, w = 0, N = c->L * c->C;
+    int *sig;
+    pe *p;
+
+    *n_words = 5 + 17 + N * (1 + 2 * FUNCTS + 8) + N * N;
+    sig = (int *)calloc(*n_words, sizeof(int));
+
+    sig[w++] = c->L;
+    sig[w++] = c->C;
+    sig[w++] = c->se_ld;
+    sig[w++] = c->se_st;
+    sig[w++] = c->data_width;
+    for (k = 0; k < 17; k++)
+        sig[w++] = c->configs[k];
+
+    for (i = 0; i < c->L; i++)
+    {
+        for (j = 0; j < c->C; j++)
+        {
+            p = c->grid[i][j];
+            if (p == NULL)
+            {
+                w += 1 + 2 * FUNCTS + 8;
+                continue;
+            }
+            sig[w++] = 1;
+            for (k = 0; k < FUNCTS; k++)
+            {
+                sig[w++] = (int)(p->functs[k] & 0xFFFFFFFF);
+                sig[w++] = (int)(p->functs[k] >> 32);
+            }
+            sig[w++] = p->fu_NInputs;
+            sig[w++] = p->RFsize;
+            sig[w++] = p->CUsize;
+            sig[w++] = p->NumOutputRegisters;
+            sig[w++] = p->pipelineStages;
+            sig[w++] = p->powerOn;
+            sig[w++] = p->rfPortsToOutputRegisters.limit;
+            sig[w++] = p->rfPortsToInputMuxes.limit;
+        }
+    }
+
+    for (i = 0; i < N; i++)
+        for (j = 0; j < N; j++)
+            sig[w++] = c->lats[i][j];
+
+    return sig;
+}
+
 cgra *buildHmgCopy(cgra *template, int rows, int cols)
 {
     cgra *new_dev;
@@ -43,11 +43,55 @@ typedef struct _cgra cgra;
 #define ASAP 1
 #define ALAP 0
 
+// Warm-start mapping hints (hints[id-1])
+#define HINT_WORDS 3
+#define HINT_POS 0     // i * C + j in the previous mapping
+#define HINT_CONTEXT 1 // configuration context (slice) in the previous mapping
+#define HINT_CYCLE 2   // start cycle in the previous mapping (-1 if unknown)
+
+// Interconnect neighbour tables: relative position of a neighbouring PE
+#define NBR_DIR_N 0
+#define NBR_DIR_NE 1
+#define NBR_DIR_E 2
+#define NBR_DIR_SE 3
+#define NBR_DIR_S 4
+#define NBR_DIR_SW 5
+#define NBR_DIR_W 6
+#define NBR_DIR_NW 7
+#define NBR_DIR_SELF 8
+#define NBR_DIR_FAR 9 // non-adjacent PE (e.g. row/column bypass)
+
+typedef struct
+{
+    int pos; // i * C + j
+    int lat; // connection latency
+    int dir; // NBR_DIR_*
+} pe_neighbour;
+
+// Proposed changes to a PE, for get_pe_prune_delta (init_pe_prune leaves every parameter unchanged)
+#define PRUNE_KEEP -1
+
+typedef struct
+{
+    int remove;             // 1 if the whole PE is removed
+    int rf_size;            // new RF size, or PRUNE_KEEP
+    int n_output_registers; // new number of output registers, or PRUNE_KEEP
+    int rf_ports_to_fu;     // new number of RF read ports to the FU input muxes, or PRUNE_KEEP
+    int rf_ports_to_ors;    // new number of RF read ports to the output registers, or PRUNE_KEEP
+    int fu_inputs;          // new number of FU inputs, or PRUNE_KEEP
+    int n_rmv_links;        // number of links driving the PE that are removed
+    const int *rmv_ops;     // operations removed from the FU
+    int n_rmv_ops;
+} pe_prune;
+
 cgra *create_cgra(int L, int C, int se_ld, int se_st, int dw);
 void set_cgra_value(cgra* t, int val, int l, int c);
 void set_cgra_tile_funct(cgra* nc, int l, int c, int funct);
 dfg_instr* get_cgra_tile(cgra *t, int l, int c);
 int *getPENeighbours(cgra *c, int i, int j);
+const pe_neighbour *getPENeighbourList(cgra *c, int i, int j, int *n);
+const pe_neighbour *getPEFanoutList(cgra *c, int i, int j, int *n);
+const int *getOpCapablePEs(cgra *c, int op, int *n);
 void add_conn_state(cgra *c, int i, int j, int opID);
 void remove_conn_state(cgra *c, int i, int j, int opID);
 int connUsedBy(cgra *c, int i1, int j1, int i2, int j2, int opID);
@@ -148,6 +192,7 @@ int getDeviceMII(cgra *c);
 int get_n_cgra_slices(cgra *nc);
 int get_n_pe(cgra *nc);
 int get_n_pe_w_funct(cgra *nc, int funct);
+int get_n_stream_ports(cgra *nc, int type, int in_use_or_all);
 int get_pe_power_mode(cgra *c, int i, int j);
 int hasInterconnects(cgra *nc, int config);
 void set_pe_power_mode(cgra *c, int i, int j, int powerOn);
@@ -190,6 +235,8 @@ int reScheduleNode(int *scheduled, cgra *template, dfg *d, dfg_instr* target, in
 int pipelineReschedule(int *scheduled, cgra *template, dfg *d, dfg_instr *target, int **placed, int distance, int II);
 int invertPipelineReschedule(int *scheduled, cgra *template, dfg *d, dfg_instr *target, int **placed, int distance, int II);
 void topologicalSortDFG(dfg *d);
+void computeCriticality(cgra *template, dfg *d);
+void orderByCriticality(dfg_instr **ops);
 
 int *schedule_dfg(cgra *template, dfg *d);
 int *schedule_dfg_asap(cgra *template, dfg *d);
@@ -205,27 +252,43 @@ int allInstructionsPlaced(int **arr, dfg *d);
 int checkStructHazard(cgra *c, dfg_instr *target, int i, int j);
 int placeOp(cgra *first_slice, int i, int j, dfg *d, dfg_instr *target, int **placed, int *schedule, int II);
 int routeOp(cgra *first_slice, dfg_instr *target, int **placed, int *schedule, int II);
+void set_multicast_routing(int enable);
+int get_multicast_routing(void);
 int unmapOp(cgra *first_slice, dfg *d, dfg_instr *target, int **placed, int *schedule, int II);
 void unRouteOutputs(cgra *first_slice, dfg *d ,dfg_instr *target, int **placed, int *schedule, int II);
 void clearMapping(cgra *fs, dfg *d, dfg_instr **dfg_ops, int **placed, int *schedule, int II);
 cgra *HandOfGod(cgra *template, dfg *d, int ***placed, int *first_mapping, int mapper, int maxII, int verbose);
+int **getPlacementHints(cgra *prior, dfg *d);
+void deletePlacementHints(int **hints, dfg *d);
+cgra *HandOfGodWarmStart(cgra *template, dfg *d, int ***placed, int **hints, int priorII, int mapper, int maxII, int verbose);
 
 //SimAnnealing
 typedef struct _temp temperature;
+typedef struct _move_deltas move_deltas;
 float *generateInitialPlacement(cgra *fs, dfg *d, dfg_instr **dfg_ops, int **placed, int *schedule, int II, int *routed);
-float computeMoveCostStdDev(cgra *fs, dfg *d, dfg_instr **dfg_ops, int ***placed, int *schedule, int II, float *cost, int N);
+float computeMoveCostStdDev(cgra *fs, dfg *d, dfg_instr **dfg_ops, int ***placed, int *schedule, int II, float *cost, int *routed, int N);
 void checkValidMapping(int *routed, int N);
 void ripUpOp(cgra *fs, dfg *d, dfg_instr *target, int **placed, int *schedule, int II);
-float *m1(cgra *fs, dfg *d, dfg_instr ** dfg_ops, dfg_instr *target, int i_pos, int j_pos, int **placed, int *schedule, int II, float *cost, int *routed);
-float *anneal_swap(cgra *fs, dfg *d, dfg_instr **dfg_ops, dfg_instr *target, int i_pos, int j_pos,
-    int **placed, int *schedule, int II, float *cost, int *routed, int *swapped);
+float m1(cgra *fs, dfg *d, dfg_instr ** dfg_ops, dfg_instr *target, int i_pos, int j_pos, int **placed, int *schedule, int II, float *cost,
+    int *routed, move_deltas *md);
+float anneal_swap(cgra *fs, dfg *d, dfg_instr **dfg_ops, dfg_instr *target, int i_pos, int j_pos,
+    int **placed, int *schedule, int II, float *cost, int *routed, int *swapped, move_deltas *md);
 float computeCost(cgra *fs, dfg_instr *target, int **placed, int *schedule, int II, int penalty);
-void updateCost(float *cost, float *newCost, int N);
-int evaluateMoveCost(temperature* t, float *cost, float *newCost, int arr_size);
+move_deltas *createMoveDeltas(int N);
+void deleteMoveDeltas(move_deltas *md);
+void resetMoveDeltas(move_deltas *md, float totalCost);
+float getMoveDelta(move_deltas *md);
+void updateCost(float *cost, float *totalCost, int *routed, int N, move_deltas *md);
+void rejectMoveDeltas(int *routed, move_deltas *md);
+int evaluateMoveCost(temperature* t, float delta);
+int evaluateReplicaExchange(temperature *ti, float costi, temperature *tj, float costj);
+unsigned int *setAnnealingRNG(unsigned int *state);
+int annealRand(void);
 temperature *initTemperature(int initialTemp);
 float getTemperature(temperature *t);
+void setTemperature(temperature *t, float temp);
 void updateTemperature(temperature *t, int nAccepted, int nTotal);
-int checkTemperatureStopCriteria(temperature *t, float *cost, int N);
+int checkTemperatureStopCriteria(temperature *t, float total_cost, int N);
 void deleteTemperature(temperature *t);
 
 // Spatial Mapping
@@ -243,6 +306,28 @@ int **getPlaceablePositions(cgra *fs, dfg_instr *target, int **placed, int *sche
 void deleteMappablePosArr(int **mp, cgra *c);
 void deleteFreePosArr(int **fpos, cgra *fs);
 cgra *parallelize_mapping(cgra* c, dfg *d, int ***placed, int verbose);
+cgra *comap_kernels(cgra *template, dfg **dfgs, int n, int *ii_targets, int mapper, int maxII, dfg **combined, int ***placed, int *copies, int verbose);
+cgra *unroll_search(cgra *template, dfg *d, int maxU, int mapper, dfg **unrolled, int ***placed, int *best_U, int verbose);
+
+// Replication Mapping
+int findReplicatedSubgraphs(dfg *d, int ***copies, int *n_copies, int *copy_size);
+void deleteReplicatedSubgraphs(int **copies, int n_copies);
+int placeReplica(cgra *fs, dfg *d, int *ids, int n, int *refPos, int *refSched, int **placed, int *schedule, int II,
+                 int *inCnt, int *outCnt);
+
+// Exact Mapping
+typedef struct _exact_model exact_model;
+exact_model *buildExactModel(cgra *fs, dfg *d, dfg_instr **dfg_ops, int II);
+int solveExactModel(exact_model *em, long maxConflicts);
+void getExactSolution(exact_model *em, int *pos, int *schedule);
+void blockExactSolution(exact_model *em, int *ids, int n);
+void limitExactLifetimes(exact_model *em, cgra *fs, int slack);
+int exactModelIsComplete(exact_model *em);
+void getExactModelSize(exact_model *em, int *vars, int *clauses);
+void deleteExactModel(exact_model *em);
+int proveMinII(cgra *template, dfg *d, int MII, int maxII, long maxConflicts, int verbose);
+void set_ii_prover(int enable);
+int get_ii_prover(void);
 
 // Resources and Utilization
 int define_exec_time(cgra *first_slice, dfg *d, int **placed, int II);
@@ -265,6 +350,8 @@ int maxVectIterPerCycle(cgra *c, int unrollingFactor);
 float ratioII(cgra *c);
 float get_cgra_area_estimate(cgra *c);
 float get_cgra_power_estimate(cgra *c);
+void init_pe_prune(pe_prune *p);
+int get_pe_prune_delta(cgra *c, int i, int j, const pe_prune *p, float *d_area, float *d_power);
 float get_resource_cost(cgra *c, dfg *d, int **placed);
 
 // Other Analyses
@@ -273,15 +360,34 @@ void display_animation(cgra *c, dfg *d, int **placed);
 void mapping_summary(cgra *c, dfg *d, int **placed);
 
 // Pruning
-void auto_prune(cgra **c, dfg **d, cgra *template, int N, int *prune_info);
+void auto_prune(cgra **c, dfg **d, cgra *template, int N, int *prune_info, float *prune_savings);
 cgra *load_mapping(cgra *template, cgra *target);
 cgra *buildHmgCopy(cgra *c, int rows, int cols);
-cgra *generateInitialDesignPoint(dfg **dfg_targets, int n_dfgs, char *constraints_file);
-cgra *aggressiveOpt(cgra *template, cgra **mapped_devs, dfg **dfg_targets, int n_dfgs, char *opt_target, char *constraints_file);
+
+// Mapping State Records
+int get_pe_state_words(int n_or, int rf, int cu);
+void get_max_pe_resources(cgra *c, int *n_or, int *rf, int *cu);
+void pack_pe_state(cgra *c, int i, int j, int *rec, int n_or, int rf, int cu);
+int unpack_pe_state(cgra *c, dfg *d, int i, int j, const int *rec, int n_or, int rf, int cu);
+int pack_conn_states(cgra *c, int *buf);
+int unpack_conn_state(cgra *c, const int *rec);
+int *get_device_signature(cgra *c, int *n_words);
+
+// DSE
+typedef struct _dse_constraints dse_constraints;
+dse_constraints *load_dse_constraints(const char *filename);
+void delete_dse_constraints(dse_constraints *k);
+cgra *generateInitialDesignPoint(dfg **dfg_targets, int n_dfgs, dse_constraints *constraints);
+cgra *aggressiveOpt(cgra *template, cgra **mapped_devs, dfg **dfg_targets, int n_dfgs, char *opt_target, dse_constraints *constraints);
+int paretoDSE(cgra *template, dfg **dfg_targets, int n_dfgs, dse_constraints *constraints, char *filename);
 
 // Exports
 int exportMapping(cgra *fs, dfg *d, int ***placed, char *filename, int vectorWidth);
+struct json_value_t *getMappingJSON(cgra *fs, dfg *d, int ***placed, int vectorWidth); // JSON_Value (parson.h)
 int exportArch(cgra *fs, char *filename, int II, int vectorWidth);
+int exportBitstream(cgra *fs, dfg *d, int ***placed, char *filename, int vectorWidth);
+cgra *importBitstream(cgra *template, dfg *d, int **placed, char *filename);
+int diffBitstreams(char *filename1, char *filename2, int verbose);
 
 void display_conns(cgra *c);
 
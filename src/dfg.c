@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <omp.h>
 #include "Item.h"
 
 #define SUBLIST_STREAM_IN 0
@@ -19,13 +20,17 @@ typedef struct _dfg_instr
     int n_inputs;
     int n_outputs;
     int n_recurrences;
+    int n_rec_inputs;
     int n_consts;
     struct _dfg_instr **inputs;
     struct _dfg_instr **outputs;
     struct _dfg_instr **recurrences;
+    struct _dfg_instr **rec_inputs; // other instructions with a recurrence edge to this one
     struct _dfg_instr **consts; // constants associated with this instruction
     int *rec_distances;
     int *trnsf_lat; // transf latency from the inputs
+    float criticality; // [0, 1], 1 for nodes with no slack (set by computeCriticality, scheduler.c)
+    int rec_cycle;     // 1 if the node is part of a recurrence cycle
 } dfg_instr;
 
 typedef struct _dfg
@@ -38,6 +43,10 @@ typedef struct _dfg
     int sorted; // auxiliary variable to check if the dfg was topologically sorted or not
 } dfg;
 
+// Id of the next instruction. Each thread numbers the dfgs it builds on its own (mapping server workers, parallel mappers)
+static int next_instr_id = 1;
+#pragma omp threadprivate(next_instr_id)
+
 /**
  * Creates an Instruction
  * Inputs: operation, latency, number of inputs and outputs
@@ -47,10 +56,9 @@ dfg_instr *create_instr(char *name, char *op, int lat, int n_inputs, int n_outpu
 
     dfg_instr *new = (dfg_instr *)malloc(sizeof(dfg_instr));
 
-    static int id = 1;
     if (reset_id == 1)
-        id = 1;
-    new->id = id++;
+        next_instr_id = 1;
+    new->id = next_instr_id++;
     new->lat = lat;
 
     new->op = (char *)calloc((strlen(op) + 1), sizeof(char));
@@ -68,8 +76,12 @@ dfg_instr *create_instr(char *name, char *op, int lat, int n_inputs, int n_outpu
     new->recurrences = (dfg_instr **)calloc(n_recurrences, sizeof(dfg_instr *));
     new->rec_distances = (int *)calloc(n_recurrences, sizeof(int));
     new->consts = (dfg_instr **)calloc(n_consts, sizeof(dfg_instr *));
+    new->n_rec_inputs = 0;
+    new->rec_inputs = NULL;
 
     new->trnsf_lat = (int*)calloc(n_inputs, sizeof(int));
+    new->criticality = 0;
+    new->rec_cycle = 0;
 
     return new;
 }
@@ -82,6 +94,10 @@ dfg_instr *copy_instr(dfg_instr *target)
     int i;
 
     copy->id = target->id;
+    copy->const_val = target->const_val;
+    memcpy(copy->trnsf_lat, target->trnsf_lat, target->n_inputs * sizeof(int));
+    copy->criticality = target->criticality;
+    copy->rec_cycle = target->rec_cycle;
 
     for (i = 0; i < target->n_inputs; i++)
     {
@@ -98,6 +114,12 @@ dfg_instr *copy_instr(dfg_instr *target)
     for (i = 0; i < target->n_consts; i++){
         copy->consts[i] = target->consts[i];
     }
+    if (target->n_rec_inputs > 0)
+    {
+        copy->rec_inputs = (dfg_instr **)malloc(target->n_rec_inputs * sizeof(dfg_instr *));
+        memcpy(copy->rec_inputs, target->rec_inputs, target->n_rec_inputs * sizeof(dfg_instr *));
+        copy->n_rec_inputs = target->n_rec_inputs;
+    }
 
     return copy;
 }
@@ -207,6 +229,11 @@ int set_recurrence(dfg_instr *target, dfg_instr *rec, int idx, int dist)
         {
             target->recurrences[i] = rec;
             target->rec_distances[i] = dist;
+            if (rec != target)
+            {
+                rec->rec_inputs = (dfg_instr **)realloc(rec->rec_inputs, (rec->n_rec_inputs + 1) * sizeof(dfg_instr *));
+                rec->rec_inputs[rec->n_rec_inputs++] = target;
+            }
             return 1;
         }
     }
@@ -237,6 +264,19 @@ dfg_instr* get_recurrence(dfg_instr *target, int idx)
     return target->recurrences[idx];
 }
 
+/**
+ * Instructions (other than target itself) whose value target reads in a later iteration, through a recurrence edge
+ */
+int get_n_rec_inputs(dfg_instr *target)
+{
+    return target->n_rec_inputs;
+}
+
+dfg_instr *get_rec_input(dfg_instr *target, int idx)
+{
+    return target->rec_inputs[idx];
+}
+
 dfg_instr *get_const(dfg_instr *target, int idx){
     return target->consts[idx];
 }
@@ -299,6 +339,22 @@ void set_input_trnsf_lat(dfg_instr *t, int i, int lat){
     t->trnsf_lat[i] = lat;
 }
 
+float get_instr_criticality(dfg_instr *t)
+{
+    return t->criticality;
+}
+
+int is_on_rec_cycle(dfg_instr *t)
+{
+    return t->rec_cycle;
+}
+
+void set_instr_criticality(dfg_instr *t, float criticality, int rec_cycle)
+{
+    t->criticality = criticality;
+    t->rec_cycle = rec_cycle;
+}
+
 /**
  * Returns target's parameter: n_inputs (number of inputs)
  */
@@ -377,6 +433,16 @@ dfg_instr *get_instr_by_op_id(dfg *d, int id){
     return NULL;
 }
 
+dfg_instr *get_instr_by_name(dfg *d, char *name){
+    int i;
+    for (i = 0; i < d->N; i++)
+    {
+        if (!strcmp(d->d[i]->name, name))
+            return d->d[i];
+    }
+    return NULL;
+}
+
 dfg_instr *get_dfg_instr(dfg *d, int idx)
 {
     if (idx >= 0 && idx < d->N)
@@ -447,6 +513,7 @@ void delete_instr(dfg_instr *i)
     free(i->trnsf_lat);
     free(i->recurrences);
     free(i->rec_distances);
+    free(i->rec_inputs);
     free(i->op);
     free(i->consts);
     free(i);
@@ -488,50 +555,292 @@ void restore_dfg(dfg *d){
 dfg *copy_dfg(dfg *target)
 {
 
-    dfg *copy = create_dfg(NULL, target->N, NULL, target->NConsts);
-    int i, j;
-
+    dfg *copy;
     dfg_instr **d = (dfg_instr **)malloc(target->N * sizeof(dfg_instr *));
-    dfg_instr **bckup = (dfg_instr **)malloc(target->N * sizeof(dfg_instr *));
     dfg_instr **c = (dfg_instr **)malloc(target->NConsts * sizeof(dfg_instr *));
+    dfg_instr **by_id, *t;
+    int i, j, max_id = 0;
+
+    for (i = 0; i < target->N; i++)
+        max_id = target->d[i]->id > max_id ? target->d[i]->id : max_id;
+    for (i = 0; i < target->NConsts; i++)
+        max_id = target->consts[i]->id > max_id ? target->consts[i]->id : max_id;
+    by_id = (dfg_instr **)calloc(max_id + 1, sizeof(dfg_instr *));
 
     for (i = 0; i < target->N; i++)
     {
         d[i] = copy_instr(target->d[i]);
-        bckup[i] = d[i];
+        by_id[d[i]->id] = d[i];
     }
-    
+    for (i = 0; i < target->NConsts; i++)
+    {
+        c[i] = copy_instr(target->consts[i]);
+        by_id[c[i]->id] = c[i];
+    }
+
+    // Every reference of the copies still points to the original instructions
+    for (i = 0; i < target->N + target->NConsts; i++)
+    {
+        t = i < target->N ? d[i] : c[i - target->N];
+        for (j = 0; j < t->n_inputs; j++)
+            t->inputs[j] = t->inputs[j] != NULL ? by_id[t->inputs[j]->id] : NULL;
+        for (j = 0; j < t->n_outputs; j++)
+            t->outputs[j] = t->outputs[j] != NULL ? by_id[t->outputs[j]->id] : NULL;
+        for (j = 0; j < t->n_recurrences; j++)
+            t->recurrences[j] = t->recurrences[j] != NULL ? by_id[t->recurrences[j]->id] : NULL;
+        for (j = 0; j < t->n_rec_inputs; j++)
+            t->rec_inputs[j] = t->rec_inputs[j] != NULL ? by_id[t->rec_inputs[j]->id] : NULL;
+        for (j = 0; j < t->n_consts; j++)
+            t->consts[j] = t->consts[j] != NULL ? by_id[t->consts[j]->id] : NULL;
+    }
+
+    copy = create_dfg(d, target->N, c, target->NConsts);
     for (i = 0; i < target->N; i++)
+        copy->backup_instr_arr[i] = by_id[target->backup_instr_arr[i]->id];
+    copy->sorted = target->sorted;
+    free(by_id);
+
+    return copy;
+}
+
+/**
+ * Creates a new dfg with copies of a subset of instructions (given by id, in order).
+ * Edges to instructions outside of the subset are dropped and constants are duplicated.
+ * The new instructions are numbered from 1, following the order of the subset.
+ */
+dfg *extract_subdfg(dfg *d, int *ids, int n)
+{
+    int i, k, cnt, nc = 0, *new_idx = (int *)malloc(d->N * sizeof(int));
+    dfg_instr *t, **instrs = (dfg_instr **)malloc(n * sizeof(dfg_instr *)), **consts;
+
+    for (i = 0; i < d->N; i++)
+        new_idx[i] = -1;
+    for (i = 0; i < n; i++)
+        new_idx[ids[i] - 1] = i;
+
+    for (i = 0; i < n; i++)
+    {
+        t = get_instr_by_op_id(d, ids[i]);
+        int n_in = 0, n_out = 0, n_rec = 0;
+        for (k = 0; k < t->n_inputs; k++)
+            n_in += new_idx[t->inputs[k]->id - 1] >= 0;
+        for (k = 0; k < t->n_outputs; k++)
+            n_out += new_idx[t->outputs[k]->id - 1] >= 0;
+        for (k = 0; k < t->n_recurrences; k++)
+            n_rec += t->recurrences[k] != NULL && new_idx[t->recurrences[k]->id - 1] >= 0;
+        instrs[i] = create_instr(t->name, t->op, t->lat, n_in, n_out, n_rec, t->n_consts, i == 0);
+        nc += t->n_consts;
+    }
+
+    consts = (dfg_instr **)malloc(nc * sizeof(dfg_instr *));
+    nc = 0;
+    for (i = 0; i < n; i++)
     {
-        for (j = 0; j < d[i]->n_inputs; j++){
-            d[i]->inputs[j] = d[d[i]->inputs[j]->id - 1];
+        t = get_instr_by_op_id(d, ids[i]);
+        for (k = 0, cnt = 0; k < t->n_inputs; k++)
+            if (new_idx[t->inputs[k]->id - 1] >= 0)
+                set_input(instrs[i], instrs[new_idx[t->inputs[k]->id - 1]], cnt++);
+        for (k = 0, cnt = 0; k < t->n_outputs; k++)
+            if (new_idx[t->outputs[k]->id - 1] >= 0)
+                set_output(instrs[i], instrs[new_idx[t->outputs[k]->id - 1]], cnt++);
+        for (k = 0; k < t->n_recurrences; k++)
+            if (t->recurrences[k] != NULL && new_idx[t->recurrences[k]->id - 1] >= 0)
+                set_recurrence(instrs[i], instrs[new_idx[t->recurrences[k]->id - 1]], k, t->rec_distances[k]);
+        for (k = 0; k < t->n_consts; k++)
+        {
+            consts[nc] = create_instr(t->consts[k]->name, t->consts[k]->op, t->consts[k]->lat, 0, 1, 0, 0, 0);
+            set_const_val(consts[nc], t->consts[k]->const_val);
+            set_output(consts[nc], instrs[i], 0);
+            set_const(instrs[i], consts[nc++], k);
         }
-        for (j = 0; j < d[i]->n_outputs; j++){
-            d[i]->outputs[j] = d[d[i]->outputs[j]->id - 1];
+    }
+
+    free(new_idx);
+    return create_dfg(instrs, n, consts, nc);
+}
+
+/**
+ * Returns the disjoint union of n dfgs, with copies[k] copies of dfgs ds[k] (one of each if copies is NULL).
+ * Nodes are renumbered in order (dfg, copy, id) and named "k<dfg>_<name>" ("k<dfg>.<copy>_<name>" for extra copies).
+ */
+dfg *merge_dfgs(dfg **ds, int *copies, int n)
+{
+    int k, r, i, q, cnt, N = 0, nc = 0, base;
+    char name[MAX_OP_NAME_LEN + 32];
+    dfg_instr *t, *m, **instrs, **consts;
+
+    for (k = 0; k < n; k++)
+    {
+        N += ds[k]->N * (copies != NULL ? copies[k] : 1);
+        nc += ds[k]->NConsts * (copies != NULL ? copies[k] : 1);
+    }
+    instrs = (dfg_instr **)malloc(N * sizeof(dfg_instr *));
+    consts = (dfg_instr **)malloc((nc + 1) * sizeof(dfg_instr *));
+
+    // Instructions first, so that their ids are 1..N
+    for (k = 0, base = 0; k < n; k++)
+    {
+        for (r = 0; r < (copies != NULL ? copies[k] : 1); r++, base += ds[k]->N)
+        {
+            for (i = 0; i < ds[k]->N; i++)
+            {
+                t = get_instr_by_op_id(ds[k], i + 1);
+                if (r == 0)
+                    snprintf(name, sizeof(name), "k%d_%s", k + 1, t->name);
+                else
+                    snprintf(name, sizeof(name), "k%d.%d_%s", k + 1, r + 1, t->name);
+                for (q = 0, cnt = 0; q < t->n_recurrences; q++)
+                    cnt += t->recurrences[q] != NULL;
+                instrs[base + i] = create_instr(name, t->op, t->lat, t->n_inputs, t->n_outputs, cnt, t->n_consts, base + i == 0);
+            }
         }
     }
 
-    for (i = 0; i < target->NConsts; i++)
+    nc = 0;
+    for (k = 0, base = 0; k < n; k++)
     {
-        c[i] = copy_instr(target->consts[i]);
+        for (r = 0; r < (copies != NULL ? copies[k] : 1); r++, base += ds[k]->N)
+        {
+            for (i = 0; i < ds[k]->N; i++)
+            {
+                t = get_instr_by_op_id(ds[k], i + 1);
+                m = instrs[base + i];
+                for (q = 0; q < t->n_inputs; q++)
+                {
+                    set_input(m, instrs[base + t->inputs[q]->id - 1], q);
+                    m->trnsf_lat[q] = t->trnsf_lat[q];
+                }
+                for (q = 0; q < t->n_outputs; q++)
+                    set_output(m, instrs[base + t->outputs[q]->id - 1], q);
+                for (q = 0, cnt = 0; q < t->n_recurrences; q++)
+                    if (t->recurrences[q] != NULL)
+                        set_recurrence(m, instrs[base + t->recurrences[q]->id - 1], cnt++, t->rec_distances[q]);
+                for (q = 0; q < t->n_consts; q++)
+                {
+                    consts[nc] = create_instr(t->consts[q]->name, t->consts[q]->op, t->consts[q]->lat, 0, 1, 0, 0, 0);
+                    set_const_val(consts[nc], t->consts[q]->const_val);
+                    set_output(consts[nc], m, 0);
+                    set_const(m, consts[nc++], q);
+                }
+            }
+        }
     }
-    
-    for (i = 0; i < target->NConsts; i++)
+
+    return create_dfg(instrs, N, consts, nc);
+}
+
+/**
+ * Returns the dfg unrolled U times: copy r computes iteration U * i + r of the original loop.
+ * Nodes are renumbered in order (copy, id), copy r > 0 is named "u<r>_<name>" and every copy has its own
+ * streams. A recurrence of distance dist read by copy u comes from copy (u - dist) mod U of the producer.
+ * If that copy belongs to the same unrolled iteration, the edge becomes an input of the consumer (appended
+ * to its inputs), otherwise it stays a recurrence, with distance ceil((dist - u) / U).
+ */
+dfg *unroll_dfg(dfg *d, int U)
+{
+    int r, u, i, q, src, dist, prod, cons, N = d->N, nc = 0;
+    int *n_in = (int *)calloc(N * U, sizeof(int)), *n_out = (int *)calloc(N * U, sizeof(int)), *n_rec = (int *)calloc(N * U, sizeof(int));
+    char name[MAX_OP_NAME_LEN + 32];
+    dfg_instr *t, *m, **instrs = (dfg_instr **)malloc(N * U * sizeof(dfg_instr *)), **consts = (dfg_instr **)malloc((d->NConsts * U + 1) * sizeof(dfg_instr *));
+
+    // Edges of each copy (the original ones plus the recurrences that became inputs)
+    for (i = 0; i < N; i++)
     {
-        for (j = 0; j < c[i]->n_inputs; j++){
-            c[i]->inputs[j] = c[c[i]->inputs[j]->id - 1];
+        t = get_instr_by_op_id(d, i + 1);
+        for (u = 0; u < U; u++)
+        {
+            n_in[u * N + i] += t->n_inputs;
+            n_out[u * N + i] += t->n_outputs;
+        }
+        for (q = 0; q < t->n_recurrences; q++)
+        {
+            if (t->recurrences[q] == NULL)
+                continue;
+            for (u = 0; u < U; u++)
+            {
+                src = u - t->rec_distances[q];
+                r = ((src % U) + U) % U;
+                prod = r * N + i;
+                cons = u * N + t->recurrences[q]->id - 1;
+                if (r - src > 0)
+                    n_rec[prod]++;
+                else
+                {
+                    n_in[cons]++;
+                    n_out[prod]++;
+                }
+            }
         }
-        for (j = 0; j < c[i]->n_outputs; j++){
-            c[i]->outputs[j] = c[c[i]->outputs[j]->id - 1];
+    }
+
+    for (u = 0; u < U; u++)
+    {
+        for (i = 0; i < N; i++)
+        {
+            t = get_instr_by_op_id(d, i + 1);
+            if (u == 0)
+                snprintf(name, sizeof(name), "%s", t->name);
+            else
+                snprintf(name, sizeof(name), "u%d_%s", u, t->name);
+            instrs[u * N + i] = create_instr(name, t->op, t->lat, n_in[u * N + i], n_out[u * N + i], n_rec[u * N + i], t->n_consts, u * N + i == 0);
         }
     }
 
-    copy->d = d;
-    copy->consts = c;
+    // Original edges and constants of each copy first, so that the recurrences that became edges are appended
+    for (u = 0; u < U; u++)
+    {
+        for (i = 0; i < N; i++)
+        {
+            t = get_instr_by_op_id(d, i + 1);
+            m = instrs[u * N + i];
+            for (q = 0; q < t->n_inputs; q++)
+            {
+                set_input(m, instrs[u * N + t->inputs[q]->id - 1], q);
+                m->trnsf_lat[q] = t->trnsf_lat[q];
+            }
+            for (q = 0; q < t->n_outputs; q++)
+                set_output(m, instrs[u * N + t->outputs[q]->id - 1], q);
+            for (q = 0; q < t->n_consts; q++)
+            {
+                consts[nc] = create_instr(t->consts[q]->name, t->consts[q]->op, t->consts[q]->lat, 0, 1, 0, 0, 0);
+                set_const_val(consts[nc], t->consts[q]->const_val);
+                set_output(consts[nc], m, 0);
+                set_const(m, consts[nc++], q);
+            }
+            n_in[u * N + i] = t->n_inputs;
+            n_out[u * N + i] = t->n_outputs;
+        }
+    }
 
-    copy->sorted = target->sorted;
+    for (i = 0; i < N; i++)
+    {
+        t = get_instr_by_op_id(d, i + 1);
+        for (q = 0; q < t->n_recurrences; q++)
+        {
+            if (t->recurrences[q] == NULL)
+                continue;
+            for (u = 0; u < U; u++)
+            {
+                src = u - t->rec_distances[q];
+                r = ((src % U) + U) % U;
+                dist = (r - src) / U;
+                prod = r * N + i;
+                cons = u * N + t->recurrences[q]->id - 1;
+                if (dist > 0)
+                    set_recurrence(instrs[prod], instrs[cons], 0, dist);
+                else
+                {
+                    set_input(instrs[cons], instrs[prod], n_in[cons]++);
+                    set_output(instrs[prod], instrs[cons], n_out[prod]++);
+                }
+            }
+        }
+    }
 
-    return copy;
+    free(n_in);
+    free(n_out);
+    free(n_rec);
+    return create_dfg(instrs, N * U, consts, nc);
 }
 
 void set_dfg_sorted(dfg *d, int sorted)
@@ -837,3 +1146,1387 @@ void delete_dfg(dfg *d, int delete_instrs)
     free(d->backup_instr_arr);
     free(d);
 }
+
+/*************************************************************
+ * DFG Optimization Passes
+ * The passes work on an index-based view of the dfg (node i holds instruction id i + 1),
+ * where producers are referenced by index and constants by value. The optimized dfg is then
+ * rebuilt from the nodes left alive, renumbered in the original order.
+ * Nodes tied to recurrence edges are only rewritten by reassociation and fusion, which keep the recurrences.
+ *************************************************************/
+
+// Pass selection, statistics and target (must match dfg.h)
+#define DFG_PASS_FOLD 0
+#define DFG_PASS_REASSOC 1
+#define DFG_PASS_FUSE 2
+#define DFG_PASS_STRENGTH 3
+#define DFG_PASS_CSE 4
+#define DFG_PASS_DCE 5
+#define DFG_N_PASSES 6
+// fold relies on the constants' values, which DOT constants without one read as 0: it only runs when named
+#define DFG_DEFAULT_PASSES (((1 << DFG_N_PASSES) - 1) & ~(1 << DFG_PASS_FOLD))
+
+typedef struct
+{
+    int runs;      // times the pass was run
+    int removed;   // nodes removed
+    int rewritten; // nodes rewritten in place
+    double time;   // seconds
+} dfg_pass_stats;
+
+// Operation supported by the target device, with the most constant operands it can read
+typedef struct
+{
+    const char *op;
+    int max_consts;
+} dfg_target_op;
+
+typedef struct
+{
+    int orig; // index in the dfg's constants array (-1 for a constant created by a pass)
+    int val;
+    char name[MAX_OP_NAME_LEN];
+} opt_const;
+
+typedef struct
+{
+    dfg_instr *t; // original instruction (NULL for a node created by a transformation)
+    char name[MAX_OP_NAME_LEN];
+    char *op; // operation (rewritten by strength reduction and fusion)
+    int lat;
+    int alive;
+    int fixed; // part of a recurrence
+    int n_inputs, n_consts;
+    int *inputs; // producers, by node index
+    int *trnsf_lat;
+    opt_const *consts;
+    int n_recs;    // recurrence edges: nodes that read this node's value in a later iteration
+    int *recs;     // by node index
+    int *rec_dist; // iteration distance of each recurrence edge
+} opt_node;
+
+static const char *pass_names[DFG_N_PASSES] = {"fold", "reassoc", "fuse", "strength", "cse", "dce"};
+
+static int is_op(opt_node *n, const char *op)
+{
+    return !strcmp(n->op, op);
+}
+
+static int is_pure_op(opt_node *n)
+{
+    return !is_op(n, "STREAM_IN") && !is_op(n, "STREAM_OUT") && !is_op(n, "LOAD") && !is_op(n, "STORE") &&
+           !is_op(n, "PHI") && !is_op(n, "BR") && !is_op(n, "CONST");
+}
+
+static int is_commutative_op(opt_node *n)
+{
+    return is_op(n, "ADD") || is_op(n, "MUL") || is_op(n, "AND") || is_op(n, "OR") || is_op(n, "XOR") ||
+           is_op(n, "FADD") || is_op(n, "FMUL");
+}
+
+/**
+ * Evaluates an integer operation over constant operands (in order).
+ * Returns 1 if the operation can be folded, 0 otherwise.
+ */
+static int eval_const_op(opt_node *n, int *val)
+{
+    int k, v;
+
+    if (n->n_consts <= 0)
+        return 0;
+    v = n->consts[0].val;
+    for (k = 1; k < n->n_consts; k++)
+    {
+        if (is_op(n, "ADD"))
+            v += n->consts[k].val;
+        else if (is_op(n, "SUB"))
+            v -= n->consts[k].val;
+        else if (is_op(n, "MUL"))
+            v *= n->consts[k].val;
+        else if (is_op(n, "AND"))
+            v &= n->consts[k].val;
+        else if (is_op(n, "OR"))
+            v |= n->consts[k].val;
+        else if (is_op(n, "XOR"))
+            v ^= n->consts[k].val;
+        else
+            return 0;
+    }
+    if (!is_op(n, "ADD") && !is_op(n, "SUB") && !is_op(n, "MUL") && !is_op(n, "AND") && !is_op(n, "OR") && !is_op(n, "XOR"))
+        return 0;
+    *val = v;
+    return 1;
+}
+
+/**
+ * Returns the most constant operands an operation can read on the target device
+ * (__INT_MAX__ if there is no target, -1 if the target does not support the operation)
+ */
+static int target_max_consts(const dfg_target_op *target, const char *op)
+{
+    int k;
+
+    if (target == NULL)
+        return __INT_MAX__;
+    for (k = 0; target[k].op != NULL; k++)
+        if (!strcmp(target[k].op, op))
+            return target[k].max_consts;
+    return -1;
+}
+
+/**
+ * Checks if every consumer of node p accepts it being replaced by a constant (or by node to, if to >= 0).
+ */
+static int can_replace_uses(opt_node *nodes, int N, int p, int to, const dfg_target_op *target)
+{
+    int i, k, uses, max;
+    for (i = 0; i < N; i++)
+    {
+        if (!nodes[i].alive)
+            continue;
+        for (k = 0, uses = 0; k < nodes[i].n_inputs; k++)
+            uses += nodes[i].inputs[k] == p;
+        if (uses == 0)
+            continue;
+        // Stream outputs do not take constants, nor are they fed directly by stream inputs
+        if (is_op(&nodes[i], "STREAM_OUT") && (to < 0 || is_op(&nodes[to], "STREAM_IN")))
+            return 0;
+        // The consumer must be able to read the new constants (operations the device lacks are not checked)
+        max = target_max_consts(target, nodes[i].op);
+        if (to < 0 && max >= 0 && nodes[i].n_consts + uses > max)
+            return 0;
+    }
+    return 1;
+}
+
+static void replace_uses(opt_node *nodes, int N, int from, int to)
+{
+    int i, k;
+    for (i = 0; i < N; i++)
+        for (k = 0; k < nodes[i].n_inputs; k++)
+            if (nodes[i].alive && nodes[i].inputs[k] == from)
+                nodes[i].inputs[k] = to;
+}
+
+/**
+ * Replaces every use of node p by a new constant with value val
+ */
+static void fold_uses(opt_node *nodes, int N, int p, int val)
+{
+    int i, k, q;
+    opt_node *n;
+
+    for (i = 0; i < N; i++)
+    {
+        n = &nodes[i];
+        for (k = 0; n->alive && k < n->n_inputs; k++)
+        {
+            if (n->inputs[k] != p)
+                continue;
+            n->consts[n->n_consts].orig = -1;
+            n->consts[n->n_consts].val = val;
+            strcpy(n->consts[n->n_consts++].name, nodes[p].name);
+            for (q = k; q < n->n_inputs - 1; q++)
+            {
+                n->inputs[q] = n->inputs[q + 1];
+                n->trnsf_lat[q] = n->trnsf_lat[q + 1];
+            }
+            n->n_inputs--;
+            k--;
+        }
+    }
+}
+
+/**
+ * Constant folding: constant-only arithmetic becomes a constant of its consumers,
+ * x + 0, x | 0, x ^ 0 and x * 1 are forwarded to x, and x * 0, x & 0 become 0.
+ */
+static void pass_fold(opt_node *nodes, int N, const dfg_target_op *target, dfg_pass_stats *st)
+{
+    int i, val, c;
+    opt_node *n;
+
+    for (i = 0; i < N; i++)
+    {
+        n = &nodes[i];
+        if (!n->alive || n->fixed || !is_pure_op(n))
+            continue;
+        if (n->n_inputs == 0 && eval_const_op(n, &val))
+        {
+            if (!can_replace_uses(nodes, N, i, -1, target))
+                continue;
+            fold_uses(nodes, N, i, val);
+        }
+        else if (n->n_inputs == 1 && n->n_consts == 1)
+        {
+            c = n->consts[0].val;
+            if ((c == 0 && (is_op(n, "ADD") || is_op(n, "OR") || is_op(n, "XOR"))) || (c == 1 && is_op(n, "MUL")))
+            {
+                if (!can_replace_uses(nodes, N, i, n->inputs[0], target))
+                    continue;
+                replace_uses(nodes, N, i, n->inputs[0]);
+            }
+            else if (c == 0 && (is_op(n, "MUL") || is_op(n, "AND")))
+            {
+                if (!can_replace_uses(nodes, N, i, -1, target))
+                    continue;
+                fold_uses(nodes, N, i, 0);
+            }
+            else
+                continue;
+        }
+        else
+            continue;
+        n->alive = 0;
+        st->removed++;
+    }
+}
+
+static int count_uses(opt_node *nodes, int N, int p)
+{
+    int i, k, cnt = 0;
+    for (i = 0; i < N; i++)
+        for (k = 0; nodes[i].alive && k < nodes[i].n_inputs; k++)
+            cnt += nodes[i].inputs[k] == p;
+    return cnt;
+}
+
+/**
+ * Counts the operands node i reads through recurrence edges (e.g. the previous value of an accumulator)
+ */
+static int count_rec_uses(opt_node *nodes, int N, int i)
+{
+    int j, r, cnt = 0;
+    for (j = 0; j < N; j++)
+        for (r = 0; nodes[j].alive && r < nodes[j].n_recs; r++)
+            cnt += nodes[j].recs[r] == i;
+    return cnt;
+}
+
+static void mark_fixed(opt_node *nodes, int N)
+{
+    int i, r;
+    for (i = 0; i < N; i++)
+        nodes[i].fixed = 0;
+    for (i = 0; i < N; i++)
+        for (r = 0; nodes[i].alive && r < nodes[i].n_recs; r++)
+            nodes[i].fixed = nodes[nodes[i].recs[r]].fixed = 1;
+}
+
+static int is_assoc_op(opt_node *n)
+{
+    return is_op(n, "ADD") || is_op(n, "MUL") || is_op(n, "AND") || is_op(n, "OR") || is_op(n, "XOR");
+}
+
+/**
+ * Earliest cycle at which each node's result is ready, ignoring recurrence edges (-1 for removed nodes)
+ */
+static void compute_asap(opt_node *nodes, int N, int *asap)
+{
+    int i, k, t, round, changed;
+
+    for (i = 0; i < N; i++)
+        asap[i] = nodes[i].alive ? nodes[i].lat : -1;
+    for (round = 0, changed = 1; changed && round <= N; round++)
+    {
+        changed = 0;
+        for (i = 0; i < N; i++)
+        {
+            for (k = 0, t = 0; nodes[i].alive && k < nodes[i].n_inputs; k++)
+                if (asap[nodes[i].inputs[k]] + nodes[i].trnsf_lat[k] > t)
+                    t = asap[nodes[i].inputs[k]] + nodes[i].trnsf_lat[k];
+            if (nodes[i].alive && t + nodes[i].lat > asap[i])
+            {
+                asap[i] = t + nodes[i].lat;
+                changed = 1;
+            }
+        }
+    }
+}
+
+#define REASSOC_INPUT 0
+#define REASSOC_CONST 1
+#define REASSOC_REC 2  // operand read through a recurrence edge
+#define REASSOC_NODE 3 // result of another node of the tree
+
+typedef struct
+{
+    int kind;
+    int idx;  // producer node (REASSOC_INPUT, REASSOC_REC) or tree node (REASSOC_NODE)
+    int edge; // recurrence edge of the producer (REASSOC_REC)
+    int trnsf_lat;
+    int ready; // cycle the value is ready
+    int depth; // operations between the value carried by the recurrence and this one (-1 if it does not depend on it)
+} reassoc_operand;
+
+// Operands that depend on the recurrence are combined last, the others earliest ready first
+static int reassoc_before(reassoc_operand *a, reassoc_operand *b)
+{
+    if ((a->depth < 0) != (b->depth < 0))
+        return a->depth < 0;
+    if (a->depth != b->depth)
+        return a->depth < b->depth;
+    return a->ready < b->ready;
+}
+
+static void reassoc_join(reassoc_operand *r, reassoc_operand *a)
+{
+    if (a->ready > r->ready)
+        r->ready = a->ready;
+    if (a->depth > r->depth)
+        r->depth = a->depth;
+}
+
+// Node x of the chain of o: same operation and latency, two operands
+static int is_chain_node(opt_node *nodes, int N, int x, opt_node *o)
+{
+    return nodes[x].alive && !strcmp(nodes[x].op, o->op) && nodes[x].lat == o->lat &&
+           nodes[x].n_inputs + nodes[x].n_consts + count_rec_uses(nodes, N, x) == 2;
+}
+
+// Chain node whose result is only used by the next node of the chain
+static int is_chain_link(opt_node *nodes, int N, int x, opt_node *o)
+{
+    return is_chain_node(nodes, N, x, o) && nodes[x].n_recs == 0 && count_uses(nodes, N, x) == 1;
+}
+
+/**
+ * Tree rooted at chain node x, as it is: ready cycle and depth of its result
+ */
+static reassoc_operand reassoc_current(opt_node *nodes, int N, int x, int *member, reassoc_operand *leaf_in, reassoc_operand *leaf_rec)
+{
+    int k, p, r;
+    reassoc_operand res = {REASSOC_NODE, x, 0, 0, 0, -1}, op;
+
+    for (k = 0; k < nodes[x].n_inputs; k++)
+    {
+        if (member[nodes[x].inputs[k]])
+            op = reassoc_current(nodes, N, nodes[x].inputs[k], member, leaf_in, leaf_rec);
+        else
+        {
+            op = leaf_in[nodes[x].inputs[k]];
+            op.ready += nodes[x].trnsf_lat[k];
+        }
+        reassoc_join(&res, &op);
+    }
+    for (p = 0; p < N; p++)
+        for (r = 0; nodes[p].alive && r < nodes[p].n_recs; r++)
+            if (nodes[p].recs[r] == x)
+                reassoc_join(&res, &leaf_rec[p]);
+    res.ready += nodes[x].lat;
+    if (res.depth >= 0)
+        res.depth++;
+    return res;
+}
+
+/**
+ * Reassociation (tree-height reduction): a chain of the same associative integer operation (ADD, MUL, AND,
+ * OR, XOR), where every intermediate result has a single use, is rebuilt as a balanced tree over the same
+ * nodes. The operands are combined earliest ready first, and the value carried by a recurrence through the
+ * tree (e.g. the previous value of an accumulator) last, so that the recurrence cycle goes through a single
+ * operation. Constant operands are merged into one. A tree is only rewritten if its height improves.
+ */
+static void pass_reassoc(opt_node *nodes, int N, const dfg_target_op *target, dfg_pass_stats *st)
+{
+    int i, j, k, p, r, x = 0, n, m, n_c, n_leaves, changed, a, b, bad;
+    int *asap = (int *)malloc((N + 1) * sizeof(int)), *member = (int *)calloc(N + 1, sizeof(int));
+    int *fwd = (int *)calloc(N + 1, sizeof(int)), *dep = (int *)calloc(N + 1, sizeof(int));
+    int *list = (int *)malloc((N + 1) * sizeof(int)), *used = (int *)malloc((4 * N + 4) * sizeof(int));
+    reassoc_operand *leaf_in = (reassoc_operand *)calloc(N + 1, sizeof(reassoc_operand));
+    reassoc_operand *leaf_rec = (reassoc_operand *)calloc(N + 1, sizeof(reassoc_operand));
+    reassoc_operand *tree = (reassoc_operand *)malloc((4 * N + 4) * sizeof(reassoc_operand)), cur, *best, *t;
+    opt_const c;
+    opt_node *o;
+
+    for (i = 0; i < N; i++)
+    {
+        o = &nodes[i];
+        if (!is_assoc_op(o) || !is_chain_node(nodes, N, i, o))
+            continue;
+        // The root of the chain: not used by another node of the chain
+        if (is_chain_link(nodes, N, i, o))
+        {
+            for (j = 0; j < N; j++)
+                for (k = 0; nodes[j].alive && k < nodes[j].n_inputs; k++)
+                    if (nodes[j].inputs[k] == i)
+                        x = j;
+            if (is_chain_node(nodes, N, x, o))
+                continue;
+        }
+
+        // Chain nodes, from the root
+        memset(member, 0, N * sizeof(int));
+        member[i] = 1;
+        list[0] = i;
+        for (n = 0, m = 1; n < m; n++)
+        {
+            for (k = 0; k < nodes[list[n]].n_inputs; k++)
+            {
+                x = nodes[list[n]].inputs[k];
+                if (!member[x] && is_chain_link(nodes, N, x, o))
+                {
+                    member[x] = 1;
+                    list[m++] = x;
+                }
+            }
+        }
+        if (m < 2)
+            continue;
+
+        // Values carried from the tree's result in a previous iteration: the nodes downstream of the root (fwd)
+        // send recurrences to some nodes, and whatever depends on these (dep) comes from the previous result
+        memset(fwd, 0, N * sizeof(int));
+        memset(dep, 0, N * sizeof(int));
+        fwd[i] = 1;
+        do
+        {
+            changed = 0;
+            for (j = 0; j < N; j++)
+                for (k = 0; nodes[j].alive && !fwd[j] && k < nodes[j].n_inputs; k++)
+                    if (fwd[nodes[j].inputs[k]])
+                        fwd[j] = changed = 1;
+        } while (changed);
+        for (j = 0; j < N; j++)
+            for (r = 0; nodes[j].alive && fwd[j] && r < nodes[j].n_recs; r++)
+                dep[nodes[j].recs[r]] = 1;
+        do
+        {
+            changed = 0;
+            for (j = 0; j < N; j++)
+                for (k = 0; nodes[j].alive && !dep[j] && !member[j] && k < nodes[j].n_inputs; k++)
+                    if (dep[nodes[j].inputs[k]])
+                        dep[j] = changed = 1;
+        } while (changed);
+
+        compute_asap(nodes, N, asap);
+        for (j = 0; j < N; j++)
+        {
+            leaf_in[j] = (reassoc_operand){REASSOC_INPUT, j, 0, 0, asap[j], dep[j] && !member[j] ? 0 : -1};
+            leaf_rec[j] = (reassoc_operand){REASSOC_REC, j, 0, 0, 0, fwd[j] ? 0 : -1};
+        }
+
+        // Operands of the tree (the constants are merged into a single one)
+        n_leaves = n_c = 0;
+        for (n = 0; n < m; n++)
+        {
+            x = list[n];
+            for (k = 0; k < nodes[x].n_inputs; k++)
+            {
+                if (member[nodes[x].inputs[k]])
+                    continue;
+                tree[n_leaves] = leaf_in[nodes[x].inputs[k]];
+                tree[n_leaves].trnsf_lat = nodes[x].trnsf_lat[k];
+                tree[n_leaves++].ready += nodes[x].trnsf_lat[k];
+            }
+            for (p = 0; p < N; p++)
+                for (r = 0; nodes[p].alive && r < nodes[p].n_recs; r++)
+                    if (nodes[p].recs[r] == x)
+                    {
+                        tree[n_leaves] = leaf_rec[p];
+                        tree[n_leaves++].edge = r;
+                    }
+            for (k = 0; k < nodes[x].n_consts; k++, n_c++)
+            {
+                if (n_c == 0)
+                {
+                    c = nodes[x].consts[k];
+                    continue;
+                }
+                c.orig = -1;
+                if (is_op(o, "ADD"))
+                    c.val += nodes[x].consts[k].val;
+                else if (is_op(o, "MUL"))
+                    c.val *= nodes[x].consts[k].val;
+                else if (is_op(o, "AND"))
+                    c.val &= nodes[x].consts[k].val;
+                else if (is_op(o, "OR"))
+                    c.val |= nodes[x].consts[k].val;
+                else
+                    c.val ^= nodes[x].consts[k].val;
+            }
+        }
+        if (n_c > 0)
+            tree[n_leaves++] = (reassoc_operand){REASSOC_CONST, -1, 0, 0, 0, -1};
+        if (n_leaves < 2 || n_leaves - 1 > m || (n_c > 0 && target_max_consts(target, o->op) == 0))
+            continue;
+
+        // Huffman-like combination, always of the two operands that come first. Node n_leaves + n combines
+        // operands idx and edge.
+        memset(used, 0, (2 * n_leaves) * sizeof(int));
+        for (n = 0, bad = 0; n < n_leaves - 1; n++)
+        {
+            for (a = -1, j = 0; j < n_leaves + n; j++)
+                if (!used[j] && (a < 0 || reassoc_before(&tree[j], &tree[a])))
+                    a = j;
+            used[a] = 1;
+            for (b = -1, j = 0; j < n_leaves + n; j++)
+                if (!used[j] && (b < 0 || reassoc_before(&tree[j], &tree[b])))
+                    b = j;
+            used[b] = 1;
+            // Every node keeps an operand from another node
+            bad |= tree[a].kind != REASSOC_INPUT && tree[a].kind != REASSOC_NODE && tree[b].kind != REASSOC_INPUT && tree[b].kind != REASSOC_NODE;
+            t = &tree[n_leaves + n];
+            *t = (reassoc_operand){REASSOC_NODE, a, b, 0, 0, -1};
+            reassoc_join(t, &tree[a]);
+            reassoc_join(t, &tree[b]);
+            t->ready += o->lat;
+            if (t->depth >= 0)
+                t->depth++;
+        }
+        best = &tree[2 * n_leaves - 2];
+        cur = reassoc_current(nodes, N, i, member, leaf_in, leaf_rec);
+        if (bad || !(best->depth < cur.depth || (best->depth == cur.depth && (best->ready < cur.ready || (best->ready == cur.ready && n_leaves - 1 < m)))))
+            continue;
+
+        // Rewrite: the last combination is the root, the others take the remaining chain nodes
+        for (n = 0; n < n_leaves - 1; n++)
+        {
+            t = &tree[n_leaves + n];
+            a = t->idx;
+            b = t->edge;
+            x = n == n_leaves - 2 ? i : list[n + 1];
+            t->idx = x;
+            free(nodes[x].inputs);
+            free(nodes[x].trnsf_lat);
+            free(nodes[x].consts);
+            nodes[x].inputs = (int *)calloc(3, sizeof(int));
+            nodes[x].trnsf_lat = (int *)calloc(3, sizeof(int));
+            nodes[x].consts = (opt_const *)calloc(3, sizeof(opt_const));
+            nodes[x].n_inputs = nodes[x].n_consts = 0;
+            for (j = 0; j < 2; j++)
+            {
+                k = j == 0 ? a : b;
+                if (tree[k].kind == REASSOC_CONST)
+                    nodes[x].consts[nodes[x].n_consts++] = c;
+                else if (tree[k].kind == REASSOC_REC)
+                    nodes[tree[k].idx].recs[tree[k].edge] = x;
+                else
+                {
+                    nodes[x].inputs[nodes[x].n_inputs] = tree[k].idx;
+                    nodes[x].trnsf_lat[nodes[x].n_inputs++] = tree[k].trnsf_lat;
+                }
+            }
+            st->rewritten++;
+        }
+        for (n = n_leaves - 1; n < m; n++)
+        {
+            nodes[list[n]].alive = 0;
+            st->removed++;
+        }
+    }
+    mark_fixed(nodes, N);
+
+    free(asap);
+    free(member);
+    free(fwd);
+    free(dep);
+    free(list);
+    free(used);
+    free(leaf_in);
+    free(leaf_rec);
+    free(tree);
+}
+
+/**
+ * Operator fusion: a MUL (FMUL) whose only consumer is an ADD (FADD) or SUB is merged into it, as a fused
+ * multiply-add (operands: the factors, then the addend):
+ *      ADD(a * b, c) -> MADD2 (at most 2 operands from other nodes, the rest constants) or MADD3
+ *      SUB(a * b, c) -> MSUB3 (a * b - c)
+ *      SUB(c, a * b) -> NMSUB3 (c - a * b)
+ * Only fused operations the target device supports, with enough constant operands, are produced (none without
+ * a target). The fused node replaces the ADD/SUB, keeping its outputs and recurrences; the MUL must not be part
+ * of a recurrence.
+ */
+static void pass_fuse(opt_node *nodes, int N, const dfg_target_op *target, dfg_pass_stats *st)
+{
+    int i, k, q, n_in, n_c, m, is_add;
+    int *inputs, *trnsf_lat;
+    opt_const *consts;
+    opt_node *o, *mul;
+    char *fused;
+
+    for (i = 0; i < N; i++)
+    {
+        o = &nodes[i];
+        is_add = is_op(o, "ADD") || is_op(o, "FADD");
+        if (!o->alive || (!is_add && !is_op(o, "SUB")) || o->n_inputs + o->n_consts + count_rec_uses(nodes, N, i) != 2)
+            continue;
+        // The operand order of a SUB is only known between inputs
+        if (!is_add && o->n_inputs != 2)
+            continue;
+        for (k = 0; k < o->n_inputs; k++)
+        {
+            m = o->inputs[k];
+            mul = &nodes[m];
+            if (m == i || !mul->alive || mul->fixed || mul->n_inputs + mul->n_consts != 2 || count_uses(nodes, N, m) != 1)
+                continue;
+            if (!(is_op(mul, "MUL") && !is_op(o, "FADD")) && !(is_op(mul, "FMUL") && is_op(o, "FADD")))
+                continue;
+
+            n_in = mul->n_inputs + o->n_inputs - 1;
+            n_c = mul->n_consts + o->n_consts;
+            if (is_add)
+                fused = n_in <= 2 && target_max_consts(target, "MADD2") >= n_c ? "MADD2" : "MADD3";
+            else
+                fused = k == 0 ? "MSUB3" : "NMSUB3";
+            if (target == NULL || target_max_consts(target, fused) < n_c)
+                continue;
+
+            inputs = (int *)malloc((n_in + 1) * sizeof(int));
+            trnsf_lat = (int *)malloc((n_in + 1) * sizeof(int));
+            consts = (opt_const *)calloc(n_in + n_c + 1, sizeof(opt_const));
+            for (q = 0; q < mul->n_inputs; q++)
+            {
+                inputs[q] = mul->inputs[q];
+                trnsf_lat[q] = mul->trnsf_lat[q];
+            }
+            for (q = 0, n_in = mul->n_inputs; q < o->n_inputs; q++)
+            {
+                if (q == k)
+                    continue;
+                inputs[n_in] = o->inputs[q];
+                trnsf_lat[n_in++] = o->trnsf_lat[q];
+            }
+            memcpy(consts, mul->consts, mul->n_consts * sizeof(opt_const));
+            memcpy(consts + mul->n_consts, o->consts, o->n_consts * sizeof(opt_const));
+
+            free(o->inputs);
+            free(o->trnsf_lat);
+            free(o->consts);
+            o->inputs = inputs;
+            o->trnsf_lat = trnsf_lat;
+            o->consts = consts;
+            o->n_inputs = n_in;
+            o->n_consts = n_c;
+            o->op = fused;
+            o->lat = mul->lat > o->lat ? mul->lat : o->lat;
+            mul->alive = 0;
+            st->removed++;
+            st->rewritten++;
+            break;
+        }
+    }
+}
+
+/**
+ * Strength reduction: x * 2^k becomes a left shift by k (SHL), if the target device has left shifters
+ */
+static void pass_strength(opt_node *nodes, int N, const dfg_target_op *target, dfg_pass_stats *st)
+{
+    int i, k, c;
+    opt_node *n;
+
+    if (target_max_consts(target, "SHL") < 1)
+        return;
+    for (i = 0; i < N; i++)
+    {
+        n = &nodes[i];
+        if (!n->alive || n->fixed || !is_op(n, "MUL") || n->n_inputs != 1 || n->n_consts != 1)
+            continue;
+        c = n->consts[0].val;
+        if (c < 2 || (c & (c - 1)) != 0)
+            continue;
+        for (k = 0; c > 1; k++)
+            c >>= 1;
+        n->op = "SHL";
+        n->consts[0].orig = -1;
+        n->consts[0].val = k;
+        st->rewritten++;
+    }
+}
+
+/**
+ * Checks if two nodes compute the same value (same operation over the same operands)
+ */
+static int same_value(opt_node *a, opt_node *b)
+{
+    int k, q, ca, cb;
+
+    if (strcmp(a->op, b->op) || a->lat != b->lat || a->n_inputs != b->n_inputs || a->n_consts != b->n_consts)
+        return 0;
+    if (!is_commutative_op(a))
+    {
+        for (k = 0; k < a->n_inputs; k++)
+            if (a->inputs[k] != b->inputs[k] || a->trnsf_lat[k] != b->trnsf_lat[k])
+                return 0;
+        for (k = 0; k < a->n_consts; k++)
+            if (a->consts[k].val != b->consts[k].val)
+                return 0;
+        return 1;
+    }
+    // Commutative: compare the operands as multisets
+    for (k = 0; k < a->n_inputs; k++)
+    {
+        for (q = 0, ca = 0, cb = 0; q < a->n_inputs; q++)
+        {
+            ca += a->inputs[q] == a->inputs[k] && a->trnsf_lat[q] == a->trnsf_lat[k];
+            cb += b->inputs[q] == a->inputs[k] && b->trnsf_lat[q] == a->trnsf_lat[k];
+        }
+        if (ca != cb)
+            return 0;
+    }
+    for (k = 0; k < a->n_consts; k++)
+    {
+        for (q = 0, ca = 0, cb = 0; q < a->n_consts; q++)
+        {
+            ca += a->consts[q].val == a->consts[k].val;
+            cb += b->consts[q].val == a->consts[k].val;
+        }
+        if (ca != cb)
+            return 0;
+    }
+    return 1;
+}
+
+/**
+ * Common-subexpression elimination: a node computing the same value as an earlier node is replaced by it
+ */
+static void pass_cse(opt_node *nodes, int N, dfg_pass_stats *st)
+{
+    int i, j;
+
+    for (j = 0; j < N; j++)
+    {
+        if (!nodes[j].alive || nodes[j].fixed || !is_pure_op(&nodes[j]))
+            continue;
+        for (i = 0; i < j; i++)
+        {
+            if (nodes[i].alive && !nodes[i].fixed && same_value(&nodes[i], &nodes[j]))
+            {
+                replace_uses(nodes, N, j, i);
+                nodes[j].alive = 0;
+                st->removed++;
+                break;
+            }
+        }
+    }
+}
+
+/**
+ * Dead-node elimination: removes the nodes that no stream output, store or branch depends on.
+ * Stream inputs are kept, as they are part of the kernel's interface.
+ */
+static void pass_dce(opt_node *nodes, int N, dfg_pass_stats *st)
+{
+    int i, k, r, rec, changed, *live = (int *)calloc(N, sizeof(int));
+
+    for (i = 0; i < N; i++)
+        live[i] = nodes[i].alive && (is_op(&nodes[i], "STREAM_IN") || is_op(&nodes[i], "STREAM_OUT") ||
+                                     is_op(&nodes[i], "STORE") || is_op(&nodes[i], "BR"));
+    do
+    {
+        changed = 0;
+        for (i = 0; i < N; i++)
+        {
+            if (!nodes[i].alive)
+                continue;
+            // Recurrence edges keep both of their ends
+            for (r = 0; r < nodes[i].n_recs; r++)
+            {
+                rec = nodes[i].recs[r];
+                if (nodes[rec].alive && live[i] != live[rec])
+                {
+                    live[i] = live[rec] = 1;
+                    changed = 1;
+                }
+            }
+            if (!live[i])
+                continue;
+            for (k = 0; k < nodes[i].n_inputs; k++)
+            {
+                if (!live[nodes[i].inputs[k]])
+                {
+                    live[nodes[i].inputs[k]] = 1;
+                    changed = 1;
+                }
+            }
+        }
+    } while (changed);
+
+    for (i = 0; i < N; i++)
+    {
+        if (nodes[i].alive && !live[i])
+        {
+            nodes[i].alive = 0;
+            st->removed++;
+        }
+    }
+    free(live);
+}
+
+/**
+ * Rebuilds a dfg from the nodes left alive, renumbered in the given order (the index order if NULL),
+ * with the constants after the instructions. Constants of the original dfg keep being shared by their
+ * remaining consumers.
+ */
+static dfg *rebuild_dfg(dfg *d, opt_node *nodes, int N, const int *order)
+{
+    int i, j, k, q, M = 0, nc = 0, n_out, n_rec, *newid = (int *)calloc(N, sizeof(int)), *cnt = (int *)calloc(N, sizeof(int));
+    int *c_uses = (int *)calloc(d->NConsts + 1, sizeof(int)), *c_idx = (int *)calloc(d->NConsts + 1, sizeof(int));
+    dfg_instr **instrs, **consts, *t, *m, *o;
+
+    for (j = 0; j < N; j++)
+    {
+        i = order != NULL ? order[j] : j;
+        if (nodes[i].alive)
+            newid[i] = ++M;
+        for (k = 0; nodes[i].alive && k < nodes[i].n_consts; k++)
+        {
+            if (nodes[i].consts[k].orig < 0)
+                nc++;
+            else if (c_uses[nodes[i].consts[k].orig]++ == 0)
+                nc++;
+        }
+    }
+    instrs = (dfg_instr **)malloc((M + 1) * sizeof(dfg_instr *));
+    consts = (dfg_instr **)malloc((nc + 1) * sizeof(dfg_instr *));
+
+    // Instructions (created in the new order, as create_instr numbers them)
+    for (q = 0; q < N; q++)
+    {
+        i = order != NULL ? order[q] : q;
+        if (!nodes[i].alive)
+            continue;
+        for (j = 0, n_out = 0; j < N; j++)
+            for (k = 0; nodes[j].alive && k < nodes[j].n_inputs; k++)
+                n_out += nodes[j].inputs[k] == i;
+        for (k = 0, n_rec = 0; k < nodes[i].n_recs; k++)
+            n_rec += nodes[nodes[i].recs[k]].alive;
+        instrs[newid[i] - 1] = create_instr(nodes[i].name, nodes[i].op, nodes[i].lat, nodes[i].n_inputs, n_out, n_rec, nodes[i].n_consts, newid[i] == 1);
+    }
+
+    for (i = 0; i < N; i++)
+    {
+        if (!nodes[i].alive)
+            continue;
+        t = nodes[i].t;
+        m = instrs[newid[i] - 1];
+        for (k = 0; k < nodes[i].n_inputs; k++)
+        {
+            set_input(m, instrs[newid[nodes[i].inputs[k]] - 1], k);
+            m->trnsf_lat[k] = nodes[i].trnsf_lat[k];
+        }
+        // Outputs: the original order first, then any consumer gained from a rewrite
+        for (j = 0; j < N; j++)
+            for (k = 0, cnt[j] = 0; nodes[j].alive && k < nodes[j].n_inputs; k++)
+                cnt[j] += nodes[j].inputs[k] == i;
+        for (k = 0, q = 0; t != NULL && k < t->n_outputs; k++)
+        {
+            o = t->outputs[k];
+            if (o != NULL && o->id >= 1 && o->id <= N && nodes[o->id - 1].t == o && cnt[o->id - 1] > 0)
+            {
+                cnt[o->id - 1]--;
+                set_output(m, instrs[newid[o->id - 1] - 1], q++);
+            }
+        }
+        for (j = 0; j < N; j++)
+            for (; cnt[j] > 0; cnt[j]--)
+                set_output(m, instrs[newid[j] - 1], q++);
+        for (k = 0, q = 0; k < nodes[i].n_recs; k++)
+            if (nodes[nodes[i].recs[k]].alive)
+                set_recurrence(m, instrs[newid[nodes[i].recs[k]] - 1], q++, nodes[i].rec_dist[k]);
+    }
+
+    // Constants
+    nc = 0;
+    for (i = 0; i < d->NConsts; i++)
+    {
+        if (c_uses[i] == 0)
+            continue;
+        t = d->consts[i];
+        consts[nc] = create_instr(t->name, t->op, t->lat, 0, c_uses[i], 0, 0, 0);
+        set_const_val(consts[nc], t->const_val);
+        c_idx[i] = nc++;
+        c_uses[i] = 0;
+    }
+    for (j = 0; j < N; j++)
+    {
+        i = order != NULL ? order[j] : j;
+        if (!nodes[i].alive)
+            continue;
+        m = instrs[newid[i] - 1];
+        for (k = 0; k < nodes[i].n_consts; k++)
+        {
+            if (nodes[i].consts[k].orig < 0)
+            {
+                consts[nc] = create_instr(nodes[i].consts[k].name, "CONST", 1, 0, 1, 0, 0, 0);
+                set_const_val(consts[nc], nodes[i].consts[k].val);
+                set_output(consts[nc], m, 0);
+                set_const(m, consts[nc++], k);
+            }
+            else
+            {
+                o = consts[c_idx[nodes[i].consts[k].orig]];
+                set_output(o, m, c_uses[nodes[i].consts[k].orig]++);
+                set_const(m, o, k);
+            }
+        }
+    }
+
+    free(newid);
+    free(cnt);
+    free(c_uses);
+    free(c_idx);
+    return create_dfg(instrs, M, consts, nc);
+}
+
+/**
+ * Parses a list of pass names ("fold", "reassoc", "fuse", "strength", "cse", "dce", separated by commas or spaces).
+ * An empty list, or "all" anywhere in it, selects the default passes (every pass but fold).
+ * Return values: mask of selected passes (1 << DFG_PASS_*), or -1 if a name is not recognized
+ */
+int parse_dfg_passes(const char *names)
+{
+    char buf[128], *tok, *save = NULL;
+    int p, mask = 0;
+
+    if (names == NULL)
+        return DFG_DEFAULT_PASSES;
+    strncpy(buf, names, sizeof(buf) - 1);
+    buf[sizeof(buf) - 1] = '\0';
+    for (tok = strtok_r(buf, ", \t", &save); tok != NULL; tok = strtok_r(NULL, ", \t", &save))
+    {
+        if (!strcmp(tok, "all"))
+        {
+            mask |= DFG_DEFAULT_PASSES;
+            continue;
+        }
+        for (p = 0; p < DFG_N_PASSES && strcmp(tok, pass_names[p]); p++)
+            ;
+        if (p >= DFG_N_PASSES)
+            return -1;
+        mask |= 1 << p;
+    }
+    return mask != 0 ? mask : DFG_DEFAULT_PASSES;
+}
+
+/**
+ * Returns the recurrence edge through which node a accumulates its own value over iterations (-1 if none):
+ * its only recurrence goes back to itself (the previous value is an operand), or to a PHI that only feeds a
+ * and starts at the operation's identity
+ */
+static int accumulator_edge(opt_node *nodes, int N, int a)
+{
+    opt_node *n = &nodes[a], *phi;
+    int k, r;
+
+    if (!n->alive || !is_assoc_op(n) || n->n_recs != 1 || count_uses(nodes, N, a) == 0)
+        return -1;
+    r = n->recs[0];
+    if (r == a)
+        return count_rec_uses(nodes, N, a) == 1 ? 0 : -1;
+    phi = &nodes[r];
+    if (!phi->alive || !is_op(phi, "PHI") || phi->n_inputs != 0 || phi->n_consts != 1 || phi->n_recs != 0 ||
+        count_rec_uses(nodes, N, r) != 1 || count_uses(nodes, N, r) != 1 || count_rec_uses(nodes, N, a) != 0)
+        return -1;
+    for (k = 0; k < n->n_inputs && n->inputs[k] != r; k++)
+        ;
+    if (k >= n->n_inputs)
+        return -1;
+    return phi->consts[0].val == (is_op(n, "MUL") ? 1 : is_op(n, "AND") ? -1 : 0) ? 0 : -1;
+}
+
+/**
+ * Splits each accumulator into k interleaved partial accumulators: the distance of its recurrence is multiplied
+ * by k, so each partial result only waits for the one k iterations before, and k - 1 new nodes add up the last
+ * k partial results for the accumulator's consumers.
+ * The node array grows with the new nodes, which are placed right after their accumulator in order.
+ * Returns the number of accumulators split.
+ */
+static int interleave_accumulators(opt_node **nodes_p, int *N_p, int k, int **order_p)
+{
+    int i, j, e, q, s, dist, N = *N_p, M = *N_p, cnt = 0, *edge = (int *)malloc((N + 1) * sizeof(int)), *order;
+    opt_node *nodes = *nodes_p, *a;
+    char name[MAX_OP_NAME_LEN + 16];
+
+    for (i = 0; i < N; i++)
+        cnt += (edge[i] = accumulator_edge(nodes, N, i)) >= 0;
+    if (cnt == 0)
+    {
+        free(edge);
+        return 0;
+    }
+    nodes = (opt_node *)realloc(nodes, (N + cnt * (k - 1)) * sizeof(opt_node));
+    memset(nodes + N, 0, cnt * (k - 1) * sizeof(opt_node));
+    order = (int *)malloc((N + cnt * (k - 1)) * sizeof(int));
+
+    for (i = 0, q = 0; i < N; i++)
+    {
+        order[q++] = i;
+        if ((e = edge[i]) < 0)
+            continue;
+        a = &nodes[i];
+        dist = a->rec_dist[e];
+        a->rec_dist[e] = dist * k;
+        replace_uses(nodes, M, i, M + k - 2);
+        a->recs = (int *)realloc(a->recs, (a->n_recs + k) * sizeof(int));
+        a->rec_dist = (int *)realloc(a->rec_dist, (a->n_recs + k) * sizeof(int));
+        for (j = 1; j < k; j++)
+        {
+            s = M + j - 1;
+            snprintf(name, sizeof(name), "%s_p%d", a->name, j);
+            strncpy(nodes[s].name, name, MAX_OP_NAME_LEN - 1);
+            nodes[s].op = a->op;
+            nodes[s].lat = a->lat;
+            nodes[s].alive = 1;
+            nodes[s].n_inputs = 1;
+            nodes[s].inputs = (int *)calloc(3, sizeof(int));
+            nodes[s].inputs[0] = j == 1 ? i : s - 1;
+            nodes[s].trnsf_lat = (int *)calloc(3, sizeof(int));
+            nodes[s].consts = (opt_const *)calloc(3, sizeof(opt_const));
+            // Partial result of j iterations before
+            a->recs[a->n_recs] = s;
+            a->rec_dist[a->n_recs++] = dist * j;
+            order[q++] = s;
+        }
+        M += k - 1;
+    }
+    mark_fixed(nodes, M);
+
+    free(edge);
+    *nodes_p = nodes;
+    *N_p = M;
+    *order_p = order;
+    return cnt;
+}
+
+static void run_dfg_passes(opt_node *nodes, int N, int passes, const dfg_target_op *target, dfg_pass_stats stats[DFG_N_PASSES])
+{
+    int p, changed, round, before;
+    double start;
+
+    for (round = 0, changed = 1; changed && round < 16; round++)
+    {
+        changed = 0;
+        for (p = 0; p < DFG_N_PASSES; p++)
+        {
+            if (!(passes & (1 << p)))
+                continue;
+            before = stats[p].removed + stats[p].rewritten;
+            start = omp_get_wtime();
+            switch (p)
+            {
+            case DFG_PASS_FOLD:
+                pass_fold(nodes, N, target, &stats[p]);
+                break;
+            case DFG_PASS_REASSOC:
+                pass_reassoc(nodes, N, target, &stats[p]);
+                break;
+            case DFG_PASS_FUSE:
+                pass_fuse(nodes, N, target, &stats[p]);
+                break;
+            case DFG_PASS_STRENGTH:
+                pass_strength(nodes, N, target, &stats[p]);
+                break;
+            case DFG_PASS_CSE:
+                pass_cse(nodes, N, &stats[p]);
+                break;
+            case DFG_PASS_DCE:
+                pass_dce(nodes, N, &stats[p]);
+                break;
+            }
+            stats[p].time += omp_get_wtime() - start;
+            stats[p].runs++;
+            changed |= stats[p].removed + stats[p].rewritten != before;
+        }
+    }
+}
+
+/**
+ * Builds the index-based view of the dfg (see DFG Optimization Passes).
+ * Returns NULL if the dfg is not numbered 1..N.
+ */
+static opt_node *load_opt_nodes(dfg *d)
+{
+    int i, k, p, N = d->N;
+    opt_node *nodes = (opt_node *)calloc(N, sizeof(opt_node));
+    dfg_instr *t;
+
+    for (i = 0; i < N; i++)
+    {
+        t = d->d[i];
+        if (t->id < 1 || t->id > N || nodes[t->id - 1].t != NULL)
+        {
+            free(nodes);
+            return NULL;
+        }
+        nodes[t->id - 1].t = t;
+    }
+
+    for (i = 0; i < N; i++)
+    {
+        t = nodes[i].t;
+        strcpy(nodes[i].name, t->name);
+        nodes[i].op = t->op;
+        nodes[i].lat = t->lat;
+        nodes[i].alive = 1;
+        nodes[i].n_inputs = t->n_inputs;
+        nodes[i].n_consts = t->n_consts;
+        nodes[i].inputs = (int *)malloc((t->n_inputs + 1) * sizeof(int));
+        nodes[i].trnsf_lat = (int *)malloc((t->n_inputs + 1) * sizeof(int));
+        nodes[i].consts = (opt_const *)calloc(t->n_inputs + t->n_consts + 1, sizeof(opt_const));
+        nodes[i].recs = (int *)malloc((t->n_recurrences + 1) * sizeof(int));
+        nodes[i].rec_dist = (int *)malloc((t->n_recurrences + 1) * sizeof(int));
+        for (k = 0; k < t->n_inputs; k++)
+        {
+            nodes[i].inputs[k] = t->inputs[k]->id - 1;
+            nodes[i].trnsf_lat[k] = t->trnsf_lat[k];
+        }
+        for (k = 0; k < t->n_consts; k++)
+        {
+            for (p = 0; p < d->NConsts && d->consts[p] != t->consts[k]; p++)
+                ;
+            nodes[i].consts[k].orig = p < d->NConsts ? p : -1;
+            nodes[i].consts[k].val = t->consts[k]->const_val;
+            strcpy(nodes[i].consts[k].name, t->consts[k]->name);
+        }
+        for (k = 0; k < t->n_recurrences; k++)
+        {
+            if (t->recurrences[k] == NULL)
+                continue;
+            nodes[i].recs[nodes[i].n_recs] = t->recurrences[k]->id - 1;
+            nodes[i].rec_dist[nodes[i].n_recs++] = t->rec_distances[k];
+        }
+    }
+    return nodes;
+}
+
+static void free_opt_nodes(opt_node *nodes, int N)
+{
+    int i;
+
+    for (i = 0; i < N; i++)
+    {
+        free(nodes[i].inputs);
+        free(nodes[i].trnsf_lat);
+        free(nodes[i].consts);
+        free(nodes[i].recs);
+        free(nodes[i].rec_dist);
+    }
+    free(nodes);
+}
+
+/**
+ * Runs the selected passes (mask of 1 << DFG_PASS_*) over the dfg, in order, until none of them changes it.
+ * target lists the operations of the device the dfg will be mapped to (terminated by a NULL op), which
+ * restricts the rewrites to what the device can execute. Without a target (NULL), no operations are fused.
+ * If interleave > 1, every accumulator is then split into that many interleaved partial accumulators (see
+ * interleave_accumulators), which divides the II its recurrence imposes, and the passes are run again.
+ * Per-pass statistics are accumulated in stats (if not NULL), and the number of accumulators split is
+ * returned in n_interleaved (if not NULL).
+ * Returns a new, optimized dfg (the original is left untouched), or NULL if the dfg is not numbered 1..N.
+ */
+dfg *optimize_dfg(dfg *d, int passes, int interleave, const dfg_target_op *target, dfg_pass_stats stats[DFG_N_PASSES], int *n_interleaved)
+{
+    int N = d->N, n_split = 0, *order = NULL;
+    dfg_pass_stats local[DFG_N_PASSES];
+    opt_node *nodes = load_opt_nodes(d);
+    dfg *o;
+
+    if (nodes == NULL)
+        return NULL;
+    if (stats == NULL)
+    {
+        memset(local, 0, sizeof(local));
+        stats = local;
+    }
+
+    mark_fixed(nodes, N);
+
+    run_dfg_passes(nodes, N, passes, target, stats);
+    if (interleave > 1 && (n_split = interleave_accumulators(&nodes, &N, interleave, &order)) > 0)
+        run_dfg_passes(nodes, N, passes, target, stats);
+    if (n_interleaved != NULL)
+        *n_interleaved = n_split;
+
+    o = rebuild_dfg(d, nodes, N, order);
+    free_opt_nodes(nodes, N);
+    free(order);
+    return o;
+}
+
+void print_dfg_pass_stats(dfg_pass_stats stats[DFG_N_PASSES])
+{
+    int p;
+
+    printf("|--------------------- DFG PASSES ---------------------|\n");
+    printf("| %-10s | %5s | %7s | %9s | %9s |\n", "Pass", "Runs", "Removed", "Rewritten", "Time (ms)");
+    for (p = 0; p < DFG_N_PASSES; p++)
+        printf("| %-10s | %5d | %7d | %9d | %9.3lf |\n", pass_names[p], stats[p].runs, stats[p].removed, stats[p].rewritten, stats[p].time * 1e3);
+    printf("|------------------------------------------------------|\n");
+}
+
+/*************************************************************
+ * Route-Through Insertion
+ * A value that waits many cycles for a consumer, or that feeds many consumers, must be kept in the output
+ * registers and LRFs of the PEs along its routes, which often fails at low IIs. The pass makes part of that
+ * routing explicit with ROUTE (move) nodes, which the mappers place like any other operation and which are
+ * configured as a pass-through of their PE's FU.
+ *************************************************************/
+
+/**
+ * Marks the nodes on a recurrence cycle: reachable from the consumer of a recurrence edge, and reaching its producer
+ */
+static void mark_rec_cycles(opt_node *nodes, int N, char *on_cycle)
+{
+    int i, j, k, r, changed;
+    char *fwd = (char *)malloc(N + 1), *bwd = (char *)malloc(N + 1);
+
+    memset(on_cycle, 0, N);
+    for (i = 0; i < N; i++)
+    {
+        for (r = 0; r < nodes[i].n_recs; r++)
+        {
+            memset(fwd, 0, N);
+            memset(bwd, 0, N);
+            fwd[nodes[i].recs[r]] = bwd[i] = 1;
+            do
+            {
+                changed = 0;
+                for (j = 0; j < N; j++)
+                {
+                    for (k = 0; k < nodes[j].n_inputs; k++)
+                    {
+                        if (fwd[nodes[j].inputs[k]] && !fwd[j])
+                            fwd[j] = changed = 1;
+                        if (bwd[j] && !bwd[nodes[j].inputs[k]])
+                            bwd[nodes[j].inputs[k]] = changed = 1;
+                    }
+                }
+            } while (changed);
+            for (j = 0; j < N; j++)
+                on_cycle[j] |= fwd[j] && bwd[j];
+        }
+    }
+    free(fwd);
+    free(bwd);
+}
+
+/**
+ * Appends a ROUTE node reading node src to the node array (grown as needed) and returns its index
+ */
+static int add_route_node(opt_node **nodes_p, int *M, int *cap, int **order_p, int src, const char *name)
+{
+    opt_node *r;
+
+    if (*M >= *cap)
+    {
+        *cap *= 2;
+        *nodes_p = (opt_node *)realloc(*nodes_p, *cap * sizeof(opt_node));
+        *order_p = (int *)realloc(*order_p, *cap * sizeof(int));
+    }
+    r = &(*nodes_p)[*M];
+    memset(r, 0, sizeof(opt_node));
+    strncpy(r->name, name, MAX_OP_NAME_LEN - 1);
+    r->op = "ROUTE";
+    r->lat = 1;
+    r->alive = 1;
+    r->n_inputs = 1;
+    r->inputs = (int *)malloc(2 * sizeof(int));
+    r->inputs[0] = src;
+    r->trnsf_lat = (int *)calloc(2, sizeof(int));
+    r->consts = (opt_const *)calloc(2, sizeof(opt_const));
+    r->recs = (int *)malloc(sizeof(int));
+    r->rec_dist = (int *)malloc(sizeof(int));
+    return (*M)++;
+}
+
+/**
+ * Inserts ROUTE nodes on the long and high-fanout edges of the dfg. The consumers of each node are visited by start
+ * time (schedule, indexed by instruction id - 1, or the ASAP schedule if NULL) and read the value from the end of a
+ * chain of ROUTE nodes that grows as needed:
+ * - a consumer that would wait more than max_span cycles for the value gets a new ROUTE node (max_span cycles later)
+ *   in between, so that a chain splits a long edge in segments of at most max_span cycles;
+ * - a node keeps at most max_fanout outputs, the later consumers being fed by a ROUTE node instead.
+ * Either limit is disabled with 0. Edges on a recurrence cycle are left untouched, as a ROUTE node would lengthen
+ * the cycle. The ROUTE nodes are numbered right after their producer, and named "<producer>_r<k>".
+ * Returns a new dfg (the original is left untouched), with the number of ROUTE nodes in n_inserted (if not NULL),
+ * or NULL if the dfg is not numbered 1..N.
+ */
+dfg *insert_route_nodes(dfg *d, const int *schedule, int max_span, int max_fanout, int *n_inserted)
+{
+    int i, j, k, q, c, src, ready, direct, n_cons, n_r, M, cap, n_order = 0, cnt = 0, N = d->N;
+    int *t, *cons, *order, *asap;
+    opt_node *nodes = load_opt_nodes(d);
+    char *on_cycle, name[MAX_OP_NAME_LEN + 16];
+    dfg *o;
+
+    if (nodes == NULL)
+        return NULL;
+    M = N;
+    cap = N > 0 ? N : 1;
+    t = (int *)malloc((N + 1) * sizeof(int));
+    cons = (int *)malloc((N + 1) * sizeof(int));
+    order = (int *)malloc(cap * sizeof(int));
+    on_cycle = (char *)malloc(N + 1);
+
+    if (schedule != NULL)
+        memcpy(t, schedule, N * sizeof(int));
+    else
+    {
+        asap = (int *)malloc((N + 1) * sizeof(int));
+        compute_asap(nodes, N, asap);
+        for (i = 0; i < N; i++)
+            t[i] = asap[i] - nodes[i].lat;
+        free(asap);
+    }
+    mark_rec_cycles(nodes, N, on_cycle);
+
+    for (i = 0; i < N; i++)
+    {
+        order[n_order++] = i;
+
+        // Distinct consumers, by start time (the ones on a recurrence cycle with i stay on i)
+        for (j = 0, n_cons = 0, direct = 0; j < N; j++)
+        {
+            for (k = 0; k < nodes[j].n_inputs && nodes[j].inputs[k] != i; k++)
+                ;
+            if (k >= nodes[j].n_inputs)
+                continue;
+            if (on_cycle[i] && on_cycle[j])
+                direct++;
+            else
+            {
+                for (q = n_cons++; q > 0 && t[cons[q - 1]] > t[j]; q--)
+                    cons[q] = cons[q - 1];
+                cons[q] = j;
+            }
+        }
+
+        src = i;
+        ready = t[i] + nodes[i].lat;
+        for (q = 0, n_r = 0; q < n_cons; q++)
+        {
+            c = cons[q];
+            for (;;)
+            {
+                if (max_span > 0 && t[c] - ready > max_span)
+                    ready += max_span;
+                else if (max_fanout > 1 && direct >= max_fanout - 1 && direct + n_cons - q > max_fanout)
+                    ready = t[c] - 1 > ready ? t[c] - 1 : ready;
+                else
+                    break;
+                snprintf(name, sizeof(name), "%.*s_r%d", MAX_OP_NAME_LEN - 8, nodes[i].name, ++n_r);
+                src = add_route_node(&nodes, &M, &cap, &order, src, name);
+                order[n_order++] = src;
+                ready++;
+                direct = 0;
+                cnt++;
+            }
+            for (k = 0; k < nodes[c].n_inputs; k++)
+                if (nodes[c].inputs[k] == i)
+                    nodes[c].inputs[k] = src;
+            direct++;
+        }
+    }
+
+    if (n_inserted != NULL)
+        *n_inserted = cnt;
+    o = rebuild_dfg(d, nodes, M, order);
+    free_opt_nodes(nodes, M);
+    free(t);
+    free(cons);
+    free(order);
+    free(on_cycle);
+    return o;
+}
@@ -5,6 +5,36 @@
 
 #define MAX_OP_NAME_LEN 20
 
+// DFG optimization passes (run in this order)
+#define DFG_PASS_FOLD 0
+#define DFG_PASS_REASSOC 1
+#define DFG_PASS_FUSE 2
+#define DFG_PASS_STRENGTH 3
+#define DFG_PASS_CSE 4
+#define DFG_PASS_DCE 5
+#define DFG_N_PASSES 6
+// fold relies on the constants' values, which DOT constants without one read as 0: it only runs when named
+#define DFG_DEFAULT_PASSES (((1 << DFG_N_PASSES) - 1) & ~(1 << DFG_PASS_FOLD))
+
+// Route-through insertion: longest wait (cycles) and most outputs of a value before a ROUTE node is inserted
+#define ROUTE_DEFAULT_SPAN 4
+#define ROUTE_DEFAULT_FANOUT 4
+
+typedef struct
+{
+    int runs;      // times the pass was run
+    int removed;   // nodes removed
+    int rewritten; // nodes rewritten in place
+    double time;   // seconds
+} dfg_pass_stats;
+
+// Operation supported by the target device, with the most constant operands it can read
+typedef struct
+{
+    const char *op;
+    int max_consts;
+} dfg_target_op;
+
 typedef struct _dfg_instr dfg_instr;
 typedef struct _dfg dfg;
 
@@ -26,6 +56,8 @@ int set_const(dfg_instr *target, dfg_instr *cnst, int idx);
 void set_const_val(dfg_instr *cnst, int val);
 int get_const_val(dfg_instr *cnst);
 dfg_instr* get_recurrence(dfg_instr *target, int idx);
+int get_n_rec_inputs(dfg_instr *target);
+dfg_instr *get_rec_input(dfg_instr *target, int idx);
 dfg_instr *get_const(dfg_instr *target, int idx);
 int get_const_id(dfg_instr *target, int idx);
 int get_n_consts(dfg_instr *target);
@@ -36,6 +68,9 @@ char* get_instr_op(dfg_instr* t);
 int get_instr_lat(dfg_instr* t);
 int get_input_trnsf_lat(dfg_instr *t, int i);
 void set_input_trnsf_lat(dfg_instr *t, int i, int lat);
+float get_instr_criticality(dfg_instr *t);
+int is_on_rec_cycle(dfg_instr *t);
+void set_instr_criticality(dfg_instr *t, float criticality, int rec_cycle);
 int get_input_id(dfg_instr* target, int idx);
 int get_output_id(dfg_instr* target, int idx);
 int get_dfg_size(dfg* d);
@@ -48,6 +83,7 @@ int get_dfg_const_id(dfg *d, int idx);
 dfg_instr *get_input_by_op_id(dfg_instr *target, int id);
 int isIO(dfg_instr *target);
 dfg_instr *get_instr_by_op_id(dfg *d, int id);
+dfg_instr *get_instr_by_name(dfg *d, char *name);
 char* get_dfg_instr_op(dfg* d, int idx);
 int *getInputRecArray(dfg *d, dfg_instr *target);
 Item *get_all_recurrences(dfg *d);
@@ -58,6 +94,9 @@ void delete_instr(dfg_instr* i);
 dfg* create_dfg(dfg_instr** d, int N, dfg_instr** c, int NConsts);
 void restore_dfg(dfg *d);
 dfg *copy_dfg(dfg* target);
+dfg *extract_subdfg(dfg *d, int *ids, int n);
+dfg *merge_dfgs(dfg **ds, int *copies, int n);
+dfg *unroll_dfg(dfg *d, int U);
 void set_dfg_sorted(dfg *d, int sorted);
 int is_dfg_sorted(dfg *d);
 int get_n_instrs_by_op(dfg *d, char *op);
@@ -76,4 +115,10 @@ void remove_instr_from_dfg(dfg *d, int idx);
 int* get_associated_nodes(dfg* d);
 void delete_dfg(dfg *d, int delete_instrs);
 
+// DFG Optimization
+int parse_dfg_passes(const char *names);
+dfg *optimize_dfg(dfg *d, int passes, int interleave, const dfg_target_op *target, dfg_pass_stats stats[DFG_N_PASSES], int *n_interleaved);
+void print_dfg_pass_stats(dfg_pass_stats stats[DFG_N_PASSES]);
+dfg *insert_route_nodes(dfg *d, const int *schedule, int max_span, int max_fanout, int *n_inserted);
+
 #endif
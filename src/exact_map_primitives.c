@@ -0,0 +1,629 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ops.h"
+#include "dfg.h"
+#include "cgra.h"
+#include "sat.h"
+
+/**************************************************************************************
+ * Exact Mapping Primitives
+ * SAT formulation of the placement and scheduling of a dfg onto the time-extended device,
+ * solved by the embedded CDCL solver (sat.h). For a given II, the model has a variable
+ * for each node and capable PE, the node's start cycle in order encoding (time >= t) and
+ * its modulo slot (time mod II), with the constraints:
+ *      - each node is placed on exactly one PE able to execute it (powered on, with the
+ *        functionality, the RF read ports for its constants and free in every slot it uses);
+ *      - no two nodes use the same PE in the same modulo slot (placeOp);
+ *      - at most ld (st) throughput stream inputs (outputs) per modulo slot;
+ *      - each edge u -> v leaves enough cycles to route the value, one hop (or one LRF hold)
+ *        per cycle: time(v) - last_cycle(u) >= max(1, hops(pe(u), pe(v))), where last_cycle
+ *        accounts for the pipeline stages of pe(u) (routeInTime). Recurrence edges get II times
+ *        their distance as extra slack.
+ * These are necessary conditions for the router, so a model without solutions proves that
+ * no mapping exists for the II. The horizon of the schedule is bounded by the longest
+ * simple path of the modulo constraints (II * ((N - 1) * w + 1) cycles, w being the largest
+ * number of iterations an edge can span), which keeps the proof complete unless the bound
+ * is capped by EXACT_MAX_HORIZON. Models are realized and validated with placeOp/routeOp
+ * by the exact mapper, which blocks the ones that fail to route and solves again.
+ *************************************************************************************/
+
+#define EXACT_MAX_HORIZON 1024 // cap on the number of schedule cycles modelled
+#define EXACT_INF_GAP -1
+
+struct _exact_model
+{
+    sat_solver *s;
+    int N, II, T, n_pe, complete;
+    dfg_instr **ops;
+    int *idx;   // node index of each dfg id - 1 (-1 if it is not a node)
+    int **P;    // P[n][p]: node n is placed on PE p (0 if p can't take node n)
+    int **G;    // G[n][t]: time(n) >= t, for t = 1..T (time(n) >= 0 always holds)
+    int **S;    // S[n][s]: time(n) mod II == s
+    int *X;     // X[(n * n_pe + p) * II + s]: P[n][p] and S[n][s] (0 if not allowed)
+    int *pos, *time;
+};
+
+/**
+ * Hop distances between PEs, dist[pu * n_pe + pv] (-1 if pv can't be reached from pu). Computed
+ * backwards from each pv through the PEs driving it, as routeInTime searches.
+ */
+static int *getHopDistances(cgra *fs)
+{
+    int L = get_cgra_L(fs), C = get_cgra_C(fs), n_pe = L * C, pv, k, n, head, tail, u, w;
+    int *dist = (int *)malloc(n_pe * n_pe * sizeof(int)), *queue = (int *)malloc(n_pe * sizeof(int));
+    const pe_neighbour *nb;
+
+    for (k = 0; k < n_pe * n_pe; k++)
+        dist[k] = -1;
+    for (pv = 0; pv < n_pe; pv++)
+    {
+        if (!isPE(fs, pv / C, pv % C) && !isStreamPort(fs, pv / C, pv % C))
+            continue;
+        dist[pv * n_pe + pv] = 0;
+        queue[0] = pv;
+        for (head = 0, tail = 1; head < tail; head++)
+        {
+            u = queue[head];
+            nb = getPENeighbourList(fs, u / C, u % C, &n);
+            for (k = 0; k < n; k++)
+            {
+                w = nb[k].pos;
+                if (dist[w * n_pe + pv] >= 0)
+                    continue;
+                dist[w * n_pe + pv] = dist[u * n_pe + pv] + 1;
+                queue[tail++] = w;
+            }
+        }
+    }
+    free(queue);
+    return dist;
+}
+
+/**
+ * Minimum number of cycles between the start of a node on pu and the start of a consumer on pv
+ */
+static int getRoutingGap(cgra *fs, int *dist, int n_pe, int pu, int pv)
+{
+    int C = get_cgra_C(fs), d = dist[pu * n_pe + pv];
+
+    if (d < 0)
+        return EXACT_INF_GAP;
+    return (d > 1 ? d : 1) + getPEPipelineStages(fs, pu / C, pu % C) - 1;
+}
+
+/**
+ * Checks if node n can start on PE p in modulo slot s: the PE has the functionality and is free
+ * (and powered on) in the slots the node occupies, with enough RF read ports for its constants.
+ */
+static int canStartAt(cgra *fs, dfg_instr *target, int p, int s, int II)
+{
+    int C = get_cgra_C(fs), i = p / C, j = p % C, o;
+    int m = II < get_instr_lat(target) ? II : get_instr_lat(target);
+    cgra *slice = getModuloSlice(fs, s, II);
+
+    if (!checkStructHazard(slice, target, i, j) || getNFreeRFRPMuxIn(slice, i, j) < get_n_consts(target))
+        return 0;
+    for (o = 0; o < m; o++)
+    {
+        if (!checkStructHazard(slice, target, i, j) || pe_occupied(slice, i, j))
+            return 0;
+        slice = getNextModuloSlice(slice);
+    }
+    return 1;
+}
+
+static void addClause2(sat_solver *s, int a, int b)
+{
+    int lits[2] = {a, b};
+    satAddClause(s, lits, 2);
+}
+
+static void addClause3(sat_solver *s, int a, int b, int c)
+{
+    int lits[3] = {a, b, c};
+    satAddClause(s, lits, 3);
+}
+
+/**
+ * At most k of the n literals are true (sequential counter encoding)
+ */
+static void atMostK(sat_solver *s, int *lits, int n, int k)
+{
+    int i, j, **r;
+
+    if (n <= k)
+        return;
+    if (k == 0)
+    {
+        for (i = 0; i < n; i++)
+            satAddClause(s, (int[]){-lits[i]}, 1);
+        return;
+    }
+    // r[i][j]: at least j + 1 of the first i + 1 literals are true
+    r = (int **)malloc(n * sizeof(int *));
+    for (i = 0; i < n; i++)
+    {
+        r[i] = (int *)malloc(k * sizeof(int));
+        for (j = 0; j < k; j++)
+            r[i][j] = satNewVar(s);
+    }
+    for (i = 0; i < n; i++)
+    {
+        addClause2(s, -lits[i], r[i][0]);
+        if (i == 0)
+        {
+            for (j = 1; j < k; j++)
+                satAddClause(s, (int[]){-r[0][j]}, 1);
+            continue;
+        }
+        for (j = 0; j < k; j++)
+        {
+            addClause2(s, -r[i - 1][j], r[i][j]);
+            if (j > 0)
+                addClause3(s, -lits[i], -r[i - 1][j - 1], r[i][j]);
+        }
+        addClause2(s, -lits[i], -r[i - 1][k - 1]);
+    }
+    for (i = 0; i < n; i++)
+        free(r[i]);
+    free(r);
+}
+
+/**
+ * Encodes time(v) + shift >= time(u) + gap(pe(u), pe(v)) for an edge u -> v. The possible gaps
+ * are ordered: E[g] is implied by any pair of placements with a gap of at least g.
+ */
+static void encodeEdge(exact_model *em, cgra *fs, int *dist, int u, int v, int shift)
+{
+    int pu, pv, g, t, target, gmax = 1, *E, n_pe = em->n_pe, T = em->T;
+    int **P = em->P, **G = em->G;
+    sat_solver *s = em->s;
+
+    for (pu = 0; pu < n_pe; pu++)
+        for (pv = 0; pv < n_pe; pv++)
+            if (P[u][pu] && P[v][pv] && (g = getRoutingGap(fs, dist, n_pe, pu, pv)) > gmax)
+                gmax = g;
+
+    E = (int *)calloc(gmax + 1, sizeof(int));
+    for (g = 2; g <= gmax; g++)
+    {
+        E[g] = satNewVar(s);
+        if (g > 2)
+            addClause2(s, -E[g], E[g - 1]);
+    }
+    for (pu = 0; pu < n_pe; pu++)
+    {
+        for (pv = 0; pv < n_pe; pv++)
+        {
+            if (!P[u][pu] || !P[v][pv])
+                continue;
+            g = getRoutingGap(fs, dist, n_pe, pu, pv);
+            if (g == EXACT_INF_GAP)
+                addClause2(s, -P[u][pu], -P[v][pv]);
+            else if (g > 1)
+                addClause3(s, -P[u][pu], -P[v][pv], E[g]);
+        }
+    }
+
+    // time(u) >= t and E[g] => time(v) >= t + g - shift
+    for (g = 1; g <= gmax; g++)
+    {
+        for (t = 0; t <= T; t++)
+        {
+            int lits[3], n = 0;
+            target = t + g - shift;
+            if (target <= 0)
+                continue;
+            if (g > 1)
+                lits[n++] = -E[g];
+            if (t > 0)
+                lits[n++] = -G[u][t];
+            if (target <= T)
+                lits[n++] = G[v][target];
+            satAddClause(s, lits, n);
+        }
+    }
+    free(E);
+}
+
+/**************************************************************************************
+ * buildExactModel
+ * Inputs: device model (first slice, possibly holding other mappings), target dfg, node list
+ * (topological order) and II
+ * Builds the SAT model of the mapping problem for the given II (see the description above).
+ * Return values: model
+ *************************************************************************************/
+exact_model *buildExactModel(cgra *fs, dfg *d, dfg_instr **dfg_ops, int II)
+{
+    exact_model *em = (exact_model *)calloc(1, sizeof(exact_model));
+    int N = get_node_sublist_size(dfg_ops), n_pe = get_cgra_L(fs) * get_cgra_C(fs), size = get_dfg_size(d);
+    int n, m, k, p, q, s, o, t, g, a, b, gmax = 1, w, nlits, *lits, *dist = getHopDistances(fs);
+    char *ok = (char *)calloc(N * n_pe * II, sizeof(char));
+    sat_solver *sat = createSATSolver();
+    dfg_instr *target, *rec;
+
+    em->s = sat;
+    em->N = N;
+    em->II = II;
+    em->n_pe = n_pe;
+    em->ops = dfg_ops;
+    em->idx = (int *)malloc(size * sizeof(int));
+    em->pos = (int *)malloc(N * sizeof(int));
+    em->time = (int *)malloc(N * sizeof(int));
+    em->P = (int **)malloc(N * sizeof(int *));
+    em->G = (int **)malloc(N * sizeof(int *));
+    em->S = (int **)malloc(N * sizeof(int *));
+    em->X = (int *)calloc(N * n_pe * II, sizeof(int));
+    for (k = 0; k < size; k++)
+        em->idx[k] = -1;
+    for (n = 0; n < N; n++)
+        em->idx[get_instr_id(dfg_ops[n]) - 1] = n;
+
+    // Placement candidates
+    for (n = 0; n < N; n++)
+    {
+        em->P[n] = (int *)calloc(n_pe, sizeof(int));
+        for (p = 0; p < n_pe; p++)
+        {
+            for (s = 0; s < II; s++)
+                if ((ok[(n * n_pe + p) * II + s] = canStartAt(fs, dfg_ops[n], p, s, II)))
+                    em->P[n][p] = 1;
+            if (em->P[n][p])
+                em->P[n][p] = satNewVar(sat);
+        }
+    }
+
+    // Schedule horizon: the largest gap between candidate placements bounds the iterations an edge spans
+    for (n = 0; n < N; n++)
+    {
+        for (k = 0; k < get_n_inputs(dfg_ops[n]) + get_n_recurrences(dfg_ops[n]); k++)
+        {
+            target = k < get_n_inputs(dfg_ops[n]) ? get_input(dfg_ops[n], k) : get_recurrence(dfg_ops[n], k - get_n_inputs(dfg_ops[n]));
+            if (target == NULL || (m = em->idx[get_instr_id(target) - 1]) < 0)
+                continue;
+            for (a = 0; a < n_pe; a++)
+                for (b = 0; b < n_pe; b++)
+                    if (em->P[n][a] && em->P[m][b] && (g = getRoutingGap(fs, dist, n_pe, a, b)) > gmax)
+                        gmax = g;
+        }
+    }
+    w = (gmax + II - 1 + II - 1) / II;
+    em->T = II * ((N - 1) * w + 1) - 1;
+    em->complete = em->T <= EXACT_MAX_HORIZON;
+    if (!em->complete)
+        em->T = EXACT_MAX_HORIZON;
+
+    for (n = 0; n < N; n++)
+    {
+        em->G[n] = (int *)calloc(em->T + 2, sizeof(int));
+        em->S[n] = (int *)calloc(II, sizeof(int));
+        for (t = 1; t <= em->T; t++)
+            em->G[n][t] = satNewVar(sat);
+        for (s = 0; s < II; s++)
+            em->S[n][s] = satNewVar(sat);
+    }
+    lits = (int *)malloc((N * II + n_pe + em->T + 1) * sizeof(int));
+
+    for (n = 0; n < N; n++)
+    {
+        // Exactly one PE
+        for (p = 0, nlits = 0; p < n_pe; p++)
+            if (em->P[n][p])
+                lits[nlits++] = em->P[n][p];
+        satAddClause(sat, lits, nlits);
+        for (a = 0; a < nlits; a++)
+            for (b = a + 1; b < nlits; b++)
+                addClause2(sat, -lits[a], -lits[b]);
+
+        // Order encoding of the start cycle, and its modulo slot: time == t => slot t mod II
+        for (t = 1; t < em->T; t++)
+            addClause2(sat, -em->G[n][t + 1], em->G[n][t]);
+        for (t = 0; t <= em->T; t++)
+        {
+            nlits = 0;
+            if (t > 0)
+                lits[nlits++] = -em->G[n][t];
+            if (t < em->T)
+                lits[nlits++] = em->G[n][t + 1];
+            lits[nlits++] = em->S[n][t % II];
+            satAddClause(sat, lits, nlits);
+        }
+        satAddClause(sat, em->S[n], II);
+        for (a = 0; a < II; a++)
+            for (b = a + 1; b < II; b++)
+                addClause2(sat, -em->S[n][a], -em->S[n][b]);
+
+        // Start slots allowed on each PE
+        for (p = 0; p < n_pe; p++)
+        {
+            if (!em->P[n][p])
+                continue;
+            for (s = 0; s < II; s++)
+            {
+                if (!ok[(n * n_pe + p) * II + s])
+                {
+                    addClause2(sat, -em->P[n][p], -em->S[n][s]);
+                    continue;
+                }
+                em->X[(n * n_pe + p) * II + s] = q = satNewVar(sat);
+                addClause3(sat, -em->P[n][p], -em->S[n][s], q);
+                addClause2(sat, -q, em->P[n][p]);
+                addClause2(sat, -q, em->S[n][s]);
+            }
+        }
+    }
+
+    // Modulo resource constraints: one node per PE and slot
+    int *owner = (int *)malloc(N * II * sizeof(int));
+    for (p = 0; p < n_pe; p++)
+    {
+        for (q = 0; q < II; q++)
+        {
+            for (n = 0, nlits = 0; n < N; n++)
+            {
+                m = II < get_instr_lat(dfg_ops[n]) ? II : get_instr_lat(dfg_ops[n]);
+                for (o = 0; o < m; o++)
+                {
+                    s = ((q - o) % II + II) % II;
+                    if (em->X[(n * n_pe + p) * II + s])
+                    {
+                        owner[nlits] = n;
+                        lits[nlits++] = em->X[(n * n_pe + p) * II + s];
+                    }
+                }
+            }
+            for (a = 0; a < nlits; a++)
+                for (b = a + 1; b < nlits; b++)
+                    if (owner[a] != owner[b])
+                        addClause2(sat, -lits[a], -lits[b]);
+        }
+    }
+    free(owner);
+
+    // Streaming throughput per slot
+    for (s = 0; s < II; s++)
+    {
+        for (nlits = 0, n = 0; n < N; n++)
+            if (!strcmp(get_instr_op(dfg_ops[n]), "STREAM_IN"))
+                lits[nlits++] = em->S[n][s];
+        atMostK(sat, lits, nlits, get_cgra_ld_trghpt(fs));
+        for (nlits = 0, n = 0; n < N; n++)
+            if (!strcmp(get_instr_op(dfg_ops[n]), "STREAM_OUT"))
+                lits[nlits++] = em->S[n][s];
+        atMostK(sat, lits, nlits, get_cgra_st_trghpt(fs));
+    }
+
+    // Routing time of the edges. Recurrences are routed by their source (not for IOs), once the target is mapped
+    for (n = 0; n < N; n++)
+    {
+        for (k = 0; k < get_n_inputs(dfg_ops[n]); k++)
+        {
+            target = get_input(dfg_ops[n], k);
+            if (target != NULL && (m = em->idx[get_instr_id(target) - 1]) >= 0)
+                encodeEdge(em, fs, dist, m, n, 0);
+        }
+        if (isIO(dfg_ops[n]))
+            continue;
+        for (k = 0; k < get_n_recurrences(dfg_ops[n]); k++)
+        {
+            rec = get_recurrence(dfg_ops[n], k);
+            if (rec != NULL && (m = em->idx[get_instr_id(rec) - 1]) >= 0 && m < n)
+                encodeEdge(em, fs, dist, n, m, II * get_rec_dist(dfg_ops[n], k));
+        }
+    }
+
+    // Symmetry breaking: shifting a whole mapping by II cycles gives an equivalent one
+    if (II <= em->T)
+    {
+        for (n = 0; n < N; n++)
+            lits[n] = -em->G[n][II];
+        satAddClause(sat, lits, N);
+    }
+
+    free(lits);
+    free(ok);
+    free(dist);
+    return em;
+}
+
+/**************************************************************************************
+ * solveExactModel
+ * Inputs: model and conflict limit (<= 0 for none)
+ * Return values: solution found ? 1 : (no solution ? 0 : -1 (limit reached / budget expired))
+ *************************************************************************************/
+int solveExactModel(exact_model *em, long maxConflicts)
+{
+    int n, p, t, status = satSolve(em->s, maxConflicts);
+
+    if (status != SAT_SAT)
+        return status == SAT_UNSAT ? 0 : -1;
+    for (n = 0; n < em->N; n++)
+    {
+        for (p = 0; p < em->n_pe; p++)
+            if (em->P[n][p] && satModelValue(em->s, em->P[n][p]))
+                em->pos[n] = p;
+        for (t = 1, em->time[n] = 0; t <= em->T && satModelValue(em->s, em->G[n][t]); t++)
+            em->time[n] = t;
+    }
+    return 1;
+}
+
+/**************************************************************************************
+ * getExactSolution
+ * Copies the last solution to the position (i * C + j) and schedule arrays, indexed by id - 1
+ *************************************************************************************/
+void getExactSolution(exact_model *em, int *pos, int *schedule)
+{
+    int n, id;
+
+    for (n = 0; n < em->N; n++)
+    {
+        id = get_instr_id(em->ops[n]);
+        if (pos != NULL)
+            pos[id - 1] = em->pos[n];
+        schedule[id - 1] = em->time[n];
+    }
+}
+
+/**************************************************************************************
+ * blockExactSolution
+ * Inputs: model, ids of the nodes and their number
+ * Excludes the placement and modulo slots of the given nodes, in the last solution, from the
+ * next solutions (e.g. nodes that could not be routed together). Slots rather than cycles are
+ * blocked, as they decide which resources the nodes share; the next solutions move the nodes
+ * instead of shifting their schedule.
+ *************************************************************************************/
+void blockExactSolution(exact_model *em, int *ids, int n)
+{
+    int k, v, nlits = 0, *lits = (int *)malloc(2 * n * sizeof(int));
+
+    for (k = 0; k < n; k++)
+    {
+        v = em->idx[ids[k] - 1];
+        lits[nlits++] = -em->P[v][em->pos[v]];
+        lits[nlits++] = -em->S[v][em->time[v] % em->II];
+    }
+    satAddClause(em->s, lits, nlits);
+    free(lits);
+}
+
+/**************************************************************************************
+ * limitExactLifetimes
+ * Inputs: model, device model and slack (cycles)
+ * Restricts the next solutions to schedules where each value is consumed at most slack cycles
+ * after it could first be routed, time(v) <= time(u) + gap(pe(u), pe(v)) + slack. Long lifetimes
+ * are legal, but each hold takes an LRF entry in every slot, so they are the schedules the router
+ * tends to reject. A model restricted this way no longer proves that an II is infeasible.
+ *************************************************************************************/
+void limitExactLifetimes(exact_model *em, cgra *fs, int slack)
+{
+    int n, k, m, pu, pv, g, t, target, gmax, *F, n_pe = em->n_pe, T = em->T, *dist = getHopDistances(fs);
+    int **P = em->P, **G = em->G;
+    sat_solver *s = em->s;
+    dfg_instr *input;
+
+    em->complete = 0;
+    for (n = 0; n < em->N; n++)
+    {
+        for (k = 0; k < get_n_inputs(em->ops[n]); k++)
+        {
+            input = get_input(em->ops[n], k);
+            if (input == NULL || (m = em->idx[get_instr_id(input) - 1]) < 0)
+                continue;
+            for (pu = 0, gmax = 1; pu < n_pe; pu++)
+                for (pv = 0; pv < n_pe; pv++)
+                    if (P[m][pu] && P[n][pv] && (g = getRoutingGap(fs, dist, n_pe, pu, pv)) > gmax)
+                        gmax = g;
+
+            // F[g]: the gap of the placements is at most g (F[gmax] always holds)
+            F = (int *)calloc(gmax + 1, sizeof(int));
+            for (g = 1; g < gmax; g++)
+            {
+                F[g] = satNewVar(s);
+                if (g > 1)
+                    addClause2(s, -F[g - 1], F[g]);
+            }
+            for (pu = 0; pu < n_pe; pu++)
+                for (pv = 0; pv < n_pe; pv++)
+                    if (P[m][pu] && P[n][pv] && (g = getRoutingGap(fs, dist, n_pe, pu, pv)) != EXACT_INF_GAP && g < gmax)
+                        addClause3(s, -P[m][pu], -P[n][pv], F[g]);
+
+            // F[g] and time(u) <= t => time(v) <= t + g + slack
+            for (g = 1; g <= gmax; g++)
+            {
+                for (t = 0; t < T; t++)
+                {
+                    int lits[3], nl = 0;
+                    target = t + g + slack + 1;
+                    if (target > T)
+                        break;
+                    if (g < gmax)
+                        lits[nl++] = -F[g];
+                    lits[nl++] = G[m][t + 1];
+                    lits[nl++] = -G[n][target];
+                    satAddClause(s, lits, nl);
+                }
+            }
+            free(F);
+        }
+    }
+    free(dist);
+}
+
+/**
+ * Returns 1 (true) if the schedule horizon of the model is complete, i.e. if the lack of solutions
+ * proves that the II is infeasible.
+ */
+int exactModelIsComplete(exact_model *em)
+{
+    return em->complete;
+}
+
+void getExactModelSize(exact_model *em, int *vars, int *clauses)
+{
+    *vars = satNumVars(em->s);
+    *clauses = satNumClauses(em->s);
+}
+
+void deleteExactModel(exact_model *em)
+{
+    int n;
+
+    if (em == NULL)
+        return;
+    for (n = 0; n < em->N; n++)
+    {
+        free(em->P[n]);
+        free(em->G[n]);
+        free(em->S[n]);
+    }
+    free(em->P);
+    free(em->G);
+    free(em->S);
+    free(em->X);
+    free(em->idx);
+    free(em->pos);
+    free(em->time);
+    deleteSATSolver(em->s);
+    free(em);
+}
+
+/**************************************************************************************
+ * proveMinII
+ * Inputs: device model, target dfg, lower bound on the II, maximum II, conflict limit of
+ * each proof and verbose flag
+ * Raises the lower bound on the II while the exact model proves that no mapping exists
+ * (without mapping), so that the mappers don't spend attempts on infeasible IIs.
+ * Return values: lowest II not proven infeasible
+ *************************************************************************************/
+int proveMinII(cgra *template, dfg *d, int MII, int maxII, long maxConflicts, int verbose)
+{
+    int II, status;
+    exact_model *em;
+    cgra *fs;
+
+    topologicalSortDFG(d);
+    dfg_instr **dfg_ins = get_dfg_inputs(d);
+    dfg_instr **dfg_ops = get_dfg_ops(d);
+    dfg_instr **dfg_outs = get_dfg_outputs(d);
+    dfg_ops = merge_sublists(dfg_ins, dfg_ops);
+    dfg_ops = merge_sublists(dfg_ops, dfg_outs);
+
+    for (II = MII; II <= maxII && II <= get_node_sublist_size(dfg_ops) + 1; II++)
+    {
+        fs = buildBaseCGRA(template, II);
+        em = buildExactModel(fs, d, dfg_ops, II);
+        status = solveExactModel(em, maxConflicts);
+        if (status == 0 && exactModelIsComplete(em) && verbose)
+            printf("Exact model: no mapping exists with II = %d.\n", II);
+        status = status == 0 && exactModelIsComplete(em);
+        deleteExactModel(em);
+        delete_cgra(fs);
+        if (!status)
+            break;
+    }
+
+    free(dfg_ops);
+    return II;
+}
@@ -544,7 +544,10 @@ JSON_Value *create_io_object(cgra *c, dfg *d, int i, int j, int **placed)
     return outer_val;
 }
 
-int exportMapping(cgra *fs, dfg *d, int ***placed, char *filename, int vectorWidth)
+/**
+ * Builds the "Mapping Results" JSON document of a mapped device (see exportMapping)
+ */
+JSON_Value *getMappingJSON(cgra *fs, dfg *d, int ***placed, int vectorWidth)
 {
 
     /***************************************************************************************************************
@@ -629,6 +632,13 @@ int exportMapping(cgra *fs, dfg *d, int ***placed, char *filename, int vectorWid
     json_object_set_value(map_obj, "Configuration Words", cw_val);
     json_object_set_value(root_obj, "Mapping Results", map_val);
 
+    return root_val;
+}
+
+int exportMapping(cgra *fs, dfg *d, int ***placed, char *filename, int vectorWidth)
+{
+    JSON_Value *root_val = getMappingJSON(fs, d, placed, vectorWidth);
+
     // Serialize to file
     char *jsonFilename = (char *)calloc(strlen(filename) + 6, sizeof(char));
     strncpy(jsonFilename, filename, strlen(filename));
@@ -668,7 +678,7 @@ JSON_Value *create_pe_arch_object(cgra *c, int i, int j, int II)
     JSON_Value *fu_ops_val = json_value_init_array();
     JSON_Array *fu_ops = json_value_get_array(fu_ops_val);
 
-    for (int k = OP_ADD; k < OP_MAX; k++)
+    for (int k = OP_ADD; k < OP_ROUTE; k++) // route-through (OP_ROUTE) is not part of the FU
     {
         if (peHasFunct(c, i, j, k))
         {
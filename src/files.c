@@ -6,6 +6,8 @@
 #include "dfg.h"
 #include "cgra.h"
 #include "ops.h"
+#include "parson.h"
+#include "files.h"
 
 #define MAX_OP_NAME_SIZE 15
 #define MAX_INSTR_NAME_LEN 20
@@ -16,12 +18,23 @@ dfg *import_dfg(char *filename)
     if (fp == NULL)
         return NULL;
 
+    dfg *d = read_dfg(fp);
+    fclose(fp);
+
+    return d;
+}
+
+/**
+ * Reads a dfg, in the .dfg format, from an open stream (a file, or an in-memory buffer opened with fmemopen)
+ */
+dfg *read_dfg(FILE *fp)
+{
     int i, j, N, NConsts = 0, lat, n_inputs, n_outputs, n_recurrences, n_consts, const_val, dep, total_recs = 0;
     char op[MAX_OP_NAME_SIZE], name[MAX_INSTR_NAME_LEN];
     dfg_instr **dfgi, **dfgc;
     dfg *d;
 
-    if (fscanf(fp, "%d", &N) == 0)
+    if (fscanf(fp, "%d", &N) != 1 || N <= 0)
     {
         return NULL;
     }
@@ -37,7 +50,7 @@ dfg *import_dfg(char *filename)
         memset(op, 0, MAX_OP_NAME_SIZE);
 
         // This is probably unsafe code, and there is a bug with storing names!
-        fscanf(fp, "%s %s %d %d %d %d %d %d", name, op, &lat, &n_inputs, &n_outputs, &n_recurrences, &n_consts, &const_val);
+        fscanf(fp, "%19s %14s %d %d %d %d %d %d", name, op, &lat, &n_inputs, &n_outputs, &n_recurrences, &n_consts, &const_val);
         //printf("line: %s | %s | %d | %d | %d | %d | %d\n", name, op, lat, n_inputs, n_outputs, n_recurrences, n_consts);
 
         // OP is a constant
@@ -92,7 +105,6 @@ dfg *import_dfg(char *filename)
             return NULL;
         }
     }
-    fclose(fp);
 
     dfg_instr **instrs = (dfg_instr **)malloc((N - NConsts) * sizeof(dfg_instr *));
     dfg_instr **constants = (dfg_instr **)malloc(NConsts * sizeof(dfg_instr *));
@@ -177,11 +189,23 @@ cgra *new_import_cgra(char *filename)
     if (fp == NULL)
         return NULL;
 
+    cgra *new = read_cgra(fp);
+    fclose(fp);
+
+    return new;
+}
+
+/**
+ * Reads a cgra, in the .cmpa format, from an open stream
+ */
+cgra *read_cgra(FILE *fp)
+{
     int i, j, l, c, val, ops, pes = 0, n_or, rf, cu, pplnStages, se_ld, se_st, dw, rfrpMuxIn, rfrpOR;
     char op[MAX_OP_NAME_SIZE];
     cgra *new;
 
-    fscanf(fp, "%d %d %d %d %d", &l, &c, &se_ld, &se_st, &dw);
+    if (fscanf(fp, "%d %d %d %d %d", &l, &c, &se_ld, &se_st, &dw) != 5 || l <= 0 || c <= 0)
+        return NULL;
 
     new = create_cgra(l, c, se_ld, se_st, dw);
 
@@ -224,7 +248,7 @@ cgra *new_import_cgra(char *filename)
 
     for (i = 0; i < ops; i++)
     {
-        fscanf(fp, "%d %d %s", &l, &c, op);
+        fscanf(fp, "%d %d %14s", &l, &c, op);
         set_cgra_tile_funct(new, l, c, get_operation_index(op));
     }
 
@@ -232,7 +256,7 @@ cgra *new_import_cgra(char *filename)
     char type[20];
     memset(type, 0, 20 * sizeof(char));
 
-    while ((scan = fscanf(fp, "%s %d %d %d %d %d", type, &y1, &x1, &y2, &x2, &lat)) == 2 || scan == 6)
+    while ((scan = fscanf(fp, "%19s %d %d %d %d %d", type, &y1, &x1, &y2, &x2, &lat)) == 2 || scan == 6)
     {
         if (scan == 2)
         {
@@ -245,8 +269,6 @@ cgra *new_import_cgra(char *filename)
         }
     }
 
-    fclose(fp);
-
     return new;
 }
 
@@ -271,6 +293,82 @@ int import_cgra_config(char *filename, cgra *c)
     return 1;
 }
 
+/**
+ * Records the hint for the node with the given name, keeping the earliest context in which it appears
+ */
+static void set_mapping_hint(int **hints, dfg *d, const char *name, int pos, int context, int cycle)
+{
+    dfg_instr *target;
+
+    if (name == NULL || !strcmp(name, "None"))
+        return;
+    target = get_instr_by_name(d, (char *)name);
+    if (target == NULL || hints[get_instr_id(target) - 1][HINT_POS] >= 0)
+        return;
+    hints[get_instr_id(target) - 1][HINT_POS] = pos;
+    hints[get_instr_id(target) - 1][HINT_CONTEXT] = context;
+    hints[get_instr_id(target) - 1][HINT_CYCLE] = cycle;
+}
+
+/*************************************************************************************
+ * import_mapping_hints
+ * Inputs: mapping results file (JSON, as generated by export_mapping), target dfg and
+ * the number of columns of the target device
+ * Reads the position and context of every PE/IO operation in a previous mapping. Nodes
+ * are matched by name. The previous II is returned through II.
+ * Return values: hints array (hints[id-1] = {pos = iC + j, context, start cycle}, with
+ * -1 where unknown), or NULL if the file cannot be parsed
+ ************************************************************************************/
+int **import_mapping_hints(char *filename, dfg *d, int C, int *II)
+{
+    JSON_Value *root_val = json_parse_file(filename);
+    const JSON_Object *map_obj, *pe_obj, *io_obj;
+    const JSON_Array *cw_arr, *pe_arr, *io_arr;
+    int **hints, k, cycle;
+    size_t s, p;
+
+    if (root_val == NULL)
+        return NULL;
+    map_obj = json_object_get_object(json_value_get_object(root_val), "Mapping Results");
+    cw_arr = json_object_get_array(map_obj, "Configuration Words");
+    if (map_obj == NULL || cw_arr == NULL)
+    {
+        json_value_free(root_val);
+        return NULL;
+    }
+
+    *II = (int)json_object_get_number(map_obj, "II");
+    hints = (int **)malloc(get_dfg_size(d) * sizeof(int *));
+    for (k = 0; k < get_dfg_size(d); k++)
+    {
+        hints[k] = (int *)malloc(HINT_WORDS * sizeof(int));
+        hints[k][HINT_POS] = hints[k][HINT_CONTEXT] = hints[k][HINT_CYCLE] = -1;
+    }
+
+    for (s = 0; s < json_array_get_count(cw_arr); s++)
+    {
+        pe_arr = json_object_get_array(json_array_get_object(cw_arr, s), "PEs");
+        io_arr = json_object_get_array(json_array_get_object(cw_arr, s), "IOs");
+
+        for (p = 0; p < json_array_get_count(pe_arr); p++)
+        {
+            pe_obj = json_object_get_object(json_array_get_object(pe_arr, p), "PE");
+            set_mapping_hint(hints, d, json_object_get_string(pe_obj, "op_name"),
+                             (int)json_object_get_number(pe_obj, "row") * C + (int)json_object_get_number(pe_obj, "col"), s, -1);
+        }
+        for (p = 0; p < json_array_get_count(io_arr); p++)
+        {
+            io_obj = json_object_get_object(json_array_get_object(io_arr, p), "IO");
+            cycle = json_object_has_value(io_obj, "cycle_start") ? (int)json_object_get_number(io_obj, "cycle_start") : -1;
+            set_mapping_hint(hints, d, json_object_get_string(io_obj, "source_io"),
+                             (int)json_object_get_number(io_obj, "row") * C + (int)json_object_get_number(io_obj, "col"), s, cycle);
+        }
+    }
+
+    json_value_free(root_val);
+    return hints;
+}
+
 // Function to trim leading and trailing whitespace
 void trim_whitespace(char *str)
 {
@@ -1,6 +1,7 @@
 #ifndef FILES_H
 #define FILES_H
 
+#include <stdio.h>
 #include "dfg.h"
 
 #define MAX_OP_NAME_SIZE 15
@@ -8,7 +9,10 @@
 dfg *import_dfg(char* filename);
 cgra* import_cgra(char* filename);
 cgra *new_import_cgra(char *filename);
+dfg *read_dfg(FILE *fp);
+cgra *read_cgra(FILE *fp);
 int import_cgra_config(char* filename, cgra* c);
+int **import_mapping_hints(char *filename, dfg *d, int C, int *II);
 void trim_whitespace(char *str);
 void to_uppercase(char *str);
 int max_array(int arr[], size_t size);
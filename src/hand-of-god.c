@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
 #include <time.h>
 #include "ops.h"
 #include "dfg.h"
@@ -8,6 +9,9 @@
 #include "pqueue.h"
 #include "stack.h"
 #include "files.h"
+#include "mapcache.h"
+#include "stats.h"
+#include "budget.h"
 #include <omp.h>
 #include <time.h>
 
@@ -29,6 +33,19 @@
 #define MAPPER_FINETUNING 1
 #define MAPPER_ITERATIVE 2
 #define MAPPER_SIM_ANNEALING 3
+#define MAPPER_REPLICATION 4
+#define MAPPER_PARALLEL_TEMPERING 5
+
+#define PT_MAX_REPLICAS 8     // maximum number of annealing replicas (one per OpenMP thread)
+#define PT_LADDER_RATIO 0.5   // temperature ratio between adjacent replicas
+#define PT_MAX_SWEEPS 1000    // maximum number of sweeps (N moves per replica) for each II
+
+#define MAPPER_EXACT 6
+#define EXACT_MAX_NODES 48          // largest dfg (nodes) handled by the exact mapper and prover
+#define EXACT_MAX_CANDIDATES 256    // solutions realized (placed and routed) for each II
+#define EXACT_MAX_CONFLICTS 200000  // conflict limit of each SAT solve of the exact mapper
+#define EXACT_LIFETIME_SLACK 1      // cycles a value may wait for its consumer in the first solutions searched
+#define EXACT_PROVER_CONFLICTS 20000 // conflict limit of each II proof before the heuristic mappers
 
 /***************************************************************************************************
  * parallelize_mapping
@@ -44,14 +61,41 @@ cgra *parallelize_mapping(cgra *c, dfg *d, int ***placed, int verbose)
     *new_placed = (int **)calloc(get_dfg_size(d), sizeof(int *));
     int mapper = get_mapping(c);
 
+    // Placement of the first mapping, reused as a reference for the copies
+    int N = get_dfg_size(d), II = get_n_cgra_slices(c), *ids = (int *)malloc(N * sizeof(int));
+    int *refPos = (int *)malloc(N * sizeof(int)), *refSched = (int *)malloc(N * sizeof(int));
+    int *schedule = (int *)calloc(N, sizeof(int)), *inCnt = (int *)calloc(II, sizeof(int)), *outCnt = (int *)calloc(II, sizeof(int));
+
     for (i = 0; i < get_dfg_size(d); i++)
+    {
         (*new_placed)[i] = (int *)calloc(5, sizeof(int)); // [placed?, line, column, first_slice, last_slice]
+        ids[i] = i + 1;
+        refPos[i] = (*placed)[i][1];
+        refSched[i] = (*placed)[i][2];
+        if (!strcmp(get_instr_op(get_instr_by_op_id(d, i + 1)), "STREAM_IN"))
+            inCnt[refSched[i] % II]++;
+        else if (!strcmp(get_instr_op(get_instr_by_op_id(d, i + 1)), "STREAM_OUT"))
+            outCnt[refSched[i] % II]++;
+    }
 
     do
     {
         parallelization_result = 0;
         set_power_for_pe_set(c, POWER_OFF, IN_USE);
-        c = HandOfGod(c, d, new_placed, &parallelization_result, mapper, INFINITY, 0);
+        // Shift the first mapping in space and time. Map the DFG from scratch if it does not fit anywhere.
+        parallelization_result = placeReplica(c, d, ids, N, refPos, refSched, *new_placed, schedule, II, inCnt, outCnt);
+        if (parallelization_result == 0)
+        {
+            c = HandOfGod(c, d, new_placed, &parallelization_result, mapper, INFINITY, 0);
+            // The copy mapped from scratch also uses streaming bandwidth, which placeReplica must respect
+            for (i = 0; i < N && parallelization_result == 1; i++)
+            {
+                if (!strcmp(get_instr_op(get_instr_by_op_id(d, i + 1)), "STREAM_IN"))
+                    inCnt[(*new_placed)[i][2] % II]++;
+                else if (!strcmp(get_instr_op(get_instr_by_op_id(d, i + 1)), "STREAM_OUT"))
+                    outCnt[(*new_placed)[i][2] % II]++;
+            }
+        }
 
         // Reset this new placed array
         for (i = 0; i < get_dfg_size(d); i++)
@@ -71,7 +115,205 @@ cgra *parallelize_mapping(cgra *c, dfg *d, int ***placed, int verbose)
 
     free(new_placed[0]);
     free(new_placed);
+    free(ids);
+    free(refPos);
+    free(refSched);
+    free(schedule);
+    free(inCnt);
+    free(outCnt);
+
+    return c;
+}
+
+/***************************************************************************************************
+ * comap_kernels
+ * Inputs: device model, target DFGs and their II targets (0 if none), mapper select and maximum II
+ * Maps n DFGs onto one device, so that they run concurrently and share its PEs in time (contexts).
+ * The DFGs are merged into a single DFG (merge_dfgs), which is mapped as a whole, so placement and
+ * routing consider all of them jointly. A DFG whose II target is below the common II is merged
+ * several times, so that its copies start an iteration at least every target cycles
+ * (II / copies <= target). The common II is increased until the merged DFG maps with every target
+ * met, up to maxII or the size of one copy of each DFG.
+ * Return values: mapped device (NULL if no co-mapping was found). The merged DFG, its placement
+ * info array and the number of copies of each DFG are returned in combined, placed and copies.
+ ***************************************************************************************************/
+cgra *comap_kernels(cgra *template, dfg **dfgs, int n, int *ii_targets, int mapper, int maxII, dfg **combined, int ***placed, int *copies, int verbose)
+{
+    int i, k, II, hiII, MII, fm, limit = 1, *schedule;
+    cgra *c = NULL;
+    dfg *m = NULL;
+
+    for (k = 0; k < n; k++)
+    {
+        limit += get_dfg_size(dfgs[k]);
+        // Copies only divide the II, so each one still needs the resources of the whole DFG
+        if (ii_targets[k] > 0 && getResMinII(template, dfgs[k]) > ii_targets[k])
+        {
+            if (verbose)
+                printf("DFG #%d cannot reach an II of %d on this device (resource MII = %d).\n", k + 1, ii_targets[k], getResMinII(template, dfgs[k]));
+            return NULL;
+        }
+    }
+    if (maxII > limit)
+        maxII = limit;
+
+    for (II = 1; II <= maxII && c == NULL && !mapping_budget_expired(); II = hiII + 1)
+    {
+        // Copies needed at this II, and the highest II at which they still meet every target
+        hiII = maxII;
+        for (k = 0; k < n; k++)
+        {
+            copies[k] = ii_targets[k] > 0 ? (II + ii_targets[k] - 1) / ii_targets[k] : 1;
+            if (ii_targets[k] > 0 && copies[k] * ii_targets[k] < hiII)
+                hiII = copies[k] * ii_targets[k];
+        }
+
+        m = merge_dfgs(dfgs, copies, n);
+        schedule = rasMixedScheduling(template, m);
+        MII = getMII(template, m, schedule);
+        free(schedule);
+        if (MII > hiII)
+        {
+            delete_dfg(m, 1);
+            continue;
+        }
+        if (verbose)
+            printf("Co-mapping %d nodes (II <= %d).\n", get_dfg_size(m), hiII);
+
+        *placed = (int **)calloc(get_dfg_size(m), sizeof(int *));
+        for (i = 0; i < get_dfg_size(m); i++)
+            (*placed)[i] = (int *)calloc(5, sizeof(int));
+        fm = 1;
+        c = HandOfGod(template, m, placed, &fm, mapper, hiII, 0);
+        if (c == NULL)
+        {
+            for (i = 0; i < get_dfg_size(m); i++)
+                free((*placed)[i]);
+            free(*placed);
+            *placed = NULL;
+            delete_dfg(m, 1);
+        }
+    }
+
+    if (c == NULL)
+        return NULL;
+    *combined = m;
+    if (verbose)
+    {
+        printf("Co-mapped %d DFGs with II = %d.\n", n, get_n_cgra_slices(c));
+        for (k = 0; k < n; k++)
+        {
+            printf("\tDFG #%d: %d cop%s, effective II = %.2f", k + 1, copies[k], copies[k] > 1 ? "ies" : "y", (float)get_n_cgra_slices(c) / copies[k]);
+            if (ii_targets[k] > 0)
+                printf(" (target %d)", ii_targets[k]);
+            printf("\n");
+        }
+    }
+    return c;
+}
+
+/***************************************************************************************************
+ * unroll_search
+ * Inputs: device model, target DFG, maximum unrolling factor and mapper select
+ * Maps the DFG unrolled U = 1, 2, 4, ... maxU times (unroll_dfg), one unrolling factor per OpenMP
+ * thread, and keeps the one with the highest throughput. The throughput of an unrolled DFG is U / II
+ * iterations per cycle, bounded by the streaming ports and bandwidth of the device: each iteration
+ * streams the inputs and outputs of the original DFG, and at most min(stream ports, load/store
+ * bandwidth / data width) of them are transferred per cycle. Ties go to the smaller factor.
+ * Return values: mapped device (NULL if no unrolling factor was mapped). The unrolled DFG, its
+ * placement info array and its unrolling factor are returned in unrolled, placed and best_U.
+ ***************************************************************************************************/
+cgra *unroll_search(cgra *template, dfg *d, int maxU, int mapper, dfg **unrolled, int ***placed, int *best_U, int verbose)
+{
+    int i, k, n, best = -1, n_in = 0, n_out = 0, ports_in, ports_out;
+    float bound = INFINITY, *ipc;
+    cgra **cs, *c = NULL;
+    dfg **ds;
+    int ***ps;
+
+    for (n = 0; (1 << n) <= maxU; n++)
+        ;
+    cs = (cgra **)calloc(n, sizeof(cgra *));
+    ds = (dfg **)malloc(n * sizeof(dfg *));
+    ps = (int ***)malloc(n * sizeof(int **));
+    ipc = (float *)calloc(n, sizeof(float));
+
+    // Stream bound (iterations per cycle), as the available stream resources of the scheduler
+    ports_in = MIN(get_n_stream_ports(template, 0, 0), get_cgra_ld_trghpt(template));
+    ports_out = MIN(get_n_stream_ports(template, 1, 0), get_cgra_st_trghpt(template));
+    for (i = 0; i < get_dfg_size(d); i++)
+    {
+        n_in += !strcmp(get_instr_op(get_dfg_instr(d, i)), "STREAM_IN");
+        n_out += !strcmp(get_instr_op(get_dfg_instr(d, i)), "STREAM_OUT");
+    }
+    if (n_in > 0)
+        bound = (float)ports_in / n_in;
+    if (n_out > 0 && (float)ports_out / n_out < bound)
+        bound = (float)ports_out / n_out;
+
+    for (k = 0; k < n; k++)
+    {
+        ds[k] = unroll_dfg(d, 1 << k);
+        ps[k] = (int **)calloc(get_dfg_size(ds[k]), sizeof(int *));
+        for (i = 0; i < get_dfg_size(ds[k]); i++)
+            ps[k][i] = (int *)calloc(5, sizeof(int));
+    }
+
+    // The unrolled dfgs are mapped in parallel, under the budget of this search
+    mapping_budget *budget = get_mapping_budget();
+#pragma omp parallel for schedule(dynamic, 1)
+    for (k = n - 1; k >= 0; k--)
+    {
+        int fm = 1;
+        mapping_budget *prev = attach_mapping_budget(budget);
+        cs[k] = HandOfGod(template, ds[k], &ps[k], &fm, mapper, INFINITY, 0);
+        if (cs[k] != NULL)
+            ipc[k] = MIN((float)(1 << k) / get_n_cgra_slices(cs[k]), bound);
+        attach_mapping_budget(prev);
+    }
+
+    for (k = 0; k < n; k++)
+        if (cs[k] != NULL && (best < 0 || ipc[k] > ipc[best]))
+            best = k;
+
+    if (verbose)
+    {
+        printf("|------------- UNROLL SEARCH -------------|\n");
+        printf("|  U | Nodes |  II | Iterations/Cycle    |\n");
+        for (k = 0; k < n; k++)
+        {
+            if (cs[k] != NULL)
+                printf("| %2d | %5d | %3d | %16.3f %s |\n", 1 << k, get_dfg_size(ds[k]), get_n_cgra_slices(cs[k]), ipc[k], k == best ? "<-" : "  ");
+            else
+                printf("| %2d | %5d |   - |                -    |\n", 1 << k, get_dfg_size(ds[k]));
+        }
+        printf("|-----------------------------------------|\n");
+        if (bound < INFINITY)
+            printf("Stream bound: %.3f iterations/cycle.\n", bound);
+    }
 
+    for (k = 0; k < n; k++)
+    {
+        if (k == best)
+            continue;
+        if (cs[k] != NULL)
+            delete_cgra(cs[k]);
+        for (i = 0; i < get_dfg_size(ds[k]); i++)
+            free(ps[k][i]);
+        free(ps[k]);
+        delete_dfg(ds[k], 1);
+    }
+    if (best >= 0)
+    {
+        *unrolled = ds[best];
+        *placed = ps[best];
+        *best_U = 1 << best;
+        c = cs[best];
+    }
+    free(ps);
+    free(ds);
+    free(ipc);
+    free(cs);
     return c;
 }
 
@@ -86,73 +328,70 @@ cgra *parallelize_mapping(cgra *c, dfg *d, int ***placed, int verbose)
 int **generatePlacementMatrix(cgra *fs, dfg_instr *target, int **placed, int *schedule, int II, int *minDist)
 {
 
-    int i, j, k, id = get_instr_id(target), iid, ii, jj, dist, t = schedule[id - 1], time_budget;
+    int i, j, k, p, n_pes, id = get_instr_id(target), iid, ii, jj, dist, t = schedule[id - 1], time_budget;
     (*minDist) = INFINITY;
     cgra *c = getModuloSlice(fs, schedule[id - 1], II);
-    int **placementMatrix = (int **)malloc(get_cgra_L(c) * sizeof(int *));
-
-    for (i = 0; i < get_cgra_L(c); i++)
+    int L = get_cgra_L(c), C = get_cgra_C(c);
+    const int *pes = getOpCapablePEs(c, get_operation_index(get_instr_op(target)), &n_pes);
+
+    // Row pointers and rows in a single block. Every tile starts as an invalid placement
+    int **placementMatrix = (int **)malloc(L * sizeof(int *) + L * C * sizeof(int));
+    int *tiles = (int *)(placementMatrix + L);
+    for (i = 0; i < L * C; i++)
+        tiles[i] = -1;
+    for (i = 0; i < L; i++)
+        placementMatrix[i] = tiles + i * C;
+
+    // Only the PEs that support the operation can hold it (structural hazards)
+    for (p = 0; p < n_pes; p++)
     {
-        placementMatrix[i] = (int *)malloc(get_cgra_C(c) * sizeof(int));
-        for (j = 0; j < get_cgra_C(c); j++)
-        {
-            placementMatrix[i][j] = checkStructHazard(c, target, i, j);
-            placementMatrix[i][j] *= !pe_occupied(c, i, j);
-        }
-    }
+        i = pes[p] / C;
+        j = pes[p] % C;
+        if (get_pe_power_mode(c, i, j) != POWER_ON || pe_occupied(c, i, j))
+            continue;
+        placementMatrix[i][j] = 1;
 
-    for (i = 0; i < get_cgra_L(c); i++)
-    {
-        for (j = 0; j < get_cgra_C(c); j++)
+        for (k = 0; k < get_n_inputs(target); k++)
         {
-            if (placementMatrix[i][j] == 0)
-            {
-                placementMatrix[i][j] = -1;
+            iid = get_instr_id(get_input(target, k));
+            if (placed[iid - 1][0] == 0)
                 continue;
-            }
-
-            for (k = 0; k < get_n_inputs(target); k++)
-            {
-                iid = get_instr_id(get_input(target, k));
-                if (placed[iid - 1][0] == 0)
-                    continue;
-                ii = placed[iid - 1][1] / get_cgra_C(c);
-                jj = placed[iid - 1][1] % get_cgra_C(c);
-                time_budget = t - (schedule[iid - 1] + get_instr_lat(get_input(target, k)) - 1);
-                dist = abs(ii - i) + abs(jj - j);
+            ii = placed[iid - 1][1] / C;
+            jj = placed[iid - 1][1] % C;
+            time_budget = t - (schedule[iid - 1] + get_instr_lat(get_input(target, k)) - 1);
+            dist = abs(ii - i) + abs(jj - j);
 
-                if (getconnLat(c, i, j, ii, jj) > 0 && getconnLat(c, i, j, ii, jj) < INFINITY)
-                    dist = dist < getconnLat(c, i, j, ii, jj) ? dist : getconnLat(c, i, j, ii, jj);
+            if (getconnLat(c, i, j, ii, jj) > 0 && getconnLat(c, i, j, ii, jj) < INFINITY)
+                dist = dist < getconnLat(c, i, j, ii, jj) ? dist : getconnLat(c, i, j, ii, jj);
 
-                if (dist <= time_budget && placementMatrix[i][j] > -1)
-                    placementMatrix[i][j] = MAX(dist, placementMatrix[i][j]);
-                else
-                {
-                    if (placementMatrix[i][j] > -1)
-                        (*minDist) = MIN((*minDist), dist - time_budget); // minimum distance, in time, that you could add to get a new position
-                    placementMatrix[i][j] = -1;
-                }
-                // placementMatrix[i][j] *= (dist <= time_budget); // if dist > time budget then it will be impossible to route from this pos
-                // placementMatrix[i][j] = MAX(dist, placementMatrix[i][j]);
+            if (dist <= time_budget && placementMatrix[i][j] > -1)
+                placementMatrix[i][j] = MAX(dist, placementMatrix[i][j]);
+            else
+            {
+                if (placementMatrix[i][j] > -1)
+                    (*minDist) = MIN((*minDist), dist - time_budget); // minimum distance, in time, that you could add to get a new position
+                placementMatrix[i][j] = -1;
             }
-            for (k = 0; k < get_n_recurrences(target); k++)
+            // placementMatrix[i][j] *= (dist <= time_budget); // if dist > time budget then it will be impossible to route from this pos
+            // placementMatrix[i][j] = MAX(dist, placementMatrix[i][j]);
+        }
+        for (k = 0; k < get_n_recurrences(target); k++)
+        {
+            iid = get_instr_id(get_recurrence(target, k));
+            if (placed[iid - 1][0] == 0)
+                continue;
+            ii = placed[iid - 1][1] / C;
+            jj = placed[iid - 1][1] % C;
+            time_budget = (schedule[iid - 1] + get_instr_lat(get_recurrence(target, k)) - 1 + II * get_rec_dist(target, k)) - t;
+            // printf("time budget for recurrence to node %d = %d (%d, %d, %d)\n",iid, time_budget, (schedule[iid - 1] + get_instr_lat(get_recurrence(target, k)) - 1, II, get_rec_dist(target, k))); exit(0);
+            dist = abs(ii - i) + abs(jj - j);
+            if (dist <= time_budget && placementMatrix[i][j] > -1)
+                placementMatrix[i][j] = MAX(dist, placementMatrix[i][j]);
+            else
             {
-                iid = get_instr_id(get_recurrence(target, k));
-                if (placed[iid - 1][0] == 0)
-                    continue;
-                ii = placed[iid - 1][1] / get_cgra_C(c);
-                jj = placed[iid - 1][1] % get_cgra_C(c);
-                time_budget = (schedule[iid - 1] + get_instr_lat(get_recurrence(target, k)) - 1 + II * get_rec_dist(target, k)) - t;
-                // printf("time budget for recurrence to node %d = %d (%d, %d, %d)\n",iid, time_budget, (schedule[iid - 1] + get_instr_lat(get_recurrence(target, k)) - 1, II, get_rec_dist(target, k))); exit(0);
-                dist = abs(ii - i) + abs(jj - j);
-                if (dist <= time_budget && placementMatrix[i][j] > -1)
-                    placementMatrix[i][j] = MAX(dist, placementMatrix[i][j]);
-                else
-                {
-                    if (placementMatrix[i][j] > -1)
-                        (*minDist) = MIN((*minDist), dist - time_budget); // minimum distance, in time, that you could add to get a new position
-                    placementMatrix[i][j] = -1;
-                }
+                if (placementMatrix[i][j] > -1)
+                    (*minDist) = MIN((*minDist), dist - time_budget); // minimum distance, in time, that you could add to get a new position
+                placementMatrix[i][j] = -1;
             }
         }
     }
@@ -175,15 +414,6 @@ int **generatePlacementMatrix(cgra *fs, dfg_instr *target, int **placed, int *sc
 
 void deletePlacementMatrix(int **mat, cgra *c)
 {
-
-    int i;
-    if (mat == NULL)
-        return;
-    for (i = 0; i < get_cgra_L(c); i++)
-    {
-        if (mat[i] != NULL)
-            free(mat[i]);
-    }
     free(mat);
 }
 
@@ -214,6 +444,58 @@ int getReschedulingTimeDistance(cgra *fs, dfg_instr *target, int **placed, int *
     return reschTimeDistance;
 }
 
+/**************************************************************************************************
+ * Placement Candidates
+ * The valid positions of a placement matrix, in the (random) order in which they are tried. Only the
+ * PEs that support the target's operation are visited, and the candidates are sorted in a reusable
+ * per-thread buffer, instead of going through a priority queue over the whole grid. The order is
+ * drawn from the RNG of the calling thread (see setAnnealingRNG), not from the shared rand().
+ *************************************************************************************************/
+typedef struct
+{
+    int pos; // i * C + j
+    int key; // try order
+} placement_cand;
+
+static placement_cand *cand_buf = NULL;
+static int cand_cap = 0;
+#pragma omp threadprivate(cand_buf, cand_cap)
+
+static int comparePlacementCand(const void *a, const void *b)
+{
+    const placement_cand *ca = (const placement_cand *)a, *cb = (const placement_cand *)b;
+
+    if (ca->key != cb->key)
+        return ca->key - cb->key;
+    return ca->pos - cb->pos;
+}
+
+/**
+ * Returns the candidate positions of the target (placement matrix >= 0), sorted by their try order.
+ * The array is owned by the calling thread and is reused by the next call.
+ */
+static placement_cand *getPlacementCandidates(cgra *fs, dfg_instr *target, int **placementMatrix, int *n)
+{
+    int k, n_pes, C = get_cgra_C(fs), sz = get_cgra_L(fs) * C;
+    const int *pes = getOpCapablePEs(fs, get_operation_index(get_instr_op(target)), &n_pes);
+
+    if (n_pes > cand_cap)
+    {
+        cand_cap = n_pes;
+        cand_buf = (placement_cand *)realloc(cand_buf, cand_cap * sizeof(placement_cand));
+    }
+    *n = 0;
+    for (k = 0; k < n_pes; k++)
+    {
+        if (placementMatrix[pes[k] / C][pes[k] % C] < 0)
+            continue;
+        cand_buf[*n].pos = pes[k];
+        cand_buf[(*n)++].key = annealRand() % sz;
+    }
+    qsort(cand_buf, *n, sizeof(placement_cand), comparePlacementCand);
+    return cand_buf;
+}
+
 /********************************
  * attemptPRNode
  * Attempts to perform the placement and routing of a node
@@ -231,7 +513,8 @@ int attemptPRNode(cgra *fs, dfg *d, dfg_instr *target, int **placed, int *schedu
      */
 
     int minDist, **placementMatrix = generatePlacementMatrix(fs, target, placed, schedule, II, &minDist);
-    int i, j, mapped = 0, num_positions = 0, sz = get_cgra_L(fs) * get_cgra_C(fs), priority, candidate_i, candidate_j, status;
+    int k, num_positions, candidate_i, candidate_j, status;
+    placement_cand *cands = getPlacementCandidates(fs, target, placementMatrix, &num_positions);
 
     /***********************************************************************************************
      * 0: All is good;
@@ -242,29 +525,6 @@ int attemptPRNode(cgra *fs, dfg *d, dfg_instr *target, int **placed, int *schedu
      **********************************************************************************************/
     int errcode = 0;
 
-    MinHeap *pq = createMinHeap(sz);
-    // Initialize all nodes with INF distance
-    for (int i = 0; i < sz; i++)
-    {
-        pq->array[i] = newMinHeapNode(i, INFINITY);
-        pq->pos[i] = i;
-    }
-    pq->size = sz;
-
-    for (i = 0; i < get_cgra_L(fs); i++)
-    {
-        for (j = 0; j < get_cgra_C(fs); j++)
-        {
-            if (placementMatrix[i][j] >= 0)
-            {
-                num_positions++;
-                priority = rand() % sz;
-                // Push to priority queue
-                decreaseKey(pq, i * get_cgra_C(fs) + j, priority);
-            }
-        }
-    }
-
     if (num_positions == 0)
     {
         // printf("ERROR[%d]: No positions to map to. MinDist is %d\n", get_instr_id(target), minDist);
@@ -287,69 +547,47 @@ int attemptPRNode(cgra *fs, dfg *d, dfg_instr *target, int **placed, int *schedu
         default:
             break;
         } */
-        freeMinHeap(pq);
         deletePlacementMatrix(placementMatrix, fs);
         return errcode;
     }
 
-    while (!mapped)
+    for (k = 0; k < num_positions; k++)
     {
-        MinHeapNode *best = extractMin(pq);
-        if (best && num_positions > 0)
-        {
-            num_positions--;
-            candidate_i = best->vertex / get_cgra_C(fs);
-            candidate_j = best->vertex % get_cgra_C(fs);
-            freeMinHeapNode(best);
-
-            // Place the Operation
-            status = placeOp(fs, candidate_i, candidate_j, d, target, placed, schedule, II);
-            if (!status)
-            {
-                /* printf("Failed to place node. (?)\n"); */
-                continue;
-            }
-            // Successful Placement
-            else
-            {
-                /************************************
-                 * Try routing the node to its inputs
-                 ************************************/
-                status = routeOp(fs, target, placed, schedule, II);
+        candidate_i = cands[k].pos / get_cgra_C(fs);
+        candidate_j = cands[k].pos % get_cgra_C(fs);
 
-                if (!status)
-                {
-                    /* printf("Failed to route the node to its inputs.\n"); */
-                    unmapOp(fs, d, target, placed, schedule, II);
-                    continue;
-                }
-                // Successful Routing
-                else
-                {
-                    mapped = 1;
-                }
-            }
+        // Place the Operation
+        status = placeOp(fs, candidate_i, candidate_j, d, target, placed, schedule, II);
+        if (!status)
+        {
+            /* printf("Failed to place node. (?)\n"); */
+            continue;
         }
-        // No more placements to try. It is impossible to map this node right now.
-        else
+
+        /************************************
+         * Try routing the node to its inputs
+         ************************************/
+        status = routeOp(fs, target, placed, schedule, II);
+        if (status)
         {
-            /* printf("Failed to map the node %d.\n", get_instr_id(target)); */
-            freeMinHeapNode(best);
-            freeMinHeap(pq);
             deletePlacementMatrix(placementMatrix, fs);
-            errcode = ERR_NO_ROUTE;
-            return errcode;
+            return STATUS_OK;
         }
+        /* printf("Failed to route the node to its inputs.\n"); */
+        unmapOp(fs, d, target, placed, schedule, II);
     }
-    freeMinHeap(pq);
+
+    // No more placements to try. It is impossible to map this node right now.
+    /* printf("Failed to map the node %d.\n", get_instr_id(target)); */
     deletePlacementMatrix(placementMatrix, fs);
-    return STATUS_OK;
+    return ERR_NO_ROUTE;
 }
 
 int attemptPRHandOfGod(cgra *fs, dfg *d, dfg_instr *target, int **placed, int *schedule, int II, int ***pms, int *minDist, int *cst)
 {
     int **placementMatrix;
-    int i, j, mapped = 0, num_positions = 0, sz = get_cgra_L(fs) * get_cgra_C(fs), priority, candidate_i, candidate_j, status;
+    placement_cand *cands;
+    int k, num_positions, candidate_i, candidate_j, status;
 
     // First time calling this node
     if (pms[get_instr_id(target) - 1] == NULL)
@@ -370,29 +608,7 @@ int attemptPRHandOfGod(cgra *fs, dfg *d, dfg_instr *target, int **placed, int *s
      **********************************************************************************************/
     int errcode = 0;
 
-    MinHeap *pq = createMinHeap(sz);
-    // Initialize all nodes with INF distance
-    for (int i = 0; i < sz; i++)
-    {
-        pq->array[i] = newMinHeapNode(i, INFINITY);
-        pq->pos[i] = i;
-    }
-    pq->size = sz;
-
-    for (i = 0; i < get_cgra_L(fs); i++)
-    {
-        for (j = 0; j < get_cgra_C(fs); j++)
-        {
-            if (placementMatrix[i][j] >= 0)
-            {
-                num_positions++;
-                priority = rand() % sz;
-                // Push to priority queue
-                decreaseKey(pq, i * get_cgra_C(fs) + j, priority);
-            }
-        }
-    }
-
+    cands = getPlacementCandidates(fs, target, placementMatrix, &num_positions);
     if (num_positions == 0)
     {
         if (minDist[get_instr_id(target) - 1] == INFINITY)
@@ -404,124 +620,71 @@ int attemptPRHandOfGod(cgra *fs, dfg *d, dfg_instr *target, int **placed, int *s
             cst[CST_DIST] = minDist[get_instr_id(target) - 1];
         }
         // printf("ERROR[%d]: No positions to map to. MinDist is %d\n", get_instr_id(target), minDist);
-        freeMinHeap(pq);
         deletePlacementMatrix(placementMatrix, fs);
         pms[get_instr_id(target) - 1] = NULL;
         minDist[get_instr_id(target) - 1] = INFINITY; // if the mapping fails after rescheduling the first time, don't reschedule anymore
         return errcode;
     }
 
-    while (!mapped)
+    for (k = 0; k < num_positions; k++)
     {
-        MinHeapNode *best = extractMin(pq);
-        if (best && num_positions > 0)
-        {
-            num_positions--;
-            candidate_i = best->vertex / get_cgra_C(fs);
-            candidate_j = best->vertex % get_cgra_C(fs);
-            freeMinHeapNode(best);
-
-            // Place the Operation
-            status = placeOp(fs, candidate_i, candidate_j, d, target, placed, schedule, II);
-            if (!status)
-            {
-                /* printf("Failed to place node. (?)\n"); */
-                continue;
-            }
-            // Successful Placement
-            else
-            {
-                /************************************
-                 * Try routing the node to its inputs
-                 ************************************/
-                status = routeOp(fs, target, placed, schedule, II);
-                placementMatrix[candidate_i][candidate_j] = -2; // in case of backtracking, prevent from retrying the same spot
+        candidate_i = cands[k].pos / get_cgra_C(fs);
+        candidate_j = cands[k].pos % get_cgra_C(fs);
 
-                if (!status)
-                {
-                    /* printf("Failed to route the node to its inputs.\n"); */
-                    unmapOp(fs, d, target, placed, schedule, II);
-                    continue;
-                }
-                // Successful Routing
-                else
-                {
-                    mapped = 1;
-                    minDist[get_instr_id(target) - 1] = INFINITY; // no more rescheduling for this node
-                }
-            }
+        // Place the Operation
+        status = placeOp(fs, candidate_i, candidate_j, d, target, placed, schedule, II);
+        if (!status)
+        {
+            /* printf("Failed to place node. (?)\n"); */
+            continue;
         }
-        // No more placements to try. It is impossible to map this node right now.
-        else
+
+        /************************************
+         * Try routing the node to its inputs
+         ************************************/
+        status = routeOp(fs, target, placed, schedule, II);
+        placementMatrix[candidate_i][candidate_j] = -2; // in case of backtracking, prevent from retrying the same spot
+        if (status)
         {
-            /* printf("Failed to map the node %d.\n", get_instr_id(target)); */
-            freeMinHeapNode(best);
-            freeMinHeap(pq);
-            deletePlacementMatrix(placementMatrix, fs);
-            pms[get_instr_id(target) - 1] = NULL;
-            errcode = ERR_NO_ROUTE;
-            return errcode;
+            minDist[get_instr_id(target) - 1] = INFINITY; // no more rescheduling for this node
+            return STATUS_OK;
         }
+        /* printf("Failed to route the node to its inputs.\n"); */
+        unmapOp(fs, d, target, placed, schedule, II);
     }
-    freeMinHeap(pq);
-    return STATUS_OK;
+
+    // No more placements to try. It is impossible to map this node right now.
+    /* printf("Failed to map the node %d.\n", get_instr_id(target)); */
+    deletePlacementMatrix(placementMatrix, fs);
+    pms[get_instr_id(target) - 1] = NULL;
+    return ERR_NO_ROUTE;
 }
 
 /**
- * Returns an array with all mappable positions for the target node, sorted in a random order
+ * Returns an array with all mappable positions for the target node, sorted in a random order.
+ * The first element stores the number of positions (mp[0][0]); mp[k] = {i, j}, for k = 1..mp[0][0]
  */
 int **getMappablePositions(cgra *fs, dfg *d, dfg_instr *target, int **placed, int *schedule, int II)
 {
     int minDist, **placementMatrix = generatePlacementMatrix(fs, target, placed, schedule, II, &minDist);
-    int i, j, num_positions = 0, sz = get_cgra_L(fs) * get_cgra_C(fs), priority, candidate_i, candidate_j, status;
-
-    int m_pos = 1, **mappable_positions = (int **)calloc(sz + 1, sizeof(int *));
-    for (i = 0; i < sz + 1; i++)
-    {
-        mappable_positions[i] = (int *)calloc(2, sizeof(int));
-    }
-
-    MinHeap *pq = createMinHeap(sz);
-    // Initialize all nodes with INF distance
-    for (int i = 0; i < sz; i++)
-    {
-        pq->array[i] = newMinHeapNode(i, INFINITY);
-        pq->pos[i] = i;
-    }
-    pq->size = sz;
-
-    for (i = 0; i < get_cgra_L(fs); i++)
-    {
-        for (j = 0; j < get_cgra_C(fs); j++)
-        {
-            if (placementMatrix[i][j] >= 0)
-            {
-                num_positions++;
-                priority = rand() % sz;
-                // Push to priority queue
-                decreaseKey(pq, i * get_cgra_C(fs) + j, priority);
-            }
-        }
-    }
+    int k, num_positions, candidate_i, candidate_j, status, m_pos = 1, **mappable_positions, *rows;
+    placement_cand *cands = getPlacementCandidates(fs, target, placementMatrix, &num_positions);
 
+    deletePlacementMatrix(placementMatrix, fs);
     if (num_positions == 0)
-    {
-        freeMinHeap(pq);
-        deletePlacementMatrix(placementMatrix, fs);
-        for (i = 0; i < sz + 1; i++)
-            free(mappable_positions[i]);
-        free(mappable_positions);
         return NULL;
-    }
+
+    // Row pointers and rows in a single block, sized for the candidates (not the whole grid)
+    mappable_positions = (int **)malloc((num_positions + 1) * (sizeof(int *) + 2 * sizeof(int)));
+    rows = (int *)(mappable_positions + num_positions + 1);
+    for (k = 0; k < num_positions + 1; k++)
+        mappable_positions[k] = rows + 2 * k;
 
     // from the filtered candidates, find the ones that result in valid node mappings
-    while (num_positions > 0)
+    for (k = 0; k < num_positions; k++)
     {
-        MinHeapNode *best = extractMin(pq);
-        num_positions--;
-        candidate_i = best->vertex / get_cgra_C(fs);
-        candidate_j = best->vertex % get_cgra_C(fs);
-        freeMinHeapNode(best);
+        candidate_i = cands[k].pos / get_cgra_C(fs);
+        candidate_j = cands[k].pos % get_cgra_C(fs);
 
         // Place the Operation
         status = placeOp(fs, candidate_i, candidate_j, d, target, placed, schedule, II);
@@ -549,18 +712,12 @@ int **getMappablePositions(cgra *fs, dfg *d, dfg_instr *target, int **placed, in
 
     // the first element of the array stores the number of positions
     mappable_positions[0][0] = m_pos - 1;
-
-    freeMinHeap(pq);
-    deletePlacementMatrix(placementMatrix, fs);
+    mappable_positions[0][1] = 0;
     return mappable_positions;
 }
 
 void deleteMappablePosArr(int **mp, cgra *c)
 {
-
-    int i, sz = get_cgra_C(c) * get_cgra_L(c);
-    for (i = 0; i < sz + 1; i++)
-        free(mp[i]);
     free(mp);
 }
 
@@ -573,7 +730,7 @@ void deleteMappablePosArr(int **mp, cgra *c)
  * be mapped. If the target can be mapped, update the placement matrices to reflect the new mappable positions.
  * Return values: search successful ? 1 : 0
  ***********************************************************************************************************************/
-int localized_search(cgra **fs, dfg *d, dfg_instr *target, int **placed, int *schedule, int II, int ***pms, int *minDist)
+static int localizedSearchImpl(cgra **fs, dfg *d, dfg_instr *target, int **placed, int *schedule, int II, int ***pms, int *minDist)
 {
 
     int i, o, p, **mp, io_id, n_pos;
@@ -713,6 +870,19 @@ int localized_search(cgra **fs, dfg *d, dfg_instr *target, int **placed, int *sc
     return 0;
 }
 
+/**
+ * Instrumented entry point: counts the calls and, with the phase timers on, times them as PHASE_LOCALIZED_SEARCH (stats.h)
+ */
+int localized_search(cgra **fs, dfg *d, dfg_instr *target, int **placed, int *schedule, int II, int ***pms, int *minDist)
+{
+    double t0 = STAT_TIMER_BEGIN();
+    int status = localizedSearchImpl(fs, d, target, placed, schedule, II, pms, minDist);
+
+    STAT_INC(STAT_LOCALIZED_SEARCH);
+    STAT_TIMER_END(PHASE_LOCALIZED_SEARCH, t0);
+    return status;
+}
+
 /**********************************************************************************************
  * mapper_fineTuning
  * Inputs: device model, target dfg, placement info array, minimum II, first time mapping flag
@@ -728,6 +898,8 @@ int localized_search(cgra **fs, dfg *d, dfg_instr *target, int **placed, int *sc
  * Return values: mapped device
  **********************************************************************************************/
 #define MAX_BACKTRACKS 100
+#define WARM_START_MAX_ITERS 4
+#define WARM_START_MAX_ROUNDS 8
 cgra *mapper_fineTuning(cgra *template, dfg *d, int ***placed, int MII, int *first_mapping, int maxII, int verbose)
 {
     if (!getRFLimitations(template, d))
@@ -735,13 +907,18 @@ cgra *mapper_fineTuning(cgra *template, dfg *d, int ***placed, int MII, int *fir
     int *schedule = rasMixedScheduling(template, d), *scheduleCopy = (int *)malloc(get_dfg_size(d) * sizeof(int));
     int *scheduleOriginal = (int *)malloc(get_dfg_size(d) * sizeof(int));
     topologicalSortDFG(d);
+    computeCriticality(template, d);
     dfg_instr **dfg_ins = get_dfg_inputs(d);
     dfg_instr **dfg_ops = get_dfg_ops(d);
     dfg_instr **dfg_outs = get_dfg_outputs(d);
+    // Critical nodes (recurrence cycles, no slack) are placed first, while the device is still empty
+    orderByCriticality(dfg_ops);
     dfg_ops = merge_sublists(dfg_ins, dfg_ops);
     dfg_ops = merge_sublists(dfg_ops, dfg_outs);
 
     int i, II, N = get_node_sublist_size(dfg_ops);
+    // Last II tried: N + 1, unless a lower maxII is given or the search starts above it
+    int lastII = (maxII < N + 1) ? maxII : (MII > N + 1) ? MII : N + 1;
     int num_contexts_for_one_iter, failed_to_map = 0, search;
     int ***placementMatrices = (int ***)calloc(get_node_sublist_size(dfg_ops), sizeof(int **));
     int *minDist = (int *)malloc(N * sizeof(int));
@@ -751,7 +928,7 @@ cgra *mapper_fineTuning(cgra *template, dfg *d, int ***placed, int MII, int *fir
 
     cgra *fs;
     int cst[CST_SIZE] = {0};
-    int n_backtracks = 0;
+    int n_backtracks = 0, out_of_budget = 0;
 
     for (i = 0; i < get_dfg_size(d); i++)
     {
@@ -782,7 +959,8 @@ cgra *mapper_fineTuning(cgra *template, dfg *d, int ***placed, int MII, int *fir
                 if (verbose)
                     printf("Failed to map with II = %d\n", II);
                 II++;
-                if (II > N + 1 || (*first_mapping) == 0 || II > maxII)
+                STAT_INC(STAT_II_INCREMENTS);
+                if (II > lastII || (*first_mapping) == 0)
                     break;
             }
             failed_to_map = 0;
@@ -796,6 +974,12 @@ cgra *mapper_fineTuning(cgra *template, dfg *d, int ***placed, int MII, int *fir
         // Iterate through all DFG Ops
         for (i = 0; i < N; i++)
         {
+            budget_note_progress(II, i, N);
+            if (mapping_budget_expired())
+            {
+                out_of_budget = 1;
+                break;
+            }
             int status = attemptPRHandOfGod(fs, d, dfg_ops[i], *placed, schedule, II, placementMatrices, minDist, cst);
 
             if (status != STATUS_OK)
@@ -855,6 +1039,7 @@ cgra *mapper_fineTuning(cgra *template, dfg *d, int ***placed, int MII, int *fir
                 unmapOp(fs, d, dfg_ops[i - 1], *placed, schedule, II);
                 i -= 2;
                 n_backtracks++;
+                STAT_INC(STAT_BACKTRACKS);
                 if (n_backtracks > MAX_BACKTRACKS)
                 {
                     n_backtracks = 0;
@@ -888,6 +1073,8 @@ cgra *mapper_fineTuning(cgra *template, dfg *d, int ***placed, int MII, int *fir
             for (i = 0; i < get_dfg_size(d); i++)
                 schedule[i] = scheduleCopy[i];
         }
+        if (out_of_budget)
+            break;
     }
 
     num_contexts_for_one_iter = max_array(schedule, get_dfg_size(d)) + get_instr_lat(get_dfg_instr(d, max_array_idx(schedule, get_dfg_size(d)))) - 1;
@@ -903,10 +1090,11 @@ cgra *mapper_fineTuning(cgra *template, dfg *d, int ***placed, int MII, int *fir
     free(reSchedules);
     free(hasDoneLocalizedSearch);
 
-    if ((II > N + 1 || II > maxII) && (*first_mapping) == 1)
+    if ((II > lastII || out_of_budget) && (*first_mapping) == 1)
     {
         if (verbose)
-            printf("Failed to map the target DFG to the target device.\n");
+            printf(out_of_budget ? "Mapping budget expired before the target DFG was mapped.\n"
+                                 : "Failed to map the target DFG to the target device.\n");
         delete_cgra(fs);
         return NULL;
     }
@@ -960,6 +1148,7 @@ cgra *mapper_iterative_kernel(cgra *template, dfg_instr **dfg_ops, dfg *d, int *
         if (attempts > 100)
         {
             II++;
+            STAT_INC(STAT_II_INCREMENTS);
             /* printf("could not map with II = %d\n",II-1); */
             if (II > N || (*first_mapping) == 0)
                 break;
@@ -970,6 +1159,9 @@ cgra *mapper_iterative_kernel(cgra *template, dfg_instr **dfg_ops, dfg *d, int *
         // Iterate through all DFG Ops
         for (i = 0; i < N; i++)
         {
+            budget_note_progress(II, i, N);
+            if (mapping_budget_expired())
+                break;
             int status = attemptPRNode(fs, d, dfg_ops[i], *placed, schedule, II, cst);
 
             if (status == STATUS_OK)
@@ -997,12 +1189,21 @@ cgra *mapper_iterative_kernel(cgra *template, dfg_instr **dfg_ops, dfg *d, int *
             for (i = 0; i < get_node_sublist_size(dfg_ops); i++)
                 schedule[i] = scheduleCopy[i];
             i = 0;
+            if (mapping_budget_expired())
+                break;
         }
 
     } while (i < N); // while (!allInstructionsPlaced(*placed, d));
 
     free(scheduleCopy);
 
+    // Budget expired before this attempt found a mapping
+    if (i < N && mapping_budget_expired() && (*first_mapping) == 1)
+    {
+        delete_cgra(fs);
+        return NULL;
+    }
+
     if (II > N && (*first_mapping) == 1)
     {
         printf("Failed to map the target DFG to the target device.\n");
@@ -1040,7 +1241,8 @@ cgra *mapper_iterative(cgra *template, dfg *d, int ***placed, int MII, int *firs
     for (i = 0; i < get_dfg_size(d); i++)
         (*curr_placed)[i] = (int *)calloc(4, sizeof(int)); // [placed?, line & column, first_slice, last_slice]
 
-    for (i = 0; i < max_attempts; i++)
+    // Out of budget: keep the best mapping found so far
+    for (i = 0; i < max_attempts && !mapping_budget_expired(); i++)
     {
         printf("attempt %d.\n", i);
         curr_attempt = mapper_iterative_kernel(template, dfg_ops, d, schedule, placed, MII, first_mapping);
@@ -1089,7 +1291,7 @@ cgra *mapper_iterative(cgra *template, dfg *d, int ***placed, int MII, int *firs
     free(scheduleCopy);
     free(dfg_ops);
 
-    if (*first_mapping == 1)
+    if (*first_mapping == 1 && fs != NULL)
     {
         set_mapping(fs, MAPPER_ITERATIVE);
         define_exec_time(fs, d, *placed, II);
@@ -1106,40 +1308,150 @@ cgra *mapper_iterative(cgra *template, dfg *d, int ***placed, int MII, int *firs
 }
 
 /**********************************************************************************************
- * mapper_simAnnealing
- * Inputs: device model, target dfg, placement info array, minimum II, first time mapping flag
- * Simulated annealing mapper. Runs a simulated annealing algorithm to map the target DFG to the
- * target device. Algorithm structure inspired by the paper 'DRESC'. Contrary to the paper, however,
- * the cost function is based on routability, instead of resource oversuse. This is inspired by the
- * cost function employed by paper 'SPR'. Also inspired by SPR, the cooling schedule is based on
- * the paper 'VPR' (as shown by 'SPR'). The temperature initialization, update and annealing end
- * conditions are all based on that paper.
- * Return values: mapped device
+ * annealNode
+ * Inputs: device model (updated if a move is accepted), target dfg, node list, placement info
+ * array and its backup, schedule, II, temperature, per-node and total costs, routed flags,
+ * move delta buffer, swap enable and the move counters
+ * One annealing step: picks a random node and tries moving it to the free (or, with swaps,
+ * placeable) positions of each cycle within its mobility, until a move is accepted. Each
+ * candidate move is applied to a copy of the device, which replaces the device if accepted.
+ * Random numbers are drawn from the thread's annealing RNG (see setAnnealingRNG).
+ * Return values: move accepted ? 1 : 0
  *********************************************************************************************/
-
-cgra *mapper_simAnnealing(cgra *template, dfg *d, int ***placed, int MII, int *first_mapping, int swap_EN)
+static int annealNode(cgra **fs, dfg *d, dfg_instr **dfg_ops, int **placed, int **placedBackup, int *schedule, int II,
+                      temperature *t, float *cost, float *totalCost, int *routed, move_deltas *md, int swap_EN,
+                      int *totalMoves, int *acceptedMoves)
 {
+    int i, j, s, Npos, N = get_node_sublist_size(dfg_ops), **fpos;
+    cgra *sacrificial_lamb;
+    float moveDelta;
 
-    int *schedule = rasMixedScheduling(template, d), *scheduleCopy = (int *)malloc(get_dfg_size(d) * sizeof(int));
-    topologicalSortDFG(d);
-    dfg_instr **dfg_ins = get_dfg_inputs(d);
-    dfg_instr **dfg_ops = get_dfg_ops(d);
-    dfg_instr **dfg_outs = get_dfg_outputs(d);
-    dfg_ops = merge_sublists(dfg_ins, dfg_ops);
-    dfg_ops = merge_sublists(dfg_ops, dfg_outs);
-    cgra *fs, *sacrificial_lamb;
-    temperature *t;
-    int i, j, s, II = MII, N = get_node_sublist_size(dfg_ops), totalMoves = 0, acceptedMoves = 0;
-    int maxII = getSerialExecLat(d), num_contexts_for_one_iter;
-    float *cost, *moveCost, initTempValue, moves;
+    // Choose a random operation in the schedule
+    int rnode = annealRand() % N;
 
-    // Array that tracks which nodes were successfully routed
-    int *routed = (int *)calloc(N + 1, sizeof(int)), *routedBackup = (int *)calloc(N + 1, sizeof(int));
-    int **placedBackup = (int **)malloc(N * sizeof(int *));
-    int **fpos, Npos, rnode;
-    int *reScheduled = (int *)calloc(N, sizeof(int));
+    /* for (i = 0; i < 4; i++)
+        placedBackup[get_instr_id(dfg_ops[rnode]) - 1][i] = placed[get_instr_id(dfg_ops[rnode]) - 1][i]; */
 
-    for (i = 0; i < N; i++)
+    int *mob = getFixedNodeMobility(schedule, dfg_ops[rnode]);
+    int acceptance = 0, swapped_id = 0;
+
+    for (s = mob[0]; s < mob[1] + 1; s++)
+    {
+        schedule[get_instr_id(dfg_ops[rnode]) - 1] = s;
+        if (swap_EN == 1)
+            fpos = getPlaceablePositions(*fs, dfg_ops[rnode], placed, schedule, II);
+        else
+            fpos = getFreePositions(*fs, dfg_ops[rnode], placed, schedule, II);
+        if (fpos == NULL)
+            continue;
+        Npos = fpos[0][0];
+
+        // Random positions to try
+        for (j = 0; j < Npos; j++)
+        {
+            // God bless
+            sacrificial_lamb = copy_all_cgra_slices(*fs);
+            resetMoveDeltas(md, *totalCost);
+            if (swap_EN == 1)
+            {
+                swapped_id = 0;
+                moveDelta = anneal_swap(sacrificial_lamb, d, dfg_ops, dfg_ops[rnode], fpos[j + 1][0], fpos[j + 1][1],
+                                        placed, schedule, II, cost, routed, &swapped_id, md);
+            }
+            else
+            {
+                moveDelta = m1(sacrificial_lamb, d, dfg_ops, dfg_ops[rnode], fpos[j + 1][0], fpos[j + 1][1], placed, schedule, II, cost,
+                               routed, md);
+            }
+
+            acceptance = evaluateMoveCost(t, moveDelta);
+
+            (*totalMoves)++;
+            if (acceptance == 1)
+            {
+                /* printf("Accepted Move!\n"); */
+                (*acceptedMoves)++;
+                STAT_INC(STAT_SA_ACCEPTED);
+                delete_cgra(*fs);
+                *fs = sacrificial_lamb;
+                updateCost(cost, totalCost, routed, N, md);
+                for (i = 0; i < 4; i++)
+                    placedBackup[get_instr_id(dfg_ops[rnode]) - 1][i] = placed[get_instr_id(dfg_ops[rnode]) - 1][i];
+                // In case of an M2 operation, update the second target node
+                if (swapped_id > 0)
+                {
+                    for (i = 0; i < 4; i++)
+                        placedBackup[swapped_id - 1][i] = placed[swapped_id - 1][i];
+                }
+                // Move was accepted, move on to the next node
+                break;
+            }
+            else
+            {
+                /* printf("Rejected move.\n"); */
+                STAT_INC(STAT_SA_REJECTED);
+                delete_cgra(sacrificial_lamb);
+                // Restore old node position
+                for (i = 0; i < 4; i++)
+                    placed[get_instr_id(dfg_ops[rnode]) - 1][i] = placedBackup[get_instr_id(dfg_ops[rnode]) - 1][i];
+                schedule[get_instr_id(dfg_ops[rnode]) - 1] = placedBackup[get_instr_id(dfg_ops[rnode]) - 1][2];
+                // In case of an M2 operation, restore the second target node
+                if (swapped_id > 0)
+                {
+                    for (i = 0; i < 4; i++)
+                        placed[swapped_id - 1][i] = placedBackup[swapped_id - 1][i];
+                    schedule[swapped_id - 1] = placedBackup[swapped_id - 1][2];
+                }
+                // Restore old routed
+                rejectMoveDeltas(routed, md);
+            }
+        }
+        deleteFreePosArr(fpos, *fs);
+
+        if (acceptance == 1)
+            break;
+    }
+
+    free(mob);
+    return acceptance;
+}
+
+/**********************************************************************************************
+ * mapper_simAnnealing
+ * Inputs: device model, target dfg, placement info array, minimum II, first time mapping flag
+ * Simulated annealing mapper. Runs a simulated annealing algorithm to map the target DFG to the
+ * target device. Algorithm structure inspired by the paper 'DRESC'. Contrary to the paper, however,
+ * the cost function is based on routability, instead of resource oversuse. This is inspired by the
+ * cost function employed by paper 'SPR'. Also inspired by SPR, the cooling schedule is based on
+ * the paper 'VPR' (as shown by 'SPR'). The temperature initialization, update and annealing end
+ * conditions are all based on that paper.
+ * Return values: mapped device
+ *********************************************************************************************/
+
+cgra *mapper_simAnnealing(cgra *template, dfg *d, int ***placed, int MII, int *first_mapping, int swap_EN)
+{
+
+    int *schedule = rasMixedScheduling(template, d), *scheduleCopy = (int *)malloc(get_dfg_size(d) * sizeof(int));
+    topologicalSortDFG(d);
+    computeCriticality(template, d); // weights of the cost function
+    dfg_instr **dfg_ins = get_dfg_inputs(d);
+    dfg_instr **dfg_ops = get_dfg_ops(d);
+    dfg_instr **dfg_outs = get_dfg_outputs(d);
+    dfg_ops = merge_sublists(dfg_ins, dfg_ops);
+    dfg_ops = merge_sublists(dfg_ops, dfg_outs);
+    cgra *fs;
+    temperature *t;
+    int i, II = MII, N = get_node_sublist_size(dfg_ops), totalMoves = 0, acceptedMoves = 0;
+    int maxII = getSerialExecLat(d), num_contexts_for_one_iter;
+    float *cost, totalCost, initTempValue, moves;
+    move_deltas *md = createMoveDeltas(N);
+
+    // Array that tracks which nodes were successfully routed
+    int *routed = (int *)calloc(N + 1, sizeof(int));
+    int **placedBackup = (int **)malloc(N * sizeof(int *));
+    int *reScheduled = (int *)calloc(N, sizeof(int));
+
+    for (i = 0; i < N; i++)
     {
         placedBackup[i] = malloc(4 * sizeof(int));
     }
@@ -1153,104 +1465,22 @@ cgra *mapper_simAnnealing(cgra *template, dfg *d, int ***placed, int MII, int *f
         cost = generateInitialPlacement(fs, d, dfg_ops, *placed, schedule, II, routed);
 
         // Compute an initial temperature value equal to 20x the move cost's std deviation
-        initTempValue = 20 * computeMoveCostStdDev(fs, d, dfg_ops, placed, schedule, II, cost, N);
+        initTempValue = 20 * computeMoveCostStdDev(fs, d, dfg_ops, placed, schedule, II, cost, routed, N);
         /* printf("Init temperature is: %.2f\n",initTempValue); */
         t = initTemperature(initTempValue); // placeholder value
-        copyArray(routedBackup, routed, N + 1);
+        totalCost = array_sum(cost, N);
         for (i = 0; i < N; i++)
             copyArray(placedBackup[i], (*placed)[i], 4);
         moves = 0;
         while (routed[N] < N)
         {
-            // Choose a random operation in the schedule
-            rnode = rand() % N;
-
-            /* for (i = 0; i < 4; i++)
-                placedBackup[get_instr_id(dfg_ops[rnode]) - 1][i] = (*placed)[get_instr_id(dfg_ops[rnode]) - 1][i]; */
-
-            int *mob = getFixedNodeMobility(schedule, dfg_ops[rnode]);
-            int acceptance, swapped_id = 0;
-
-            for (s = mob[0]; s < mob[1] + 1; s++)
-            {
-                schedule[get_instr_id(dfg_ops[rnode]) - 1] = s;
-                if (swap_EN == 1)
-                    fpos = getPlaceablePositions(fs, dfg_ops[rnode], *placed, schedule, II);
-                else
-                    fpos = getFreePositions(fs, dfg_ops[rnode], *placed, schedule, II);
-                if (fpos == NULL)
-                    continue;
-                Npos = fpos[0][0];
-
-                // Random positions to try
-                for (j = 0; j < Npos; j++)
-                {
-                    // God bless
-                    sacrificial_lamb = copy_all_cgra_slices(fs);
-                    if (swap_EN == 1)
-                    {
-                        swapped_id = 0;
-                        moveCost = anneal_swap(sacrificial_lamb, d, dfg_ops, dfg_ops[rnode], fpos[j + 1][0], fpos[j + 1][1],
-                                               *placed, schedule, II, cost, routed, &swapped_id);
-                    }
-                    else
-                    {
-                        moveCost = m1(sacrificial_lamb, d, dfg_ops, dfg_ops[rnode], fpos[j + 1][0], fpos[j + 1][1], *placed, schedule, II, cost, routed);
-                    }
-
-                    acceptance = evaluateMoveCost(t, cost, moveCost, N);
-
-                    totalMoves++;
-                    if (acceptance == 1)
-                    {
-                        /* printf("Accepted Move!\n"); */
-                        acceptedMoves++;
-                        delete_cgra(fs);
-                        fs = sacrificial_lamb;
-                        updateCost(cost, moveCost, N);
-                        for (i = 0; i < 4; i++)
-                            placedBackup[get_instr_id(dfg_ops[rnode]) - 1][i] = (*placed)[get_instr_id(dfg_ops[rnode]) - 1][i];
-                        // In case of an M2 operation, update the second target node
-                        if (swapped_id > 0)
-                        {
-                            for (i = 0; i < 4; i++)
-                                placedBackup[swapped_id - 1][i] = (*placed)[swapped_id - 1][i];
-                        }
-                        // Update routed backup
-                        copyArray(routedBackup, routed, N + 1);
-                        // Move was accepted, move on to the next node
-                        break;
-                    }
-                    else
-                    {
-                        /* printf("Rejected move.\n"); */
-                        delete_cgra(sacrificial_lamb);
-                        // Restore old node position
-                        for (i = 0; i < 4; i++)
-                            (*placed)[get_instr_id(dfg_ops[rnode]) - 1][i] = placedBackup[get_instr_id(dfg_ops[rnode]) - 1][i];
-                        schedule[get_instr_id(dfg_ops[rnode]) - 1] = placedBackup[get_instr_id(dfg_ops[rnode]) - 1][2];
-                        // In case of an M2 operation, restore the second target node
-                        if (swapped_id > 0)
-                        {
-                            for (i = 0; i < 4; i++)
-                                (*placed)[swapped_id - 1][i] = placedBackup[swapped_id - 1][i];
-                            schedule[swapped_id - 1] = placedBackup[swapped_id - 1][2];
-                        }
-                        // Restore old routed
-                        copyArray(routed, routedBackup, N + 1);
-                        free(moveCost);
-                    }
-                }
-                deleteFreePosArr(fpos, fs);
-
-                if (acceptance == 1)
-                    break;
-            }
-
-            free(mob);
+            annealNode(&fs, d, dfg_ops, *placed, placedBackup, schedule, II, t, cost, &totalCost, routed, md, swap_EN,
+                       &totalMoves, &acceptedMoves);
+            budget_note_progress(II, routed[N], N);
+            if (mapping_budget_expired())
+                break;
 
-            // Check if all nodes have successfully been now mapped
-            checkValidMapping(routed, N);
+            // Check if all nodes have successfully been now mapped (routed[N] is kept up to date by updateCost)
             if (routed[N] == N)
                 break;
 
@@ -1259,9 +1489,11 @@ cgra *mapper_simAnnealing(cgra *template, dfg *d, int ***placed, int MII, int *f
             {
                 moves = 0;
                 updateTemperature(t, acceptedMoves, totalMoves);
-                printf("temperature is %.2f, total cost is %.2f\n", getTemperature(t), array_sum(cost, N));
+                // Resynchronize the incrementally updated total, to bound the floating point drift
+                totalCost = array_sum(cost, N);
+                printf("temperature is %.2f, total cost is %.2f\n", getTemperature(t), totalCost);
 
-                if (checkTemperatureStopCriteria(t, cost, N) == 1)
+                if (checkTemperatureStopCriteria(t, totalCost, N) == 1)
                 {
                     display_cgra_in_time(fs, d);
                     break;
@@ -1277,6 +1509,11 @@ cgra *mapper_simAnnealing(cgra *template, dfg *d, int ***placed, int MII, int *f
             printf("Successfully routed all %d DFG nodes. Mapping successfully complete.\n", N);
             break;
         }
+        if (mapping_budget_expired())
+        {
+            delete_cgra(fs);
+            break;
+        }
 
         // Check for schedule padding candidates
         int padScheduling = 0;
@@ -1300,14 +1537,19 @@ cgra *mapper_simAnnealing(cgra *template, dfg *d, int ***placed, int MII, int *f
                 reScheduled[i] = 0;
             printf("Failed to map with II = %d.\n", II);
             II++;
+            STAT_INC(STAT_II_INCREMENTS);
         }
         else
             printf("Padding the scheduling.\n");
     }
 
+    // No mapping found (II limit reached or budget expired). Additional mappings keep the device they were given.
+    if (routed[N] < N)
+        fs = (*first_mapping == 0) ? template : NULL;
+
     num_contexts_for_one_iter = max_array(schedule, get_dfg_size(d)) + get_instr_lat(get_dfg_instr(d, max_array_idx(schedule, get_dfg_size(d)))) - 1;
 
-    if (*first_mapping == 1)
+    if (*first_mapping == 1 && fs != NULL)
     {
         set_mapping(fs, MAPPER_SIM_ANNEALING);
         define_exec_time(fs, d, *placed, II);
@@ -1321,7 +1563,7 @@ cgra *mapper_simAnnealing(cgra *template, dfg *d, int ***placed, int MII, int *f
     free(placedBackup);
     free(schedule);
     free(scheduleCopy);
-    free(routedBackup);
+    deleteMoveDeltas(md);
     free(routed);
     free(dfg_ops);
     free(reScheduled);
@@ -1329,6 +1571,854 @@ cgra *mapper_simAnnealing(cgra *template, dfg *d, int ***placed, int MII, int *f
     return fs;
 }
 
+typedef struct
+{
+    cgra *fs;
+    int **placed, **placedBackup, *schedule, *routed;
+    float *cost, totalCost;
+    move_deltas *md;
+    temperature *t;
+    unsigned int seed;
+    int totalMoves, acceptedMoves;
+} anneal_replica;
+
+/**********************************************************************************************
+ * initReplica
+ * Builds a fresh device for the replica and generates a random initial placement, using the
+ * replica's RNG.
+ * Return values: initial temperature estimate (20x the move cost's std deviation)
+ *********************************************************************************************/
+static float initReplica(anneal_replica *rp, cgra *template, dfg *d, dfg_instr **dfg_ops, int *schedule, int II)
+{
+    int i, N = get_node_sublist_size(dfg_ops), size = get_dfg_size(d);
+    float initTempValue;
+
+    unsigned int *prev_rng = setAnnealingRNG(&rp->seed);
+    for (i = 0; i < size; i++)
+        memset(rp->placed[i], 0, 5 * sizeof(int));
+    copyArray(rp->schedule, schedule, size);
+    rp->fs = buildBaseCGRA(template, II);
+    rp->cost = generateInitialPlacement(rp->fs, d, dfg_ops, rp->placed, rp->schedule, II, rp->routed);
+    initTempValue = 20 * computeMoveCostStdDev(rp->fs, d, dfg_ops, &rp->placed, rp->schedule, II, rp->cost, rp->routed, N);
+    rp->totalCost = array_sum(rp->cost, N);
+    for (i = 0; i < N; i++)
+        copyArray(rp->placedBackup[i], rp->placed[i], 4);
+    rp->totalMoves = 0;
+    rp->acceptedMoves = 0;
+    setAnnealingRNG(prev_rng);
+
+    return initTempValue;
+}
+
+/**********************************************************************************************
+ * mapper_parallelTempering
+ * Inputs: device model, target dfg, placement info array, minimum II, first time mapping flag
+ * Parallel tempering (replica exchange) version of the simulated annealing mapper. K replicas of
+ * the annealing state (device, placement, schedule, costs and RNG) run concurrently, one per
+ * OpenMP thread, each at a different temperature of a geometric ladder. After every sweep (N
+ * moves per replica), replicas at adjacent temperatures exchange their states with probability
+ * min(1, exp((E_i - E_j) * (1/T_i - 1/T_j))), so that good states found at high temperatures
+ * are refined at low ones. Each temperature follows the VPR cooling schedule of the annealer.
+ * The II is increased once every replica meets the stop criteria without a full mapping.
+ * Return values: mapped device (if no mapping was found: NULL, or the input device for additional
+ * mappings)
+ *********************************************************************************************/
+cgra *mapper_parallelTempering(cgra *template, dfg *d, int ***placed, int MII, int *first_mapping)
+{
+    int *schedule = rasMixedScheduling(template, d);
+    topologicalSortDFG(d);
+    computeCriticality(template, d); // weights of the cost function
+    dfg_instr **dfg_ins = get_dfg_inputs(d);
+    dfg_instr **dfg_ops = get_dfg_ops(d);
+    dfg_instr **dfg_outs = get_dfg_outputs(d);
+    dfg_ops = merge_sublists(dfg_ins, dfg_ops);
+    dfg_ops = merge_sublists(dfg_ops, dfg_outs);
+    int i, r, sweep, stop, exchanges, II = MII, N = get_node_sublist_size(dfg_ops), size = get_dfg_size(d);
+    int maxII = getSerialExecLat(d), num_contexts_for_one_iter, mapped = -1;
+    int K = omp_get_max_threads() < PT_MAX_REPLICAS ? omp_get_max_threads() : PT_MAX_REPLICAS;
+    float T0, P;
+    mapping_budget *budget = get_mapping_budget(); // shared by the replicas
+    anneal_replica *rep, tmp;
+    temperature *t;
+    cgra *fs = NULL;
+
+    if (K < 2)
+        K = 2;
+    rep = (anneal_replica *)calloc(K, sizeof(anneal_replica));
+    for (r = 0; r < K; r++)
+    {
+        rep[r].placed = (int **)malloc(size * sizeof(int *));
+        for (i = 0; i < size; i++)
+            rep[r].placed[i] = (int *)calloc(5, sizeof(int));
+        rep[r].placedBackup = (int **)malloc(N * sizeof(int *));
+        for (i = 0; i < N; i++)
+            rep[r].placedBackup[i] = (int *)malloc(4 * sizeof(int));
+        rep[r].schedule = (int *)malloc(size * sizeof(int));
+        rep[r].routed = (int *)calloc(N + 1, sizeof(int));
+        rep[r].md = createMoveDeltas(N);
+        rep[r].t = initTemperature(0);
+        rep[r].seed = (unsigned int)annealRand();
+    }
+
+    while (II < maxII && mapped < 0)
+    {
+        // Random initial placements, one per replica. The ladder starts at the hottest estimate.
+        T0 = 0;
+#pragma omp parallel for num_threads(K) schedule(static, 1) reduction(max : T0)
+        for (r = 0; r < K; r++)
+        {
+            mapping_budget *prev = attach_mapping_budget(budget);
+            float T = initReplica(&rep[r], template, d, dfg_ops, schedule, II);
+            T0 = T > T0 ? T : T0;
+            attach_mapping_budget(prev);
+        }
+        for (r = 0, P = 1; r < K; r++, P *= PT_LADDER_RATIO)
+            setTemperature(rep[r].t, T0 * P);
+
+        exchanges = 0;
+        for (sweep = 0; sweep < PT_MAX_SWEEPS; sweep++)
+        {
+#pragma omp parallel for num_threads(K) schedule(static, 1)
+            for (r = 0; r < K; r++)
+            {
+                anneal_replica *rp = &rep[r];
+                mapping_budget *prev = attach_mapping_budget(budget);
+                unsigned int *prev_rng = setAnnealingRNG(&rp->seed);
+                for (int m = 0; m < N && rp->routed[N] < N; m++)
+                    annealNode(&rp->fs, d, dfg_ops, rp->placed, rp->placedBackup, rp->schedule, II, rp->t, rp->cost, &rp->totalCost,
+                               rp->routed, rp->md, 1, &rp->totalMoves, &rp->acceptedMoves);
+                updateTemperature(rp->t, rp->acceptedMoves, rp->totalMoves);
+                // Resynchronize the incrementally updated total, to bound the floating point drift
+                rp->totalCost = array_sum(rp->cost, N);
+                setAnnealingRNG(prev_rng);
+                attach_mapping_budget(prev);
+            }
+
+            for (r = 0; r < K && mapped < 0; r++)
+            {
+                budget_note_progress(II, rep[r].routed[N], N);
+                if (rep[r].routed[N] == N)
+                    mapped = r;
+            }
+            if (mapped >= 0 || mapping_budget_expired())
+                break;
+
+            // Replica exchange between adjacent temperatures (even and odd pairs in alternate sweeps)
+            for (r = sweep % 2; r + 1 < K; r += 2)
+            {
+                if (evaluateReplicaExchange(rep[r].t, rep[r].totalCost, rep[r + 1].t, rep[r + 1].totalCost))
+                {
+                    // Exchange the states, but keep each temperature (and its cooling statistics) in place
+                    tmp = rep[r];
+                    rep[r] = rep[r + 1];
+                    rep[r + 1] = tmp;
+                    t = rep[r].t;
+                    rep[r].t = rep[r + 1].t;
+                    rep[r + 1].t = t;
+                    i = rep[r].totalMoves;
+                    rep[r].totalMoves = rep[r + 1].totalMoves;
+                    rep[r + 1].totalMoves = i;
+                    i = rep[r].acceptedMoves;
+                    rep[r].acceptedMoves = rep[r + 1].acceptedMoves;
+                    rep[r + 1].acceptedMoves = i;
+                    exchanges++;
+                }
+            }
+
+            for (r = 0, stop = 1; r < K; r++)
+                stop &= checkTemperatureStopCriteria(rep[r].t, rep[r].totalCost, N);
+            if (stop)
+                break;
+        }
+
+        printf("II = %d: %d sweeps, %d replica exchanges, best total cost is %.2f\n", II, sweep + (sweep < PT_MAX_SWEEPS), exchanges,
+               rep[mapped >= 0 ? mapped : K - 1].totalCost);
+
+        // Keep the device of the successful replica (if any)
+        for (r = 0; r < K; r++)
+        {
+            if (r != mapped)
+                delete_cgra(rep[r].fs);
+            free(rep[r].cost);
+        }
+
+        if (mapped < 0)
+        {
+            printf("Failed to map with II = %d.\n", II);
+            if (mapping_budget_expired())
+                break;
+            II++;
+            STAT_INC(STAT_II_INCREMENTS);
+        }
+    }
+
+    if (mapped >= 0)
+    {
+        printf("Successfully routed all %d DFG nodes. Mapping successfully complete.\n", N);
+        fs = rep[mapped].fs;
+        for (i = 0; i < size; i++)
+            copyArray((*placed)[i], rep[mapped].placed[i], 5);
+        num_contexts_for_one_iter = max_array(rep[mapped].schedule, size) + get_instr_lat(get_dfg_instr(d, max_array_idx(rep[mapped].schedule, size))) - 1;
+
+        if (*first_mapping == 1)
+        {
+            set_mapping(fs, MAPPER_PARALLEL_TEMPERING);
+            define_exec_time(fs, d, *placed, II);
+            set_num_contexts_for_one_iteration(fs, num_contexts_for_one_iter + 1);
+        }
+        if ((*first_mapping) == 0)
+            (*first_mapping) = 1;
+    }
+    // Additional mappings (parallelize_mapping) keep the device they were given
+    else if (*first_mapping == 0)
+        fs = template;
+
+    for (r = 0; r < K; r++)
+    {
+        for (i = 0; i < size; i++)
+            free(rep[r].placed[i]);
+        free(rep[r].placed);
+        for (i = 0; i < N; i++)
+            free(rep[r].placedBackup[i]);
+        free(rep[r].placedBackup);
+        free(rep[r].schedule);
+        free(rep[r].routed);
+        deleteMoveDeltas(rep[r].md);
+        deleteTemperature(rep[r].t);
+    }
+    free(rep);
+    free(schedule);
+    free(dfg_ops);
+
+    return fs;
+}
+
+/***************************************************************************************************
+ * mapper_replication
+ * Inputs: device model, target dfg, placement info array, minimum II, maximum II and verbose flag
+ * Mapper for dfgs made of repeated isomorphic subgraphs (e.g. unrolled loop bodies). Maps a single
+ * copy with the fine tuning mapper and replicates its placement on the other copies, shifted in
+ * space and time (placeReplica). The remaining nodes (glue logic) are then mapped with the fine
+ * tuning primitives. When the copies or the glue logic do not fit, the whole dfg is mapped with the
+ * fine tuning mapper at the same II before the II is increased, so that the replicated mapping never
+ * ends at a higher II than fine tuning. Dfgs without replicated subgraphs are mapped by fine tuning.
+ * Return values: mapped device, or NULL if the dfg could not be mapped
+ ***************************************************************************************************/
+cgra *mapper_replication(cgra *template, dfg *d, int ***placed, int MII, int maxII, int verbose)
+{
+    int **copies, n_copies, n, fm = 1;
+
+    if (!getRFLimitations(template, d))
+        return NULL;
+    if (!findReplicatedSubgraphs(d, &copies, &n_copies, &n))
+    {
+        if (verbose)
+            printf("No replicated subgraphs found. Mapping with Fine Tuning.\n");
+        return mapper_fineTuning(template, d, placed, MII, &fm, maxII, verbose);
+    }
+    if (verbose)
+        printf("Found %d copies of a subgraph with %d nodes.\n", n_copies, n);
+
+    int *schedule = rasMixedScheduling(template, d), *scheduleCopy = (int *)malloc(get_dfg_size(d) * sizeof(int));
+    topologicalSortDFG(d);
+    dfg_instr **dfg_ins = get_dfg_inputs(d);
+    dfg_instr **dfg_ops = get_dfg_ops(d);
+    dfg_instr **dfg_outs = get_dfg_outputs(d);
+    dfg_ops = merge_sublists(dfg_ins, dfg_ops);
+    dfg_ops = merge_sublists(dfg_ops, dfg_outs);
+
+    int i, k, c, II, ok, replicated = 0, status, t, num_contexts_for_one_iter, N = get_node_sublist_size(dfg_ops);
+    // Same II range as the fine tuning mapper on the whole dfg
+    int lastII = (maxII < N + 1) ? maxII : (MII > N + 1) ? MII : N + 1;
+    int ***placementMatrices = (int ***)calloc(N, sizeof(int **));
+    int *minDist = (int *)malloc(N * sizeof(int)), cst[CST_SIZE] = {0};
+    int *refPos = (int *)malloc(n * sizeof(int)), *refSched = (int *)malloc(n * sizeof(int));
+    int *inCopy = (int *)calloc(get_dfg_size(d), sizeof(int));
+    int **subPlaced = (int **)malloc(n * sizeof(int *));
+    dfg *sub = extract_subdfg(d, copies[0], n);
+    dfg_instr *target;
+    cgra *fs = NULL, *subFs;
+
+    for (i = 0; i < get_dfg_size(d); i++)
+        scheduleCopy[i] = schedule[i];
+    for (c = 0; c < n_copies; c++)
+        for (k = 0; k < n; k++)
+            inCopy[copies[c][k] - 1] = 1;
+    for (k = 0; k < n; k++)
+        subPlaced[k] = (int *)calloc(5, sizeof(int));
+
+    for (II = MII; II <= lastII && !mapping_budget_expired(); II++)
+    {
+        // Reference mapping of a single copy
+        fm = 1;
+        subFs = mapper_fineTuning(template, sub, &subPlaced, II, &fm, II, 0);
+        if (subFs == NULL)
+        {
+            for (k = 0; k < n; k++)
+                memset(subPlaced[k], 0, 5 * sizeof(int));
+        }
+        else
+        {
+            for (k = 0; k < n; k++)
+            {
+                refPos[k] = subPlaced[k][1];
+                refSched[k] = subPlaced[k][2];
+                memset(subPlaced[k], 0, 5 * sizeof(int));
+            }
+            delete_cgra(subFs);
+
+            // Replicate it
+            int *inCnt = (int *)calloc(II, sizeof(int)), *outCnt = (int *)calloc(II, sizeof(int));
+            fs = buildBaseCGRA(template, II);
+            for (c = 0, ok = 1; c < n_copies && ok; c++)
+                ok = placeReplica(fs, d, copies[c], n, refPos, refSched, *placed, schedule, II, inCnt, outCnt);
+
+            // Glue logic (not connected to the copies)
+            for (i = 0; i < N && ok; i++)
+            {
+                if (mapping_budget_expired())
+                {
+                    ok = 0;
+                    break;
+                }
+                target = dfg_ops[i];
+                if (inCopy[get_instr_id(target) - 1])
+                    continue;
+                status = attemptPRHandOfGod(fs, d, target, *placed, schedule, II, placementMatrices, minDist, cst);
+                if (status == ERR_TIME_BUDGET)
+                {
+                    t = getReschedulingTimeDistance(fs, target, *placed, schedule, II, cst[CST_DIST]);
+                    if (reScheduleNode(schedule, template, d, target, t, 0, II) > 0)
+                        status = attemptPRHandOfGod(fs, d, target, *placed, schedule, II, placementMatrices, minDist, cst);
+                }
+                if (status != STATUS_OK && !localized_search(&fs, d, target, *placed, schedule, II, placementMatrices, minDist))
+                    ok = 0;
+                // Streaming bandwidth shared with the copies
+                t = schedule[get_instr_id(target) - 1] % II;
+                if (ok && !strcmp(get_instr_op(target), "STREAM_IN") && ++inCnt[t] > get_cgra_ld_trghpt(fs))
+                    ok = 0;
+                if (ok && !strcmp(get_instr_op(target), "STREAM_OUT") && ++outCnt[t] > get_cgra_st_trghpt(fs))
+                    ok = 0;
+            }
+            free(inCnt);
+            free(outCnt);
+
+            if (ok)
+            {
+                replicated = 1;
+                break;
+            }
+
+            clearMapping(fs, d, dfg_ops, *placed, schedule, II);
+            for (i = 0; i < N; i++)
+            {
+                deletePlacementMatrix(placementMatrices[i], fs);
+                placementMatrices[i] = NULL;
+            }
+            for (i = 0; i < get_dfg_size(d); i++)
+                schedule[i] = scheduleCopy[i];
+            delete_cgra(fs);
+        }
+        if (verbose)
+            printf("Failed to replicate with II = %d\n", II);
+
+        // The whole dfg with the fine tuning mapper, at the same II
+        fm = 1;
+        fs = mapper_fineTuning(template, d, placed, II, &fm, II, 0);
+        if (fs != NULL)
+        {
+            if (verbose)
+                printf("Mapped with Fine Tuning at II = %d\n", II);
+            break;
+        }
+        for (i = 0; i < get_dfg_size(d); i++)
+            memset((*placed)[i], 0, 5 * sizeof(int));
+        STAT_INC(STAT_II_INCREMENTS);
+    }
+
+    if (replicated)
+    {
+        num_contexts_for_one_iter = max_array(schedule, get_dfg_size(d)) + get_instr_lat(get_dfg_instr(d, max_array_idx(schedule, get_dfg_size(d)))) - 1;
+        set_mapping(fs, MAPPER_REPLICATION);
+        define_exec_time(fs, d, *placed, II);
+        set_num_contexts_for_one_iteration(fs, num_contexts_for_one_iter + 1);
+    }
+
+    for (i = 0; i < N; i++)
+        deletePlacementMatrix(placementMatrices[i], template);
+    for (k = 0; k < n; k++)
+        free(subPlaced[k]);
+    free(subPlaced);
+    free(placementMatrices);
+    free(minDist);
+    free(refPos);
+    free(refSched);
+    free(inCopy);
+    free(schedule);
+    free(scheduleCopy);
+    free(dfg_ops);
+    delete_dfg(sub, 1);
+    deleteReplicatedSubgraphs(copies, n_copies);
+
+    return fs;
+}
+
+/**********************************************************************************************
+ * realizeExactSolution
+ * Inputs: device model, target dfg, node list, placement info array, schedule, solution
+ * (positions and schedule, by id - 1) and II
+ * Places and routes the nodes of an exact model solution, in the order of the node list, with
+ * the mapping primitives (placeOp/routeOp). The schedule of the nodes not yet placed is reset
+ * to the solution before each placement, as pipelined PEs may delay their successors.
+ * Return values: index of the node that could not be placed or routed, or -1 if all were mapped
+ *********************************************************************************************/
+static int realizeExactSolution(cgra *fs, dfg *d, dfg_instr **dfg_ops, int **placed, int *schedule, int *pos, int *solSchedule, int II)
+{
+    int n, k, id, N = get_node_sublist_size(dfg_ops), C = get_cgra_C(fs);
+
+    for (n = 0; n < N; n++)
+    {
+        for (k = 0; k < N; k++)
+        {
+            id = get_instr_id(dfg_ops[k]);
+            if (placed[id - 1][0] == 0)
+                schedule[id - 1] = solSchedule[id - 1];
+        }
+        id = get_instr_id(dfg_ops[n]);
+        if (!placeOp(fs, pos[id - 1] / C, pos[id - 1] % C, d, dfg_ops[n], placed, schedule, II))
+            return n;
+        if (!routeOp(fs, dfg_ops[n], placed, schedule, II))
+        {
+            unmapOp(fs, d, dfg_ops[n], placed, schedule, II);
+            return n;
+        }
+    }
+    return -1;
+}
+
+/**********************************************************************************************
+ * mapper_exact
+ * Inputs: device model, target dfg, placement info array, minimum II, first time mapping flag,
+ * maximum II, verbose flag and the lowest II not proven infeasible (output)
+ * Exact mapper for small dfgs (up to EXACT_MAX_NODES nodes). For each II, from the MII, the
+ * placement and schedule are solved as a SAT problem (buildExactModel) with the embedded solver.
+ * Each solution is placed and routed with the mapping primitives; if a node fails, the positions
+ * and modulo slots of that node and of the mapped nodes it depends on (inputs, recurrences, same
+ * PE) are blocked and the model is solved again, up to EXACT_MAX_CANDIDATES times. Solutions with
+ * short value lifetimes (limitExactLifetimes) are tried first. An II whose model has no solution
+ * is proven infeasible, so the first II mapped after a sequence of proofs is optimal.
+ * Return values: mapped device (if no mapping was found: NULL, or the input device for additional
+ * mappings)
+ *********************************************************************************************/
+cgra *mapper_exact(cgra *template, dfg *d, int ***placed, int MII, int *first_mapping, int maxII, int verbose, int *provenII)
+{
+    topologicalSortDFG(d);
+    dfg_instr **dfg_ins = get_dfg_inputs(d);
+    dfg_instr **dfg_ops = get_dfg_ops(d);
+    dfg_instr **dfg_outs = get_dfg_outputs(d);
+    dfg_ops = merge_sublists(dfg_ins, dfg_ops);
+    dfg_ops = merge_sublists(dfg_ops, dfg_outs);
+    int i, k, n, id, II, status, failed = 0, candidates = 0, infeasible, limited, proven = 1, mapped = 0, vars, clauses;
+    int N = get_node_sublist_size(dfg_ops), size = get_dfg_size(d), num_contexts_for_one_iter;
+    int *schedule = (int *)calloc(size, sizeof(int)), *solSchedule = (int *)calloc(size, sizeof(int));
+    int *pos = (int *)calloc(size, sizeof(int)), *ids = (int *)malloc(N * sizeof(int));
+    exact_model *em;
+    cgra *fs = NULL;
+    dfg_instr *target;
+
+    *provenII = MII;
+    if (N > EXACT_MAX_NODES || !getRFLimitations(template, d))
+    {
+        if (verbose && N > EXACT_MAX_NODES)
+            printf("The exact mapper handles dfgs of up to %d nodes (%d given).\n", EXACT_MAX_NODES, N);
+        free(schedule);
+        free(solSchedule);
+        free(pos);
+        free(ids);
+        free(dfg_ops);
+        return (*first_mapping == 0) ? template : NULL;
+    }
+
+    // Additional mappings (parallelize_mapping) must fit the device as it is
+    if (*first_mapping == 0)
+        MII = maxII = get_n_cgra_slices(template);
+
+    for (II = MII, status = 0; II <= maxII && II <= N + 1; II++)
+    {
+        fs = (*first_mapping == 1) ? buildBaseCGRA(template, II) : template;
+        em = buildExactModel(fs, d, dfg_ops, II);
+        if (verbose)
+        {
+            getExactModelSize(em, &vars, &clauses);
+            printf("II = %d: exact model with %d variables and %d clauses.\n", II, vars, clauses);
+        }
+
+        // The full model decides if the II is feasible. Its solutions are then searched with short
+        // lifetimes first (the router rejects most of the others), and without the limit after those
+        status = solveExactModel(em, EXACT_MAX_CONFLICTS);
+        infeasible = status == 0 && exactModelIsComplete(em);
+        limited = status != 0;
+        if (limited)
+        {
+            deleteExactModel(em);
+            em = buildExactModel(fs, d, dfg_ops, II);
+            limitExactLifetimes(em, fs, EXACT_LIFETIME_SLACK);
+        }
+
+        for (candidates = 0, failed = 0; status != 0 && candidates < EXACT_MAX_CANDIDATES; candidates++)
+        {
+            budget_note_progress(II, failed, N);
+            status = solveExactModel(em, EXACT_MAX_CONFLICTS);
+            if (status != 1 && limited)
+            {
+                deleteExactModel(em);
+                em = buildExactModel(fs, d, dfg_ops, II);
+                limited = 0;
+                status = solveExactModel(em, EXACT_MAX_CONFLICTS);
+            }
+            if (status != 1)
+                break;
+            getExactSolution(em, pos, solSchedule);
+            failed = realizeExactSolution(fs, d, dfg_ops, *placed, schedule, pos, solSchedule, II);
+            if (failed < 0)
+                break;
+
+            // Block the failed node together with the mapped nodes that constrain it
+            target = dfg_ops[failed];
+            ids[0] = get_instr_id(target);
+            for (n = 0, k = 1; n < failed; n++)
+            {
+                id = get_instr_id(dfg_ops[n]);
+                if (get_input_idx(target, dfg_ops[n]) >= 0 || get_rec_dist_from_instr(target, dfg_ops[n]) > 0 ||
+                    get_rec_dist_from_instr(dfg_ops[n], target) > 0 || pos[id - 1] == pos[ids[0] - 1])
+                    ids[k++] = id;
+            }
+            blockExactSolution(em, ids, k);
+
+            if (*first_mapping == 1)
+            {
+                delete_cgra(fs);
+                fs = buildBaseCGRA(template, II);
+                for (i = 0; i < size; i++)
+                    memset((*placed)[i], 0, 5 * sizeof(int));
+            }
+            else
+                clearMapping(fs, d, dfg_ops, *placed, schedule, II);
+            if (mapping_budget_expired())
+            {
+                status = -1;
+                break;
+            }
+        }
+        deleteExactModel(em);
+
+        if (status == 1 && failed < 0)
+        {
+            mapped = 1;
+            break;
+        }
+
+        // An II is proven infeasible only if its model had no solutions at all
+        if (infeasible)
+        {
+            if (proven)
+                *provenII = II + 1;
+            if (verbose)
+                printf("No mapping exists with II = %d.\n", II);
+        }
+        else
+        {
+            proven = 0;
+            if (verbose)
+                printf("Failed to map with II = %d (%d candidate solutions%s).\n", II, candidates,
+                       status < 0 ? ", search limit reached" : "");
+        }
+        if (*first_mapping == 1)
+            delete_cgra(fs);
+        if (mapping_budget_expired())
+            break;
+        STAT_INC(STAT_II_INCREMENTS);
+    }
+
+    if (mapped)
+    {
+        if (verbose)
+            printf("Mapped with II = %d after %d candidate solution(s)%s.\n", II, candidates + 1, proven ? " (optimal II)" : "");
+        num_contexts_for_one_iter = max_array(schedule, size) + get_instr_lat(get_dfg_instr(d, max_array_idx(schedule, size))) - 1;
+        if (*first_mapping == 1)
+        {
+            set_mapping(fs, MAPPER_EXACT);
+            define_exec_time(fs, d, *placed, II);
+            set_num_contexts_for_one_iteration(fs, num_contexts_for_one_iter + 1);
+        }
+        else
+            (*first_mapping) = 1;
+    }
+    // Additional mappings (parallelize_mapping) keep the device they were given
+    else
+        fs = (*first_mapping == 0) ? template : NULL;
+
+    free(schedule);
+    free(solSchedule);
+    free(pos);
+    free(ids);
+    free(dfg_ops);
+
+    return fs;
+}
+
+/***************************************************************************************************
+ * getPlacementHints
+ * Inputs: previously mapped device (e.g. from the result FIFO) and the target dfg
+ * Extracts the position and context of every node of the previous mapping that is also present in
+ * the target dfg. Nodes are matched by name and operation.
+ * Return values: hints array (hints[id-1] = {pos = iC + j, context, start cycle}, -1 if unknown)
+ ***************************************************************************************************/
+int **getPlacementHints(cgra *prior, dfg *d)
+{
+    int i, j, s, id, **hints = (int **)malloc(get_dfg_size(d) * sizeof(int *));
+    dfg_instr *instr, *target;
+    cgra *c = getFirstSlice(prior);
+
+    for (i = 0; i < get_dfg_size(d); i++)
+    {
+        hints[i] = (int *)malloc(HINT_WORDS * sizeof(int));
+        hints[i][HINT_POS] = hints[i][HINT_CONTEXT] = hints[i][HINT_CYCLE] = -1;
+    }
+
+    for (s = 0; c != NULL; s++, c = get_next_slice(c))
+    {
+        for (i = 0; i < get_cgra_L(c); i++)
+        {
+            for (j = 0; j < get_cgra_C(c); j++)
+            {
+                instr = get_cgra_tile(c, i, j);
+                if (instr == NULL)
+                    continue;
+                target = get_instr_by_name(d, get_instr_name(instr));
+                if (target == NULL || strcmp(get_instr_op(target), get_instr_op(instr)))
+                    continue;
+                id = get_instr_id(target);
+                if (hints[id - 1][HINT_POS] >= 0)
+                    continue;
+                hints[id - 1][HINT_POS] = i * get_cgra_C(c) + j;
+                hints[id - 1][HINT_CONTEXT] = s;
+            }
+        }
+    }
+    return hints;
+}
+
+void deletePlacementHints(int **hints, dfg *d)
+{
+    int i;
+    if (hints == NULL)
+        return;
+    for (i = 0; i < get_dfg_size(d); i++)
+        free(hints[i]);
+    free(hints);
+}
+
+/***************************************************************************************************
+ * mapper_warmStart
+ * Inputs: device model, target dfg, placement info array, placement hints, II, the counter of nodes
+ * kept from the previous mapping and the node that could not be repaired (output)
+ * Incremental mapper. Visits the nodes in the same order as the fine tuning mapper and first tries
+ * to place and route each node exactly where it was in the previous mapping (same PE and context).
+ * Only the nodes for which that is no longer legal (changed nodes, removed PEs or interconnects,
+ * inputs that moved) are searched for a new position, with the fine tuning primitives.
+ * Return values: mapped device, or NULL if the invalidated region could not be repaired
+ ***************************************************************************************************/
+cgra *mapper_warmStart(cgra *template, dfg *d, int ***placed, int **hints, int II, int *kept, dfg_instr **failed)
+{
+    if (!getRFLimitations(template, d))
+        return NULL;
+    int *schedule = rasMixedScheduling(template, d), *scheduleCopy = (int *)malloc(get_dfg_size(d) * sizeof(int));
+    int *scheduleOriginal = (int *)malloc(get_dfg_size(d) * sizeof(int));
+    topologicalSortDFG(d);
+    dfg_instr **dfg_ins = get_dfg_inputs(d);
+    dfg_instr **dfg_ops = get_dfg_ops(d);
+    dfg_instr **dfg_outs = get_dfg_outputs(d);
+    dfg_ops = merge_sublists(dfg_ins, dfg_ops);
+    dfg_ops = merge_sublists(dfg_ops, dfg_outs);
+
+    int i, j, k, iid, pos, ready, t, prev, it, placedAtHint, status, num_contexts_for_one_iter;
+    int N = get_node_sublist_size(dfg_ops), C = get_cgra_C(template), L = get_cgra_L(template);
+    int ***placementMatrices = (int ***)calloc(N, sizeof(int **));
+    int *minDist = (int *)malloc(N * sizeof(int));
+    int cst[CST_SIZE] = {0};
+    dfg_instr *target;
+    cgra *fs;
+
+    for (i = 0; i < get_dfg_size(d); i++)
+    {
+        scheduleCopy[i] = schedule[i];
+        scheduleOriginal[i] = schedule[i];
+    }
+    adjustModuloScheduling(schedule, scheduleCopy, scheduleOriginal, template, d, dfg_ops, II);
+
+    fs = buildBaseCGRA(template, II);
+    *kept = 0;
+    *failed = NULL;
+
+    for (i = 0; i < N; i++)
+    {
+        target = dfg_ops[i];
+        k = get_instr_id(target) - 1;
+
+        // Inputs may have been mapped at a different time than scheduled
+        ready = 0;
+        for (j = 0; j < get_n_inputs(target); j++)
+        {
+            iid = get_instr_id(get_input(target, j));
+            if (schedule[iid - 1] + get_instr_lat(get_input(target, j)) > ready)
+                ready = schedule[iid - 1] + get_instr_lat(get_input(target, j));
+        }
+        if (schedule[k] < ready)
+            schedule[k] = ready;
+
+        // Try to keep the previous placement (same PE, same context)
+        pos = hints[k][HINT_POS];
+        if (pos >= 0 && pos < L * C)
+        {
+            prev = schedule[k];
+            if (hints[k][HINT_CYCLE] >= ready)
+                t = hints[k][HINT_CYCLE];
+            else if (hints[k][HINT_CONTEXT] >= 0)
+                t = ready + ((hints[k][HINT_CONTEXT] - ready) % II + II) % II;
+            else
+                t = prev;
+
+            // The start cycle is only known modulo II: try the same context over a few iterations
+            for (it = 0, placedAtHint = 0; it < WARM_START_MAX_ITERS && !placedAtHint; it++, t += II)
+            {
+                schedule[k] = t;
+                if (!checkStructHazard(getModuloSlice(fs, t, II), target, pos / C, pos % C) ||
+                    !placeOp(fs, pos / C, pos % C, d, target, *placed, schedule, II))
+                    continue;
+                placedAtHint = routeOp(fs, target, *placed, schedule, II);
+                if (!placedAtHint)
+                    unmapOp(fs, d, target, *placed, schedule, II);
+                if (hints[k][HINT_CYCLE] >= ready)
+                    break;
+            }
+            if (placedAtHint)
+            {
+                (*kept)++;
+                continue;
+            }
+            schedule[k] = prev;
+        }
+
+        // Repair: search for a new position for the invalidated node
+        status = attemptPRHandOfGod(fs, d, target, *placed, schedule, II, placementMatrices, minDist, cst);
+        if (status == ERR_TIME_BUDGET)
+        {
+            t = getReschedulingTimeDistance(fs, target, *placed, schedule, II, cst[CST_DIST]);
+            if (reScheduleNode(schedule, template, d, target, t, 0, II) > 0)
+                status = attemptPRHandOfGod(fs, d, target, *placed, schedule, II, placementMatrices, minDist, cst);
+        }
+        if (status != STATUS_OK && !localized_search(&fs, d, target, *placed, schedule, II, placementMatrices, minDist))
+            break;
+    }
+
+    num_contexts_for_one_iter = max_array(schedule, get_dfg_size(d)) + get_instr_lat(get_dfg_instr(d, max_array_idx(schedule, get_dfg_size(d)))) - 1;
+
+    if (i < N)
+    {
+        *failed = dfg_ops[i];
+        clearMapping(fs, d, dfg_ops, *placed, schedule, II);
+        delete_cgra(fs);
+        fs = NULL;
+    }
+    else
+    {
+        set_mapping(fs, MAPPER_FINETUNING);
+        define_exec_time(fs, d, *placed, II);
+        set_num_contexts_for_one_iteration(fs, num_contexts_for_one_iter + 1);
+    }
+
+    free(schedule);
+    free(scheduleCopy);
+    free(scheduleOriginal);
+    for (i = 0; i < N; i++)
+        deletePlacementMatrix(placementMatrices[i], template);
+    free(placementMatrices);
+    free(dfg_ops);
+    free(minDist);
+
+    return fs;
+}
+
+/*****************************************************************************************************
+ * HandOfGodWarmStart
+ * Inputs: device model, target dfg, placement info array, placement hints from a previous mapping,
+ * the previous II, a mapper select (used if the warm start fails), maximum II and verbose flag
+ * Remaps a slightly changed dfg/device starting from a previous mapping: every node whose placement
+ * and routes are still legal is kept, and only the invalidated region is remapped. Falls back to a
+ * full mapping (HandOfGod) if the invalidated region cannot be repaired. The hints are updated
+ * as the invalidated region grows.
+ * Return values: mapped device
+ ****************************************************************************************************/
+cgra *HandOfGodWarmStart(cgra *template, dfg *d, int ***placed, int **hints, int priorII, int mapper, int maxII, int verbose)
+{
+    int *schedule = rasMixedScheduling(template, d);
+    int MII = getMII(template, d, schedule), II, kept, round, i, j, fm = 1;
+    double start, end;
+    dfg_instr *failed;
+    cgra *fs = NULL;
+
+    free(schedule);
+    srand(time(NULL));
+    if (verbose)
+        start = omp_get_wtime();
+
+    II = priorII > MII ? priorII : MII;
+
+    // If a node cannot be repaired, release the previous placement of its inputs and retry
+    for (round = 0; hints != NULL && II <= maxII && round < WARM_START_MAX_ROUNDS; round++)
+    {
+        fs = mapper_warmStart(template, d, placed, hints, II, &kept, &failed);
+        if (fs != NULL || failed == NULL)
+            break;
+        for (i = 0; i < get_n_inputs(failed); i++)
+            hints[get_instr_id(get_input(failed, i)) - 1][HINT_POS] = -1;
+        hints[get_instr_id(failed) - 1][HINT_POS] = -1;
+    }
+
+    if (fs == NULL)
+    {
+        if (verbose)
+            printf("Warm start failed. Remapping from scratch.\n");
+        for (i = 0; i < get_dfg_size(d); i++)
+            for (j = 0; j < 5; j++)
+                (*placed)[i][j] = 0;
+        return HandOfGod(template, d, placed, &fm, mapper, maxII, verbose);
+    }
+
+    setDeviceMII(fs, MII);
+    if (verbose)
+    {
+        end = omp_get_wtime();
+        printf("Warm start: kept %d of %d nodes from the previous mapping (II = %d).\n", kept, get_dfg_size(d), II);
+        printf("execution time: %lf\n", end - start);
+    }
+    return fs;
+}
+
+// Whether the heuristic mappers start above the IIs proven infeasible by the exact model (proveMinII)
+static int ii_prover = 0;
+
+void set_ii_prover(int enable)
+{
+    ii_prover = enable != 0;
+}
+
+int get_ii_prover(void)
+{
+    return ii_prover;
+}
+
 /*****************************************************************************************************
  * HandOfGod
  * Inputs: device model, target dfg, placement info array, first time mapping flag and a mapper select
@@ -1338,15 +2428,36 @@ cgra *mapper_simAnnealing(cgra *template, dfg *d, int ***placed, int MII, int *f
  ****************************************************************************************************/
 cgra *HandOfGod(cgra *template, dfg *d, int ***placed, int *first_mapping, int mapper, int maxII, int verbose)
 {
+    cgra *fs;
+
     /**
      * placed[id-1] = {placed ? 1:0, pos = iC + j, sched first context, sched last context}
      */
+    // Reuse a previous mapping of the same kernel onto the same device (first mappings only)
+    if (*first_mapping == 1)
+    {
+        fs = mapping_cache_lookup(template, d, *placed, mapper, maxII);
+        if (fs != NULL)
+        {
+            if (verbose)
+                printf("Mapping cache hit: II = %d\n", get_n_cgra_slices(fs));
+            return fs;
+        }
+    }
+
+    double t_map = STAT_TIMER_BEGIN();
     int *schedule = rasMixedScheduling(template, d);
     int MII = getMII(template, d, schedule);
 
     free(schedule);
+
+    // Skip the IIs that the exact model proves infeasible (first mappings of small dfgs, if enabled)
+    int searchMII = MII;
+    if (ii_prover && *first_mapping == 1 && mapper != MAPPER_EXACT && get_dfg_size(d) <= EXACT_MAX_NODES)
+        searchMII = proveMinII(template, d, MII, maxII, EXACT_PROVER_CONFLICTS, verbose);
+
     int seed;
-    cgra *fs;
+    unsigned int rng, *prev_rng;
     double start, end;
     double cpu_time_used;
 
@@ -1354,7 +2465,10 @@ cgra *HandOfGod(cgra *template, dfg *d, int ***placed, int *first_mapping, int m
     //seed = 1747756595;
 
     srand(seed);
-    
+    // The randomized primitives of this run draw from its own generator, as runs may be concurrent
+    rng = seed;
+    prev_rng = setAnnealingRNG(&rng);
+
     if (verbose)
         start = omp_get_wtime();
 
@@ -1402,32 +2516,64 @@ cgra *HandOfGod(cgra *template, dfg *d, int ***placed, int *first_mapping, int m
     case MAPPER_FINETUNING:
         if (verbose)
             printf("Mapper: Fine Tuning\n");
-        fs = mapper_fineTuning(template, d, placed, MII, first_mapping, maxII, verbose);
+        fs = mapper_fineTuning(template, d, placed, searchMII, first_mapping, maxII, verbose);
         break;
     // Iterative Mapper. Each iteration consists in a basic mapper with dynamic node rescheduling
     case MAPPER_ITERATIVE:
         if (verbose)
             printf("Mapper: Iterative\n");
-        fs = mapper_iterative(template, d, placed, MII, first_mapping);
+        fs = mapper_iterative(template, d, placed, searchMII, first_mapping);
         break;
     case MAPPER_SIM_ANNEALING:
         if (verbose)
             printf("Mapper: Simulated Annealing\n");
         // fs = mapper_simAnnealing(template, d, placed, MII, first_mapping, 1);
-        fs = mapper_simAnnealing(template, d, placed, MII, first_mapping, 1);
+        fs = mapper_simAnnealing(template, d, placed, searchMII, first_mapping, 1);
+        break;
+    // Simulated annealing with several replicas at different temperatures, one per thread
+    case MAPPER_PARALLEL_TEMPERING:
+        if (verbose)
+            printf("Mapper: Parallel Tempering\n");
+        fs = mapper_parallelTempering(template, d, placed, searchMII, first_mapping);
+        break;
+    // SAT based mapper for small dfgs. Falls back to Fine Tuning above the IIs it proved infeasible
+    case MAPPER_EXACT:
+        if (verbose)
+            printf("Mapper: Exact\n");
+        fs = mapper_exact(template, d, placed, searchMII, first_mapping, maxII, verbose, &searchMII);
+        if (fs == NULL && *first_mapping == 1 && searchMII <= maxII && !mapping_budget_expired())
+        {
+            if (verbose)
+                printf("No exact mapping found. Falling back to Fine Tuning from II = %d.\n", searchMII);
+            fs = mapper_fineTuning(template, d, placed, searchMII, first_mapping, maxII, verbose);
+        }
+        break;
+    // Maps one copy of a replicated subgraph and reuses its placement for the other copies
+    case MAPPER_REPLICATION:
+        if (verbose)
+            printf("Mapper: Replication\n");
+        // Additional mappings (parallelize_mapping) replicate through placeReplica already
+        if (*first_mapping == 1)
+            fs = mapper_replication(template, d, placed, searchMII, maxII, verbose);
+        else
+            fs = mapper_fineTuning(template, d, placed, searchMII, first_mapping, maxII, verbose);
         break;
     default:
         if (verbose)
             printf("Default Mapper (Fine Tuning)\n");
-        fs = mapper_fineTuning(template, d, placed, MII, first_mapping, maxII, verbose);
+        fs = mapper_fineTuning(template, d, placed, searchMII, first_mapping, maxII, verbose);
         break;
     }
 
-    // For the first mapping, set the MII
+    // For the first mapping, set the MII. Best-effort results of an expired budget are not cached.
     if (fs != NULL && (*first_mapping == 1))
     {
         setDeviceMII(fs, MII);
+        if (!mapping_budget_expired())
+            mapping_cache_store(fs, template, d, *placed, mapper, maxII);
     }
+    setAnnealingRNG(prev_rng);
+    STAT_TIMER_END(PHASE_MAPPING, t_map);
 
     // end = clock();
     if (verbose)
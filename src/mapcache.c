@@ -0,0 +1,301 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include "dfg.h"
+#include "cgra.h"
+#include "bitstream.h"
+#include "mapcache.h"
+
+static char cache_dir[MAPCACHE_MAX_PATH] = ""; // disabled
+static unsigned tmp_ctr = 0; // temporary entry names are unique per store, so that threads of a process never collide
+
+static uint64_t hash_int(int val, uint64_t h)
+{
+    return fnv1a_hash(&val, sizeof(int), h);
+}
+
+static uint64_t hash_instr(dfg_instr *t)
+{
+    uint64_t h = FNV_OFFSET_BASIS;
+    char *op = get_instr_op(t);
+    int k;
+
+    h = hash_int(get_instr_id(t), h);
+    h = fnv1a_hash(op, strlen(op) + 1, h);
+    h = hash_int(get_instr_lat(t), h);
+
+    h = hash_int(get_n_inputs(t), h);
+    for (k = 0; k < get_n_inputs(t); k++)
+        h = hash_int(get_input(t, k) != NULL ? get_input_id(t, k) : 0, h);
+
+    h = hash_int(get_n_outputs(t), h);
+    for (k = 0; k < get_n_outputs(t); k++)
+        h = hash_int(get_output(t, k) != NULL ? get_output_id(t, k) : 0, h);
+
+    h = hash_int(get_n_recurrences(t), h);
+    for (k = 0; k < get_n_recurrences(t); k++)
+    {
+        if (get_recurrence(t, k) == NULL)
+            continue;
+        h = hash_int(get_instr_id(get_recurrence(t, k)), h);
+        h = hash_int(get_rec_dist(t, k), h);
+    }
+
+    h = hash_int(get_n_consts(t), h);
+    for (k = 0; k < get_n_consts(t); k++)
+    {
+        if (get_const(t, k) == NULL)
+            continue;
+        h = hash_int(get_const_id(t, k), h);
+        h = hash_int(get_const_val(get_const(t, k)), h);
+    }
+
+    return h;
+}
+
+/**************************************************************************************
+ * hash_dfg
+ * Content hash of the dfg: ops, latencies, edges, recurrences and constants.
+ * Node records are combined commutatively, so the hash does not depend on the order
+ * of the instruction array (which the schedulers may sort in place).
+ *************************************************************************************/
+uint64_t hash_dfg(dfg *d)
+{
+    uint64_t h = 0;
+    int k;
+
+    for (k = 0; k < get_dfg_size(d); k++)
+        h += hash_instr(get_dfg_instr(d, k));
+    for (k = 0; k < get_dfg_n_consts(d); k++)
+        h += hash_instr(get_dfg_const(d, k));
+
+    h = hash_int(get_dfg_size(d), h);
+    return hash_int(get_dfg_n_consts(d), h);
+}
+
+uint64_t hash_device(cgra *template)
+{
+    int n_words;
+    int *sig = get_device_signature(template, &n_words);
+    uint64_t h = fnv1a_hash(sig, n_words * sizeof(int), FNV_OFFSET_BASIS);
+
+    free(sig);
+    return h;
+}
+
+/**************************************************************************************
+ * set_mapping_cache_dir
+ * Sets the cache directory. NULL (or an empty string) disables the mapping cache.
+ *************************************************************************************/
+void set_mapping_cache_dir(const char *dir)
+{
+    if (dir == NULL)
+        cache_dir[0] = '\0';
+    else
+        snprintf(cache_dir, MAPCACHE_MAX_PATH, "%s", dir);
+}
+
+const char *get_mapping_cache_dir(void)
+{
+    return cache_dir[0] == '\0' ? NULL : cache_dir;
+}
+
+/**************************************************************************************
+ * get_default_mapping_cache_dir
+ * Per-user cache directory: $XDG_CACHE_HOME/midas, or $HOME/.cache/midas.
+ * Return values: directory, or NULL if neither variable is set
+ *************************************************************************************/
+const char *get_default_mapping_cache_dir(void)
+{
+    static char dir[MAPCACHE_MAX_PATH];
+    const char *base = getenv("XDG_CACHE_HOME");
+
+    if (base != NULL && base[0] != '\0')
+        snprintf(dir, MAPCACHE_MAX_PATH, "%s/%s", base, MAPCACHE_SUBDIR);
+    else if ((base = getenv("HOME")) != NULL && base[0] != '\0')
+        snprintf(dir, MAPCACHE_MAX_PATH, "%s/.cache/%s", base, MAPCACHE_SUBDIR);
+    else
+        return NULL;
+    return dir;
+}
+
+/**
+ * Creates the cache directory and its missing parents
+ * Return values: success ? 0 : -1
+ */
+static int make_cache_dir(void)
+{
+    char dir[MAPCACHE_MAX_PATH];
+    char *p;
+
+    snprintf(dir, MAPCACHE_MAX_PATH, "%s", cache_dir);
+    for (p = dir + 1; *p != '\0'; p++)
+    {
+        if (*p != '/')
+            continue;
+        *p = '\0';
+        if (mkdir(dir, 0755) != 0 && errno != EEXIST)
+            return -1;
+        *p = '/';
+    }
+    return (mkdir(dir, 0755) != 0 && errno != EEXIST) ? -1 : 0;
+}
+
+static void get_entry_path(char *path, uint64_t dfg_hash, uint64_t device_hash, int mapper, int maxII)
+{
+    snprintf(path, MAPCACHE_MAX_PATH + 64, "%s/v%d-%016llx-%016llx-m%d-ii%d%s%s.mbs", cache_dir, MAPCACHE_VERSION,
+             (unsigned long long)dfg_hash, (unsigned long long)device_hash, mapper, maxII, get_multicast_routing() ? "-mc" : "",
+             get_ii_prover() ? "-pv" : "");
+}
+
+/**
+ * Returns 1 (true) if every node is placed on a PE that holds it in at least one context
+ */
+static int placement_matches_device(cgra *fs, dfg *d, int **placed)
+{
+    int k, s, pos, found, II = get_n_cgra_slices(fs), L = get_cgra_L(fs), C = get_cgra_C(fs);
+    dfg_instr *target;
+    cgra *c;
+
+    if (!allInstructionsPlaced(placed, d))
+        return 0;
+
+    for (k = 0; k < get_dfg_size(d); k++)
+    {
+        target = get_instr_by_op_id(d, k + 1);
+        pos = placed[k][1];
+        if (target == NULL)
+            continue;
+        if (pos < 0 || pos >= L * C)
+            return 0;
+
+        found = 0;
+        for (s = 0, c = fs; s < II && !found; s++, c = get_next_slice(c))
+            found = get_cgra_tile(c, pos / C, pos % C) == target;
+        if (!found)
+            return 0;
+    }
+    return 1;
+}
+
+/**************************************************************************************
+ * mapping_cache_lookup
+ * Inputs: device template, dfg, placement info array and the mapper configuration
+ * Loads a previously stored mapping for the same (dfg, device, mapper) key. Entries that
+ * fail validation are removed from the cache. placed is cleared on a miss.
+ * Return values: mapped device on a hit, NULL otherwise
+ *************************************************************************************/
+cgra *mapping_cache_lookup(cgra *template, dfg *d, int **placed, int mapper, int maxII)
+{
+    char path[MAPCACHE_MAX_PATH + 64];
+    uint64_t dfg_hash, device_hash;
+    const bs_header *h;
+    bitstream *bs;
+    cgra *fs = NULL;
+    int k;
+
+    if (cache_dir[0] == '\0')
+        return NULL;
+
+    dfg_hash = hash_dfg(d);
+    device_hash = hash_device(template);
+    get_entry_path(path, dfg_hash, device_hash, mapper, maxII);
+    if (access(path, R_OK) != 0)
+        return NULL;
+
+    bs = open_bitstream(path);
+    if (bs != NULL)
+    {
+        h = bitstream_header(bs);
+        if (h->dfg_hash == dfg_hash && h->device_hash == device_hash)
+            fs = bitstream_to_cgra(bs, template, d, placed);
+        close_bitstream(bs);
+    }
+
+    if (fs != NULL && !placement_matches_device(fs, d, placed))
+    {
+        delete_cgra(fs);
+        fs = NULL;
+    }
+
+    if (fs == NULL)
+    {
+        printf("Discarding invalid mapping cache entry '%s'.\n", path);
+        unlink(path);
+        for (k = 0; k < get_dfg_size(d); k++)
+            memset(placed[k], 0, BS_PLACED_WORDS * sizeof(int));
+    }
+
+    return fs;
+}
+
+/**************************************************************************************
+ * mapping_cache_store
+ * Stores a mapped device in the cache. The entry is written to a temporary file and
+ * renamed, so that concurrent runs never observe a partially written entry.
+ * Return values: success ? 0 : -1
+ *************************************************************************************/
+int mapping_cache_store(cgra *fs, cgra *template, dfg *d, int **placed, int mapper, int maxII)
+{
+    char path[MAPCACHE_MAX_PATH + 64], tmp_path[MAPCACHE_MAX_PATH + 80];
+    uint64_t dfg_hash, device_hash;
+
+    if (cache_dir[0] == '\0' || fs == NULL)
+        return -1;
+
+    if (make_cache_dir() != 0)
+    {
+        printf("ERROR: Could not create the mapping cache directory '%s'.\n", cache_dir);
+        return -1;
+    }
+
+    dfg_hash = hash_dfg(d);
+    device_hash = hash_device(template);
+    get_entry_path(path, dfg_hash, device_hash, mapper, maxII);
+    snprintf(tmp_path, sizeof(tmp_path), "%s.%d.%u.tmp", path, (int)getpid(), __atomic_fetch_add(&tmp_ctr, 1, __ATOMIC_RELAXED));
+
+    if (write_bitstream(fs, d, placed, tmp_path, 1, dfg_hash, device_hash) != 0)
+    {
+        unlink(tmp_path);
+        return -1;
+    }
+    if (rename(tmp_path, path) != 0)
+    {
+        unlink(tmp_path);
+        return -1;
+    }
+    return 0;
+}
+
+/**************************************************************************************
+ * clear_mapping_cache
+ * Removes every entry from the cache directory.
+ * Return values: number of removed entries, or -1 if the cache is disabled/unreadable
+ *************************************************************************************/
+int clear_mapping_cache(void)
+{
+    char path[MAPCACHE_MAX_PATH + 256];
+    struct dirent *entry;
+    size_t len;
+    DIR *dir;
+    int n = 0;
+
+    if (cache_dir[0] == '\0' || (dir = opendir(cache_dir)) == NULL)
+        return -1;
+
+    while ((entry = readdir(dir)) != NULL)
+    {
+        len = strlen(entry->d_name);
+        if (len < 4 || strcmp(entry->d_name + len - 4, ".mbs") != 0)
+            continue;
+        snprintf(path, sizeof(path), "%s/%s", cache_dir, entry->d_name);
+        if (unlink(path) == 0)
+            n++;
+    }
+    closedir(dir);
+    return n;
+}
@@ -0,0 +1,32 @@
+#ifndef MAPCACHE_H
+#define MAPCACHE_H
+
+#include <stdint.h>
+#include "dfg.h"
+#include "cgra.h"
+
+/**********************************************************************************************
+ * Persistent Mapping Cache
+ * Mapped devices are stored as bitstreams (.mbs) in a cache directory, keyed by the content
+ * hashes of the dfg (ops, edges, recurrences, constants) and of the device template (grid,
+ * functs, RF/CU/OR sizes, interconnect), plus the cache version and the mapper configuration:
+ *      <dir>/v<version>-<dfg hash>-<device hash>-m<mapper>-ii<max II>[-mc][-pv].mbs
+ * (-mc: multicast routing, -pv: II prover).
+ * Entries are validated (checksum, recorded hashes, placement) before being used. The cache is
+ * off until a directory is set (mapping_cache <dir>, or 'on' for $XDG_CACHE_HOME/midas).
+ *********************************************************************************************/
+
+#define MAPCACHE_VERSION 2 // bump when the mappers or the entry format change, so that older entries are not reused
+#define MAPCACHE_SUBDIR "midas"
+#define MAPCACHE_MAX_PATH 512
+
+uint64_t hash_dfg(dfg *d);
+uint64_t hash_device(cgra *template);
+void set_mapping_cache_dir(const char *dir);
+const char *get_mapping_cache_dir(void);
+const char *get_default_mapping_cache_dir(void);
+cgra *mapping_cache_lookup(cgra *template, dfg *d, int **placed, int mapper, int maxII);
+int mapping_cache_store(cgra *fs, cgra *template, dfg *d, int **placed, int mapper, int maxII);
+int clear_mapping_cache(void);
+
+#endif
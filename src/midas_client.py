@@ -0,0 +1,139 @@
+import argparse
+import hashlib
+import json
+import os
+import socket
+import subprocess
+import sys
+import tempfile
+
+# Client for the MIDAS mapping server (the 'serve' command). Requests and responses are JSON
+# objects, one per line, over a Unix domain socket.
+
+DEFAULT_SOCKET = os.environ.get("MIDAS_SOCKET", "midas.sock")
+
+
+class MidasClient:
+
+    def __init__(self, path):
+        self.sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        self.sock.connect(path)
+        self.stream = self.sock.makefile("r")
+
+    def request(self, cmd, **args):
+        args["cmd"] = cmd
+        self.sock.sendall((json.dumps(args) + "\n").encode())
+        line = self.stream.readline()
+        if not line:
+            raise ConnectionError("the server closed the connection")
+        res = json.loads(line)
+        if res.get("status") != "ok":
+            raise RuntimeError(res.get("message", "request failed"))
+        return res
+
+    def close(self):
+        self.stream.close()
+        self.sock.close()
+
+
+def read_dfg_text(path):
+    """Returns the .dfg text of a kernel, converting .dot/.txt kernels with dfg_parser.py"""
+    if not path.endswith(".dot") and not path.endswith(".txt"):
+        with open(path) as f:
+            return f.read()
+    parser = os.path.join(os.path.dirname(os.path.abspath(__file__)), "dfg_parser.py")
+    with tempfile.TemporaryDirectory() as tmp:
+        subprocess.run([sys.executable, parser, os.path.abspath(path)], cwd=tmp, check=True,
+                       stdout=subprocess.DEVNULL)
+        with open(os.path.join(tmp, "kernel.dfg")) as f:
+            return f.read()
+
+
+def ensure_cgra(client, path, reload=False):
+    """Imports a device template, unless it is already resident. Templates are named by their path and
+    content hash, so that a changed file is imported again; the templates of its older contents are dropped."""
+    with open(path) as f:
+        text = f.read()
+    prefix = os.path.abspath(path) + "@"
+    name = prefix + hashlib.sha1(text.encode()).hexdigest()[:16]
+    cgras = client.request("list")["cgras"]
+    if reload or name not in cgras:
+        for old in cgras:
+            if old.startswith(prefix) and old != name:
+                client.request("drop", name=old)
+        client.request("import_cgra", name=name, text=text)
+    return name
+
+
+def write_mapping(res, output):
+    if output == "-":
+        json.dump(res["mapping"], sys.stdout, indent=4)
+        print()
+    else:
+        with open(output + ".json", "w") as f:
+            json.dump(res["mapping"], f, indent=4)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Send requests to a MIDAS mapping server.")
+    parser.add_argument("--socket", default=DEFAULT_SOCKET, help="server socket (Default: $MIDAS_SOCKET or midas.sock)")
+    sub = parser.add_subparsers(dest="cmd", required=True)
+
+    p = sub.add_parser("map", help="map a kernel (.dfg, .dot or .txt) and write the mapping results")
+    p.add_argument("kernel")
+    p.add_argument("--cgra", default="design.cmpa", help="CGRA architecture file (Default: design.cmpa)")
+    p.add_argument("--mapper", type=int, default=1)
+    p.add_argument("--max-ii", type=int, default=0)
+    p.add_argument("--budget", help="wall-clock limit of the mapping, <time>[us|ms|s] (Default: none)")
+    p.add_argument("--expansions", type=int, default=0, help="limit on the routing search nodes expanded (Default: none)")
+    p.add_argument("--name", help="name of the resident dfg and result (Default: the kernel path)")
+    p.add_argument("--reload", action="store_true", help="re-import the CGRA even if it is resident")
+    p.add_argument("-o", "--output", default="res", help="mapping results file, without .json, or - (Default: res)")
+
+    p = sub.add_parser("export", help="write the mapping results of a resident result")
+    p.add_argument("result")
+    p.add_argument("-o", "--output", default="-")
+
+    p = sub.add_parser("prune", help="prune the CGRA of resident results to the resources they use")
+    p.add_argument("results", nargs="+")
+    p.add_argument("--name", help="name of the pruned CGRA (Default: <cgra>_pruned)")
+
+    p = sub.add_parser("drop", help="release resident objects")
+    p.add_argument("name")
+
+    sub.add_parser("list", help="list the resident CGRAs, dfgs and results")
+    sub.add_parser("shutdown", help="stop the server")
+
+    args = parser.parse_args()
+    client = MidasClient(args.socket)
+    try:
+        if args.cmd == "map":
+            name = args.name or os.path.abspath(args.kernel)
+            cgra = ensure_cgra(client, args.cgra, args.reload)
+            client.request("import_dfg", name=name, text=read_dfg_text(args.kernel))
+            req = {"cgra": cgra, "dfg": name, "mapper": args.mapper, "max_ii": args.max_ii, "expansions": args.expansions}
+            if args.budget:
+                req["budget"] = args.budget
+            res = client.request("map", **req)
+            write_mapping(res, args.output)
+            print(f"II = {res['II']} (MII = {res['MII']}), mapped in {res['time'] * 1000:.1f} ms", file=sys.stderr)
+        elif args.cmd == "export":
+            write_mapping(client.request("export", result=args.result), args.output)
+        elif args.cmd == "prune":
+            req = {"results": args.results}
+            if args.name:
+                req["name"] = args.name
+            print(json.dumps(client.request("prune", **req), indent=4))
+        elif args.cmd == "drop":
+            client.request("drop", name=args.name)
+        else:
+            print(json.dumps(client.request(args.cmd), indent=4))
+    except (RuntimeError, ConnectionError) as e:
+        print(f"ERROR: {e}", file=sys.stderr)
+        sys.exit(1)
+    finally:
+        client.close()
+
+
+if __name__ == "__main__":
+    main()
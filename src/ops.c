@@ -42,15 +42,17 @@ typedef enum {
     OP_STORE,
     // Branch and Loop control OPs
     OP_ICMP,
-    OP_PHI,
-
     OP_MAX3,
     OP_MIN3,
     OP_EQ3,
     OP_NEQ3,
-
+    OP_PHI,
     OP_BR,
     OP_CONST,
+    // Left shift by a constant amount (target of strength reduction; listed explicitly, not part of a FULL PE)
+    OP_SHL,
+    // Route-through (move) pseudo-op: forwards its input unchanged, supported by every compute PE
+    OP_ROUTE,
     OP_MAX  // Total number of supported operations
 } OperationIndex;
 
@@ -89,7 +91,9 @@ const char *operation_names[] = {
 
     [OP_PHI] = "PHI",
     [OP_BR] = "BR",
-    [OP_CONST] = "CONST"
+    [OP_CONST] = "CONST",
+    [OP_SHL] = "SHL",
+    [OP_ROUTE] = "ROUTE"
 };
 
 char *get_operation(int index) {
@@ -130,7 +134,9 @@ const float functional_unit_areas[] = {
     [OP_ICMP] = 300,
     [OP_PHI] = 600,
     [OP_BR] = 500,
-    [OP_CONST] = 0
+    [OP_CONST] = 0,
+    [OP_SHL] = 200,
+    [OP_ROUTE] = 0
 };
 
 /**********************************************************
@@ -150,6 +156,7 @@ float get_op_estimated_area_cost(int index, int data_width){
         return 5.4692 * data_width * data_width - 119.29 * data_width + 803.9;		
         break;
         case OP_ASHR: // similar to OP_MUL
+        case OP_SHL:
         return 5.3537 * data_width - 26.518;		
         break;
         case OP_AND:
@@ -193,6 +200,7 @@ float get_op_estimated_power_cost(int index, int data_width){
         return 4.3762 * data_width * data_width - 90.39 * data_width + 575;		
         break;
         case OP_ASHR: // similar to OP_MUL
+        case OP_SHL:
         return 3.682 * data_width - 22.236;		
         break;
         case OP_AND:
@@ -50,6 +50,10 @@ typedef enum {
     OP_PHI,
     OP_BR,
     OP_CONST,
+    // Left shift by a constant amount (target of strength reduction; listed explicitly, not part of a FULL PE)
+    OP_SHL,
+    // Route-through (move) pseudo-op: forwards its input unchanged, supported by every compute PE
+    OP_ROUTE,
     OP_MAX  // Total number of supported operations
 } OperationIndex;
 
@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 #include <stdbool.h>
 #include "ops.h"
@@ -8,6 +9,8 @@
 #include "pqueue.h"
 #include "stack.h"
 #include "files.h"
+#include "stats.h"
+#include "budget.h"
 #include <omp.h>
 #include <time.h>
 
@@ -39,11 +42,62 @@ typedef struct _stackItem
     int t;          // time t, for the device slice
     bool parentReg; // 0 if this item was obtained by reserving an output register, 1 if it reserved a register from the LRF
     cgra *c;
+    struct _stackItem *next_free; // link in the per-thread free list, while the item is not in use
 } stackItem;
 
+/**********************************************************************************************************************
+ * Routing Workspace
+ * Scratch state of routeInTime, kept per thread and reused between calls, so that routing does not touch the heap in
+ * steady state:
+ * - stack items are recycled through a free list (deleteStackItem returns them to it);
+ * - the visited cube is a flat array of generation stamps: a PE is visited if its stamp matches the current
+ *   generation, so clearing it is a single increment;
+ * - path arrays are bump-allocated from an arena that is reset at the start of every routeOp call (every path is
+ *   released before routeOp returns);
+ * - the DFS stack and the LRF addressing arrays are grown on demand.
+ *********************************************************************************************************************/
+#define ITEM_CHUNK_SIZE 256
+#define ARENA_BLOCK_SIZE (16 * 1024)
+
+typedef struct _arenaBlock
+{
+    size_t size;
+    size_t used;
+    struct _arenaBlock *next;
+    char *mem;
+} arenaBlock;
+
+typedef struct
+{
+    stackItem *free_items;
+    arenaBlock *arena, *arena_cur;
+    unsigned *visited, gen;
+    size_t visited_size;
+    int *rfAddrCounts, *rfAddresses;
+    size_t rf_size;
+    stack *s;
+} routingWorkspace;
+
+static routingWorkspace ws;
+#pragma omp threadprivate(ws)
+
 stackItem *createStackItem(int i, int j, int t, bool parentReg, cgra *c)
 {
-    stackItem *si = malloc(sizeof(stackItem));
+    stackItem *si;
+    int k;
+
+    if (ws.free_items == NULL)
+    {
+        // Items are never returned to the heap; they stay in this thread's free list
+        stackItem *chunk = (stackItem *)malloc(ITEM_CHUNK_SIZE * sizeof(stackItem));
+        for (k = 0; k < ITEM_CHUNK_SIZE - 1; k++)
+            chunk[k].next_free = &chunk[k + 1];
+        chunk[ITEM_CHUNK_SIZE - 1].next_free = NULL;
+        ws.free_items = chunk;
+    }
+    si = ws.free_items;
+    ws.free_items = si->next_free;
+
     si->i = i;
     si->j = j;
     si->t = t;
@@ -54,7 +108,114 @@ stackItem *createStackItem(int i, int j, int t, bool parentReg, cgra *c)
 
 void deleteStackItem(stackItem *si)
 {
-    free(si);
+    si->next_free = ws.free_items;
+    ws.free_items = si;
+}
+
+/**********************************************************************************************************************
+ * arenaAlloc
+ * Returns 'size' zeroed bytes from the routing arena. Blocks are kept when the arena is reset, so they are reused by
+ * the following routeOp calls.
+ *********************************************************************************************************************/
+static void *arenaAlloc(size_t size)
+{
+    arenaBlock *b = ws.arena_cur, *nb;
+    void *ptr;
+
+    size = (size + 15) & ~(size_t)15;
+    while (b != NULL && b->size - b->used < size)
+        b = b->next;
+    if (b == NULL)
+    {
+        nb = (arenaBlock *)malloc(sizeof(arenaBlock));
+        nb->size = size > ARENA_BLOCK_SIZE ? size : ARENA_BLOCK_SIZE;
+        nb->used = 0;
+        nb->mem = (char *)malloc(nb->size);
+        // Append to the chain, so that blocks ahead of the current one are still reached by later allocations
+        nb->next = NULL;
+        if (ws.arena == NULL)
+            ws.arena = nb;
+        else
+        {
+            for (b = ws.arena; b->next != NULL; b = b->next)
+                ;
+            b->next = nb;
+        }
+        b = nb;
+    }
+    ws.arena_cur = b;
+    ptr = b->mem + b->used;
+    b->used += size;
+    memset(ptr, 0, size);
+    return ptr;
+}
+
+static void resetArena(void)
+{
+    arenaBlock *b;
+    for (b = ws.arena; b != NULL; b = b->next)
+        b->used = 0;
+    ws.arena_cur = ws.arena;
+}
+
+/**********************************************************************************************************************
+ * prepareRoutingWorkspace
+ * Sizes the workspace for a routing search over L x C PEs and T device slices: starts a new visited generation, clears
+ * the LRF addressing arrays and empties the DFS stack.
+ *********************************************************************************************************************/
+static void prepareRoutingWorkspace(int L, int C, int T)
+{
+    size_t n = (size_t)L * C * T;
+
+    if (n > ws.visited_size)
+    {
+        free(ws.visited);
+        ws.visited = (unsigned *)calloc(n, sizeof(unsigned));
+        ws.visited_size = n;
+        ws.gen = 0;
+    }
+    // On wrap-around, stale stamps could match the new generation
+    if (++ws.gen == 0)
+    {
+        memset(ws.visited, 0, ws.visited_size * sizeof(unsigned));
+        ws.gen = 1;
+    }
+
+    if ((size_t)T > ws.rf_size)
+    {
+        free(ws.rfAddrCounts);
+        free(ws.rfAddresses);
+        ws.rfAddrCounts = (int *)malloc(T * sizeof(int));
+        ws.rfAddresses = (int *)malloc(T * sizeof(int));
+        ws.rf_size = T;
+    }
+    memset(ws.rfAddrCounts, 0, T * sizeof(int));
+    memset(ws.rfAddresses, 0, T * sizeof(int));
+
+    if (ws.s == NULL)
+        ws.s = createStack(L * C * (T - 2) + 1);
+    else
+        resetStack(ws.s, L * C * (T - 2) + 1);
+}
+
+/**********************************************************************************************************************
+ * Multicast Routing
+ * When enabled, the route from a consumer to a value may end on the route tree already built for that value (a
+ * register that holds it at that cycle), instead of always reaching the producer on its own. The consumer then
+ * signs the tree segments between that point and the producer, so that they are released per consumer, as usual.
+ * The routes of a high-fanout value grow as a time-extended Steiner tree, one consumer at a time, sharing output
+ * registers, LRF entries and links.
+ *********************************************************************************************************************/
+static int multicast_routing = 0;
+
+void set_multicast_routing(int enable)
+{
+    multicast_routing = enable != 0;
+}
+
+int get_multicast_routing(void)
+{
+    return multicast_routing;
 }
 
 /**
@@ -70,6 +231,7 @@ void deleteStackItem(stackItem *si)
  *                 where it would store the value)
  *                 [] we can explicitely define routing nodes as extra tasks to be mapped (extra nodes to the DFG) that get mapped aswell. That way, the choice of which
  *                 register to store the value in can be done dynamically, depending on the current configurations of the array
+ *                 (done by insert_route_nodes, in dfg.c: ROUTE nodes on long and high-fanout edges)
  *                 [] we can also try changing the schedule, if the node has the needed mobility
  */
 
@@ -225,7 +387,7 @@ int getRFLimitations(cgra *c, dfg *d)
  * places an operation in the device model, according to its latency and the modulo scheduling
  * Return values: placed ? 1 : 0\
  **********************************************************************************************************************************************/
-int placeOp(cgra *first_slice, int i, int j, dfg *d, dfg_instr *target, int **placed, int *schedule, int II)
+static int placeOpImpl(cgra *first_slice, int i, int j, dfg *d, dfg_instr *target, int **placed, int *schedule, int II)
 {
 
     int t, c, id, maxPlacements = II < get_instr_lat(target) ? II : get_instr_lat(target), consts = get_n_consts(target), ecnsts = 0;
@@ -340,6 +502,19 @@ int placeOp(cgra *first_slice, int i, int j, dfg *d, dfg_instr *target, int **pl
     return 1;
 }
 
+/**
+ * Instrumented entry point: counts the calls and, with the phase timers on, times them as PHASE_PLACE (stats.h)
+ */
+int placeOp(cgra *first_slice, int i, int j, dfg *d, dfg_instr *target, int **placed, int *schedule, int II)
+{
+    double t0 = STAT_TIMER_BEGIN();
+    int status = placeOpImpl(first_slice, i, j, d, target, placed, schedule, II);
+
+    STAT_INC(STAT_PLACE_OP);
+    STAT_TIMER_END(PHASE_PLACE, t0);
+    return status;
+}
+
 /***********************************************************************************************************************************************
  * routeByLRF
  * Inputs:
@@ -384,18 +559,19 @@ int routeByLRF(stackItem *si, stack *s, cgra *c, bool ***visited, int *rfAddrCou
 int routeToNeighbour(stackItem *si, stack *s, cgra *c, bool ***visited, int *rfAddrCounts,
                      int t, int t1, int t2, int iid, int i1, int j1)
 {
-    int *neighbours, i, j, k, C = get_cgra_C(c), rfac;
+    int n_neighbours, i, j, k, C = get_cgra_C(c), rfac;
+    const pe_neighbour *neighbours;
     stackItem *nsi;
 
     rfac = (getRFAccess(si->c, si->i, si->j) == 0 || getRFAccess(si->c, si->i, si->j) == iid);
     // Search for unvisited neighbours that have either the LRF or the output register free
-    neighbours = getPENeighbours(si->c, si->i, si->j);
+    neighbours = getPENeighbourList(si->c, si->i, si->j, &n_neighbours);
 
     // Check neighbouring PEs apart from itself
-    for (k = 1; k <= neighbours[0]; k++)
+    for (k = 0; k < n_neighbours; k++)
     {
-        i = neighbours[k] / C;
-        j = neighbours[k] % C;
+        i = neighbours[k].pos / C;
+        j = neighbours[k].pos % C;
         // Skip already visited PEs
         if (visited[i][j][t - t2] == true)
             continue;
@@ -421,7 +597,6 @@ int routeToNeighbour(stackItem *si, stack *s, cgra *c, bool ***visited, int *rfA
             /* printf("Added path to (%d, %d) @ t=%d!\n", i, j, t); */
             nsi = createStackItem(i, j, t, false, c);
             push(s, (Item)nsi); // push onto the stack
-            free(neighbours);
             return 1;
         }
 
@@ -438,7 +613,6 @@ int routeToNeighbour(stackItem *si, stack *s, cgra *c, bool ***visited, int *rfA
                 rfAddrCounts[t1 - t] = 0;
                 nsi = createStackItem(i, j, t, false, c);
                 push(s, (Item)nsi); // push onto the stack
-                free(neighbours);
                 return 1;
             }
             else if ((or = hasFreeOutputRegister(si->c, si->i, si->j)) > -1)
@@ -448,12 +622,10 @@ int routeToNeighbour(stackItem *si, stack *s, cgra *c, bool ***visited, int *rfA
                 markOutputRegister(si->c, si->i, si->j, or, NOT_YET_COMMITTED, si->t); // mark the free output register as uncommitted
                 nsi = createStackItem(i, j, t, false, c);
                 push(s, (Item)nsi); // push onto the stack
-                free(neighbours);
                 return 1;
             }
         }
     }
-    free(neighbours);
     return 0;
 }
 
@@ -461,7 +633,7 @@ int routeToNeighbour(stackItem *si, stack *s, cgra *c, bool ***visited, int *rfA
  * routeInTime_forward
  * Inputs: device model (first slice), target and input nodes (and respective coordinates), the schedule and the II
  * Forward version of routeInTime.
- * WARNING: Reuqires getPENeighbours to read c->lats[k][pos]!
+ * WARNING: Reuqires getPENeighbourList to return the PEs driven by pos (c->lats[k][pos])!
  * Return values: The generated path (stackItem**). If no path was found, a NULL pointer is returned.
  **********************************************************************************************************************************************/
 stackItem **routeInTime_forward(cgra *fs, dfg_instr *target, int i1, int j1, dfg_instr *input, int i2, int j2,
@@ -528,6 +700,8 @@ stackItem **routeInTime_forward(cgra *fs, dfg_instr *target, int i1, int j1, dfg
             pathIdx--;
             break;
         }
+        STAT_INC(STAT_ROUTE_DFS_NODES);
+        BUDGET_EXPAND();
 
         if (si != path[pathIdx - 1])
             path[pathIdx++] = si;
@@ -633,7 +807,7 @@ stackItem **routeInTime_forward(cgra *fs, dfg_instr *target, int i1, int j1, dfg
             {
                 setUncommittedReservation(path[i]->c, path[i]->i, path[i]->j, path[i]->t, FREE);
                 markUncommittedOutputRegister(path[i]->c, path[i]->i, path[i]->j, FREE, 0);
-                free(path[i]);
+                deleteStackItem(path[i]);
             }
         }
         free(path);
@@ -667,6 +841,94 @@ stackItem **routeInTime_forward(cgra *fs, dfg_instr *target, int i1, int j1, dfg
     return NULL;
 }
 
+/***********************************************************************************************************************************************
+ * routeToTree
+ * Inputs: current stack item, the device model for the previous time step (t), the visited cube (and its generation), the input's coordinates
+ * and final cycle (i2, j2, t2), the input's id and the RF access control of the current PE
+ * Auxiliary Function for routeInTime, in multicast mode. Searches for a neighbour whose output register already holds the input's value at
+ * cycle t, through a link that is free or already carries that value, i.e., a step onto the value's route tree.
+ * Return values: Position of the neighbour (i * C + j), or -1 if there is no such neighbour
+ **********************************************************************************************************************************************/
+static int routeToTree(stackItem *si, cgra *c, unsigned *visited, unsigned gen, int T, int t, int i2, int j2, int t2, int iid, int rfac)
+{
+    int n_neighbours, i, j, k, C = get_cgra_C(c);
+    const pe_neighbour *neighbours;
+
+    if (!rfac && si->parentReg == true)
+        return -1;
+
+    neighbours = getPENeighbourList(si->c, si->i, si->j, &n_neighbours);
+    for (k = 0; k < n_neighbours; k++)
+    {
+        i = neighbours[k].pos / C;
+        j = neighbours[k].pos % C;
+        if (visited[(i * C + j) * T + t - t2] == gen || get_pe_power_mode(c, i, j) == POWER_OFF)
+            continue;
+        if ((t == t2) && (i != i2 || j != j2))
+            continue;
+        if (hasOutputRegister(c, i, j, iid, t) < 0)
+            continue;
+        if (!connInUse(si->c, si->i, si->j, i, j) || checkConnValTime(si->c, si->i, si->j, i, j, iid, t))
+            return neighbours[k].pos;
+    }
+    return -1;
+}
+
+/***********************************************************************************************************************************************
+ * graftOnTree
+ * Inputs: the path (its last item holds the input's value in a committed register), the path size, the input's coordinates and final cycle,
+ * the target's cycle, the input's id and rfAddrCounts
+ * Auxiliary Function for routeInTime, in multicast mode. Completes the path with the route tree segments between its last item and the input,
+ * following the value backwards as unmapOp does (through the LRF first, then through the links that carry it). Nothing is reserved: the
+ * segments are already committed, and are only signed by the target when the path is committed.
+ * Return values: Size of the completed path, or 0 if the tree does not lead back to the input (the path is left unchanged)
+ **********************************************************************************************************************************************/
+static int graftOnTree(stackItem **path, int pathIdx, int i2, int j2, int t2, int t1, int iid, int *rfAddrCounts)
+{
+    stackItem *si = path[pathIdx - 1];
+    int n_neighbours, k, i = si->i, j = si->j, t = si->t, n = pathIdx, C = get_cgra_C(si->c);
+    const pe_neighbour *neighbours;
+    cgra *curr = si->c, *prev;
+    bool parentReg;
+
+    while ((i != i2 || j != j2 || t != t2) && t > t2)
+    {
+        prev = getPrevModuloSlice(curr);
+        t--;
+
+        // The value was kept in this PE's LRF
+        if (hasLRFEntry(prev, i, j, t, iid))
+            parentReg = true;
+        // The value came from the output register of a neighbour
+        else
+        {
+            neighbours = getPENeighbourList(curr, i, j, &n_neighbours);
+            for (k = 0; k < n_neighbours; k++)
+            {
+                if (connInUse(curr, i, j, neighbours[k].pos / C, neighbours[k].pos % C) &&
+                    checkConnValTime(curr, i, j, neighbours[k].pos / C, neighbours[k].pos % C, iid, t) &&
+                    hasOutputRegister(prev, neighbours[k].pos / C, neighbours[k].pos % C, iid, t) > -1)
+                    break;
+            }
+            if (k == n_neighbours)
+                break;
+            i = neighbours[k].pos / C;
+            j = neighbours[k].pos % C;
+            parentReg = false;
+        }
+        rfAddrCounts[t1 - t] = 0;
+        path[n++] = createStackItem(i, j, t, parentReg, prev);
+        curr = prev;
+    }
+
+    if (i == i2 && j == j2 && t == t2)
+        return n;
+
+    while (n > pathIdx)
+        deleteStackItem(path[--n]);
+    return 0;
+}
+
 /***********************************************************************************************************************************************
  * routeInTime
  * Inputs: device model (first slice), target and input nodes (and respective coordinates), the schedule and the II
@@ -678,7 +940,8 @@ stackItem **routeInTime_forward(cgra *fs, dfg_instr *target, int i1, int j1, dfg
  * if the Output Register is free.
  * When analyzing these routes, the LRF and/or the Output register might have the target input value already reserved (by a previous node that
  * was already routed). In this case, this route merges with the previous route (i.e. the path is considered successful upon reaching the common
- * PE between both routes).
+ * PE between both routes). With multicast routing, steps onto the previous routes are preferred, and the path is completed along them (see
+ * graftOnTree).
  * Return values: The generated path (stackItem**). If no path was found, a NULL pointer is returned.
  **********************************************************************************************************************************************/
 stackItem **routeInTime(cgra *fs, dfg_instr *target, int i1, int j1, dfg_instr *input, int i2, int j2,
@@ -687,7 +950,8 @@ stackItem **routeInTime(cgra *fs, dfg_instr *target, int i1, int j1, dfg_instr *
 
     int id = get_instr_id(target), iid = get_instr_id(input), L = get_cgra_L(fs), C = get_cgra_C(fs);
     int t1 = schedule[id - 1], /* t2 = schedule[iid - 1] + get_instr_lat(input) - 1, */ t, k, i, j;
-    int *neighbours, nvisited, success = 0;
+    int n_neighbours, nvisited, success = 0, multicast = multicast_routing && recFlag == 0;
+    const pe_neighbour *neighbours;
     int *rfAddrCounts, *rfAddresses, addr;
 
     // For recurrence edges,
@@ -700,25 +964,20 @@ stackItem **routeInTime(cgra *fs, dfg_instr *target, int i1, int j1, dfg_instr *
     if (t1 <= t2)
         return NULL;
 
-    stackItem **path = (stackItem **)calloc((t1 - t2 + 1) * C, sizeof(stackItem *)); // array that stores the various stack items of the path, in order
+    // array that stores the various stack items of the path, in order (lives in the routing arena)
+    stackItem **path = (stackItem **)arenaAlloc((t1 - t2 + 1) * C * sizeof(stackItem *));
 
-    // Create a binary matrix for all nodes (visited / unvisited)
-    bool ***visited = (bool ***)malloc(L * sizeof(bool **));
-    for (i = 0; i < L; i++)
-    {
-        visited[i] = (bool **)malloc(C * sizeof(bool *));
-        for (j = 0; j < C; j++)
-        {
-            visited[i][j] = (bool *)calloc(t1 - t2 + 1, sizeof(bool));
-        }
-    }
+    // Visited cube (PE x time), indexed as ((i * C) + j) * T + (t - t2)
+    int T = t1 - t2 + 1;
+    prepareRoutingWorkspace(L, C, T); // only need to search for PEs in the interval ]t2, t1[
+    unsigned *visited = ws.visited, gen = ws.gen;
     int pathIdx = 0, rfac, next_rfac, rfrp_flag/*, rfrpMuxIn_flag */;
 
-    rfAddrCounts = (int *)calloc(t1 - t2 + 1, sizeof(int));
-    rfAddresses = (int *)calloc(t1 - t2 + 1, sizeof(int));
+    rfAddrCounts = ws.rfAddrCounts;
+    rfAddresses = ws.rfAddresses;
 
     cgra *c = getModuloSlice(fs, t1, II);
-    stack *s = createStack(L * C * (t1 - t2 - 1) + 1); // only need to search for PEs in the interval ]t2, t1[
+    stack *s = ws.s;
 
     // Create and push an initial stack item with the starting point of the DFS
     stackItem *si = createStackItem(i1, j1, t1, false, c), *nsi;
@@ -743,6 +1002,8 @@ stackItem **routeInTime(cgra *fs, dfg_instr *target, int i1, int j1, dfg_instr *
             pathIdx--;
             break;
         }
+        STAT_INC(STAT_ROUTE_DFS_NODES);
+        BUDGET_EXPAND();
 
         if (si != path[pathIdx - 1])
             path[pathIdx++] = si;
@@ -754,7 +1015,7 @@ stackItem **routeInTime(cgra *fs, dfg_instr *target, int i1, int j1, dfg_instr *
 
         // Mark as Visited
         // markPEVisited(si->c, si->i, si->j, si->t);
-        visited[si->i][si->j][si->t - t2] = true;
+        visited[(si->i * C + si->j) * T + si->t - t2] = gen;
 
         // Search has arrived at the target PE at the target cycle
         if (si->i == i2 && si->j == j2 && si->t == t2)
@@ -763,6 +1024,17 @@ stackItem **routeInTime(cgra *fs, dfg_instr *target, int i1, int j1, dfg_instr *
             break;
         }
 
+        // Search has arrived at a register that already holds the input's value: complete the path along the value's route tree
+        if (multicast && pathIdx > 2 &&
+            (si->parentReg ? hasLRFEntry(si->c, si->i, si->j, si->t, iid) : hasOutputRegister(si->c, si->i, si->j, iid, si->t) > -1) &&
+            (k = graftOnTree(path, pathIdx, i2, j2, t2, t1, iid, rfAddrCounts)) > 0)
+        {
+            STAT_INC(STAT_ROUTE_TREE_GRAFTS);
+            pathIdx = k;
+            success = 1;
+            break;
+        }
+
         // RFAccess Control: 1 to allow routing this section -> allows, if rfa flag is enabled or the RF is not written or it is written
         // by the same input (@ this clock cycle)
         rfac = (getRFAccess(si->c, si->i, si->j) == 0 || getRFAccess(si->c, si->i, si->j) == iid);
@@ -773,8 +1045,23 @@ stackItem **routeInTime(cgra *fs, dfg_instr *target, int i1, int j1, dfg_instr *
         rfrp_flag = (si->t == t1 && getNFreeRFRPMuxIn(si->c, si->i, si->j) > 0)
                     || (si->t < t1 && getNFreeRFRPOR(si->c, si->i, si->j) > 0);
 
+        /**********************************************************************************************************
+         * Each expansion pushes one child: the path array holds one item per step, and si is expanded again when the
+         * child leads nowhere. Candidates are tried in order (route tree, itself, neighbours), so a step onto the
+         * input's route tree is explored first and the other expansions of si remain for backtracking.
+         *********************************************************************************************************/
+        // Multicast: step onto the input's route tree, unless the value is already kept in this PE's LRF
+        k = (multicast && !hasLRFEntry(c, si->i, si->j, t, iid)) ? routeToTree(si, c, visited, gen, T, t, i2, j2, t2, iid, rfac) : -1;
+        if (k > -1)
+        {
+            rfAddrCounts[t1 - t] = 0;
+            nsi = createStackItem(k / C, k % C, t, false, c);
+            push(s, (Item)nsi); // push onto the stack
+            nvisited++;
+        }
+
         // Check for a possible connection to itself
-        if (visited[si->i][si->j][t - t2] == false && get_pe_power_mode(c, si->i, si->j) == POWER_ON)
+        if (nvisited == 0 && visited[(si->i * C + si->j) * T + t - t2] != gen && get_pe_power_mode(c, si->i, si->j) == POWER_ON)
         {
             if (((t > t2) || (si->i == i2 && si->j == j2)) && next_rfac && rfrp_flag/* rfrpMuxIn_flag */)
             {
@@ -796,15 +1083,15 @@ stackItem **routeInTime(cgra *fs, dfg_instr *target, int i1, int j1, dfg_instr *
         }
 
         // Search for unvisited neighbours that have either the LRF or the output register free
-        neighbours = getPENeighbours(si->c, si->i, si->j);
+        neighbours = getPENeighbourList(si->c, si->i, si->j, &n_neighbours);
 
         // Check neighbouring PEs apart from itself
-        for (k = 1; k <= neighbours[0]; k++)
+        for (k = 0; k < n_neighbours && nvisited == 0; k++)
         {
-            i = neighbours[k] / C;
-            j = neighbours[k] % C;
+            i = neighbours[k].pos / C;
+            j = neighbours[k].pos % C;
             // Skip already visited PEs
-            if (visited[i][j][t - t2] == true)
+            if (visited[(i * C + j) * T + t - t2] == gen)
                 continue;
 
             // Skip PEs that are powered off in this clock cycle
@@ -862,7 +1149,6 @@ stackItem **routeInTime(cgra *fs, dfg_instr *target, int i1, int j1, dfg_instr *
                 }
             }
         }
-        free(neighbours);
 
         // This PE doesn't provide a valid path. Remove it from the final path array
         if (nvisited == 0)
@@ -878,13 +1164,6 @@ stackItem **routeInTime(cgra *fs, dfg_instr *target, int i1, int j1, dfg_instr *
         }
     }
 
-    for (i = 0; i < L; i++)
-    {
-        for (j = 0; j < C; j++)
-            free(visited[i][j]);
-        free(visited[i]);
-    }
-    free(visited);
     /**************************************************************************************************
      * A path was successfully found.
      * Free all uncommitted resource reservations that don't belong in this path, then return the path.
@@ -910,10 +1189,9 @@ stackItem **routeInTime(cgra *fs, dfg_instr *target, int i1, int j1, dfg_instr *
             {
                 setUncommittedReservation(path[i]->c, path[i]->i, path[i]->j, path[i]->t, FREE);
                 markUncommittedOutputRegister(path[i]->c, path[i]->i, path[i]->j, FREE, 0);
-                free(path[i]);
+                deleteStackItem(path[i]);
             }
         }
-        free(path);
         path = NULL; // Return NULL if no path is found
         /* printf("Failed at finding a path.\n"); */
     }
@@ -936,16 +1214,14 @@ stackItem **routeInTime(cgra *fs, dfg_instr *target, int i1, int j1, dfg_instr *
         }
     }
 
-    free(rfAddrCounts);
-    free(rfAddresses);
-    deleteStack(s);
     return path;
 }
 
 /************************************************************************************************************************************************
  * defineInputRoutingOrder
  * Inputs: device model (first slice), target node and the placement info array (placed)
- * Returns a list with the inputs. It is sorted by minimum manhattan distance to the target.
+ * Returns a list with the inputs. It is sorted by minimum manhattan distance to the target. If the target is on a recurrence cycle, the inputs
+ * on a recurrence cycle come first: their edges have the least slack, so they take the short (LRF-local) routes.
  * Return values: Sorted input array
  **********************************************************************************************************************************************/
 dfg_instr **defineInputRoutingOrder(cgra *c, dfg_instr *target, int **placed)
@@ -962,6 +1238,8 @@ dfg_instr **defineInputRoutingOrder(cgra *c, dfg_instr *target, int **placed)
         i = placed[id - 1][1] / get_cgra_C(c);
         j = placed[id - 1][1] % get_cgra_C(c);
         pq[k] = newMinHeapNode(id, abs(i - i_target) + abs(j - j_target));
+        if (is_on_rec_cycle(target) && is_on_rec_cycle(get_input(target, k)))
+            pq[k]->distance -= get_cgra_L(c) + get_cgra_C(c);
     }
     qsort(pq, get_n_inputs(target), sizeof(MinHeapNode *), comparePQ);
 
@@ -985,30 +1263,45 @@ dfg_instr **defineInputRoutingOrder(cgra *c, dfg_instr *target, int **placed)
  * deleted.
  * Return values: Routed ? 1 : 0
  **********************************************************************************************************************************************/
-int routeOp(cgra *first_slice, dfg_instr *target, int **placed, int *schedule, int II)
+static int routeOpImpl(cgra *first_slice, dfg_instr *target, int **placed, int *schedule, int II)
 {
 
     int i, j, k, N, C = get_cgra_C(first_slice), id = get_instr_id(target), iid;
     int i1 = placed[id - 1][1] / C, j1 = placed[id - 1][1] % C;
-    int i2, j2;
+    int i2, j2, n_routes = get_n_inputs(target), n_rec;
 
     // Target was not yet placed
     if (placed[id - 1][0] == 0)
         return 0;
 
+    // Values the target reads from a previous iteration of nodes already placed are routed like its inputs
+    // (the others are routed when those nodes are placed, as their recurrences)
+    for (k = 0; k < get_n_rec_inputs(target); k++)
+        n_routes += placed[get_instr_id(get_rec_input(target, k)) - 1][0] != 0;
+
     // No inputs to route the target to
-    if (get_n_inputs(target) == 0)
+    if (n_routes == 0)
         return 1;
 
-    // Define the input routing order
-    dfg_instr **input_order = defineInputRoutingOrder(first_slice, target, placed);
+    // Paths of the previous call have all been released: their arrays can be reused
+    resetArena();
+
+    // Define the input routing order. The values from the previous iteration go first: their deadline is set by the II
+    dfg_instr **inputs = defineInputRoutingOrder(first_slice, target, placed);
+    dfg_instr **input_order = (dfg_instr **)malloc(n_routes * sizeof(dfg_instr *));
+    for (k = 0, n_rec = 0; k < get_n_rec_inputs(target); k++)
+        if (placed[get_instr_id(get_rec_input(target, k)) - 1][0] != 0)
+            input_order[n_rec++] = get_rec_input(target, k);
+    for (k = 0; k < get_n_inputs(target); k++)
+        input_order[n_rec + k] = inputs[k];
+    free(inputs);
 
     // Array of paths
-    stackItem ***paths = (stackItem ***)malloc(get_n_inputs(target) * sizeof(stackItem **));
-    stackItem ***recurrence_paths = (stackItem ***)malloc(get_n_recurrences(target) * sizeof(stackItem **));
+    stackItem ***paths = (stackItem ***)malloc(n_routes * sizeof(stackItem **));
+    stackItem ***recurrence_paths = (stackItem ***)calloc(get_n_recurrences(target) + 1, sizeof(stackItem **));
     stackItem *si, *next;
 
-    for (k = 0; k < get_n_inputs(target); k++)
+    for (k = 0; k < n_routes; k++)
     {
         iid = get_instr_id(input_order[k]);
         // if the input wasn't mapped, skip the routing
@@ -1019,7 +1312,7 @@ int routeOp(cgra *first_slice, dfg_instr *target, int **placed, int *schedule, i
         }
         i2 = placed[iid - 1][1] / C;
         j2 = placed[iid - 1][1] % C;
-        paths[k] = routeInTime(first_slice, target, i1, j1, input_order[k], i2, j2, placed[iid - 1][3], schedule, II, 0);
+        paths[k] = routeInTime(first_slice, target, i1, j1, input_order[k], i2, j2, placed[iid - 1][3], schedule, II, k < n_rec);
 
         // Failed to route to input k
         if (paths[k] == NULL)
@@ -1040,7 +1333,9 @@ int routeOp(cgra *first_slice, dfg_instr *target, int **placed, int *schedule, i
             if (next->i == si->i && next->j == si->j)
             {
                 setUncommittedReservation(next->c, next->i, next->j, next->t, ALMOST_COMMITTED - iid);
-                signLRFEntry(next->c, next->i, next->j, next->t, ALMOST_COMMITTED - iid, id);
+                // Entries of previous routes of the value (merged with, or grafted onto) are already committed: sign them too
+                if (!signLRFEntry(next->c, next->i, next->j, next->t, ALMOST_COMMITTED - iid, id))
+                    signLRFEntry(next->c, next->i, next->j, next->t, iid, id);
                 if (i == N - 1 && getRFAccess(next->c, next->i, next->j) == 0)
                 { // start of route and it routes to itself -> mark RF Access
                     setRFAccess(next->c, next->i, next->j, ALMOST_COMMITTED - iid);
@@ -1079,7 +1374,7 @@ int routeOp(cgra *first_slice, dfg_instr *target, int **placed, int *schedule, i
     }
 
     // Failed to route input k, therefore the placement of target is invalid
-    if (k < get_n_inputs(target))
+    if (k < n_routes)
     {
         for (j = 0; j < k; j++)
         {
@@ -1093,7 +1388,8 @@ int routeOp(cgra *first_slice, dfg_instr *target, int **placed, int *schedule, i
                 // Route to itself
                 if (next->i == si->i && next->j == si->j)
                 {
-                    unsignLRFEntry(next->c, next->i, next->j, next->t, ALMOST_COMMITTED - iid, id);
+                    if (!unsignLRFEntry(next->c, next->i, next->j, next->t, ALMOST_COMMITTED - iid, id))
+                        unsignLRFEntry(next->c, next->i, next->j, next->t, iid, id);
                     // changeSetReservation(next->c, next->i, next->j, ALMOST_COMMITTED-iid, FREE);
                     if (i == N - 1 && getRFAccess(next->c, next->i, next->j) == ALMOST_COMMITTED - iid)
                     { // start of route and it routes to itself -> mark RF Access
@@ -1141,7 +1437,6 @@ int routeOp(cgra *first_slice, dfg_instr *target, int **placed, int *schedule, i
                 si = next;
             }
             deleteStackItem(si);
-            free(paths[j]);
         }
         // Reserve the necessary LRF entries
         int consts = get_n_consts(target);
@@ -1243,6 +1538,9 @@ int routeOp(cgra *first_slice, dfg_instr *target, int **placed, int *schedule, i
                 // Remove the routes for the recurrences
                 for (j = 0; j < k; j++)
                 {
+                    // Recurrences to nodes not placed yet were not routed
+                    if (recurrence_paths[j] == NULL)
+                        continue;
                     iid = get_instr_id(get_recurrence(target, j));
                     si = recurrence_paths[j][1];
                     N = recurrence_paths[j][0]->i;
@@ -1301,12 +1599,11 @@ int routeOp(cgra *first_slice, dfg_instr *target, int **placed, int *schedule, i
                         si = next;
                     }
                     deleteStackItem(si);
-                    free(recurrence_paths[j]);
                 }
                 free(recurrence_paths);
 
                 // Remove the routes for the inputs
-                for (j = 0; j < get_n_inputs(target); j++)
+                for (j = 0; j < n_routes; j++)
                 {
                     iid = get_instr_id(input_order[j]);
                     si = paths[j][1];
@@ -1318,7 +1615,8 @@ int routeOp(cgra *first_slice, dfg_instr *target, int **placed, int *schedule, i
                         // Route to itself
                         if (next->i == si->i && next->j == si->j)
                         {
-                            unsignLRFEntry(next->c, next->i, next->j, next->t, ALMOST_COMMITTED - iid, id);
+                            if (!unsignLRFEntry(next->c, next->i, next->j, next->t, ALMOST_COMMITTED - iid, id))
+                                unsignLRFEntry(next->c, next->i, next->j, next->t, iid, id);
                             // changeSetReservation(next->c, next->i, next->j, ALMOST_COMMITTED-iid, FREE);
                             if (i == N - 1 && getRFAccess(next->c, next->i, next->j) == ALMOST_COMMITTED - iid)
                             { // start of route and it routes to itself -> mark RF Access
@@ -1366,7 +1664,6 @@ int routeOp(cgra *first_slice, dfg_instr *target, int **placed, int *schedule, i
                         si = next;
                     }
                     deleteStackItem(si);
-                    free(paths[j]);
                 }
                 // Reserve the necessary LRF entries
                 int consts = get_n_consts(target);
@@ -1385,7 +1682,7 @@ int routeOp(cgra *first_slice, dfg_instr *target, int **placed, int *schedule, i
         }
 
         // Routing was successful. Commit all generated paths
-        for (k = 0; k < get_n_inputs(target); k++)
+        for (k = 0; k < n_routes; k++)
         {
             si = paths[k][1];
             N = paths[k][0]->i;
@@ -1424,7 +1721,6 @@ int routeOp(cgra *first_slice, dfg_instr *target, int **placed, int *schedule, i
                 si = next;
             }
             deleteStackItem(si);
-            free(paths[k]);
         }
         free(paths);
         free(input_order);
@@ -1432,6 +1728,8 @@ int routeOp(cgra *first_slice, dfg_instr *target, int **placed, int *schedule, i
         // Commit all generated paths regarding recurrences
         for (k = 0; k < get_n_recurrences(target); k++)
         {
+            if (recurrence_paths[k] == NULL)
+                continue;
             iid = get_instr_id(get_recurrence(target, k));
             si = recurrence_paths[k][1];
             N = recurrence_paths[k][0]->i;
@@ -1469,13 +1767,25 @@ int routeOp(cgra *first_slice, dfg_instr *target, int **placed, int *schedule, i
                 si = next;
             }
             deleteStackItem(si);
-            free(recurrence_paths[k]);
         }
         free(recurrence_paths);
         return 1;
     }
 }
 
+/**
+ * Instrumented entry point: counts the calls and, with the phase timers on, times them as PHASE_ROUTE (stats.h)
+ */
+int routeOp(cgra *first_slice, dfg_instr *target, int **placed, int *schedule, int II)
+{
+    double t0 = STAT_TIMER_BEGIN();
+    int status = routeOpImpl(first_slice, target, placed, schedule, II);
+
+    STAT_INC(STAT_ROUTE_OP);
+    STAT_TIMER_END(PHASE_ROUTE, t0);
+    return status;
+}
+
 /************************************************************************************************************************************************
  * unmapOp
  * Inputs: device model (first slice), target node, the placement info array (placed), the schedule and the II
@@ -1483,15 +1793,17 @@ int routeOp(cgra *first_slice, dfg_instr *target, int **placed, int *schedule, i
  * were only reserved by the target, then they are also removed. Lastly, the target node is removed from the device.
  * Return values: unmapped ? 1 : 0
  **********************************************************************************************************************************************/
-int unmapOp(cgra *first_slice, dfg *d, dfg_instr *target, int **placed, int *schedule, int II)
+static int unmapOpImpl(cgra *first_slice, dfg *d, dfg_instr *target, int **placed, int *schedule, int II)
 {
 
     if (target == NULL)
         return 0;
 
     int i, j, t, c, consts = get_n_consts(target), ti, k, maxPlacements, id = get_instr_id(target), iid, tt = schedule[id - 1], pos = placed[id - 1][1], p, ii, jj, or;
+    int ts, n_in = get_n_inputs(target);
     bool parentReg;
     cgra *prev, *curr, *targetSlice = getModuloSlice(first_slice, schedule[id - 1], II);
+    dfg_instr *input;
 
     // Op is not placed
     if (placed[id - 1][0] == 0)
@@ -1499,11 +1811,17 @@ int unmapOp(cgra *first_slice, dfg *d, dfg_instr *target, int **placed, int *sch
                   /* printf("unmapping: %d\n",get_instr_id(target)); */
     // Unmap routes to inputs
 
-    for (k = 0; k < get_n_inputs(target); k++)
+    // (and to the values read from previous iterations of other nodes, if these are still placed)
+    for (k = 0; k < n_in + get_n_rec_inputs(target); k++)
     {
-        iid = get_instr_id(get_input(target, k));
-        ti = schedule[iid - 1] + get_instr_lat(get_input(target, k)) - 1; // final schedule time of the input
-        t = schedule[id - 1];
+        input = k < n_in ? get_input(target, k) : get_rec_input(target, k - n_in);
+        iid = get_instr_id(input);
+        if (k >= n_in && placed[iid - 1][0] == 0)
+            continue;
+        ti = schedule[iid - 1] + get_instr_lat(input) - 1; // final schedule time of the input
+        // Routes of recurrences are timed from the target's iteration 'dist' iterations later
+        ts = schedule[id - 1] + (k < n_in ? 0 : II * get_rec_dist_from_instr(input, target));
+        t = ts;
         i = pos / get_cgra_C(first_slice);
         j = pos % get_cgra_C(first_slice);
         curr = targetSlice;
@@ -1522,11 +1840,11 @@ int unmapOp(cgra *first_slice, dfg *d, dfg_instr *target, int **placed, int *sch
                 // Unsign the target from this reservation. If no other targets are reserving this, then the reservation is freed.
                 unsignLRFEntry(prev, i, j, t, iid, id);
                 // Remove RF Read Reservation
-                if (t == tt - 1)
+                if (t == ts - 1)
                 {
                     removeRFRPReservationMuxIn(curr, i, j, iid, t);
                 }
-                else if (parentReg == false && hasConnectedPEsWithVal(curr, i, j, iid, t + 1) < 0 && t < tt - 1)
+                else if (parentReg == false && hasConnectedPEsWithVal(curr, i, j, iid, t + 1) < 0 && t < ts - 1)
                 {
                     removeRFRPReservationOR(curr, i, j, iid, t);
                 }
@@ -1572,6 +1890,9 @@ int unmapOp(cgra *first_slice, dfg *d, dfg_instr *target, int **placed, int *sch
     for (k = 0; k < get_n_recurrences(target); k++)
     {
         iid = get_instr_id(get_recurrence(target, k));
+        // A recurrence to a node that is not placed has no route (or it was removed when that node was unmapped)
+        if (iid != id && placed[iid - 1][0] == 0)
+            continue;
         ti = schedule[iid - 1] + II * get_rec_dist_from_instr(target, get_recurrence(target, k)); // final schedule time of the input
         tt = ti;
         t = schedule[id - 1] + get_instr_lat(target) - 1;
@@ -1703,6 +2024,19 @@ int unmapOp(cgra *first_slice, dfg *d, dfg_instr *target, int **placed, int *sch
     return 1;
 }
 
+/**
+ * Instrumented entry point: counts the calls and, with the phase timers on, times them as PHASE_UNMAP (stats.h)
+ */
+int unmapOp(cgra *first_slice, dfg *d, dfg_instr *target, int **placed, int *schedule, int II)
+{
+    double t0 = STAT_TIMER_BEGIN();
+    int status = unmapOpImpl(first_slice, d, target, placed, schedule, II);
+
+    STAT_INC(STAT_UNMAP_OP);
+    STAT_TIMER_END(PHASE_UNMAP, t0);
+    return status;
+}
+
 /************************************************************************************************************************************************
  * unRouteOutputs
  * Inputs: device model (first slice), target node, the placement info array (placed), the schedule and the II
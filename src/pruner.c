@@ -13,9 +13,13 @@
 #include "pqueue.h"
 #include "ops.h"
 #include "parson.h"
+#include "mapcache.h"
 
 #define MAX_IO_SIDES 4
 #define MAX_INTERCONNECTS 16
+#define PARETO_PE_STEPS 4 // PE counts explored by paretoDSE
+#define DSE_IO_SEED 1     // seed of the spare IO port directions (set_req_IOs), so that rebuilt DUTs are identical
+#define MAX_CONSTRAINTS_PATH 256
 
 typedef struct
 {
@@ -100,7 +104,11 @@ int *find_square_like_shape(int N, int max_val, int N_IOs)
     return shape;
 }
 
-void set_req_IOs(cgra *dev, int inputs, int outputs)
+/**
+ * Sets the required input and output stream ports on the periphery of dev. The directions of spare ports are
+ * random: drawn from rand_r(seed), or from rand() if seed is NULL.
+ */
+void set_req_IOs(cgra *dev, int inputs, int outputs, unsigned int *seed)
 {
     int rows = get_cgra_L(dev), cols = get_cgra_C(dev);
     int n_io_ports = 2 * (rows + cols - 4); // -4 because of the IOs in the periphery which are counted for the rows and cols
@@ -264,7 +272,7 @@ void set_req_IOs(cgra *dev, int inputs, int outputs)
             // IO port exists and is not yet an input
             if (get_cgra_tile_value(dev, 0, j) != -1 && !isInputStreamPort(dev, 0, j) && !isOutputStreamPort(dev, 0, j))
             {
-                rnd = rand() % 2;
+                rnd = (seed != NULL ? rand_r(seed) : rand()) % 2;
                 if (rnd == 0)
                     set_cgra_tile_funct(dev, 0, j, OP_STREAM_IN);
                 else
@@ -278,7 +286,7 @@ void set_req_IOs(cgra *dev, int inputs, int outputs)
             // IO port exists
             if (get_cgra_tile_value(dev, i, 0) != -1 && !isInputStreamPort(dev, i, 0) && !isOutputStreamPort(dev, i, 0))
             {
-                rnd = rand() % 2;
+                rnd = (seed != NULL ? rand_r(seed) : rand()) % 2;
                 if (rnd == 0)
                     set_cgra_tile_funct(dev, i, 0, OP_STREAM_IN);
                 else
@@ -292,7 +300,7 @@ void set_req_IOs(cgra *dev, int inputs, int outputs)
             // IO port exists and is not yet an input
             if (get_cgra_tile_value(dev, rows - 1, j) != -1 && !isInputStreamPort(dev, rows - 1, j) & !isOutputStreamPort(dev, rows - 1, j))
             {
-                rnd = rand() % 2;
+                rnd = (seed != NULL ? rand_r(seed) : rand()) % 2;
                 if (rnd == 0)
                     set_cgra_tile_funct(dev, rows - 1, j, OP_STREAM_IN);
                 else
@@ -305,7 +313,7 @@ void set_req_IOs(cgra *dev, int inputs, int outputs)
             // IO port exists
             if (get_cgra_tile_value(dev, i, cols - 1) != -1 && !isInputStreamPort(dev, i, cols - 1) && !isOutputStreamPort(dev, i, cols - 1))
             {
-                rnd = rand() % 2;
+                rnd = (seed != NULL ? rand_r(seed) : rand()) % 2;
                 if (rnd == 0)
                     set_cgra_tile_funct(dev, i, cols - 1, OP_STREAM_IN);
                 else
@@ -368,15 +376,13 @@ int parseDir(const char *dir)
     return 0;
 }
 
-PEParsedConfig parse_pe_architecture(const char *filename)
+static PEParsedConfig parse_pe_architecture(const JSON_Object *root_obj)
 {
     PEParsedConfig config;
-    int i;
     // --- Set Defaults ---
     config.n_output_registers = 2;
     config.fu_inputs = 2;
-    for (i = 0; i < MAX_OPS; i++)
-        memset(config.operations[i], 0, MAX_OP_NAME_LEN);
+    memset(config.operations, 0, sizeof(config.operations));
     strcpy(config.operations[0], "ADD");
     strcpy(config.operations[1], "MUL");
 
@@ -397,16 +403,12 @@ PEParsedConfig parse_pe_architecture(const char *filename)
     for (int i = 0; i < MAX_INTERCONNECTS; ++i)
         config.interconnects[i] = 0;
 
-    // --- Parse JSON ---
-    JSON_Value *root_val = json_parse_file(filename);
-    if (!root_val)
+    if (!root_obj)
     {
-        fprintf(stderr, "Failed to parse JSON file: %s\nUsing default PE config.\n", filename);
         config.interconnects[ADJACENT] = 1;
         return config;
     }
 
-    const JSON_Object *root_obj = json_value_get_object(root_val);
     config.ld_bw = json_object_get_number(root_obj, "maximum_se_load_bw");
     config.st_bw = json_object_get_number(root_obj, "maximum_se_store_bw");
     config.dw = json_object_get_number(root_obj, "data_width");
@@ -414,7 +416,6 @@ PEParsedConfig parse_pe_architecture(const char *filename)
     const JSON_Object *pe_obj = json_object_get_object(root_obj, "PE_Architecture");
     if (!pe_obj)
     {
-        json_value_free(root_val);
         config.interconnects[ADJACENT] = 1;
         return config;
     }
@@ -546,7 +547,6 @@ PEParsedConfig parse_pe_architecture(const char *filename)
         config.interconnects[ADJACENT] = 1;
     }
 
-    json_value_free(root_val);
     return config;
 }
 
@@ -576,7 +576,8 @@ cgra *createPETemplate(PEParsedConfig config, dfg **dfg_targets, int n_dfgs)
     }
     for (j = 0; j < MAX_OPS; j++)
     {
-        ops[get_operation_index(config.operations[j])] = 1;
+        if (get_operation_index(config.operations[j]) >= 0)
+            ops[get_operation_index(config.operations[j])] = 1;
     }
 
     for (i = 0; i < MAX_OPS; i++)
@@ -627,41 +628,20 @@ cgra *createPETemplate(PEParsedConfig config, dfg **dfg_targets, int n_dfgs)
     return t;
 }
 
-cgra *buildHmgCGRA(int rows, int cols, char *constraints_file, dfg **dfg_targets, int n_dfgs)
-{
-    PEParsedConfig config = parse_pe_architecture(constraints_file);
-    cgra *single_tile = createPETemplate(config, dfg_targets, n_dfgs);
-    int n_rows = rows + (config.io_directions[0] != 0) + (config.io_directions[2] != 0);
-    int n_cols = cols + (config.io_directions[1] != 0) + (config.io_directions[3] != 0);
-
-    cgra *new_dev = buildHmgCopy(single_tile, n_rows, n_cols);
-    delete_cgra(single_tile);
-    return new_dev;
-}
-
 /**
- * Parses the "maximum_II" array from a JSON file.
+ * Parses the "maximum_II" array of the constraints.
  * The returned array has size N + 1, where:
  *   - result[0] = N (the number of elements)
  *   - result[1..N] = values from the JSON array
  *
  * Caller is responsible for freeing the returned array.
  */
-int *parse_II_constraints(const char *filename)
+static int *parse_II_constraints(const JSON_Object *root_obj)
 {
-    JSON_Value *root_val = json_parse_file(filename);
-    if (root_val == NULL)
-    {
-        fprintf(stderr, "Failed to parse JSON file: %s\n", filename);
-        return NULL;
-    }
-
-    const JSON_Object *root_obj = json_value_get_object(root_val);
     const JSON_Array *ii_array = json_object_get_array(root_obj, "maximum_II");
     if (ii_array == NULL)
     {
         fprintf(stderr, "Could not find 'maximum_II' array in JSON.\n");
-        json_value_free(root_val);
         return NULL;
     }
 
@@ -670,7 +650,6 @@ int *parse_II_constraints(const char *filename)
     if (result == NULL)
     {
         perror("malloc failed");
-        json_value_free(root_val);
         return NULL;
     }
 
@@ -680,62 +659,146 @@ int *parse_II_constraints(const char *filename)
         result[i + 1] = (int)json_array_get_number(ii_array, i);
     }
 
-    json_value_free(root_val);
     return result;
 }
 
 /**
- * Parses the "maximum_area" value from a JSON file.
+ * Parses the "maximum_area" value of the constraints.
  * Returns the area as a double.
  * Returns -1.0 on failure.
  */
-double parse_area_constraint(const char *filename)
+static double parse_area_constraint(const JSON_Object *root_obj)
 {
-    JSON_Value *root_val = json_parse_file(filename);
-    if (root_val == NULL)
-    {
-        fprintf(stderr, "Failed to parse JSON file: %s\n", filename);
-        return -1.0;
-    }
-
-    const JSON_Object *root_obj = json_value_get_object(root_val);
     if (!json_object_has_value_of_type(root_obj, "maximum_area", JSONNumber))
     {
         fprintf(stderr, "Could not find 'maximum_area' in JSON.\n");
-        json_value_free(root_val);
         return -1.0;
     }
 
-    double area = json_object_get_number(root_obj, "maximum_area");
-    json_value_free(root_val);
-    return area;
+    return json_object_get_number(root_obj, "maximum_area");
 }
 
 /**
- * Parses the "maximum_power" value from a JSON file.
+ * Parses the "maximum_power" value of the constraints.
  * Returns the power as a double.
  * Returns -1.0 on failure.
  */
-double parse_power_constraint(const char *filename)
+static double parse_power_constraint(const JSON_Object *root_obj)
 {
-    JSON_Value *root_val = json_parse_file(filename);
-    if (root_val == NULL)
+    if (!json_object_has_value_of_type(root_obj, "maximum_power", JSONNumber))
     {
-        fprintf(stderr, "Failed to parse JSON file: %s\n", filename);
+        fprintf(stderr, "Could not find 'maximum_power' in JSON.\n");
         return -1.0;
     }
 
+    return json_object_get_number(root_obj, "maximum_power");
+}
+
+/**************************************************************************************
+ * DSE Constraints
+ * The constraints file is parsed and validated once (import_constraints), and the DSE
+ * functions share the resulting object. The PE tile of the homogeneous devices
+ * (createPETemplate) depends on the PE architecture and on the operations of the dfgs,
+ * so the last one built is kept, and every device of the same configuration is a copy
+ * of it (buildHmgCopy).
+ *************************************************************************************/
+struct _dse_constraints
+{
+    char filename[MAX_CONSTRAINTS_PATH];
+    PEParsedConfig config;
+    int *iis;         // maximum IIs (iis[0] = count), NULL if not given
+    double max_area;  // -1 if not given
+    double max_power; // -1 if not given
+
+    cgra *pe_tile; // last tile built, for tile_config and the operations in tile_ops
+    PEParsedConfig tile_config;
+    unsigned char tile_ops[MAX_OPS];
+};
+
+/**
+ * Parses a constraints file. If it cannot be parsed, the defaults are used (no II, area or
+ * power constraints, default PE architecture).
+ */
+dse_constraints *load_dse_constraints(const char *filename)
+{
+    dse_constraints *k = (dse_constraints *)calloc(1, sizeof(dse_constraints));
+    JSON_Value *root_val = json_parse_file(filename);
     const JSON_Object *root_obj = json_value_get_object(root_val);
-    if (!json_object_has_value_of_type(root_obj, "maximum_power", JSONNumber))
+
+    strncpy(k->filename, filename, MAX_CONSTRAINTS_PATH - 1);
+    if (root_val == NULL)
+        fprintf(stderr, "Failed to parse JSON file: %s\nUsing default PE config.\n", filename);
+
+    k->config = parse_pe_architecture(root_obj);
+    k->iis = root_obj != NULL ? parse_II_constraints(root_obj) : NULL;
+    k->max_area = root_obj != NULL ? parse_area_constraint(root_obj) : -1.0;
+    k->max_power = root_obj != NULL ? parse_power_constraint(root_obj) : -1.0;
+
+    json_value_free(root_val);
+    return k;
+}
+
+void delete_dse_constraints(dse_constraints *k)
+{
+    if (k == NULL)
+        return;
+    if (k->pe_tile != NULL)
+        delete_cgra(k->pe_tile);
+    free(k->iis);
+    free(k);
+}
+
+/**
+ * Returns a copy of the II constraints (as parse_II_constraints), or NULL if none were given.
+ */
+static int *get_II_constraints(dse_constraints *k)
+{
+    int *iis;
+
+    if (k->iis == NULL)
+        return NULL;
+    iis = (int *)malloc((k->iis[0] + 1) * sizeof(int));
+    memcpy(iis, k->iis, (k->iis[0] + 1) * sizeof(int));
+    return iis;
+}
+
+/**
+ * Returns the PE tile for a PE configuration and the operations of the dfgs. It is rebuilt
+ * only if either changed since the last call. The tile is owned by the constraints object.
+ */
+static cgra *get_pe_tile(dse_constraints *k, PEParsedConfig config, dfg **dfg_targets, int n_dfgs)
+{
+    unsigned char ops[MAX_OPS] = {0};
+    int i, j;
+
+    for (i = 0; i < n_dfgs; i++)
+        for (j = 0; j < get_dfg_size(dfg_targets[i]); j++)
+            if (get_operation_index(get_instr_op(get_dfg_instr(dfg_targets[i], j))) >= 0)
+                ops[get_operation_index(get_instr_op(get_dfg_instr(dfg_targets[i], j)))] = 1;
+
+    if (k->pe_tile == NULL || memcmp(&config, &k->tile_config, sizeof(PEParsedConfig)) != 0 || memcmp(ops, k->tile_ops, sizeof(ops)) != 0)
     {
-        fprintf(stderr, "Could not find 'maximum_power' in JSON.\n");
-        json_value_free(root_val);
-        return -1.0;
+        if (k->pe_tile != NULL)
+            delete_cgra(k->pe_tile);
+        k->pe_tile = createPETemplate(config, dfg_targets, n_dfgs);
+        k->tile_config = config;
+        memcpy(k->tile_ops, ops, sizeof(ops));
     }
+    return k->pe_tile;
+}
 
-    double power = json_object_get_number(root_obj, "maximum_power");
-    json_value_free(root_val);
-    return power;
+static cgra *buildHmgCGRAFromConfig(int rows, int cols, dse_constraints *constraints, PEParsedConfig config, dfg **dfg_targets, int n_dfgs)
+{
+    cgra *single_tile = get_pe_tile(constraints, config, dfg_targets, n_dfgs);
+    int n_rows = rows + (config.io_directions[0] != 0) + (config.io_directions[2] != 0);
+    int n_cols = cols + (config.io_directions[1] != 0) + (config.io_directions[3] != 0);
+
+    return buildHmgCopy(single_tile, n_rows, n_cols);
+}
+
+cgra *buildHmgCGRA(int rows, int cols, dse_constraints *constraints, dfg **dfg_targets, int n_dfgs)
+{
+    return buildHmgCGRAFromConfig(rows, cols, constraints, constraints->config, dfg_targets, n_dfgs);
 }
 
 int get_recurrence_delay(dfg *graph, dfg_instr *start, dfg_instr *end)
@@ -927,7 +990,7 @@ int *findSizeforPerformance(dfg **dfg_targets, int n_dfgs, int *ii_constraints,
     return resources;
 }
 
-cgra *generateInitialDesignPoint(dfg **dfg_targets, int n_dfgs, char *constraints_file)
+cgra *generateInitialDesignPoint(dfg **dfg_targets, int n_dfgs, dse_constraints *constraints)
 {
     int max_area, max_power, rows, cols;
     int *ii_constraints, *res;
@@ -935,20 +998,20 @@ cgra *generateInitialDesignPoint(dfg **dfg_targets, int n_dfgs, char *constraint
     int *shape;
     float overhead = 1.0;
 
-    PEParsedConfig config;
     int has_io_specs;
 
-    printf("Generating an initial design point, considering %d input DFGs and the '%s' constraints file.\n", n_dfgs, constraints_file);
+    printf("Generating an initial design point, considering %d input DFGs and the '%s' constraints file.\n", n_dfgs, constraints->filename);
 
-    ii_constraints = parse_II_constraints(constraints_file);
+    ii_constraints = get_II_constraints(constraints);
 
     if (ii_constraints == NULL)
     {
-        fprintf(stderr, "Failed to parse II constraints from file: %s\n", constraints_file);
+        fprintf(stderr, "Failed to parse II constraints from file: %s\n", constraints->filename);
+        return NULL;
     }
 
-    max_area = parse_area_constraint(constraints_file);
-    max_power = parse_power_constraint(constraints_file);
+    max_area = constraints->max_area;
+    max_power = constraints->max_power;
 
     if (ii_constraints[0] < n_dfgs)
     {
@@ -958,8 +1021,7 @@ Only the first %d DFGs will be considered.\033[0;m\n",
         n_dfgs = ii_constraints[0];
     }
 
-    config = parse_pe_architecture(constraints_file);
-    has_io_specs = config.has_io_specs;
+    has_io_specs = constraints->config.has_io_specs;
 
     res = findSizeforPerformance(dfg_targets, n_dfgs, ii_constraints, max_area, max_power);
     free(ii_constraints);
@@ -979,9 +1041,9 @@ Only the first %d DFGs will be considered.\033[0;m\n",
         } while (rows == 0 || cols == 0);
         res[0] = rows * cols;
         // printf("\033[1;36mINFO: Generating design point with %d PEs.\033[1;0m\n\n", res[0]);
-        cgra *dev = buildHmgCGRA(rows, cols, constraints_file, dfg_targets, n_dfgs);
+        cgra *dev = buildHmgCGRA(rows, cols, constraints, dfg_targets, n_dfgs);
         if (!has_io_specs)
-            set_req_IOs(dev, res[1], res[2]);
+            set_req_IOs(dev, res[1], res[2], NULL);
         free(res);
         return dev;
     }
@@ -990,28 +1052,28 @@ Only the first %d DFGs will be considered.\033[0;m\n",
     return NULL;
 }
 
-cgra *buildIdealHmgCGRA(dfg **dfg_targets, int n_dfgs, int **res, char *opt_target, char *constraints_file)
+cgra *buildIdealHmgCGRA(dfg **dfg_targets, int n_dfgs, int **res, char *opt_target, dse_constraints *constraints)
 {
     int max_area, max_power, rows, cols;
     int *ii_constraints, *shape;
 
-    PEParsedConfig config;
     int has_io_specs;
 
     printf("Building Ideal Homogeneous CGRA, considering %d input DFGs.\n", n_dfgs);
 
-    ii_constraints = parse_II_constraints(constraints_file);
+    ii_constraints = get_II_constraints(constraints);
 
-    config = parse_pe_architecture(constraints_file);
-    has_io_specs = config.has_io_specs;
+    has_io_specs = constraints->config.has_io_specs;
 
     if (ii_constraints == NULL)
     {
-        fprintf(stderr, "\033[1;31mFailed to parse II constraints from file: \033[0;m%s\n", constraints_file);
+        fprintf(stderr, "\033[1;31mFailed to parse II constraints from file: \033[0;m%s\n", constraints->filename);
+        *res = (int *)calloc(3, sizeof(int));
+        return NULL;
     }
 
-    max_area = parse_area_constraint(constraints_file);
-    max_power = parse_power_constraint(constraints_file);
+    max_area = constraints->max_area;
+    max_power = constraints->max_power;
 
     if (ii_constraints[0] < n_dfgs)
     {
@@ -1057,15 +1119,15 @@ Only the first %d DFGs will be considered.\033[0;m\n",
         rows = shape[0];
         cols = shape[1];
         free(shape);
-        cgra *dev = buildHmgCGRA(rows, cols, constraints_file, dfg_targets, n_dfgs);
+        cgra *dev = buildHmgCGRA(rows, cols, constraints, dfg_targets, n_dfgs);
         if (!has_io_specs)
-            set_req_IOs(dev, (*res)[1], (*res)[2]);
+            set_req_IOs(dev, (*res)[1], (*res)[2], NULL);
         return dev;
     }
     return NULL;
 }
 
-cgra *buildDUT(int n_pes, int n_ins, int n_outs, char *constraints_file, dfg **dfg_targets, int n_dfgs, int sign, int min_PEs)
+cgra *buildDUT(int n_pes, int n_ins, int n_outs, dse_constraints *constraints, dfg **dfg_targets, int n_dfgs, int sign, int min_PEs)
 {
     //int r, c, tries = 0;
     int rows = 0, cols = 0;
@@ -1073,7 +1135,6 @@ cgra *buildDUT(int n_pes, int n_ins, int n_outs, char *constraints_file, dfg **d
 
     int *shape;
 
-    PEParsedConfig config;
     int has_io_specs;
 
     /*     do
@@ -1095,22 +1156,176 @@ cgra *buildDUT(int n_pes, int n_ins, int n_outs, char *constraints_file, dfg **d
             // Avoid [1xP] arrays, where P is a prime number higher than 5 (1x5 should still be acceptable, I guess)
         } while ((rows <= 1 || cols <= 1) && n_pes > 6 && tries < max_tries);
 
-        return buildHmgCGRA(rows, cols, constraints_file, dfg_targets, n_dfgs); */
+        return buildHmgCGRA(rows, cols, constraints, dfg_targets, n_dfgs); */
 
-    config = parse_pe_architecture(constraints_file);
-    has_io_specs = config.has_io_specs;
+    has_io_specs = constraints->config.has_io_specs;
 
     shape = find_square_like_shape(n_pes, n_pes, n_ins + n_outs);
     rows = shape[0];
     cols = shape[1];
     free(shape);
 
-    cgra *dev = buildHmgCGRA(rows, cols, constraints_file, dfg_targets, n_dfgs);
+    cgra *dev = buildHmgCGRA(rows, cols, constraints, dfg_targets, n_dfgs);
+    unsigned int io_seed = DSE_IO_SEED;
     if (!has_io_specs)
-        set_req_IOs(dev, n_ins, n_outs);
+        set_req_IOs(dev, n_ins, n_outs, &io_seed);
     return dev;
 }
 
+/**************************************************************************************
+ * DSE Memoization
+ * Mapping results of the design space exploration (II and PE utilization), keyed by the
+ * content hashes of the device under test (hash_device: grid, functs, RF/OR sizes,
+ * interconnect) and of the dfg, by the maximum II allowed and by the mapper settings that
+ * change its results (multicast routing, II prover). Different PE counts often yield the
+ * same array shape, and the searches revisit devices, which are then not remapped.
+ * The results are kept for the whole session.
+ *************************************************************************************/
+typedef struct
+{
+    uint64_t device_hash, dfg_hash;
+    int maxII;
+    int config; // mapper settings (dse_memo_config)
+    int ii;     // 0 if the dfg could not be mapped
+    float util;
+} dse_memo_entry;
+
+static dse_memo_entry *dse_memo = NULL;
+static int dse_memo_size = 0, dse_memo_capacity = 0;
+static int dse_memo_hits = 0, dse_memo_misses = 0;
+
+/** Returns the mapper settings that are part of the key, as bit flags */
+static int dse_memo_config(void)
+{
+    return (get_multicast_routing() ? 1 : 0) | (get_ii_prover() ? 2 : 0);
+}
+
+static int dse_memo_lookup(uint64_t device_hash, uint64_t dfg_hash, int maxII, int *ii, float *util)
+{
+    int k, config = dse_memo_config();
+
+    for (k = 0; k < dse_memo_size; k++)
+    {
+        if (dse_memo[k].device_hash == device_hash && dse_memo[k].dfg_hash == dfg_hash && dse_memo[k].maxII == maxII &&
+            dse_memo[k].config == config)
+        {
+            *ii = dse_memo[k].ii;
+            *util = dse_memo[k].util;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void dse_memo_store(uint64_t device_hash, uint64_t dfg_hash, int maxII, int ii, float util)
+{
+    int k, config = dse_memo_config();
+
+    // A remapped device keeps one entry, with its latest result
+    for (k = 0; k < dse_memo_size; k++)
+    {
+        if (dse_memo[k].device_hash == device_hash && dse_memo[k].dfg_hash == dfg_hash && dse_memo[k].maxII == maxII &&
+            dse_memo[k].config == config)
+        {
+            dse_memo[k].ii = ii;
+            dse_memo[k].util = util;
+            return;
+        }
+    }
+    if (dse_memo_size == dse_memo_capacity)
+    {
+        dse_memo_capacity = dse_memo_capacity ? 2 * dse_memo_capacity : 64;
+        dse_memo = (dse_memo_entry *)realloc(dse_memo, dse_memo_capacity * sizeof(dse_memo_entry));
+    }
+    dse_memo[dse_memo_size].device_hash = device_hash;
+    dse_memo[dse_memo_size].dfg_hash = dfg_hash;
+    dse_memo[dse_memo_size].maxII = maxII;
+    dse_memo[dse_memo_size].config = config;
+    dse_memo[dse_memo_size].ii = ii;
+    dse_memo[dse_memo_size].util = util;
+    dse_memo_size++;
+}
+
+/**
+ * Fetches the memoized IIs and utilizations of all dfgs on the DUT. maxIIs may be NULL (no limit).
+ * Returns 1 if all of them were found, 0 otherwise.
+ */
+static int lookupDUT(cgra *dut, dfg **dfg_targets, int n_dfgs, int *maxIIs, int *iis, float *utils)
+{
+    uint64_t h = hash_device(dut);
+    int i;
+
+    for (i = 0; i < n_dfgs; i++)
+        if (!dse_memo_lookup(h, hash_dfg(dfg_targets[i]), maxIIs ? maxIIs[i] : __INT_MAX__, &iis[i], &utils[i]))
+            return 0;
+    dse_memo_hits += n_dfgs;
+    return 1;
+}
+
+/**
+ * Maps every dfg onto the DUT (fine tuning mapper), storing the IIs (0 if a dfg could not be
+ * mapped) and PE utilizations, and memoizes them. The mapped devices are returned in maps, or
+ * deleted if maps is NULL, in which case memoized results are used instead of remapping.
+ */
+static void evaluateDUT(cgra *dut, dfg **dfg_targets, int n_dfgs, int *maxIIs, int *iis, float *utils, cgra **maps)
+{
+    uint64_t h = hash_device(dut), hd;
+    int i, k, fm, maxII, ***placed = (int ***)calloc(1, sizeof(int **));
+    dfg *d;
+    cgra *m;
+
+    for (i = 0; i < n_dfgs; i++)
+    {
+        d = dfg_targets[i];
+        hd = hash_dfg(d);
+        maxII = maxIIs ? maxIIs[i] : __INT_MAX__;
+        if (maps == NULL && dse_memo_lookup(h, hd, maxII, &iis[i], &utils[i]))
+        {
+            dse_memo_hits++;
+            continue;
+        }
+
+        *placed = (int **)calloc(get_dfg_size(d), sizeof(int *));
+        for (k = 0; k < get_dfg_size(d); k++)
+            (*placed)[k] = (int *)calloc(5, sizeof(int)); // [placed?, line & column, first_slice, last_slice, pipeline-rescheduled]
+        fm = 1;
+
+        printf("Mapping DFG #%d.\n", i + 1);
+        m = HandOfGod(dut, d, placed, &fm, 1, maxII, 0);
+        iis[i] = get_n_cgra_slices(m);
+        utils[i] = (m != NULL) ? get_dynamic_pe_util_ratio(m) : 0;
+        dse_memo_misses++;
+        dse_memo_store(h, hd, maxII, iis[i], utils[i]);
+
+        if (maps != NULL)
+            maps[i] = m;
+        else
+            delete_cgra(m);
+        for (k = 0; k < get_dfg_size(d); k++)
+            free(placed[0][k]);
+        free(placed[0]);
+    }
+    free(placed);
+}
+
+/**
+ * Replaces the IIs of dfgs that could not be mapped (0) by one above their limit.
+ * Returns 1 if any II exceeds its limit, 0 otherwise.
+ */
+static int checkIIConstraints(int *iis, int *maxIIs, int n_dfgs)
+{
+    int i, violations = 0;
+
+    for (i = 0; i < n_dfgs; i++)
+    {
+        if (iis[i] == 0)
+            iis[i] = maxIIs[i] + 1;
+        if (iis[i] > maxIIs[i])
+            violations = 1;
+    }
+    return violations;
+}
+
 float computeAggressiveOptCostFun(cgra *c, int *ii_vals, float *utils, int N, float min_area, float min_power, int tgt_fun)
 {
     float area = get_cgra_area_estimate(c);
@@ -1178,13 +1393,12 @@ float computeAggressiveOptCostFun(cgra *c, int *ii_vals, float *utils, int N, fl
     return cost;
 }
 
-cgra *aggressiveOpt(cgra *template, cgra **final_maps, dfg **dfg_targets, int n_dfgs, char *opt_target, char *constraints_file)
+cgra *aggressiveOpt(cgra *template, cgra **final_maps, dfg **dfg_targets, int n_dfgs, char *opt_target, dse_constraints *constraints)
 {
     cgra *dev = template, *dut;
     cgra **mapped_devs = (cgra **)malloc(n_dfgs * sizeof(cgra *));
-    cgra **dut_mappings = (cgra **)malloc(n_dfgs * sizeof(cgra *));
-    dfg *d;
-    int i, k, fm, ***placed = (int ***)calloc(1, sizeof(int **)), opt_tgt_fun = -1, min_res0, constraint_violations;
+    cgra **dut_mappings = (cgra **)calloc(n_dfgs, sizeof(cgra *));
+    int i, ***placed = (int ***)calloc(1, sizeof(int **)), opt_tgt_fun = -1, min_res0, constraint_violations, memoized;
     int *mapped_ii_vals = (int *)malloc(n_dfgs * sizeof(int)), *res, step, curr_res0;
     int *ii_constraints = (int *)malloc((n_dfgs + 1) * sizeof(int)), *iis;
     float *util_ratios = (float *)malloc(n_dfgs * sizeof(float));
@@ -1205,10 +1419,10 @@ cgra *aggressiveOpt(cgra *template, cgra **final_maps, dfg **dfg_targets, int n_
     else if (!strcmp(opt_target, "UTILIZATION"))
         opt_tgt_fun = 3;
 
-    max_area = parse_area_constraint(constraints_file);
-    max_power = parse_power_constraint(constraints_file);
+    max_area = constraints->max_area;
+    max_power = constraints->max_power;
 
-    iis = parse_II_constraints(constraints_file);
+    iis = constraints->iis;
     for (i = 0; i < n_dfgs; i++)
     {
 
@@ -1217,13 +1431,11 @@ cgra *aggressiveOpt(cgra *template, cgra **final_maps, dfg **dfg_targets, int n_
         else
             ii_constraints[i + 1] = __INT_MAX__;
     }
-    if (iis)
-        free(iis);
 
     if (!dev)
     {
         printf("\033[1;33mWARNING: No device model found. Generating initial design point.\033[1;0m\n");
-        dev = generateInitialDesignPoint(dfg_targets, n_dfgs, constraints_file);
+        dev = generateInitialDesignPoint(dfg_targets, n_dfgs, constraints);
         printf("\033[1;36mINFO: Generated a design point with %d PEs.\033[1;0m\n\n", get_n_pe(dev));
     }
 
@@ -1235,38 +1447,13 @@ cgra *aggressiveOpt(cgra *template, cgra **final_maps, dfg **dfg_targets, int n_
     printf("Determining initial mapping for %d DFGs.\n", n_dfgs);
 
     // Initial mapping of all DFGs, separately
-    for (i = 0; i < n_dfgs; i++)
-    {
-        d = dfg_targets[i];
-
-        *placed = (int **)calloc(get_dfg_size(d), sizeof(int *));
-
-        for (k = 0; k < get_dfg_size(d); k++)
-            (*placed)[k] = (int *)calloc(5, sizeof(int)); // [placed?, line & column, first_slice, last_slice, pipeline-rescheduled]
-        fm = 1;
-
-        printf("Mapping DFG #%d.\n", i + 1);
-        mapped_devs[i] = HandOfGod(dev, d, placed, &fm, 1, __INT_MAX__, 0);
-        mapped_ii_vals[i] = get_n_cgra_slices(mapped_devs[i]);
-        util_ratios[i] = get_dynamic_pe_util_ratio(mapped_devs[i]);
-        // To test pruning on the SDP
-        // final_maps[i] = mapped_devs[i];
-
-        /* if (mapped_devs[i] != NULL)
-            printf("Mapped DFG #%d with II = %d.\n", i + 1, mapped_ii_vals[i]); */
-
-        // display_cgra_in_time(mapped_devs[i], d);
-
-        for (k = 0; k < get_dfg_size(d); k++)
-            free(placed[0][k]);
-        free(placed[0]);
-    }
+    evaluateDUT(dev, dfg_targets, n_dfgs, NULL, mapped_ii_vals, util_ratios, mapped_devs);
     // To test pruning on the SDP
     // return dev;
     printf("Determining ideal device, considering the %d provided DFGs.\n", n_dfgs);
 
     // Compute Ideal Device (min area for area opt => gives best case scenario)
-    dut = buildIdealHmgCGRA(dfg_targets, n_dfgs, &res, opt_target, constraints_file);
+    dut = buildIdealHmgCGRA(dfg_targets, n_dfgs, &res, opt_target, constraints);
     display_config_arch(dut);
     min_area = get_cgra_area_estimate(dut);
     min_power = get_cgra_power_estimate(dut);
@@ -1301,7 +1488,7 @@ cgra *aggressiveOpt(cgra *template, cgra **final_maps, dfg **dfg_targets, int n_
         if (curr_res0 < 1)
             dut = NULL;
         else
-            dut = buildDUT(curr_res0, res[1], res[2], constraints_file, dfg_targets, n_dfgs, step, min_res0);
+            dut = buildDUT(curr_res0, res[1], res[2], constraints, dfg_targets, n_dfgs, step, min_res0);
         if (!dut)
             curr_area = -1.1;
         else
@@ -1313,47 +1500,36 @@ cgra *aggressiveOpt(cgra *template, cgra **final_maps, dfg **dfg_targets, int n_
             step *= -1;
             delete_cgra(dut);
             curr_res0 = get_n_pe(dev) - step;
-            dut = buildDUT(curr_res0, res[1], res[2], constraints_file, dfg_targets, n_dfgs, step, min_res0);
+            dut = buildDUT(curr_res0, res[1], res[2], constraints, dfg_targets, n_dfgs, step, min_res0);
         }
         // display_config_arch(dut);
 
         printf("Generated a DUT with %d PEs.\n", get_n_pe(dut));
-        printf("Determining the correspondent mapping for %d DFGs.\n", n_dfgs);
 
-        constraint_violations = 0;
-        // Map all DFGs to the DUT, separately
-        for (i = 0; i < n_dfgs; i++)
+        // A device evaluated before is only remapped if it would replace the current best
+        memoized = lookupDUT(dut, dfg_targets, n_dfgs, ii_constraints + 1, mapped_ii_vals, util_ratios);
+        if (!memoized)
         {
-            d = dfg_targets[i];
-
-            *placed = (int **)calloc(get_dfg_size(d), sizeof(int *));
-
-            for (k = 0; k < get_dfg_size(d); k++)
-                (*placed)[k] = (int *)calloc(5, sizeof(int)); // [placed?, line & column, first_slice, last_slice, pipeline-rescheduled]
-            fm = 1;
-
-            printf("Mapping DFG #%d.\n", i + 1);
-            dut_mappings[i] = HandOfGod(dut, d, placed, &fm, 1, ii_constraints[i + 1], 0);
-            mapped_ii_vals[i] = get_n_cgra_slices(dut_mappings[i]);
-            if (dut_mappings[i] == NULL)
-                mapped_ii_vals[i] = ii_constraints[i + 1] + 1;
-            util_ratios[i] = get_dynamic_pe_util_ratio(dut_mappings[i]);
-
-            if (mapped_ii_vals[i] > ii_constraints[i + 1])
-                constraint_violations = 1;
-            // printf("constraints: %d > %d\n",ii_constraints[i + 1], mapped_ii_vals[i]);
-            /* if (dut_mappings[i] != NULL)
-                printf("Mapped DFG #%d with II = %d.\n", i + 1, mapped_ii_vals[i]); */
-
-            // display_cgra_in_time(dut_mappings[i], d);
-
-            for (k = 0; k < get_dfg_size(d); k++)
-                free(placed[0][k]);
-            free(placed[0]);
+            printf("Determining the correspondent mapping for %d DFGs.\n", n_dfgs);
+            evaluateDUT(dut, dfg_targets, n_dfgs, ii_constraints + 1, mapped_ii_vals, util_ratios, dut_mappings);
         }
+
+        constraint_violations = checkIIConstraints(mapped_ii_vals, ii_constraints + 1, n_dfgs);
         printf("constraints violiations: %d\n", constraint_violations);
         new_cost = computeAggressiveOptCostFun(dut, mapped_ii_vals, util_ratios, n_dfgs, min_area, min_power, opt_tgt_fun);
 
+        if (memoized && new_cost < curr_cost && !constraint_violations)
+        {
+            printf("Determining the correspondent mapping for %d DFGs.\n", n_dfgs);
+            evaluateDUT(dut, dfg_targets, n_dfgs, ii_constraints + 1, mapped_ii_vals, util_ratios, dut_mappings);
+            // The mapper may not reproduce the memoized result: the DUT is judged by the mapping it is adopted with
+            constraint_violations = checkIIConstraints(mapped_ii_vals, ii_constraints + 1, n_dfgs);
+            printf("constraints violiations: %d\n", constraint_violations);
+            new_cost = computeAggressiveOptCostFun(dut, mapped_ii_vals, util_ratios, n_dfgs, min_area, min_power, opt_tgt_fun);
+        }
+        else if (memoized)
+            printf("\033[1;36mINFO: The DUT was already evaluated.\033[0;0m\n");
+
         // The current DUT yields better results than the previous best!
         if (new_cost < curr_cost && !constraint_violations)
         {
@@ -1389,6 +1565,7 @@ cgra *aggressiveOpt(cgra *template, cgra **final_maps, dfg **dfg_targets, int n_
     }
 
     printf("\033[1;32mThe optimizer has converged!\033[0;0m\n");
+    printf("DSE memo: %d mapping results reused, %d computed.\n", dse_memo_hits, dse_memo_misses);
     display_config_arch(dev);
 
     // When the target is performance
@@ -1425,4 +1602,291 @@ cgra *aggressiveOpt(cgra *template, cgra **final_maps, dfg **dfg_targets, int n_
     printf("execution time: %lf\n", cpu_time_used);
 
     return dev;
-}
\ No newline at end of file
+}
+static const char *interconnect_names[MAX_INTERCONNECTS] = {
+    "Horizontal", "Vertical", "Diagonal", "Adjacent", "LeftRight", "RightLeft", "UpDown", "DownUp",
+    "DiagonalSE", "DiagonalNE", "DiagonalNW", "DiagonalSW", "Wrap_aroundLR", "Wrap_aroundRL", "Wrap_aroundUD", "Wrap_aroundDU"};
+
+typedef struct
+{
+    int pes, rows, cols, rf_size, n_output_registers, ii_sum, mapped, pareto;
+    int interconnects[MAX_INTERCONNECTS];
+    float area, power, util;
+    int *iis;
+} dse_point;
+
+static void sprint_interconnects(char *buf, const int *interconnects)
+{
+    int i;
+
+    buf[0] = '\0';
+    for (i = 0; i < MAX_INTERCONNECTS; i++)
+    {
+        if (!interconnects[i])
+            continue;
+        if (buf[0] != '\0')
+            strcat(buf, "+");
+        strcat(buf, interconnect_names[i]);
+    }
+}
+
+// Adds v to the set of values (n of them), if not there yet
+static void add_dse_value(int *values, int *n, int v)
+{
+    int k;
+
+    if (v < 1)
+        return;
+    for (k = 0; k < *n; k++)
+        if (values[k] == v)
+            return;
+    values[(*n)++] = v;
+}
+
+/**
+ * Writes all design points, with the Pareto front flagged. JSON if the file name ends in .json,
+ * CSV otherwise. Return values: success ? 0 : -1
+ */
+static int write_dse_points(const char *filename, dse_point *points, int n_points, int n_dfgs)
+{
+    char buf[MAX_INTERCONNECTS * 16];
+    const char *ext = strrchr(filename, '.');
+    int p, i;
+
+    if (ext != NULL && !strcmp(ext, ".json"))
+    {
+        JSON_Value *root_val = json_value_init_object(), *points_val = json_value_init_array(), *pt_val, *ii_val;
+        JSON_Object *root_obj = json_value_get_object(root_val), *pt_obj;
+
+        json_object_set_number(root_obj, "dfgs", n_dfgs);
+        for (p = 0; p < n_points; p++)
+        {
+            pt_val = json_value_init_object();
+            pt_obj = json_value_get_object(pt_val);
+            sprint_interconnects(buf, points[p].interconnects);
+            json_object_set_number(pt_obj, "pes", points[p].pes);
+            json_object_set_number(pt_obj, "rows", points[p].rows);
+            json_object_set_number(pt_obj, "cols", points[p].cols);
+            json_object_set_number(pt_obj, "rf_size", points[p].rf_size);
+            json_object_set_number(pt_obj, "output_registers", points[p].n_output_registers);
+            json_object_set_string(pt_obj, "interconnects", buf);
+            json_object_set_number(pt_obj, "area", points[p].area);
+            json_object_set_number(pt_obj, "power", points[p].power);
+            ii_val = json_value_init_array();
+            for (i = 0; i < n_dfgs; i++)
+                json_array_append_number(json_value_get_array(ii_val), points[p].iis[i]);
+            json_object_set_value(pt_obj, "ii", ii_val);
+            json_object_set_number(pt_obj, "ii_sum", points[p].ii_sum);
+            json_object_set_number(pt_obj, "pe_util", points[p].util);
+            json_object_set_boolean(pt_obj, "mapped", points[p].mapped);
+            json_object_set_boolean(pt_obj, "pareto", points[p].pareto);
+            json_array_append_value(json_value_get_array(points_val), pt_val);
+        }
+        json_object_set_value(root_obj, "points", points_val);
+        i = json_serialize_to_file_pretty(root_val, filename) == JSONSuccess ? 0 : -1;
+        json_value_free(root_val);
+        return i;
+    }
+
+    FILE *f = fopen(filename, "w");
+    if (f == NULL)
+        return -1;
+    fprintf(f, "pes,rows,cols,rf_size,output_registers,interconnects,area,power");
+    for (i = 0; i < n_dfgs; i++)
+        fprintf(f, ",ii_dfg%d", i + 1);
+    fprintf(f, ",ii_sum,pe_util,mapped,pareto\n");
+    for (p = 0; p < n_points; p++)
+    {
+        sprint_interconnects(buf, points[p].interconnects);
+        fprintf(f, "%d,%d,%d,%d,%d,%s,%.2f,%.2f", points[p].pes, points[p].rows, points[p].cols, points[p].rf_size,
+                points[p].n_output_registers, buf, points[p].area, points[p].power);
+        for (i = 0; i < n_dfgs; i++)
+            fprintf(f, ",%d", points[p].iis[i]);
+        fprintf(f, ",%d,%.4f,%d,%d\n", points[p].ii_sum, points[p].util, points[p].mapped, points[p].pareto);
+    }
+    fclose(f);
+    return 0;
+}
+
+/**************************************************************************************
+ * paretoDSE
+ * Inputs: device template (NULL to generate an initial design point), target dfgs, constraints
+ * file and output file
+ * Explores homogeneous devices along four dimensions: the number of PEs (PARETO_PE_STEPS points,
+ * from the ideal device to the template), the RF size (half, as given and double), the number of
+ * output registers (1 and as given) and the interconnect set (as given, and with diagonals).
+ * Every dfg is mapped onto each device (memoized, see DSE Memoization), and all design points are
+ * written to the output file (JSON if it ends in .json, CSV otherwise) with their area, power and
+ * IIs. Points where all dfgs were mapped and no other point has lower or equal area, power and
+ * total II (one of them strictly lower) form the Pareto front.
+ * Return values: number of points on the Pareto front (-1 if the output could not be written)
+ *************************************************************************************/
+int paretoDSE(cgra *template, dfg **dfg_targets, int n_dfgs, dse_constraints *constraints, char *filename)
+{
+    PEParsedConfig config = constraints->config, pt_config;
+    int *iis = constraints->iis, *ii_constraints = (int *)malloc(n_dfgs * sizeof(int)), *res, *shape;
+    int pe_vals[PARETO_PE_STEPS], rf_vals[3], or_vals[2], n_pe_vals = 0, n_rf_vals = 0, n_or_vals = 0, n_ic_vals;
+    int a, b, c, e, i, k, lo, hi, rows, cols, n_points = 0, max_points, n_front = 0;
+    unsigned int io_seed;
+    float *utils = (float *)malloc(n_dfgs * sizeof(float));
+    char opt_target[] = "AREA", buf[MAX_INTERCONNECTS * 16];
+    uint64_t *seen;
+    dse_point *points;
+    cgra *dev;
+    double start = omp_get_wtime();
+
+    if (iis == NULL)
+    {
+        printf("\033[1;31mERROR: No valid constraints file (%s). Use import_constraints.\033[0;m\n", constraints->filename);
+        free(ii_constraints);
+        free(utils);
+        return -1;
+    }
+    for (i = 0; i < n_dfgs; i++)
+        ii_constraints[i] = (i < iis[0]) ? iis[i + 1] : __INT_MAX__;
+
+    // Number of PEs: from the ideal device for the dfgs to the template (or initial design point)
+    dev = buildIdealHmgCGRA(dfg_targets, n_dfgs, &res, opt_target, constraints);
+    if (dev == NULL)
+    {
+        printf("\033[1;31mERROR: Could not determine the ideal device for the DFGs.\033[0;m\n");
+        free(res);
+        free(ii_constraints);
+        free(utils);
+        return -1;
+    }
+    lo = get_n_pe(dev);
+    delete_cgra(dev);
+    if (template != NULL)
+        hi = get_n_pe(template);
+    else
+    {
+        dev = generateInitialDesignPoint(dfg_targets, n_dfgs, constraints);
+        hi = (dev != NULL) ? get_n_pe(dev) : lo;
+        delete_cgra(dev);
+    }
+    if (hi < lo)
+        hi = lo;
+    for (k = 0; k < PARETO_PE_STEPS; k++)
+        add_dse_value(pe_vals, &n_pe_vals, lo + (hi - lo) * k / (PARETO_PE_STEPS - 1));
+
+    add_dse_value(rf_vals, &n_rf_vals, config.rf_size / 2);
+    add_dse_value(rf_vals, &n_rf_vals, config.rf_size);
+    add_dse_value(rf_vals, &n_rf_vals, config.rf_size * 2);
+    add_dse_value(or_vals, &n_or_vals, 1);
+    add_dse_value(or_vals, &n_or_vals, config.n_output_registers);
+    n_ic_vals = config.interconnects[DIAGONAL] ? 1 : 2;
+
+    max_points = n_pe_vals * n_rf_vals * n_or_vals * n_ic_vals;
+    points = (dse_point *)calloc(max_points, sizeof(dse_point));
+    seen = (uint64_t *)malloc(max_points * sizeof(uint64_t));
+    printf("Exploring %d design points (%d PE counts, %d RF sizes, %d output register counts, %d interconnect sets) for %d DFGs.\n",
+           max_points, n_pe_vals, n_rf_vals, n_or_vals, n_ic_vals, n_dfgs);
+
+    for (a = 0; a < n_pe_vals; a++)
+    {
+        for (b = 0; b < n_rf_vals; b++)
+        {
+            for (c = 0; c < n_or_vals; c++)
+            {
+                for (e = 0; e < n_ic_vals; e++)
+                {
+                    pt_config = config;
+                    pt_config.rf_size = rf_vals[b];
+                    pt_config.n_output_registers = or_vals[c];
+                    if (e == 1)
+                        pt_config.interconnects[DIAGONAL] = 1;
+
+                    shape = find_square_like_shape(pe_vals[a], pe_vals[a], res[1] + res[2]);
+                    rows = shape[0];
+                    cols = shape[1];
+                    free(shape);
+                    dev = buildHmgCGRAFromConfig(rows, cols, constraints, pt_config, dfg_targets, n_dfgs);
+                    io_seed = DSE_IO_SEED;
+                    if (!config.has_io_specs)
+                        set_req_IOs(dev, res[1], res[2], &io_seed);
+
+                    // Different PE counts may yield the same device
+                    seen[n_points] = hash_device(dev);
+                    for (k = 0; k < n_points && seen[k] != seen[n_points]; k++)
+                        ;
+                    if (k < n_points)
+                    {
+                        delete_cgra(dev);
+                        continue;
+                    }
+
+                    dse_point *pt = &points[n_points++];
+                    pt->pes = get_n_pe(dev);
+                    pt->rows = rows;
+                    pt->cols = cols;
+                    pt->rf_size = pt_config.rf_size;
+                    pt->n_output_registers = pt_config.n_output_registers;
+                    memcpy(pt->interconnects, pt_config.interconnects, sizeof(pt->interconnects));
+                    pt->area = get_cgra_area_estimate(dev);
+                    pt->power = get_cgra_power_estimate(dev);
+                    pt->iis = (int *)malloc(n_dfgs * sizeof(int));
+                    printf("Design point #%d: %d PEs, RF size %d, %d output registers%s.\n", n_points, pt->pes, pt->rf_size,
+                           pt->n_output_registers, e == 1 ? ", with diagonal connections" : "");
+
+                    evaluateDUT(dev, dfg_targets, n_dfgs, ii_constraints, pt->iis, utils, NULL);
+                    pt->mapped = 1;
+                    for (i = 0; i < n_dfgs; i++)
+                    {
+                        pt->mapped = pt->mapped && pt->iis[i] > 0;
+                        pt->ii_sum += pt->iis[i];
+                        pt->util += utils[i] / n_dfgs;
+                    }
+                    delete_cgra(dev);
+                }
+            }
+        }
+    }
+
+    // Pareto front over (area, power, total II), among the points where every dfg was mapped
+    for (a = 0; a < n_points; a++)
+    {
+        if (!points[a].mapped)
+            continue;
+        for (b = 0; b < n_points; b++)
+        {
+            if (b == a || !points[b].mapped)
+                continue;
+            if (points[b].area <= points[a].area && points[b].power <= points[a].power && points[b].ii_sum <= points[a].ii_sum &&
+                (points[b].area < points[a].area || points[b].power < points[a].power || points[b].ii_sum < points[a].ii_sum))
+                break;
+        }
+        points[a].pareto = (b == n_points);
+        n_front += points[a].pareto;
+    }
+
+    printf("\033[1;33mPareto front (%d of %d design points):\033[0;0m\n", n_front, n_points);
+    for (a = 0; a < n_points; a++)
+    {
+        if (!points[a].pareto)
+            continue;
+        sprint_interconnects(buf, points[a].interconnects);
+        printf("\t%d PEs (%dx%d), RF size %d, %d output registers, %s: area %.2f, power %.2f, II sum %d\n", points[a].pes,
+               points[a].rows, points[a].cols, points[a].rf_size, points[a].n_output_registers, buf, points[a].area,
+               points[a].power, points[a].ii_sum);
+    }
+    printf("DSE memo: %d mapping results reused, %d computed.\n", dse_memo_hits, dse_memo_misses);
+
+    if (write_dse_points(filename, points, n_points, n_dfgs) < 0)
+    {
+        printf("\033[1;31mERROR: Could not write the design points to '%s'.\033[0;m\n", filename);
+        n_front = -1;
+    }
+    else
+        printf("Design points written to '%s'.\n", filename);
+    printf("execution time: %lf\n", omp_get_wtime() - start);
+
+    for (a = 0; a < n_points; a++)
+        free(points[a].iis);
+    free(points);
+    free(seen);
+    free(res);
+    free(ii_constraints);
+    free(utils);
+    return n_front;
+}
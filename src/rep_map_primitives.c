@@ -0,0 +1,357 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ops.h"
+#include "dfg.h"
+#include "cgra.h"
+
+/**************************************************************************************
+ * Replication Mapping Primitives
+ * Detection of repeated isomorphic subgraphs (e.g. unrolled loop bodies) and placement
+ * of a mapped copy of a subgraph onto other regions of the device, by translating its
+ * placement in space (row/column offset) and in time (context offset).
+ *************************************************************************************/
+
+static int findRoot(int *parent, int x)
+{
+    while (parent[x] != x)
+    {
+        parent[x] = parent[parent[x]];
+        x = parent[x];
+    }
+    return x;
+}
+
+/**
+ * Returns 1 (true) if the p-th node of A corresponds to the p-th node of B, for every p, with
+ * the same operation, latency, constants and edges (inputs and recurrences).
+ */
+static int isomorphicByOrder(dfg_instr **instrs, int *A, int *B, int n, int *pos)
+{
+    int p, k;
+    dfg_instr *a, *b;
+
+    for (p = 0; p < n; p++)
+    {
+        a = instrs[A[p] - 1];
+        b = instrs[B[p] - 1];
+        if (strcmp(get_instr_op(a), get_instr_op(b)) || get_instr_lat(a) != get_instr_lat(b) ||
+            get_n_inputs(a) != get_n_inputs(b) || get_n_outputs(a) != get_n_outputs(b) ||
+            get_n_recurrences(a) != get_n_recurrences(b) || get_n_consts(a) != get_n_consts(b))
+            return 0;
+        for (k = 0; k < get_n_inputs(a); k++)
+            if (pos[get_input_id(a, k) - 1] != pos[get_input_id(b, k) - 1])
+                return 0;
+        for (k = 0; k < get_n_recurrences(a); k++)
+        {
+            if ((get_recurrence(a, k) == NULL) != (get_recurrence(b, k) == NULL))
+                return 0;
+            if (get_recurrence(a, k) == NULL)
+                continue;
+            if (pos[get_instr_id(get_recurrence(a, k)) - 1] != pos[get_instr_id(get_recurrence(b, k)) - 1] ||
+                get_rec_dist(a, k) != get_rec_dist(b, k))
+                return 0;
+        }
+    }
+    return 1;
+}
+
+/**************************************************************************************
+ * findReplicatedSubgraphs
+ * Inputs: target dfg
+ * Splits the dfg into connected components and groups isomorphic components. Nodes are
+ * matched by their relative order within each component (unrolled bodies are generated
+ * in the same order) and every correspondence is verified edge by edge. The group that
+ * covers the largest number of nodes is returned: copies[c][p] is the id of the p-th
+ * node of copy c. The remaining components are left as glue logic.
+ * Return values: replicated subgraphs found ? 1 : 0
+ *************************************************************************************/
+int findReplicatedSubgraphs(dfg *d, int ***copies, int *n_copies, int *copy_size)
+{
+    int N = get_dfg_size(d), i, k, r, c, best = -1, best_cover = 0, n_comps = 0;
+    int *parent = (int *)malloc(N * sizeof(int)), *comp = (int *)malloc(N * sizeof(int));
+    int *pos = (int *)malloc(N * sizeof(int)), *size = (int *)calloc(N, sizeof(int));
+    int *cls = (int *)malloc(N * sizeof(int)), *count = (int *)calloc(N, sizeof(int));
+    int **members = (int **)calloc(N, sizeof(int *));
+    dfg_instr *t, **instrs = (dfg_instr **)malloc(N * sizeof(dfg_instr *));
+
+    for (i = 0; i < N; i++)
+    {
+        t = get_dfg_instr(d, i);
+        instrs[get_instr_id(t) - 1] = t;
+        parent[i] = i;
+    }
+
+    // Connected components (data edges and recurrences)
+    for (i = 0; i < N; i++)
+    {
+        for (k = 0; k < get_n_inputs(instrs[i]); k++)
+            parent[findRoot(parent, i)] = findRoot(parent, get_input_id(instrs[i], k) - 1);
+        for (k = 0; k < get_n_recurrences(instrs[i]); k++)
+            if (get_recurrence(instrs[i], k) != NULL)
+                parent[findRoot(parent, i)] = findRoot(parent, get_instr_id(get_recurrence(instrs[i], k)) - 1);
+    }
+
+    // Component members, in id order
+    for (i = 0; i < N; i++)
+        comp[i] = -1;
+    for (i = 0; i < N; i++)
+    {
+        r = findRoot(parent, i);
+        if (comp[r] < 0)
+        {
+            comp[r] = n_comps;
+            members[n_comps++] = (int *)malloc(N * sizeof(int));
+        }
+        c = comp[r];
+        pos[i] = size[c];
+        members[c][size[c]++] = i + 1;
+    }
+
+    // Group isomorphic components
+    for (c = 0; c < n_comps; c++)
+    {
+        cls[c] = c;
+        for (k = 0; k < c; k++)
+        {
+            if (cls[k] == k && size[k] == size[c] && isomorphicByOrder(instrs, members[k], members[c], size[c], pos))
+            {
+                cls[c] = k;
+                break;
+            }
+        }
+        count[cls[c]]++;
+    }
+
+    for (c = 0; c < n_comps; c++)
+    {
+        if (cls[c] == c && count[c] > 1 && count[c] * size[c] > best_cover)
+        {
+            best = c;
+            best_cover = count[c] * size[c];
+        }
+    }
+
+    if (best >= 0)
+    {
+        *n_copies = count[best];
+        *copy_size = size[best];
+        *copies = (int **)malloc(count[best] * sizeof(int *));
+        for (c = 0, k = 0; c < n_comps; c++)
+        {
+            if (cls[c] != best)
+                continue;
+            (*copies)[k] = (int *)malloc(size[c] * sizeof(int));
+            memcpy((*copies)[k++], members[c], size[c] * sizeof(int));
+        }
+    }
+
+    for (c = 0; c < n_comps; c++)
+        free(members[c]);
+    free(members);
+    free(parent);
+    free(comp);
+    free(pos);
+    free(size);
+    free(cls);
+    free(count);
+    free(instrs);
+
+    return best >= 0;
+}
+
+void deleteReplicatedSubgraphs(int **copies, int n_copies)
+{
+    int c;
+    for (c = 0; c < n_copies; c++)
+        free(copies[c]);
+    free(copies);
+}
+
+/**
+ * Places the target at (i, j) and routes it to its inputs. Undoes the placement if routing fails.
+ */
+static int placeAndRouteAt(cgra *fs, dfg *d, dfg_instr *target, int i, int j, int **placed, int *schedule, int II)
+{
+    if (i < 0 || j < 0 || i >= get_cgra_L(fs) || j >= get_cgra_C(fs))
+        return 0;
+    if (!checkStructHazard(getModuloSlice(fs, schedule[get_instr_id(target) - 1], II), target, i, j))
+        return 0;
+    if (!placeOp(fs, i, j, d, target, placed, schedule, II))
+        return 0;
+    if (routeOp(fs, target, placed, schedule, II))
+        return 1;
+    unmapOp(fs, d, target, placed, schedule, II);
+    return 0;
+}
+
+/**
+ * IO nodes cannot always be translated (stream ports sit on the borders): try the other stream
+ * ports, closest to the translated position first. The extra distance is covered by reading the
+ * stream earlier (inputs) or writing it later (outputs), by up to one cycle per hop.
+ */
+static int placeAndRouteIO(cgra *fs, dfg *d, dfg_instr *target, int i, int j, int **placed, int *schedule, int II)
+{
+    int L = get_cgra_L(fs), C = get_cgra_C(fs), k, s, dist, best, best_dist, id = get_instr_id(target) - 1;
+    int t = schedule[id], dir = !strcmp(get_instr_op(target), "STREAM_IN") ? -1 : 1;
+    int *tried = (int *)calloc(L * C, sizeof(int));
+
+    if (i >= 0 && j >= 0 && i < L && j < C)
+        tried[i * C + j] = 1;
+
+    while (1)
+    {
+        best = -1;
+        best_dist = INFINITY;
+        for (k = 0; k < L * C; k++)
+        {
+            if (tried[k] || !isStreamPort(fs, k / C, k % C))
+                continue;
+            dist = abs(k / C - i) + abs(k % C - j);
+            if (dist < best_dist)
+            {
+                best = k;
+                best_dist = dist;
+            }
+        }
+        if (best < 0)
+            break;
+        tried[best] = 1;
+        for (s = 0; s <= best_dist && t + dir * s >= 0; s++)
+        {
+            schedule[id] = t + dir * s;
+            if (placeAndRouteAt(fs, d, target, best / C, best % C, placed, schedule, II))
+            {
+                free(tried);
+                return 1;
+            }
+        }
+    }
+    schedule[id] = t;
+    free(tried);
+    return 0;
+}
+
+/**
+ * Returns 1 (true) if the IO nodes of the copy, at their final schedule, fit in the streaming
+ * bandwidth left in each context. Updates the counters.
+ */
+static int reserveStreams(cgra *fs, dfg_instr **copy, int n, int *schedule, int II, int *inCnt, int *outCnt)
+{
+    int p, q, fits = 1, *ins = (int *)calloc(II, sizeof(int)), *outs = (int *)calloc(II, sizeof(int));
+
+    for (p = 0; p < n; p++)
+    {
+        if (!strcmp(get_instr_op(copy[p]), "STREAM_IN"))
+            ins[schedule[get_instr_id(copy[p]) - 1] % II]++;
+        else if (!strcmp(get_instr_op(copy[p]), "STREAM_OUT"))
+            outs[schedule[get_instr_id(copy[p]) - 1] % II]++;
+    }
+    for (q = 0; q < II; q++)
+        if (inCnt[q] + ins[q] > get_cgra_ld_trghpt(fs) || outCnt[q] + outs[q] > get_cgra_st_trghpt(fs))
+            fits = 0;
+    for (q = 0; q < II && fits; q++)
+    {
+        inCnt[q] += ins[q];
+        outCnt[q] += outs[q];
+    }
+    free(ins);
+    free(outs);
+    return fits;
+}
+
+/**
+ * Tries to place one copy, translated by (di, dj) and delayed by dt cycles. Nodes are placed in
+ * the order of the reference schedule, so that inputs are always placed before their consumers.
+ */
+static int placeCopyAt(cgra *fs, dfg *d, dfg_instr **copy, int n, int *order, int *refPos, int *refSched,
+                       int **placed, int *schedule, int II, int *inCnt, int *outCnt, int di, int dj, int dt)
+{
+    int q, p, i, j, ok = 1, C = get_cgra_C(fs);
+
+    // Quick check: all translated compute nodes must land on capable PEs
+    for (p = 0; p < n; p++)
+    {
+        if (isIO(copy[p]))
+            continue;
+        i = refPos[p] / C + di;
+        j = refPos[p] % C + dj;
+        if (i < 0 || j < 0 || i >= get_cgra_L(fs) || j >= C ||
+            !checkStructHazard(getModuloSlice(fs, refSched[p] + dt, II), copy[p], i, j))
+            return 0;
+    }
+
+    for (q = 0; q < n && ok; q++)
+    {
+        p = order[q];
+        schedule[get_instr_id(copy[p]) - 1] = refSched[p] + dt;
+        i = refPos[p] / C + di;
+        j = refPos[p] % C + dj;
+
+        ok = placeAndRouteAt(fs, d, copy[p], i, j, placed, schedule, II);
+        if (!ok && isIO(copy[p]))
+            ok = placeAndRouteIO(fs, d, copy[p], i, j, placed, schedule, II);
+    }
+    if (ok && reserveStreams(fs, copy, n, schedule, II, inCnt, outCnt))
+        return 1;
+
+    // Undo the partial placement
+    if (!ok)
+        q--;
+    while (--q >= 0)
+        unmapOp(fs, d, copy[order[q]], placed, schedule, II);
+    return 0;
+}
+
+/**************************************************************************************
+ * placeReplica
+ * Inputs: mapped device, dfg, the nodes of the copy to place (ids), number of nodes, the
+ * position and schedule of each node in the reference copy, placement info array, schedule,
+ * II and the number of IO streams already used per context
+ * Places and routes a copy of an already mapped subgraph, reusing the reference placement:
+ * tries every context offset and every row/column offset, closest first. IO nodes that
+ * cannot be translated are moved to the closest free stream port. The streaming bandwidth
+ * of each context is respected.
+ * Return values: copy placed ? 1 : 0
+ *************************************************************************************/
+int placeReplica(cgra *fs, dfg *d, int *ids, int n, int *refPos, int *refSched, int **placed, int *schedule, int II,
+                 int *inCnt, int *outCnt)
+{
+    int L = get_cgra_L(fs), C = get_cgra_C(fs), p, q, tmp, dt, di, dj, dist, ok = 0;
+    int *order = (int *)malloc(n * sizeof(int));
+    dfg_instr **copy = (dfg_instr **)malloc(n * sizeof(dfg_instr *));
+
+    for (p = 0; p < n; p++)
+    {
+        copy[p] = get_instr_by_op_id(d, ids[p]);
+        order[p] = p;
+    }
+    // Order by reference schedule (insertion sort, stable)
+    for (p = 1; p < n; p++)
+    {
+        tmp = order[p];
+        for (q = p - 1; q >= 0 && refSched[order[q]] > refSched[tmp]; q--)
+            order[q + 1] = order[q];
+        order[q + 1] = tmp;
+    }
+
+    // Context offsets up to 2 * II: the second half leaves room to read relocated input streams earlier
+    for (dt = 0; dt < 2 * II && !ok; dt++)
+    {
+        // Row/column offsets, closest first
+        for (dist = 0; dist < L + C && !ok; dist++)
+        {
+            for (di = -dist; di <= dist && !ok; di++)
+            {
+                dj = dist - abs(di);
+                ok = placeCopyAt(fs, d, copy, n, order, refPos, refSched, placed, schedule, II, inCnt, outCnt, di, dj, dt);
+                if (!ok && dj != 0)
+                    ok = placeCopyAt(fs, d, copy, n, order, refPos, refSched, placed, schedule, II, inCnt, outCnt, di, -dj, dt);
+            }
+        }
+    }
+
+    free(order);
+    free(copy);
+    return ok;
+}
@@ -19,6 +19,48 @@ typedef struct _temp
     float alpha;
 } temperature;
 
+typedef struct _cost_delta
+{
+    int node;       // index of the node in the cost array
+    float old_cost; // cost before the move
+    float new_cost; // cost after the move
+    int old_routed; // routed flag before the move
+} cost_delta;
+
+typedef struct _move_deltas
+{
+    cost_delta *deltas; // one entry per node touched by the move
+    int n;              // number of entries in use
+    int *slot;          // entry of each node (-1 if untouched)
+    float base_total;   // total cost before the move
+    float delta;        // total cost difference caused by the move
+} move_deltas;
+
+/********************************************************
+ * Random Number Generation
+ * By default, the annealer draws from rand(). A thread
+ * can install its own generator state (e.g. one per
+ * mapping run, or one per parallel tempering replica),
+ * which is then used by every randomized primitive
+ * called from that thread. Returns the previous state,
+ * to be restored by the caller.
+ *******************************************************/
+static unsigned int *anneal_rng = NULL;
+#pragma omp threadprivate(anneal_rng)
+
+unsigned int *setAnnealingRNG(unsigned int *state)
+{
+    unsigned int *prev = anneal_rng;
+
+    anneal_rng = state;
+    return prev;
+}
+
+int annealRand(void)
+{
+    return anneal_rng != NULL ? rand_r(anneal_rng) : rand();
+}
+
 /********************************************************
  * Temperature / Cooling Function Primitives
  *******************************************************/
@@ -36,6 +78,11 @@ float getTemperature(temperature *t)
     return t->temp;
 }
 
+void setTemperature(temperature *t, float temp)
+{
+    t->temp = temp;
+}
+
 void deleteTemperature(temperature *t)
 {
     free(t);
@@ -65,11 +112,9 @@ void updateTemperature(temperature *t, int nAccepted, int nTotal)
  * Stop criteria
  * Return values: stop criteria met ? 1 : 0
  ******************************************************/
-int checkTemperatureStopCriteria(temperature *t, float *cost, int N)
+int checkTemperatureStopCriteria(temperature *t, float total_cost, int N)
 {
 
-    float total_cost = array_sum(cost, N);
-
     if (t->temp < 0.005 * total_cost / N)
         return 1;
     return 0;
@@ -79,16 +124,22 @@ int checkTemperatureStopCriteria(temperature *t, float *cost, int N)
  * Cost Function
  * c = a * delay + b * penalty?1:0
  * if failed to place: c = gamma (>>)
+ * The distance to each input is weighted by the
+ * criticality of the edge (the least critical of its
+ * ends, see computeCriticality): stretching an edge
+ * without slack costs up to (1 + CRIT_WEIGHT) times more
  ******************************************************/
 #define ALPHA 1
 #define BETA 10
 #define GAMMA 50
+#define CRIT_WEIGHT 1
 float computeCost(cgra *fs, dfg_instr *target, int **placed, int *schedule, int II, int penalty)
 {
 
     int k, iid, ii, ij, id = get_instr_id(target);
     int i_pos, j_pos;
-    int delay = 0;
+    float delay = 0, crit, edgeDelay;
+    dfg_instr *input;
 
     if (placed[id - 1][0] == 0)
         return GAMMA;
@@ -98,46 +149,148 @@ float computeCost(cgra *fs, dfg_instr *target, int **placed, int *schedule, int
 
     for (k = 0; k < get_n_inputs(target); k++)
     {
-        iid = get_instr_id(get_input(target, k));
+        input = get_input(target, k);
+        iid = get_instr_id(input);
 
         ii = placed[iid - 1][1] / get_cgra_C(fs);
         ij = placed[iid - 1][1] % get_cgra_C(fs);
 
-        delay = MAX(delay, abs(ii - i_pos) + abs(ij - j_pos));
+        crit = get_instr_criticality(input) < get_instr_criticality(target) ? get_instr_criticality(input) : get_instr_criticality(target);
+        edgeDelay = (1 + CRIT_WEIGHT * crit) * (abs(ii - i_pos) + abs(ij - j_pos));
+        delay = MAX(delay, edgeDelay);
     }
 
     return (float)(ALPHA * delay) + (float)(BETA * penalty);
 }
 
+/********************************************************
+ * Move Cost Deltas
+ * A move records the nodes whose cost it changes, as
+ * (node, old cost, new cost) entries, in a buffer that
+ * is allocated once per annealing run. The total cost
+ * is then updated incrementally, in O(touched nodes).
+ *******************************************************/
+
+move_deltas *createMoveDeltas(int N)
+{
+    move_deltas *md = (move_deltas *)malloc(sizeof(move_deltas));
+    md->deltas = (cost_delta *)malloc(N * sizeof(cost_delta));
+    md->slot = (int *)malloc(N * sizeof(int));
+    for (int i = 0; i < N; i++)
+        md->slot[i] = -1;
+    md->n = 0;
+    md->base_total = 0;
+    md->delta = 0;
+    return md;
+}
+
+void deleteMoveDeltas(move_deltas *md)
+{
+    free(md->deltas);
+    free(md->slot);
+    free(md);
+}
+
+/*******************************************************
+ * resetMoveDeltas
+ * Clears the entries of the previous move. Must be
+ * called before each move, with the current total cost.
+ ******************************************************/
+void resetMoveDeltas(move_deltas *md, float totalCost)
+{
+    for (int k = 0; k < md->n; k++)
+        md->slot[md->deltas[k].node] = -1;
+    md->n = 0;
+    md->base_total = totalCost;
+    md->delta = 0;
+}
+
+float getMoveDelta(move_deltas *md)
+{
+    return md->delta;
+}
+
+/*******************************************************
+ * recordCostDelta
+ * Sets the cost of a node after the move. The routed
+ * flag is updated in place; its old value is kept so
+ * that rejectMoveDeltas can restore it.
+ ******************************************************/
+static void recordCostDelta(move_deltas *md, float *cost, int *routed, int node, float newCost, int newRouted)
+{
+    int k = md->slot[node];
+
+    if (k < 0)
+    {
+        k = md->n++;
+        md->slot[node] = k;
+        md->deltas[k].node = node;
+        md->deltas[k].old_cost = cost[node];
+        md->deltas[k].new_cost = cost[node];
+        md->deltas[k].old_routed = routed[node];
+    }
+    md->delta += newCost - md->deltas[k].new_cost;
+    md->deltas[k].new_cost = newCost;
+    routed[node] = newRouted;
+}
+
+/*******************************************************
+ * forceMoveTotal
+ * Sets the cost of a node such that the total cost
+ * after the move equals 'total'. Used to make invalid
+ * moves (nearly) impossible to accept.
+ ******************************************************/
+static void forceMoveTotal(move_deltas *md, float *cost, int *routed, int node, float total)
+{
+    int k = md->slot[node];
+    float others = md->base_total + md->delta - (k < 0 ? cost[node] : md->deltas[k].new_cost);
+
+    recordCostDelta(md, cost, routed, node, total - others, routed[node]);
+}
+
 /******************************************************
  * updateCost
- * Warning: This function deletes the newCost array!
- * Do not use the aforementioned array after calling
- * this function!
+ * Commits an accepted move: applies its cost deltas to
+ * the cost array and the total cost, and updates the
+ * number of routed nodes, routed[N].
  *****************************************************/
-void updateCost(float *cost, float *newCost, int N)
+void updateCost(float *cost, float *totalCost, int *routed, int N, move_deltas *md)
 {
 
-    int i;
-    for (i = 0; i < N; i++)
-        cost[i] = newCost[i];
-    free(newCost);
+    int k, node;
+    for (k = 0; k < md->n; k++)
+    {
+        node = md->deltas[k].node;
+        cost[node] = md->deltas[k].new_cost;
+        routed[N] += routed[node] - md->deltas[k].old_routed;
+    }
+    *totalCost += md->delta;
+}
+
+/******************************************************
+ * rejectMoveDeltas
+ * Discards a rejected move: restores the routed flags
+ * of the nodes it touched.
+ *****************************************************/
+void rejectMoveDeltas(int *routed, move_deltas *md)
+{
+    for (int k = 0; k < md->n; k++)
+        routed[md->deltas[k].node] = md->deltas[k].old_routed;
 }
 
 /***************************************************************************************************************
  * evaluateMoveCost
- * Inputs: current temperature, t, current cost, the new cost caused by the move and the size of the cost arrays
+ * Inputs: current temperature, t, and the total cost difference caused by the move
  * Determines whether the move should be accepted or not, based on the cost difference and on the current
  * temperature.
  * Return values: accepted ? 1 : 0
  **************************************************************************************************************/
-int evaluateMoveCost(temperature *t, float *cost, float *newCost, int arr_size)
+int evaluateMoveCost(temperature *t, float delta)
 {
 
-    float totalCost = array_sum(cost, arr_size), newTotalCost = array_sum(newCost, arr_size), delta, P, r;
-    delta = newTotalCost - totalCost;
+    float P, r;
     P = exp(-delta / t->temp);
-    r = (float)rand() / RAND_MAX;
+    r = (float)annealRand() / RAND_MAX;
 
     // If the move results in a smaller cost or the temperature allows it, accept the move
     if (delta < 0 || r < P)
@@ -145,38 +298,73 @@ int evaluateMoveCost(temperature *t, float *cost, float *newCost, int arr_size)
     return 0;
 }
 
+/***************************************************************************************************************
+ * evaluateReplicaExchange
+ * Inputs: temperature and total cost of two replicas
+ * Replica exchange (parallel tempering) acceptance test: the states are swapped with probability
+ * min(1, exp((E_i - E_j) * (1/T_i - 1/T_j))).
+ * Return values: exchange accepted ? 1 : 0
+ **************************************************************************************************************/
+int evaluateReplicaExchange(temperature *ti, float costi, temperature *tj, float costj)
+{
+
+    float P, r;
+    if (ti->temp <= 0 || tj->temp <= 0)
+        return 0;
+    P = exp((costi - costj) * (1 / ti->temp - 1 / tj->temp));
+    r = (float)annealRand() / RAND_MAX;
+
+    if (P >= 1 || r < P)
+        return 1;
+    return 0;
+}
+
 int **getFreePositions(cgra *fs, dfg_instr *target, int **placed, int *schedule, int II);
 void deleteFreePosArr(int **fpos, cgra *fs);
+static void undoM1(cgra *fs, dfg *d, dfg_instr *target, int *oldPlacement, int **placed, int *schedule, int II,
+                   float *cost, float *totalCost, int *routed);
 
-float computeMoveCostStdDev(cgra *fs, dfg *d, dfg_instr **dfg_ops, int ***placed, int *schedule, int II, float *cost, int N)
+/***************************************************************************************************************
+ * computeMoveCostStdDev
+ * Samples one M1 move per node and returns the standard deviation of the resulting total costs. Each sampled
+ * move is rolled back on the device itself (the node is ripped up and re-placed at its previous position),
+ * instead of being applied to a copy of the device. Re-routing may not yield the exact same routes, so the
+ * costs and routed flags of the nodes touched by the rollback are refreshed.
+ **************************************************************************************************************/
+float computeMoveCostStdDev(cgra *fs, dfg *d, dfg_instr **dfg_ops, int ***placed, int *schedule, int II, float *cost, int *routed, int N)
 {
 
-    int i, currentPlacement;
-    float *costArr = (float *)malloc((N + 1) * sizeof(float)), *moveCost, stddev;
-    int *routed = (int *)calloc(N, sizeof(int));
+    int i, id, oldPlacement[4];
+    float *costArr = (float *)malloc((N + 1) * sizeof(float)), stddev, totalCost = array_sum(cost, N);
     int **fpos;
-    cgra *aux;
+    move_deltas *md = createMoveDeltas(N);
 
-    costArr[N] = array_sum(cost, N);
+    costArr[N] = totalCost;
     // Do N uncommited moves and compute the total cost's std deviation
     for (i = 0; i < N; i++)
     {
+        costArr[i] = totalCost;
         fpos = getFreePositions(fs, dfg_ops[i], *placed, schedule, II);
         if (fpos == NULL || fpos[0][0] == 0)
+        {
+            if (fpos != NULL)
+                deleteFreePosArr(fpos, fs);
             continue;
-        // God Bless
-        aux = copy_all_cgra_slices(fs);
-        currentPlacement = (*placed)[get_instr_id(dfg_ops[i]) - 1][1];
-        moveCost = m1(aux, d, dfg_ops, dfg_ops[i], fpos[1][0], fpos[1][1], *placed, schedule, II, cost, routed);
-        costArr[i] = array_sum(moveCost, N);
-        delete_cgra(aux);
+        }
+        id = get_instr_id(dfg_ops[i]);
+        copyArray(oldPlacement, (*placed)[id - 1], 4);
+
+        resetMoveDeltas(md, totalCost);
+        costArr[i] = totalCost + m1(fs, d, dfg_ops, dfg_ops[i], fpos[1][0], fpos[1][1], *placed, schedule, II, cost, routed, md);
         deleteFreePosArr(fpos, fs);
-        // Restore old node position
-        (*placed)[get_instr_id(dfg_ops[i]) - 1][1] = currentPlacement;
-        free(moveCost);
+
+        // Roll the move back
+        rejectMoveDeltas(routed, md);
+        undoM1(fs, d, dfg_ops[i], oldPlacement, *placed, schedule, II, cost, &totalCost, routed);
     }
     stddev = array_std_dev(costArr, N + 1);
-    free(routed);
+    checkValidMapping(routed, N);
+    deleteMoveDeltas(md);
     free(costArr);
 
     return stddev;
@@ -185,57 +373,47 @@ float computeMoveCostStdDev(cgra *fs, dfg *d, dfg_instr **dfg_ops, int ***placed
 int **generatePlacementMatrixNoBudget(cgra *fs, dfg_instr *target, int **placed, int *schedule, int II)
 {
 
-    int i, j, k, id = get_instr_id(target), iid, ii, jj, dist;
+    int i, j, k, p, n_pes, id = get_instr_id(target), iid, ii, jj, dist;
     cgra *c = getModuloSlice(fs, schedule[id - 1], II);
-    int **placementMatrix = (int **)malloc(get_cgra_L(c) * sizeof(int *));
-
-    for (i = 0; i < get_cgra_L(c); i++)
+    int L = get_cgra_L(c), C = get_cgra_C(c);
+    const int *pes = getOpCapablePEs(c, get_operation_index(get_instr_op(target)), &n_pes);
+
+    // Same layout as generatePlacementMatrix (single block, freed with deletePlacementMatrix)
+    int **placementMatrix = (int **)malloc(L * sizeof(int *) + L * C * sizeof(int));
+    int *tiles = (int *)(placementMatrix + L);
+    for (i = 0; i < L * C; i++)
+        tiles[i] = -1;
+    for (i = 0; i < L; i++)
+        placementMatrix[i] = tiles + i * C;
+
+    for (p = 0; p < n_pes; p++)
     {
-        placementMatrix[i] = (int *)malloc(get_cgra_C(c) * sizeof(int));
-        for (j = 0; j < get_cgra_C(c); j++)
-        {
-            placementMatrix[i][j] = checkStructHazard(c, target, i, j);
-            placementMatrix[i][j] *= !pe_occupied(c, i, j);
-        }
-    }
+        i = pes[p] / C;
+        j = pes[p] % C;
+        if (get_pe_power_mode(c, i, j) != POWER_ON || pe_occupied(c, i, j))
+            continue;
+        placementMatrix[i][j] = 1;
 
-    for (i = 0; i < get_cgra_L(c); i++)
-    {
-        for (j = 0; j < get_cgra_C(c); j++)
+        for (k = 0; k < get_n_inputs(target); k++)
         {
-            if (placementMatrix[i][j] == 0)
-            {
-                placementMatrix[i][j] = -1;
+            iid = get_instr_id(get_input(target, k));
+            if (placed[iid - 1][0] == 0)
                 continue;
-            }
+            ii = placed[iid - 1][1] / C;
+            jj = placed[iid - 1][1] % C;
 
-            for (k = 0; k < get_n_inputs(target); k++)
-            {
-                iid = get_instr_id(get_input(target, k));
-                if (placed[iid - 1][0] == 0)
-                    continue;
-                ii = placed[iid - 1][1] / get_cgra_C(c);
-                jj = placed[iid - 1][1] % get_cgra_C(c);
-
-                dist = abs(ii - i) + abs(jj - j);
-                if (placementMatrix[i][j] > -1)
-                    placementMatrix[i][j] = MAX(dist, placementMatrix[i][j]);
-                else
-                    placementMatrix[i][j] = -1;
-            }
-            for (k = 0; k < get_n_recurrences(target); k++)
-            {
-                iid = get_instr_id(get_recurrence(target, k));
-                if (placed[iid - 1][0] == 0)
-                    continue;
-                ii = placed[iid - 1][1] / get_cgra_C(c);
-                jj = placed[iid - 1][1] % get_cgra_C(c);
-                dist = abs(ii - i) + abs(jj - j);
-                if (placementMatrix[i][j] > -1)
-                    placementMatrix[i][j] = MAX(dist, placementMatrix[i][j]);
-                else
-                    placementMatrix[i][j] = -1;
-            }
+            dist = abs(ii - i) + abs(jj - j);
+            placementMatrix[i][j] = MAX(dist, placementMatrix[i][j]);
+        }
+        for (k = 0; k < get_n_recurrences(target); k++)
+        {
+            iid = get_instr_id(get_recurrence(target, k));
+            if (placed[iid - 1][0] == 0)
+                continue;
+            ii = placed[iid - 1][1] / C;
+            jj = placed[iid - 1][1] % C;
+            dist = abs(ii - i) + abs(jj - j);
+            placementMatrix[i][j] = MAX(dist, placementMatrix[i][j]);
         }
     }
     return placementMatrix;
@@ -292,7 +470,7 @@ float *generateInitialPlacement(cgra *fs, dfg *d, dfg_instr **dfg_ops, int **pla
             }
         }
 
-        rand_pos = rand() % n_pos;
+        rand_pos = annealRand() % n_pos;
         if (penalty == 1)
         {
             /* printf("placement matrix @ (%d, %d) is %d. Penalty!\n", candidate_positions[rand_pos][0], candidate_positions[rand_pos][1],
@@ -332,66 +510,68 @@ float *generateInitialPlacement(cgra *fs, dfg *d, dfg_instr **dfg_ops, int **pla
     return cost;
 }
 
-int **getFreePositions(cgra *fs, dfg_instr *target, int **placed, int *schedule, int II)
+/**
+ * Reusable (per-thread) list of the positions found by getFreePositions/getPlaceablePositions
+ */
+static int *pos_buf = NULL;
+static int pos_cap = 0;
+#pragma omp threadprivate(pos_buf, pos_cap)
+
+/**
+ * Returns the PEs of the target's slice that can hold the target (only the free ones, if free_only), in a
+ * random order, as a single-block array: fpos[0][0] is the number of positions, fpos[k] = {i, j}.
+ * Returns NULL if there are none.
+ */
+static int **getShuffledPositions(cgra *fs, dfg_instr *target, int *schedule, int II, int free_only)
 {
 
-    int i, j, r, sz = get_cgra_L(fs) * get_cgra_C(fs);
-    int num_positions = 0, **free_positions = (int **)calloc(sz + 1, sizeof(int *));
-    int **pos_list = (int **)calloc(sz, sizeof(int *));
+    int k, r, n_pes, C = get_cgra_C(fs), num_positions = 0, **free_positions, *rows;
     cgra *curr = getModuloSlice(fs, schedule[get_instr_id(target) - 1], II);
-    for (i = 0; i < sz + 1; i++)
+    const int *pes = getOpCapablePEs(curr, get_operation_index(get_instr_op(target)), &n_pes);
+
+    if (n_pes > pos_cap)
     {
-        if (i < sz)
-            pos_list[i] = (int *)calloc(2, sizeof(int));
-        free_positions[i] = (int *)calloc(2, sizeof(int));
+        pos_cap = n_pes;
+        pos_buf = (int *)realloc(pos_buf, pos_cap * sizeof(int));
     }
 
-    // Search for free PEs in the target slice
-    for (i = 0; i < get_cgra_L(fs); i++)
+    // Search for the PEs that support the target in the target slice
+    for (k = 0; k < n_pes; k++)
     {
-        for (j = 0; j < get_cgra_C(fs); j++)
-        {
-            if (pe_occupied(curr, i, j) || checkStructHazard(curr, target, i, j) == 0)
-                continue;
-
-            /* free_positions[f_pos][0] = i;
-            free_positions[f_pos++][1] = j; */
-            pos_list[num_positions][0] = i;
-            pos_list[num_positions++][1] = j;
-        }
+        if (get_pe_power_mode(curr, pes[k] / C, pes[k] % C) != POWER_ON || (free_only && pe_occupied(curr, pes[k] / C, pes[k] % C)))
+            continue;
+        pos_buf[num_positions++] = pes[k];
     }
 
-    // No free PEs to map to
+    // No PEs to map to
     if (num_positions <= 0)
-    {
-        for (i = 0; i < sz + 1; i++)
-            free(free_positions[i]);
-        free(free_positions);
-        for (i = 0; i < sz; i++)
-            free(pos_list[i]);
-        free(pos_list);
         return NULL;
-    }
+
+    free_positions = (int **)malloc((num_positions + 1) * (sizeof(int *) + 2 * sizeof(int)));
+    rows = (int *)(free_positions + num_positions + 1);
+    for (k = 0; k < num_positions + 1; k++)
+        free_positions[k] = rows + 2 * k;
 
     free_positions[0][0] = num_positions;
-    // Sort the free positions randomly
-    for (i = 0; i < num_positions; i++)
+    free_positions[0][1] = 0;
+    // Sort the positions randomly
+    for (k = 0; k < num_positions; k++)
     {
-        r = rand() % (num_positions - i);
-        free_positions[i + 1][0] = pos_list[r][0];
-        free_positions[i + 1][1] = pos_list[r][1];
+        r = annealRand() % (num_positions - k);
+        free_positions[k + 1][0] = pos_buf[r] / C;
+        free_positions[k + 1][1] = pos_buf[r] % C;
         // remove chosen position
-        pos_list[r][0] = pos_list[num_positions - 1 - i][0];
-        pos_list[r][1] = pos_list[num_positions - 1 - i][1];
+        pos_buf[r] = pos_buf[num_positions - 1 - k];
     }
 
-    for (i = 0; i < sz; i++)
-        free(pos_list[i]);
-    free(pos_list);
-
     return free_positions;
 }
 
+int **getFreePositions(cgra *fs, dfg_instr *target, int **placed, int *schedule, int II)
+{
+    return getShuffledPositions(fs, target, schedule, II, 1);
+}
+
 /**
  * Generates an array with all legal positions for the target to be placed on.
  * Effectively corresponds to all free placeable positions (getFreePositions) + the valid positions that are occupied
@@ -399,68 +579,11 @@ int **getFreePositions(cgra *fs, dfg_instr *target, int **placed, int *schedule,
  */
 int **getPlaceablePositions(cgra *fs, dfg_instr *target, int **placed, int *schedule, int II)
 {
-
-    int i, j, r, sz = get_cgra_L(fs) * get_cgra_C(fs);
-    int num_positions = 0, **free_positions = (int **)calloc(sz + 1, sizeof(int *));
-    int **pos_list = (int **)calloc(sz, sizeof(int *));
-    cgra *curr = getModuloSlice(fs, schedule[get_instr_id(target) - 1], II);
-    for (i = 0; i < sz + 1; i++)
-    {
-        if (i < sz)
-            pos_list[i] = (int *)calloc(2, sizeof(int));
-        free_positions[i] = (int *)calloc(2, sizeof(int));
-    }
-
-    // Search for free PEs in the target slice
-    for (i = 0; i < get_cgra_L(fs); i++)
-    {
-        for (j = 0; j < get_cgra_C(fs); j++)
-        {
-            if (checkStructHazard(curr, target, i, j) == 0)
-                continue;
-
-            /* free_positions[f_pos][0] = i;
-            free_positions[f_pos++][1] = j; */
-            pos_list[num_positions][0] = i;
-            pos_list[num_positions++][1] = j;
-        }
-    }
-
-    // No free PEs to map to
-    if (num_positions <= 0)
-    {
-        for (i = 0; i < sz + 1; i++)
-            free(free_positions[i]);
-        free(free_positions);
-        for (i = 0; i < sz; i++)
-            free(pos_list[i]);
-        free(pos_list);
-        return NULL;
-    }
-
-    free_positions[0][0] = num_positions;
-    // Sort the free positions randomly
-    for (i = 0; i < num_positions; i++)
-    {
-        r = rand() % (num_positions - i);
-        free_positions[i + 1][0] = pos_list[r][0];
-        free_positions[i + 1][1] = pos_list[r][1];
-        // remove chosen position
-        pos_list[r][0] = pos_list[num_positions - 1 - i][0];
-        pos_list[r][1] = pos_list[num_positions - 1 - i][1];
-    }
-
-    for (i = 0; i < sz; i++)
-        free(pos_list[i]);
-    free(pos_list);
-
-    return free_positions;
+    return getShuffledPositions(fs, target, schedule, II, 0);
 }
 
 void deleteFreePosArr(int **fpos, cgra *fs)
 {
-    for (int i = 0; i < get_cgra_L(fs) * get_cgra_C(fs) + 1; i++)
-        free(fpos[i]);
     free(fpos);
 }
 
@@ -485,18 +608,15 @@ void ripUpOp(cgra *fs, dfg *d, dfg_instr *target, int **placed, int *schedule, i
  * recommended to store a copy of the device before
  * calling this function.
  *************************************************/
-float *m1(cgra *fs, dfg *d, dfg_instr **dfg_ops, dfg_instr *target, int i_pos, int j_pos, int **placed, int *schedule, int II, float *cost, int *routed)
+float m1(cgra *fs, dfg *d, dfg_instr **dfg_ops, dfg_instr *target, int i_pos, int j_pos, int **placed, int *schedule, int II, float *cost,
+         int *routed, move_deltas *md)
 {
 
-    int i, o, id = get_instr_id(target), oid, p, N = get_node_sublist_size(dfg_ops), n_outputs = get_n_outputs(target), status, penalty = 0;
+    int o, id = get_instr_id(target), oid, p, n_outputs = get_n_outputs(target), status, penalty = 0;
     dfg_instr *output;
-    float *newCost = (float *)malloc(N * sizeof(float));
 
     int auxSch = schedule[id - 1];
 
-    for (i = 0; i < N; i++)
-        newCost[i] = cost[i];
-
     // Unmap the target and remove its outputs' routes
     schedule[id - 1] = placed[id - 1][2];
     ripUpOp(fs, d, target, placed, schedule, II);
@@ -523,8 +643,7 @@ float *m1(cgra *fs, dfg *d, dfg_instr **dfg_ops, dfg_instr *target, int i_pos, i
     }
 
     // update the cost for the target
-    newCost[get_instr_id(target) - 1] = computeCost(fs, target, placed, schedule, II, penalty);
-    routed[get_instr_id(target) - 1] = !penalty;
+    recordCostDelta(md, cost, routed, id - 1, computeCost(fs, target, placed, schedule, II, penalty), !penalty);
 
     // Only if the node was successfully placed
     if (p == 0)
@@ -548,17 +667,63 @@ float *m1(cgra *fs, dfg *d, dfg_instr **dfg_ops, dfg_instr *target, int i_pos, i
             {
                 penalty = 1;
             }
-            newCost[oid - 1] = computeCost(fs, output, placed, schedule, II, penalty);
-            routed[oid - 1] = !penalty;
+            recordCostDelta(md, cost, routed, oid - 1, computeCost(fs, output, placed, schedule, II, penalty), !penalty);
         }
     }
     // Should be nearly impossible to accept this move
     else
     {
-        newCost[get_instr_id(target) - 1] = INFINITY - array_sum(newCost, N) - 1;
+        forceMoveTotal(md, cost, routed, id - 1, INFINITY - 1);
+    }
+
+    return getMoveDelta(md);
+}
+
+/**************************************************
+ * undoM1
+ * Rolls back an M1 move of the target: rips it up
+ * from its new position and re-places and re-routes
+ * it (and its outputs) at its old position. The
+ * resulting costs are written to the cost array.
+ *************************************************/
+static void undoM1(cgra *fs, dfg *d, dfg_instr *target, int *oldPlacement, int **placed, int *schedule, int II,
+                   float *cost, float *totalCost, int *routed)
+{
+
+    int o, id = get_instr_id(target), oid, auxSch = schedule[id - 1], status = 0;
+    float newCost;
+    dfg_instr *output;
+
+    if (placed[id - 1][0] == 1)
+    {
+        schedule[id - 1] = placed[id - 1][2];
+        ripUpOp(fs, d, target, placed, schedule, II);
+        schedule[id - 1] = oldPlacement[2];
     }
 
-    return newCost;
+    if (oldPlacement[0] == 1 && placeOp(fs, oldPlacement[1] / get_cgra_C(fs), oldPlacement[1] % get_cgra_C(fs), d, target, placed, schedule, II))
+        status = routeOp(fs, target, placed, schedule, II);
+    schedule[id - 1] = auxSch;
+
+    newCost = computeCost(fs, target, placed, schedule, II, !status);
+    *totalCost += newCost - cost[id - 1];
+    cost[id - 1] = newCost;
+    routed[id - 1] = status;
+
+    if (placed[id - 1][0] == 0)
+        return;
+    for (o = 0; o < get_n_outputs(target); o++)
+    {
+        output = get_output(target, o);
+        oid = get_instr_id(output);
+        if (placed[oid - 1][0] == 0)
+            continue;
+        status = routeOp(fs, output, placed, schedule, II);
+        newCost = computeCost(fs, output, placed, schedule, II, !status);
+        *totalCost += newCost - cost[oid - 1];
+        cost[oid - 1] = newCost;
+        routed[oid - 1] = status;
+    }
 }
 
 /**************************************************
@@ -568,12 +733,11 @@ float *m1(cgra *fs, dfg *d, dfg_instr **dfg_ops, dfg_instr *target, int i_pos, i
  * recommended to store a copy of the device before
  * calling this function.
  *************************************************/
-float *m2(cgra *fs, dfg *d, dfg_instr **dfg_ops, dfg_instr *target1, int i_pos1, int j_pos1,
-          dfg_instr *target2, int i_pos2, int j_pos2, int **placed, int *schedule, int II, float *cost, int *routed)
+float m2(cgra *fs, dfg *d, dfg_instr **dfg_ops, dfg_instr *target1, int i_pos1, int j_pos1,
+         dfg_instr *target2, int i_pos2, int j_pos2, int **placed, int *schedule, int II, float *cost, int *routed, move_deltas *md)
 {
     int id1 = get_instr_id(target1), id2 = get_instr_id(target2);
     int s1 = schedule[id1 - 1], s2 = schedule[id2 - 1];
-    float *newCost1, *newCost2;
     // Rip Up both operations and swap them
     schedule[id1 - 1] = placed[id1 - 1][2];
     schedule[id2 - 1] = placed[id2 - 1][2];
@@ -583,29 +747,24 @@ float *m2(cgra *fs, dfg *d, dfg_instr **dfg_ops, dfg_instr *target1, int i_pos1,
     schedule[id2 - 1] = s2;
 
     // First place target 1
-    newCost1 = m1(fs, d, dfg_ops, target1, i_pos1, j_pos1, placed, schedule, II, cost, routed);
-    // Next, place target 2
-    newCost2 = m1(fs, d, dfg_ops, target2, i_pos2, j_pos2, placed, schedule, II, newCost1, routed);
-
-    free(newCost1);
-    return newCost2;
+    m1(fs, d, dfg_ops, target1, i_pos1, j_pos1, placed, schedule, II, cost, routed, md);
+    // Next, place target 2 (its deltas accumulate on top of target 1's)
+    return m1(fs, d, dfg_ops, target2, i_pos2, j_pos2, placed, schedule, II, cost, routed, md);
 }
 
-float *anneal_swap(cgra *fs, dfg *d, dfg_instr **dfg_ops, dfg_instr *target, int i_pos, int j_pos,
-                   int **placed, int *schedule, int II, float *cost, int *routed, int* swapped)
+float anneal_swap(cgra *fs, dfg *d, dfg_instr **dfg_ops, dfg_instr *target, int i_pos, int j_pos,
+                  int **placed, int *schedule, int II, float *cost, int *routed, int* swapped, move_deltas *md)
 {
-    int N = get_node_sublist_size(dfg_ops), i_pos2, j_pos2, id = get_instr_id(target);
+    int i_pos2, j_pos2, id = get_instr_id(target);
     cgra *curr = getModuloSlice(fs, schedule[get_instr_id(target) - 1], II);
     dfg_instr *target2;
-    float *newCost = NULL;
 
     // NULL or unplaceable tile due to structural hazard
     if (checkStructHazard(curr, target, i_pos, j_pos) == 0)
     {
         // Return a total cost of infinity
-        newCost = (float *)calloc(N, sizeof(float));
-        newCost[0] = INFINITY;
-        return newCost;
+        forceMoveTotal(md, cost, routed, id - 1, INFINITY);
+        return getMoveDelta(md);
     }
 
     // If the selected tile is already in use by another op, swap both tiles (M2)
@@ -629,11 +788,9 @@ float *anneal_swap(cgra *fs, dfg *d, dfg_instr **dfg_ops, dfg_instr *target, int
             j_pos2 = fpos[1][1];
             deleteFreePosArr(fpos, fs);
         }
-        newCost = m2(fs, d, dfg_ops, target, i_pos, j_pos, target2, i_pos2, j_pos2, placed, schedule, II, cost, routed);
-        return newCost;
+        return m2(fs, d, dfg_ops, target, i_pos, j_pos, target2, i_pos2, j_pos2, placed, schedule, II, cost, routed, md);
     }
 
     // Tile is free, move the op there (M1)
-    newCost = m1(fs, d, dfg_ops, target, i_pos, j_pos, placed, schedule, II, cost, routed);
-    return newCost;
+    return m1(fs, d, dfg_ops, target, i_pos, j_pos, placed, schedule, II, cost, routed, md);
 }
\ No newline at end of file
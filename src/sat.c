@@ -0,0 +1,623 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sat.h"
+#include "budget.h"
+
+#define VAL_FALSE 0
+#define VAL_TRUE 1
+#define VAL_UNDEF 2
+
+#define CLAUSE_LEARNT 1
+#define CLAUSE_DELETED 2
+
+#define VAR_DECAY 0.95
+#define RESTART_BASE 100  // conflicts of the first restart interval (scaled by the Luby sequence)
+#define BUDGET_POLL 256   // conflicts between two mapping budget checks
+
+typedef struct
+{
+    int *data;
+    int size, cap;
+} ivec;
+
+/**
+ * Clauses live in an int arena: [size, flags, lit_0, ..., lit_size-1], referenced by their offset.
+ * Literals are internally encoded as 2 * var + sign (var from 0, sign 1 = negated). The first two
+ * literals of a clause are the watched ones; the literal implied by a reason clause is lit_0.
+ */
+struct _sat_solver
+{
+    int nvars, cap_vars, ok;
+    int *arena, arena_size, arena_cap, n_clauses;
+    ivec *watches, learnts, trail_lim, learnt, toclear;
+    signed char *assigns, *polarity, *model, *seen;
+    int *level, *reason, *trail, trail_size, qhead;
+    double *activity, var_inc;
+    int *heap, *heap_pos, heap_size;
+    long conflicts;
+    int max_learnts;
+};
+
+typedef struct
+{
+    int size, cr;
+} learnt_ref;
+
+static void ivecPush(ivec *v, int x)
+{
+    if (v->size == v->cap)
+    {
+        v->cap = v->cap ? 2 * v->cap : 4;
+        v->data = (int *)realloc(v->data, v->cap * sizeof(int));
+    }
+    v->data[v->size++] = x;
+}
+
+static int litValue(sat_solver *s, int lit)
+{
+    int a = s->assigns[lit >> 1];
+    return a == VAL_UNDEF ? VAL_UNDEF : a ^ (lit & 1);
+}
+
+static int decisionLevel(sat_solver *s)
+{
+    return s->trail_lim.size;
+}
+
+/*************************************************************************************
+ * Variable order heap (max-heap on the VSIDS activity)
+ ************************************************************************************/
+static void heapSwap(sat_solver *s, int a, int b)
+{
+    int v = s->heap[a];
+
+    s->heap[a] = s->heap[b];
+    s->heap[b] = v;
+    s->heap_pos[s->heap[a]] = a;
+    s->heap_pos[s->heap[b]] = b;
+}
+
+static void heapUp(sat_solver *s, int i)
+{
+    while (i > 0 && s->activity[s->heap[(i - 1) / 2]] < s->activity[s->heap[i]])
+    {
+        heapSwap(s, i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+}
+
+static void heapDown(sat_solver *s, int i)
+{
+    int c;
+
+    while ((c = 2 * i + 1) < s->heap_size)
+    {
+        if (c + 1 < s->heap_size && s->activity[s->heap[c + 1]] > s->activity[s->heap[c]])
+            c++;
+        if (s->activity[s->heap[c]] <= s->activity[s->heap[i]])
+            break;
+        heapSwap(s, i, c);
+        i = c;
+    }
+}
+
+static void heapInsert(sat_solver *s, int v)
+{
+    if (s->heap_pos[v] >= 0)
+        return;
+    s->heap[s->heap_size] = v;
+    s->heap_pos[v] = s->heap_size++;
+    heapUp(s, s->heap_pos[v]);
+}
+
+static int heapRemoveMax(sat_solver *s)
+{
+    int v = s->heap[0];
+
+    heapSwap(s, 0, --s->heap_size);
+    s->heap_pos[v] = -1;
+    if (s->heap_size > 0)
+        heapDown(s, 0);
+    return v;
+}
+
+static void bumpVar(sat_solver *s, int v)
+{
+    int k;
+
+    if ((s->activity[v] += s->var_inc) > 1e100)
+    {
+        for (k = 0; k < s->nvars; k++)
+            s->activity[k] *= 1e-100;
+        s->var_inc *= 1e-100;
+    }
+    if (s->heap_pos[v] >= 0)
+        heapUp(s, s->heap_pos[v]);
+}
+
+/*************************************************************************************
+ * Clauses, assignments and propagation
+ ************************************************************************************/
+static int newClause(sat_solver *s, const int *lits, int n, int learnt)
+{
+    int cr = s->arena_size;
+
+    if (s->arena_size + n + 2 > s->arena_cap)
+    {
+        while (s->arena_size + n + 2 > s->arena_cap)
+            s->arena_cap = s->arena_cap ? 2 * s->arena_cap : 1024;
+        s->arena = (int *)realloc(s->arena, s->arena_cap * sizeof(int));
+    }
+    s->arena[cr] = n;
+    s->arena[cr + 1] = learnt ? CLAUSE_LEARNT : 0;
+    memcpy(&s->arena[cr + 2], lits, n * sizeof(int));
+    s->arena_size += n + 2;
+
+    ivecPush(&s->watches[lits[0]], cr);
+    ivecPush(&s->watches[lits[1]], cr);
+    return cr;
+}
+
+static void enqueue(sat_solver *s, int lit, int reason)
+{
+    int v = lit >> 1;
+
+    s->assigns[v] = !(lit & 1);
+    s->level[v] = decisionLevel(s);
+    s->reason[v] = reason;
+    s->trail[s->trail_size++] = lit;
+}
+
+static void cancelUntil(sat_solver *s, int lvl)
+{
+    int c, v;
+
+    if (decisionLevel(s) <= lvl)
+        return;
+    for (c = s->trail_size - 1; c >= s->trail_lim.data[lvl]; c--)
+    {
+        v = s->trail[c] >> 1;
+        s->polarity[v] = s->assigns[v]; // phase saving
+        s->assigns[v] = VAL_UNDEF;
+        s->reason[v] = -1;
+        heapInsert(s, v);
+    }
+    s->trail_size = s->qhead = s->trail_lim.data[lvl];
+    s->trail_lim.size = lvl;
+}
+
+/**
+ * Unit propagation with two watched literals. Clauses deleted by reduceDB are dropped from the
+ * watch lists as they are found.
+ * Return values: conflicting clause, or -1 if there is no conflict
+ */
+static int propagate(sat_solver *s)
+{
+    int p, falseLit, cr, i, j, k, n, tmp, *lits;
+    ivec *ws;
+
+    while (s->qhead < s->trail_size)
+    {
+        p = s->trail[s->qhead++];
+        falseLit = p ^ 1;
+        ws = &s->watches[falseLit];
+        for (i = j = 0; i < ws->size;)
+        {
+            cr = ws->data[i++];
+            if (s->arena[cr + 1] & CLAUSE_DELETED)
+                continue;
+            n = s->arena[cr];
+            lits = &s->arena[cr + 2];
+            // Make sure the false literal is lits[1]
+            if (lits[0] == falseLit)
+            {
+                lits[0] = lits[1];
+                lits[1] = falseLit;
+            }
+            if (litValue(s, lits[0]) == VAL_TRUE)
+            {
+                ws->data[j++] = cr;
+                continue;
+            }
+            // Look for a new literal to watch
+            for (k = 2; k < n; k++)
+            {
+                if (litValue(s, lits[k]) != VAL_FALSE)
+                {
+                    tmp = lits[1];
+                    lits[1] = lits[k];
+                    lits[k] = tmp;
+                    ivecPush(&s->watches[lits[1]], cr);
+                    break;
+                }
+            }
+            if (k < n)
+                continue;
+
+            // Unit or conflicting clause
+            ws->data[j++] = cr;
+            if (litValue(s, lits[0]) == VAL_FALSE)
+            {
+                while (i < ws->size)
+                    ws->data[j++] = ws->data[i++];
+                ws->size = j;
+                s->qhead = s->trail_size;
+                return cr;
+            }
+            enqueue(s, lits[0], cr);
+        }
+        ws->size = j;
+    }
+    return -1;
+}
+
+/**
+ * First-UIP conflict analysis. The learnt clause (asserting literal first, then the literal of
+ * the backjump level) is left in s->learnt.
+ * Return values: backjump level
+ */
+static int analyze(sat_solver *s, int confl)
+{
+    int pathC = 0, p = -1, idx = s->trail_size - 1, cr = confl, i, k, v, n, keep, *lits, btlevel = 0;
+
+    s->learnt.size = 0;
+    ivecPush(&s->learnt, -1);
+    do
+    {
+        n = s->arena[cr];
+        lits = &s->arena[cr + 2];
+        for (i = (p == -1) ? 0 : 1; i < n; i++)
+        {
+            v = lits[i] >> 1;
+            if (!s->seen[v] && s->level[v] > 0)
+            {
+                bumpVar(s, v);
+                s->seen[v] = 1;
+                if (s->level[v] >= decisionLevel(s))
+                    pathC++;
+                else
+                    ivecPush(&s->learnt, lits[i]);
+            }
+        }
+        // Next literal of the current level to expand
+        while (!s->seen[s->trail[idx] >> 1])
+            idx--;
+        p = s->trail[idx--];
+        cr = s->reason[p >> 1];
+        s->seen[p >> 1] = 0;
+        pathC--;
+    } while (pathC > 0);
+    s->learnt.data[0] = p ^ 1;
+
+    // Clause minimization: drop literals implied by the other literals of the clause
+    s->toclear.size = 0;
+    for (i = 1; i < s->learnt.size; i++)
+        ivecPush(&s->toclear, s->learnt.data[i]);
+    for (i = k = 1; i < s->learnt.size; i++)
+    {
+        v = s->learnt.data[i] >> 1;
+        keep = s->reason[v] == -1;
+        if (!keep)
+        {
+            n = s->arena[s->reason[v]];
+            lits = &s->arena[s->reason[v] + 2];
+            for (int j = 1; j < n && !keep; j++)
+                keep = !s->seen[lits[j] >> 1] && s->level[lits[j] >> 1] > 0;
+        }
+        if (keep)
+            s->learnt.data[k++] = s->learnt.data[i];
+    }
+    s->learnt.size = k;
+    for (i = 0; i < s->toclear.size; i++)
+        s->seen[s->toclear.data[i] >> 1] = 0;
+
+    // Move the literal with the highest level (the backjump level) to the second position
+    if (s->learnt.size > 1)
+    {
+        for (i = 2, k = 1; i < s->learnt.size; i++)
+            if (s->level[s->learnt.data[i] >> 1] > s->level[s->learnt.data[k] >> 1])
+                k = i;
+        p = s->learnt.data[k];
+        s->learnt.data[k] = s->learnt.data[1];
+        s->learnt.data[1] = p;
+        btlevel = s->level[p >> 1];
+    }
+    return btlevel;
+}
+
+static int compareLearnts(const void *a, const void *b)
+{
+    return ((const learnt_ref *)b)->size - ((const learnt_ref *)a)->size;
+}
+
+/**
+ * Deletes the longest half of the learnt clauses (binary clauses and current reasons are kept)
+ */
+static void reduceDB(sat_solver *s)
+{
+    int i, n = s->learnts.size, cr, lit0;
+    learnt_ref *refs = (learnt_ref *)malloc(n * sizeof(learnt_ref));
+
+    for (i = 0; i < n; i++)
+    {
+        refs[i].cr = s->learnts.data[i];
+        refs[i].size = s->arena[refs[i].cr];
+    }
+    qsort(refs, n, sizeof(learnt_ref), compareLearnts);
+
+    s->learnts.size = 0;
+    for (i = 0; i < n; i++)
+    {
+        cr = refs[i].cr;
+        lit0 = s->arena[cr + 2];
+        if (i < n / 2 && refs[i].size > 2 && !(litValue(s, lit0) == VAL_TRUE && s->reason[lit0 >> 1] == cr))
+            s->arena[cr + 1] |= CLAUSE_DELETED;
+        else
+            ivecPush(&s->learnts, cr);
+    }
+    free(refs);
+}
+
+// Luby restart sequence: 1, 1, 2, 1, 1, 2, 4, ...
+static long luby(int x)
+{
+    int size, seq;
+
+    for (size = 1, seq = 0; size < x + 1; seq++, size = 2 * size + 1)
+        ;
+    while (size - 1 != x)
+    {
+        size = (size - 1) >> 1;
+        seq--;
+        x = x % size;
+    }
+    return 1L << seq;
+}
+
+/*************************************************************************************
+ * Interface
+ ************************************************************************************/
+sat_solver *createSATSolver(void)
+{
+    sat_solver *s = (sat_solver *)calloc(1, sizeof(sat_solver));
+
+    s->ok = 1;
+    s->var_inc = 1;
+    return s;
+}
+
+void deleteSATSolver(sat_solver *s)
+{
+    int k;
+
+    if (s == NULL)
+        return;
+    for (k = 0; k < 2 * s->cap_vars; k++)
+        free(s->watches[k].data);
+    free(s->watches);
+    free(s->learnts.data);
+    free(s->trail_lim.data);
+    free(s->learnt.data);
+    free(s->toclear.data);
+    free(s->arena);
+    free(s->assigns);
+    free(s->polarity);
+    free(s->model);
+    free(s->seen);
+    free(s->level);
+    free(s->reason);
+    free(s->trail);
+    free(s->activity);
+    free(s->heap);
+    free(s->heap_pos);
+    free(s);
+}
+
+/**************************************************************************************
+ * satNewVar
+ * Creates a new variable (unassigned, with a false default phase)
+ * Return values: variable number (DIMACS, from 1)
+ *************************************************************************************/
+int satNewVar(sat_solver *s)
+{
+    int v = s->nvars++;
+
+    if (s->nvars > s->cap_vars)
+    {
+        int old = s->cap_vars;
+        s->cap_vars = s->cap_vars ? 2 * s->cap_vars : 64;
+        s->watches = (ivec *)realloc(s->watches, 2 * s->cap_vars * sizeof(ivec));
+        memset(&s->watches[2 * old], 0, 2 * (s->cap_vars - old) * sizeof(ivec));
+        s->assigns = (signed char *)realloc(s->assigns, s->cap_vars);
+        s->polarity = (signed char *)realloc(s->polarity, s->cap_vars);
+        s->model = (signed char *)realloc(s->model, s->cap_vars);
+        s->seen = (signed char *)realloc(s->seen, s->cap_vars);
+        s->level = (int *)realloc(s->level, s->cap_vars * sizeof(int));
+        s->reason = (int *)realloc(s->reason, s->cap_vars * sizeof(int));
+        s->trail = (int *)realloc(s->trail, s->cap_vars * sizeof(int));
+        s->activity = (double *)realloc(s->activity, s->cap_vars * sizeof(double));
+        s->heap = (int *)realloc(s->heap, s->cap_vars * sizeof(int));
+        s->heap_pos = (int *)realloc(s->heap_pos, s->cap_vars * sizeof(int));
+    }
+    s->assigns[v] = VAL_UNDEF;
+    s->polarity[v] = VAL_FALSE;
+    s->model[v] = VAL_UNDEF;
+    s->seen[v] = 0;
+    s->level[v] = 0;
+    s->reason[v] = -1;
+    s->activity[v] = 0;
+    s->heap_pos[v] = -1;
+    heapInsert(s, v);
+
+    return v + 1;
+}
+
+int satNumVars(sat_solver *s)
+{
+    return s->nvars;
+}
+
+int satNumClauses(sat_solver *s)
+{
+    return s->n_clauses;
+}
+
+long satNumConflicts(sat_solver *s)
+{
+    return s->conflicts;
+}
+
+/**************************************************************************************
+ * satAddClause
+ * Inputs: solver, DIMACS literals and their number
+ * Adds a clause to the problem (the search restarts from the top level). Duplicated and
+ * falsified literals are removed, satisfied clauses and tautologies are ignored.
+ * Return values: problem still satisfiable ? 1 : 0
+ *************************************************************************************/
+int satAddClause(sat_solver *s, const int *lits, int n)
+{
+    int i, k, lit, dup;
+
+    if (!s->ok)
+        return 0;
+    cancelUntil(s, 0);
+
+    s->learnt.size = 0;
+    for (i = 0; i < n; i++)
+    {
+        lit = 2 * (abs(lits[i]) - 1) + (lits[i] < 0);
+        if (litValue(s, lit) == VAL_TRUE)
+            return 1;
+        if (litValue(s, lit) == VAL_FALSE)
+            continue;
+        for (k = 0, dup = 0; k < s->learnt.size && !dup; k++)
+        {
+            if (s->learnt.data[k] == (lit ^ 1))
+                return 1;
+            dup = s->learnt.data[k] == lit;
+        }
+        if (!dup)
+            ivecPush(&s->learnt, lit);
+    }
+
+    if (s->learnt.size == 0)
+        s->ok = 0;
+    else if (s->learnt.size == 1)
+    {
+        enqueue(s, s->learnt.data[0], -1);
+        s->ok = propagate(s) < 0;
+    }
+    else
+    {
+        newClause(s, s->learnt.data, s->learnt.size, 0);
+        s->n_clauses++;
+    }
+    return s->ok;
+}
+
+/**************************************************************************************
+ * satSetPhase
+ * Sets the value first tried when the solver decides on a variable (updated by phase saving)
+ *************************************************************************************/
+void satSetPhase(sat_solver *s, int var, int val)
+{
+    s->polarity[var - 1] = val ? VAL_TRUE : VAL_FALSE;
+}
+
+/**************************************************************************************
+ * satSolve
+ * Inputs: solver and a limit on the conflicts of this call (<= 0 for no limit)
+ * Searches for a model of the clauses added so far. The search is also interrupted if the
+ * mapping budget expires (budget.h).
+ * Return values: SAT_SAT, SAT_UNSAT or SAT_UNKNOWN (limit reached)
+ *************************************************************************************/
+int satSolve(sat_solver *s, long maxConflicts)
+{
+    long start = s->conflicts, sinceRestart = 0, restartLimit;
+    int confl, btlevel, lit, cr, restarts = 0, v;
+
+    if (!s->ok)
+        return SAT_UNSAT;
+    cancelUntil(s, 0);
+    if (propagate(s) >= 0)
+    {
+        s->ok = 0;
+        return SAT_UNSAT;
+    }
+    restartLimit = RESTART_BASE * luby(restarts);
+    if (s->max_learnts == 0)
+        s->max_learnts = s->n_clauses / 3 + 1000;
+
+    for (;;)
+    {
+        confl = propagate(s);
+        if (confl >= 0)
+        {
+            s->conflicts++;
+            sinceRestart++;
+            if (decisionLevel(s) == 0)
+            {
+                s->ok = 0;
+                return SAT_UNSAT;
+            }
+            btlevel = analyze(s, confl);
+            cancelUntil(s, btlevel);
+            if (s->learnt.size == 1)
+                enqueue(s, s->learnt.data[0], -1);
+            else
+            {
+                cr = newClause(s, s->learnt.data, s->learnt.size, 1);
+                ivecPush(&s->learnts, cr);
+                enqueue(s, s->learnt.data[0], cr);
+            }
+            s->var_inc /= VAR_DECAY;
+
+            if ((maxConflicts > 0 && s->conflicts - start >= maxConflicts) ||
+                ((s->conflicts - start) % BUDGET_POLL == 0 && mapping_budget_expired()))
+            {
+                cancelUntil(s, 0);
+                return SAT_UNKNOWN;
+            }
+        }
+        else
+        {
+            if (sinceRestart >= restartLimit)
+            {
+                cancelUntil(s, 0);
+                restartLimit = RESTART_BASE * luby(++restarts);
+                sinceRestart = 0;
+            }
+            if (s->learnts.size - s->trail_size >= s->max_learnts)
+            {
+                reduceDB(s);
+                s->max_learnts += s->max_learnts / 10;
+            }
+
+            // Decide on the most active unassigned variable
+            lit = -1;
+            while (s->heap_size > 0 && lit < 0)
+            {
+                v = heapRemoveMax(s);
+                if (s->assigns[v] == VAL_UNDEF)
+                    lit = 2 * v + (s->polarity[v] != VAL_TRUE);
+            }
+            if (lit < 0)
+            {
+                memcpy(s->model, s->assigns, s->nvars);
+                return SAT_SAT;
+            }
+            ivecPush(&s->trail_lim, s->trail_size);
+            enqueue(s, lit, -1);
+        }
+    }
+}
+
+/**************************************************************************************
+ * satModelValue
+ * Return values: value of the variable in the last model found (1 / 0)
+ *************************************************************************************/
+int satModelValue(sat_solver *s, int var)
+{
+    return s->model[var - 1] == VAL_TRUE;
+}
@@ -0,0 +1,30 @@
+#ifndef SAT_H
+#define SAT_H
+
+/**********************************************************************************************
+ * CDCL SAT Solver
+ * Small self-contained conflict-driven clause learning solver, used by the exact mapper: two
+ * watched literals, first-UIP learning with clause minimization, VSIDS decisions with phase
+ * saving, Luby restarts and learnt clause reduction.
+ * Variables are numbered from 1 and literals follow the DIMACS convention (v / -v). Clauses
+ * can be added between solves (incremental use, e.g. to block a rejected model).
+ *********************************************************************************************/
+
+#define SAT_UNSAT 0
+#define SAT_SAT 1
+#define SAT_UNKNOWN -1
+
+typedef struct _sat_solver sat_solver;
+
+sat_solver *createSATSolver(void);
+void deleteSATSolver(sat_solver *s);
+int satNewVar(sat_solver *s);
+int satNumVars(sat_solver *s);
+int satNumClauses(sat_solver *s);
+long satNumConflicts(sat_solver *s);
+int satAddClause(sat_solver *s, const int *lits, int n);
+void satSetPhase(sat_solver *s, int var, int val);
+int satSolve(sat_solver *s, long maxConflicts);
+int satModelValue(sat_solver *s, int var);
+
+#endif
@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
 #include <time.h>
 #include "ops.h"
 #include "dfg.h"
@@ -9,6 +10,7 @@
 #include "pqueue.h"
 #include "stack.h"
 #include "files.h"
+#include "stats.h"
 #include <omp.h>
 #include <time.h>
 
@@ -463,11 +465,24 @@ int *rasALAP(cgra *template, dfg *d)
     return scheduled;
 }
 
+/** Number of consecutive route-through nodes ending at target (target included) */
+static int getRouteDepth(dfg_instr *target)
+{
+    int depth = 0;
+
+    while (target != NULL && get_operation_index(get_instr_op(target)) == OP_ROUTE && get_n_inputs(target) > 0)
+    {
+        depth++;
+        target = get_input(target, 0);
+    }
+    return depth;
+}
+
 /* ***************************************************************************************************************
  * Resource Aware Scheduling (RAS): Mixed Scheduling. Accepts operations with varying latencies.
  * Returns the scheduling of all the nodes in the DFG
  *****************************************************************************************************************/
-int *rasMixedScheduling(cgra *template, dfg *d)
+static int *rasMixedSchedulingImpl(cgra *template, dfg *d)
 {
     // If topological sort has been run before on this DFG, restore it
     if (is_dfg_sorted(d))
@@ -591,6 +606,18 @@ int *rasMixedScheduling(cgra *template, dfg *d)
                 ongoing = 1;
                 continue;
             }
+            // A chain of route-through nodes splits a long edge: spread its nodes evenly between the producer and the
+            // consumers, instead of gathering them right before the consumers (which would leave the long wait in place)
+            if (get_operation_index(get_instr_op(get_dfg_instr(d, si[i].id))) == OP_ROUTE && pos > asap[si[i].id])
+            {
+                int depth = getRouteDepth(get_dfg_instr(d, si[i].id));
+                int spread = asap[si[i].id] + (pos - asap[si[i].id]) * depth / (depth + 1);
+                // Latest free slot between the ASAP and the spread position; the node stays put if there is none
+                while (spread > asap[si[i].id] && cgra_resources[spread][OP_ROUTE] <= 0)
+                    spread--;
+                if (cgra_resources[spread][OP_ROUTE] > 0)
+                    pos = spread;
+            }
             schedule[si[i].id] = pos;
             cgra_resources[pos][get_operation_index(get_instr_op(get_dfg_instr(d, si[i].id)))]--; // update available resources
         }
@@ -609,6 +636,18 @@ int *rasMixedScheduling(cgra *template, dfg *d)
     return schedule;
 }
 
+/**
+ * Instrumented entry point: with the phase timers on, times the scheduler as PHASE_SCHEDULING (stats.h)
+ */
+int *rasMixedScheduling(cgra *template, dfg *d)
+{
+    double t0 = STAT_TIMER_BEGIN();
+    int *schedule = rasMixedSchedulingImpl(template, d);
+
+    STAT_TIMER_END(PHASE_SCHEDULING, t0);
+    return schedule;
+}
+
 /* ***************************************************************************************************************
  * Modulo Scheduling: Returns the target schedule adapted to a target modulus, II
  *****************************************************************************************************************/
@@ -1059,4 +1098,149 @@ void topologicalSortDFG(dfg *d)
     free(critical_nodes);
 }
 
+/* ***************************************************************************************************************
+ * Criticality Analysis
+ * The criticality of a node is 1 - mobility / (max mobility + 1), where the mobility is the difference between its
+ * ALAP and ASAP schedules: the nodes on the critical path get 1 and the ones that can slide the most get the least.
+ * Nodes on a recurrence cycle also get 1, as the cycle bounds the II. The criticality orders the placement of the
+ * fine-tuning mapper (orderByCriticality), weights the delays of the annealer's cost function and the input routing
+ * order (recurrence cycle edges are routed first).
+ *****************************************************************************************************************/
+
+/** Marks the nodes reachable from start, forward (through the outputs) or backward (through the inputs) */
+static void markReachable(dfg_instr *start, int forward, char *mark, dfg_instr **queue)
+{
+    int k, n, head = 0, tail = 0;
+    dfg_instr *curr, *next;
+
+    mark[get_instr_id(start) - 1] = 1;
+    queue[tail++] = start;
+    while (head < tail)
+    {
+        curr = queue[head++];
+        n = forward ? get_n_outputs(curr) : get_n_inputs(curr);
+        for (k = 0; k < n; k++)
+        {
+            next = forward ? get_output(curr, k) : get_input(curr, k);
+            if (next == NULL || mark[get_instr_id(next) - 1])
+                continue;
+            mark[get_instr_id(next) - 1] = 1;
+            queue[tail++] = next;
+        }
+    }
+}
+
+/* ***************************************************************************************************************
+ * computeCriticality
+ * Inputs: device model and target DFG
+ * Sets the criticality and recurrence cycle membership of every node of the DFG (see Criticality Analysis)
+ *****************************************************************************************************************/
+void computeCriticality(cgra *template, dfg *d)
+{
+    int i, j, k, id, N = get_dfg_size(d), maxMobility = 0;
+    int *asap = rasASAP(template, d), *alap = rasALAP(template, d), *mobility = getNodeMobility(asap, alap, N);
+    char *fwd = (char *)malloc(N), *bwd = (char *)malloc(N), *onCycle = (char *)calloc(N, 1);
+    dfg_instr **queue = (dfg_instr **)malloc(N * sizeof(dfg_instr *)), *curr;
+
+    for (i = 0; i < N; i++)
+    {
+        if (mobility[i] < 0) // resource constraints may push the ALAP before the ASAP
+            mobility[i] = 0;
+        maxMobility = MAX(maxMobility, mobility[i]);
+    }
+
+    // A recurrence edge from curr to start closes a cycle with every path from start to curr
+    for (i = 0; i < N; i++)
+    {
+        curr = get_dfg_instr(d, i);
+        if (isIO(curr))
+            continue;
+        for (k = 0; k < get_n_recurrences(curr); k++)
+        {
+            if (get_recurrence(curr, k) == NULL) // removed recurrence slot
+                continue;
+            memset(fwd, 0, N);
+            memset(bwd, 0, N);
+            markReachable(get_recurrence(curr, k), 1, fwd, queue);
+            markReachable(curr, 0, bwd, queue);
+            for (j = 0; j < N; j++)
+                onCycle[j] |= fwd[j] & bwd[j];
+        }
+    }
+
+    for (i = 0; i < N; i++)
+    {
+        curr = get_dfg_instr(d, i);
+        id = get_instr_id(curr) - 1;
+        set_instr_criticality(curr, onCycle[id] ? 1 : 1 - (float)mobility[id] / (maxMobility + 1), onCycle[id]);
+    }
+
+    free(asap);
+    free(alap);
+    free(mobility);
+    free(fwd);
+    free(bwd);
+    free(onCycle);
+    free(queue);
+}
+
+/** Returns 1 if node a must be placed before node b (when both can be placed) */
+static int moreCritical(dfg_instr *a, dfg_instr *b)
+{
+    if (is_on_rec_cycle(a) != is_on_rec_cycle(b))
+        return is_on_rec_cycle(a);
+    return get_instr_criticality(a) > get_instr_criticality(b);
+}
+
+/* ***************************************************************************************************************
+ * orderByCriticality
+ * Inputs: list of nodes (node sublist), in topological order, with the criticality computed (computeCriticality)
+ * Reorders the list in place: each position takes the most critical node whose inputs in the list were already
+ * taken (recurrence cycles first, then by criticality; ties keep the list order). The order stays topological.
+ *****************************************************************************************************************/
+void orderByCriticality(dfg_instr **ops)
+{
+    int i, k, pos, best, iid, n = get_node_sublist_size(ops), maxId = 0;
+    char *inList, *taken, *done = (char *)calloc(n, 1);
+    dfg_instr **ordered = (dfg_instr **)malloc(n * sizeof(dfg_instr *));
+
+    for (i = 0; i < n; i++)
+        maxId = MAX(maxId, get_instr_id(ops[i]));
+    inList = (char *)calloc(maxId + 1, 1);
+    taken = (char *)calloc(maxId + 1, 1);
+    for (i = 0; i < n; i++)
+        inList[get_instr_id(ops[i])] = 1;
+
+    for (pos = 0; pos < n; pos++)
+    {
+        best = -1;
+        for (i = 0; i < n; i++)
+        {
+            if (done[i] || (best >= 0 && !moreCritical(ops[i], ops[best])))
+                continue;
+            for (k = 0; k < get_n_inputs(ops[i]); k++)
+            {
+                iid = get_instr_id(get_input(ops[i], k));
+                if (iid <= maxId && inList[iid] && !taken[iid])
+                    break;
+            }
+            if (k == get_n_inputs(ops[i]))
+                best = i;
+        }
+        // Only on a malformed (cyclic) list: keep the list order
+        if (best < 0)
+            for (best = 0; done[best]; best++)
+                ;
+        done[best] = 1;
+        taken[get_instr_id(ops[best])] = 1;
+        ordered[pos] = ops[best];
+    }
+    memcpy(ops, ordered, n * sizeof(dfg_instr *));
+
+    free(inList);
+    free(taken);
+    free(done);
+    free(ordered);
+}
+
 /****************************************************************************************************************/
\ No newline at end of file
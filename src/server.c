@@ -0,0 +1,706 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <omp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "dfg.h"
+#include "cgra.h"
+#include "files.h"
+#include "parson.h"
+#include "mapcache.h"
+#include "budget.h"
+#include "server.h"
+
+#define RESIDENT_CGRA 0
+#define RESIDENT_DFG 1
+#define RESIDENT_RESULT 2
+
+#define SERVER_POLL_MS 200
+#define SERVER_READ_CHUNK 4096
+
+// Resident object (device template, dfg or mapping result), shared by the requests that use it
+typedef struct _resident
+{
+    char name[SERVER_MAX_NAME];
+    int type;
+    int refs;                // the store holds one reference, and each request using the object another
+    cgra *c;                 // device template, or mapped device
+    dfg *d;                  // dfg, or the copy of it that was mapped
+    int **placed;            // placement info (mapping results only)
+    struct _resident *tmpl;  // template a result was mapped onto
+    struct _resident *next;
+} resident;
+
+typedef struct
+{
+    int listen_fd;
+    volatile int stop;
+
+    // Pending connections, served by the worker pool
+    int queue[SERVER_QUEUE_SIZE];
+    int head, count;
+    pthread_mutex_t queue_lock;
+    pthread_cond_t queue_cond;
+
+    resident *store;
+    pthread_mutex_t store_lock;
+} server;
+
+/**************************************************************************************
+ * Resident Store
+ *************************************************************************************/
+
+static void release_resident(server *srv, resident *r)
+{
+    int refs;
+
+    if (r == NULL)
+        return;
+    pthread_mutex_lock(&srv->store_lock);
+    refs = --r->refs;
+    pthread_mutex_unlock(&srv->store_lock);
+    if (refs > 0)
+        return;
+
+    if (r->type == RESIDENT_RESULT && r->placed != NULL)
+    {
+        for (int i = 0; i < get_dfg_size(r->d); i++)
+            free(r->placed[i]);
+        free(r->placed);
+    }
+    if (r->c != NULL)
+        delete_cgra(r->c);
+    if (r->d != NULL)
+        delete_dfg(r->d, 1);
+    release_resident(srv, r->tmpl);
+    free(r);
+}
+
+/**
+ * Looks up a resident object by type and name. The caller gets a reference, to be released after use.
+ */
+static resident *get_resident(server *srv, int type, const char *name)
+{
+    resident *r;
+
+    if (name == NULL)
+        return NULL;
+    pthread_mutex_lock(&srv->store_lock);
+    for (r = srv->store; r != NULL; r = r->next)
+        if (r->type == type && !strcmp(r->name, name))
+        {
+            r->refs++;
+            break;
+        }
+    pthread_mutex_unlock(&srv->store_lock);
+    return r;
+}
+
+/**
+ * Adds a new object to the store, replacing (and releasing) an object of the same type and name.
+ * The store takes over the caller's reference.
+ */
+static void put_resident(server *srv, resident *r)
+{
+    resident **p, *old = NULL;
+
+    pthread_mutex_lock(&srv->store_lock);
+    for (p = &srv->store; *p != NULL; p = &(*p)->next)
+        if ((*p)->type == r->type && !strcmp((*p)->name, r->name))
+        {
+            old = *p;
+            *p = old->next;
+            break;
+        }
+    r->next = srv->store;
+    srv->store = r;
+    pthread_mutex_unlock(&srv->store_lock);
+    release_resident(srv, old);
+}
+
+/**
+ * Removes every object with the given name from the store
+ * Return values: number of objects removed
+ */
+static int drop_resident(server *srv, const char *name)
+{
+    resident **p, *dropped = NULL, *r;
+    int n = 0;
+
+    pthread_mutex_lock(&srv->store_lock);
+    for (p = &srv->store; *p != NULL;)
+    {
+        r = *p;
+        if (strcmp(r->name, name))
+        {
+            p = &r->next;
+            continue;
+        }
+        *p = r->next;
+        r->next = dropped;
+        dropped = r;
+    }
+    pthread_mutex_unlock(&srv->store_lock);
+
+    while (dropped != NULL)
+    {
+        r = dropped->next;
+        release_resident(srv, dropped);
+        dropped = r;
+        n++;
+    }
+    return n;
+}
+
+static resident *new_resident(int type, const char *name)
+{
+    resident *r = (resident *)calloc(1, sizeof(resident));
+    r->type = type;
+    r->refs = 1;
+    snprintf(r->name, SERVER_MAX_NAME, "%s", name);
+    return r;
+}
+
+/**************************************************************************************
+ * Requests
+ *************************************************************************************/
+
+static JSON_Value *error_response(const char *message)
+{
+    JSON_Value *val = json_value_init_object();
+    JSON_Object *obj = json_value_get_object(val);
+
+    json_object_set_string(obj, "status", "error");
+    json_object_set_string(obj, "message", message);
+    return val;
+}
+
+static JSON_Value *ok_response(JSON_Object **obj)
+{
+    JSON_Value *val = json_value_init_object();
+
+    *obj = json_value_get_object(val);
+    json_object_set_string(*obj, "status", "ok");
+    return val;
+}
+
+/**
+ * Imports a device template or a dfg, from a file ("path") or from inline text ("text")
+ */
+static JSON_Value *serve_import(server *srv, JSON_Object *req, int type)
+{
+    const char *name = json_object_get_string(req, "name"), *path = json_object_get_string(req, "path");
+    const char *text = json_object_get_string(req, "text");
+    JSON_Object *obj;
+    JSON_Value *res;
+    FILE *fp;
+    resident *r;
+    cgra *c = NULL;
+    dfg *d = NULL;
+
+    if (name == NULL || strlen(name) == 0 || strlen(name) >= SERVER_MAX_NAME)
+        return error_response("Missing or invalid name.");
+    if ((path == NULL) == (text == NULL))
+        return error_response("Either a path or a text must be given.");
+
+    // Dfgs are built (imports, copies, and sub-dfgs in the mappers) with per-thread instruction ids, so requests parse in parallel
+    if (path != NULL)
+    {
+        if (type == RESIDENT_CGRA)
+            c = new_import_cgra((char *)path);
+        else
+            d = import_dfg((char *)path);
+    }
+    else if ((fp = fmemopen((void *)text, strlen(text), "r")) != NULL)
+    {
+        if (type == RESIDENT_CGRA)
+            c = read_cgra(fp);
+        else
+            d = read_dfg(fp);
+        fclose(fp);
+    }
+
+    if (c == NULL && d == NULL)
+        return error_response(type == RESIDENT_CGRA ? "Could not import the CGRA architecture." : "Could not import the DFG.");
+
+    res = ok_response(&obj);
+    json_object_set_string(obj, "name", name);
+    if (type == RESIDENT_CGRA)
+    {
+        json_object_set_number(obj, "rows", get_cgra_L(c));
+        json_object_set_number(obj, "cols", get_cgra_C(c));
+    }
+    else
+    {
+        json_object_set_number(obj, "nodes", get_dfg_size(d));
+        json_object_set_number(obj, "consts", get_dfg_n_consts(d));
+    }
+
+    r = new_resident(type, name);
+    r->c = c;
+    r->d = d;
+    put_resident(srv, r);
+    return res;
+}
+
+/**
+ * Maps a resident dfg onto a resident template. The mapping is kept as a result (named after the dfg, by
+ * default), and is returned inline unless "export" is false.
+ */
+static JSON_Value *serve_map(server *srv, JSON_Object *req)
+{
+    const char *result = json_object_get_string(req, "result");
+    resident *tmpl = get_resident(srv, RESIDENT_CGRA, json_object_get_string(req, "cgra"));
+    resident *src = get_resident(srv, RESIDENT_DFG, json_object_get_string(req, "dfg"));
+    const char *time_budget = json_object_get_string(req, "budget");
+    int i, fm = 1, mapper, maxII = INFINITY;
+    char budget_args[64] = "";
+    double budget_seconds;
+    uint64_t budget_max_expansions;
+    mapping_budget budget;
+    JSON_Object *obj;
+    JSON_Value *res;
+    resident *r;
+    double t;
+
+    if (tmpl == NULL || src == NULL)
+    {
+        release_resident(srv, tmpl);
+        release_resident(srv, src);
+        return error_response(tmpl == NULL ? "Unknown CGRA." : "Unknown DFG.");
+    }
+    if (result == NULL)
+        result = json_object_get_string(req, "dfg");
+    else if (strlen(result) == 0 || strlen(result) >= SERVER_MAX_NAME)
+    {
+        release_resident(srv, tmpl);
+        release_resident(srv, src);
+        return error_response("Invalid result name.");
+    }
+    mapper = (int)json_object_get_number(req, "mapper");
+    if (json_object_get_number(req, "max_ii") > 0)
+        maxII = (int)json_object_get_number(req, "max_ii");
+    // Budget of this request only, in the place_and_route syntax
+    if (time_budget != NULL)
+        snprintf(budget_args, sizeof(budget_args), "budget=%.40s ", time_budget);
+    if (json_object_get_number(req, "expansions") > 0)
+        snprintf(budget_args + strlen(budget_args), sizeof(budget_args) - strlen(budget_args), "expansions=%.0f",
+                 json_object_get_number(req, "expansions"));
+    if (parse_mapping_budget(budget_args, &budget_seconds, &budget_max_expansions) < 0)
+    {
+        release_resident(srv, tmpl);
+        release_resident(srv, src);
+        return error_response("Invalid mapping budget.");
+    }
+
+    // Each request maps its own copy of the dfg (the mappers sort it in place)
+    r = new_resident(RESIDENT_RESULT, result);
+    r->tmpl = tmpl;
+    r->d = copy_dfg(src->d);
+    release_resident(srv, src);
+    r->placed = (int **)calloc(get_dfg_size(r->d), sizeof(int *));
+    for (i = 0; i < get_dfg_size(r->d); i++)
+        r->placed[i] = (int *)calloc(5, sizeof(int));
+
+    t = omp_get_wtime();
+    start_mapping_budget(&budget, budget_seconds, budget_max_expansions);
+    r->c = HandOfGod(tmpl->c, r->d, &r->placed, &fm, mapper, maxII, 0);
+    stop_mapping_budget();
+    t = omp_get_wtime() - t;
+
+    if (r->c == NULL)
+    {
+        release_resident(srv, r);
+        return error_response(budget.expired ? "No legal mapping was found within the budget." : "No legal mapping was found.");
+    }
+
+    res = ok_response(&obj);
+    json_object_set_string(obj, "result", result);
+    json_object_set_number(obj, "II", get_n_cgra_slices(r->c));
+    json_object_set_number(obj, "MII", getDeviceMII(r->c));
+    json_object_set_number(obj, "time", t);
+    if (budget.active)
+        json_object_set_boolean(obj, "budget_expired", budget.expired);
+    if (json_object_get_boolean(req, "export") != 0)
+        json_object_set_value(obj, "mapping", getMappingJSON(r->c, r->d, &r->placed, 1));
+    put_resident(srv, r);
+    return res;
+}
+
+static JSON_Value *serve_export(server *srv, JSON_Object *req)
+{
+    resident *r = get_resident(srv, RESIDENT_RESULT, json_object_get_string(req, "result"));
+    JSON_Object *obj;
+    JSON_Value *res;
+
+    if (r == NULL)
+        return error_response("Unknown mapping result.");
+    res = ok_response(&obj);
+    json_object_set_string(obj, "result", r->name);
+    json_object_set_value(obj, "mapping", getMappingJSON(r->c, r->d, &r->placed, 1));
+    release_resident(srv, r);
+    return res;
+}
+
+/**
+ * Prunes a copy of the template of the given mapping results (which must share it) to the resources they
+ * use. The pruned device becomes a new resident template ("<template>_pruned", by default).
+ */
+static JSON_Value *serve_prune(server *srv, JSON_Object *req)
+{
+    JSON_Array *names = json_object_get_array(req, "results");
+    const char *name = json_object_get_string(req, "name");
+    int i, N = names != NULL ? (int)json_array_get_count(names) : 0, n = 0;
+    int pruning_info[] = {0, 0, 0, 0, 0, 0, 0, 0};
+    float pruning_savings[2];
+    char pruned_name[SERVER_MAX_NAME];
+    JSON_Value *res = NULL;
+    JSON_Object *obj;
+    resident **rs, *pruned;
+    cgra **cs;
+    dfg **ds;
+
+    if (N == 0)
+        return error_response("No mapping results given.");
+    if (name != NULL && (strlen(name) == 0 || strlen(name) >= SERVER_MAX_NAME))
+        return error_response("Invalid name.");
+
+    rs = (resident **)calloc(N, sizeof(resident *));
+    cs = (cgra **)calloc(N, sizeof(cgra *));
+    ds = (dfg **)calloc(N, sizeof(dfg *));
+    for (n = 0; n < N; n++)
+    {
+        rs[n] = get_resident(srv, RESIDENT_RESULT, json_array_get_string(names, n));
+        if (rs[n] == NULL)
+        {
+            res = error_response("Unknown mapping result.");
+            break;
+        }
+        if (rs[n]->tmpl != rs[0]->tmpl)
+        {
+            n++;
+            res = error_response("The mapping results do not share the same CGRA.");
+            break;
+        }
+        cs[n] = rs[n]->c;
+        ds[n] = rs[n]->d;
+    }
+
+    if (res == NULL)
+    {
+        if (name == NULL)
+        {
+            snprintf(pruned_name, SERVER_MAX_NAME, "%.*s_pruned", SERVER_MAX_NAME - 8, rs[0]->tmpl->name);
+            name = pruned_name;
+        }
+        pruned = new_resident(RESIDENT_CGRA, name);
+        pruned->c = copy_cgra(rs[0]->tmpl->c);
+        auto_prune(cs, ds, pruned->c, N, pruning_info, pruning_savings);
+        put_resident(srv, pruned);
+
+        res = ok_response(&obj);
+        json_object_set_string(obj, "cgra", name);
+        json_object_set_number(obj, "connections_removed", pruning_info[0]);
+        json_object_set_number(obj, "output_registers_removed", pruning_info[4]);
+        json_object_set_number(obj, "registers_removed", pruning_info[1]);
+        json_object_set_number(obj, "rf_ports_removed", pruning_info[6]);
+        json_object_set_number(obj, "fu_inputs_removed", pruning_info[7]);
+        json_object_set_number(obj, "fu_operations_removed", pruning_info[5]);
+        json_object_set_number(obj, "pes_removed", pruning_info[2]);
+        json_object_set_number(obj, "stream_ports_removed", pruning_info[3]);
+        json_object_set_number(obj, "area_reduction", pruning_savings[0]);
+        json_object_set_number(obj, "power_reduction", pruning_savings[1]);
+    }
+
+    for (i = 0; i < n; i++)
+        release_resident(srv, rs[i]);
+    free(rs);
+    free(cs);
+    free(ds);
+    return res;
+}
+
+static JSON_Value *serve_list(server *srv)
+{
+    JSON_Value *lists[3];
+    JSON_Object *obj;
+    JSON_Value *res = ok_response(&obj);
+    resident *r;
+    int t;
+
+    for (t = 0; t < 3; t++)
+        lists[t] = json_value_init_array();
+    pthread_mutex_lock(&srv->store_lock);
+    for (r = srv->store; r != NULL; r = r->next)
+        json_array_append_string(json_value_get_array(lists[r->type]), r->name);
+    pthread_mutex_unlock(&srv->store_lock);
+
+    json_object_set_value(obj, "cgras", lists[RESIDENT_CGRA]);
+    json_object_set_value(obj, "dfgs", lists[RESIDENT_DFG]);
+    json_object_set_value(obj, "results", lists[RESIDENT_RESULT]);
+    return res;
+}
+
+/**
+ * Parses and serves one request line
+ * Return values: response (to be freed by the caller)
+ */
+static JSON_Value *serve_request(server *srv, const char *line)
+{
+    JSON_Value *req_val = json_parse_string(line), *res;
+    JSON_Object *req = json_value_get_object(req_val), *obj;
+    const char *cmd = json_object_get_string(req, "cmd");
+
+    if (req == NULL || cmd == NULL)
+        res = error_response("Invalid request.");
+    else if (!strcmp(cmd, "import_cgra"))
+        res = serve_import(srv, req, RESIDENT_CGRA);
+    else if (!strcmp(cmd, "import_dfg"))
+        res = serve_import(srv, req, RESIDENT_DFG);
+    else if (!strcmp(cmd, "map"))
+        res = serve_map(srv, req);
+    else if (!strcmp(cmd, "export"))
+        res = serve_export(srv, req);
+    else if (!strcmp(cmd, "prune"))
+        res = serve_prune(srv, req);
+    else if (!strcmp(cmd, "list"))
+        res = serve_list(srv);
+    else if (!strcmp(cmd, "drop"))
+    {
+        const char *name = json_object_get_string(req, "name");
+        if (name == NULL)
+            res = error_response("Missing name.");
+        else
+        {
+            res = ok_response(&obj);
+            json_object_set_number(obj, "dropped", drop_resident(srv, name));
+        }
+    }
+    else if (!strcmp(cmd, "shutdown"))
+    {
+        srv->stop = 1;
+        res = ok_response(&obj);
+    }
+    else
+        res = error_response("Unknown command.");
+
+    json_value_free(req_val);
+    return res;
+}
+
+/**************************************************************************************
+ * Connections
+ *************************************************************************************/
+
+static int send_all(int fd, const char *buf, size_t n)
+{
+    ssize_t w;
+
+    while (n > 0)
+    {
+        w = send(fd, buf, n, MSG_NOSIGNAL);
+        if (w < 0 && errno == EINTR)
+            continue;
+        if (w <= 0)
+            return -1;
+        buf += w;
+        n -= w;
+    }
+    return 0;
+}
+
+/**
+ * Serves the requests of a connection (one JSON object per line), until the client closes it or the
+ * server stops
+ */
+static void serve_connection(server *srv, int fd)
+{
+    size_t size = SERVER_READ_CHUNK, len = 0, start;
+    char *buf = (char *)malloc(size), *nl, *out;
+    struct pollfd pfd = {fd, POLLIN, 0};
+    JSON_Value *res;
+    ssize_t n;
+    int ret;
+
+    while (!srv->stop)
+    {
+        ret = poll(&pfd, 1, SERVER_POLL_MS);
+        if (ret < 0 && errno != EINTR)
+            break;
+        if (ret <= 0)
+            continue;
+
+        if (size - len < SERVER_READ_CHUNK)
+        {
+            size *= 2;
+            buf = (char *)realloc(buf, size);
+        }
+        n = recv(fd, buf + len, size - len - 1, 0);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+        len += n;
+        buf[len] = '\0';
+
+        // Serve every complete line
+        start = 0;
+        while ((nl = memchr(buf + start, '\n', len - start)) != NULL)
+        {
+            *nl = '\0';
+            if (nl > buf + start)
+            {
+                res = serve_request(srv, buf + start);
+                out = json_serialize_to_string(res);
+                ret = send_all(fd, out, strlen(out)) || send_all(fd, "\n", 1);
+                json_free_serialized_string(out);
+                json_value_free(res);
+                if (ret != 0) // client is gone
+                    break;
+            }
+            start = nl - buf + 1;
+        }
+        if (nl != NULL)
+            break;
+        memmove(buf, buf + start, len - start);
+        len -= start;
+    }
+    free(buf);
+    close(fd);
+}
+
+static void *worker(void *arg)
+{
+    server *srv = (server *)arg;
+    int fd;
+
+    while (1)
+    {
+        pthread_mutex_lock(&srv->queue_lock);
+        while (srv->count == 0 && !srv->stop)
+            pthread_cond_wait(&srv->queue_cond, &srv->queue_lock);
+        if (srv->count == 0)
+        {
+            pthread_mutex_unlock(&srv->queue_lock);
+            break;
+        }
+        fd = srv->queue[srv->head];
+        srv->head = (srv->head + 1) % SERVER_QUEUE_SIZE;
+        srv->count--;
+        pthread_mutex_unlock(&srv->queue_lock);
+
+        serve_connection(srv, fd);
+    }
+    return NULL;
+}
+
+/*****************************************************************************************************
+ * run_mapping_server
+ * Inputs: socket path and number of worker threads
+ * Listens on a Unix domain socket and serves mapping requests until a shutdown request is received.
+ * Return values: success ? 0 : -1 (the socket could not be created)
+ ****************************************************************************************************/
+int run_mapping_server(const char *socket_path, int n_workers)
+{
+    struct sockaddr_un addr;
+    struct pollfd pfd;
+    pthread_t *workers;
+    server srv;
+    resident *r;
+    char cache_dir[MAPCACHE_MAX_PATH] = "";
+    int i, fd;
+
+    if (strlen(socket_path) >= sizeof(addr.sun_path))
+    {
+        printf("ERROR: Socket path too long.\n");
+        return -1;
+    }
+    if (n_workers <= 0)
+        n_workers = SERVER_DEFAULT_WORKERS;
+    if (n_workers > SERVER_MAX_WORKERS)
+        n_workers = SERVER_MAX_WORKERS;
+
+    memset(&srv, 0, sizeof(server));
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, socket_path);
+
+    srv.listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(socket_path);
+    if (srv.listen_fd < 0 || bind(srv.listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(srv.listen_fd, SERVER_QUEUE_SIZE) != 0)
+    {
+        printf("ERROR: Could not listen on '%s' (%s).\n", socket_path, strerror(errno));
+        if (srv.listen_fd >= 0)
+            close(srv.listen_fd);
+        return -1;
+    }
+
+    // Requests are answered without touching the filesystem: the mapping cache is off while serving
+    if (get_mapping_cache_dir() != NULL)
+        snprintf(cache_dir, MAPCACHE_MAX_PATH, "%s", get_mapping_cache_dir());
+    set_mapping_cache_dir(NULL);
+
+    pthread_mutex_init(&srv.queue_lock, NULL);
+    pthread_cond_init(&srv.queue_cond, NULL);
+    pthread_mutex_init(&srv.store_lock, NULL);
+    workers = (pthread_t *)malloc(n_workers * sizeof(pthread_t));
+    for (i = 0; i < n_workers; i++)
+        pthread_create(&workers[i], NULL, worker, &srv);
+
+    printf("Mapping server listening on '%s' (%d workers).\n", socket_path, n_workers);
+    fflush(stdout);
+
+    pfd.fd = srv.listen_fd;
+    pfd.events = POLLIN;
+    while (!srv.stop)
+    {
+        if (poll(&pfd, 1, SERVER_POLL_MS) <= 0)
+            continue;
+        fd = accept(srv.listen_fd, NULL, NULL);
+        if (fd < 0)
+            continue;
+
+        pthread_mutex_lock(&srv.queue_lock);
+        if (srv.count == SERVER_QUEUE_SIZE)
+        {
+            pthread_mutex_unlock(&srv.queue_lock);
+            close(fd);
+            continue;
+        }
+        srv.queue[(srv.head + srv.count++) % SERVER_QUEUE_SIZE] = fd;
+        pthread_cond_signal(&srv.queue_cond);
+        pthread_mutex_unlock(&srv.queue_lock);
+    }
+
+    // Stop the workers (pending connections are closed unanswered)
+    pthread_mutex_lock(&srv.queue_lock);
+    pthread_cond_broadcast(&srv.queue_cond);
+    pthread_mutex_unlock(&srv.queue_lock);
+    for (i = 0; i < n_workers; i++)
+        pthread_join(workers[i], NULL);
+    free(workers);
+    for (; srv.count > 0; srv.count--, srv.head = (srv.head + 1) % SERVER_QUEUE_SIZE)
+        close(srv.queue[srv.head]);
+
+    close(srv.listen_fd);
+    unlink(socket_path);
+
+    while (srv.store != NULL)
+    {
+        r = srv.store->next;
+        release_resident(&srv, srv.store);
+        srv.store = r;
+    }
+    pthread_mutex_destroy(&srv.queue_lock);
+    pthread_cond_destroy(&srv.queue_cond);
+    pthread_mutex_destroy(&srv.store_lock);
+    set_mapping_cache_dir(cache_dir);
+
+    printf("Mapping server stopped.\n");
+    return 0;
+}
@@ -0,0 +1,28 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+/**********************************************************************************************
+ * Mapping Server
+ * Long-running mode for repeated mapping requests: device templates, dfgs and mapping results
+ * are kept resident (by name) between requests, so that a mapping does not pay the process
+ * startup and the file parsing again. Clients connect to a Unix domain socket and send one JSON
+ * object per line; every request is answered with one JSON line. Each connection is served by
+ * a thread of a worker pool, so concurrent clients map in parallel. Requests ("cmd"):
+ *      import_cgra {name, path | text}         import_dfg {name, path | text}
+ *      map {cgra, dfg, [mapper], [max_ii], [budget], [expansions], [result], [export]}
+ *      export {result}                         prune {results, [name]}
+ *      list                                    drop {name}
+ *      shutdown
+ * Responses carry "status" ("ok" or "error", with a "message"). Mapping results are returned
+ * inline, in the export_mapping JSON format; nothing is written to the filesystem (the mapping
+ * cache is off while serving).
+ *********************************************************************************************/
+
+#define SERVER_DEFAULT_WORKERS 4
+#define SERVER_MAX_WORKERS 64
+#define SERVER_QUEUE_SIZE 64
+#define SERVER_MAX_NAME 128
+
+int run_mapping_server(const char *socket_path, int n_workers);
+
+#endif
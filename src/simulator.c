@@ -5,6 +5,10 @@
 #include "dfg.h"
 #include "cgra.h"
 #include "files.h"
+#include "mapcache.h"
+#include "stats.h"
+#include "budget.h"
+#include "server.h"
 
 #define INPUT_FILES 1
 #define MAX_COMMAND_SIZE 200
@@ -24,6 +28,62 @@ void display_sim_ver()
     printf("MIDAS - Mapping Infrastructure for Data Streaming-based DSAs, ver. 1.0\n");
 }
 
+/**
+ * Deletes the current mapping (c and placed[0]) of the dfg d
+ */
+void discard_current_mapping(cgra **c, int ***placed, dfg *d)
+{
+    int i;
+
+    if (*c != NULL)
+    {
+        delete_cgra(*c);
+        *c = NULL;
+    }
+    if (placed[0] != NULL)
+    {
+        for (i = 0; i < get_dfg_size(d); i++)
+            free(placed[0][i]);
+        free(placed[0]);
+        placed[0] = NULL;
+    }
+}
+
+/**
+ * Deletes the dfg d, unless it is one of the imported DFGs or a mapping in any slot of the result FIFO (mapped_dfgs)
+ * still uses it
+ */
+void release_dfg(dfg *d, dfg **dfg_targets, int n_targets, dfg **mapped_dfgs, int fifo_ctr)
+{
+    int i;
+
+    if (d == NULL)
+        return;
+    for (i = 0; i < n_targets; i++)
+        if (dfg_targets[i] == d)
+            return;
+    for (i = 0; i < fifo_ctr && i < RESULT_FIFO_SIZE; i++)
+        if (mapped_dfgs[i] == d)
+            return;
+    delete_dfg(d, 1);
+}
+
+/**
+ * Makes new_d the current DFG, in place of *d. Any mapping of *d is discarded, the imported DFGs that were *d become
+ * new_d, and *d is released (release_dfg).
+ */
+void replace_current_dfg(dfg **d, dfg *new_d, cgra **c, int ***placed, dfg **dfg_targets, int n_targets, dfg **mapped_dfgs, int fifo_ctr)
+{
+    int i;
+
+    discard_current_mapping(c, placed, *d);
+    for (i = 0; i < n_targets; i++)
+        if (dfg_targets[i] == *d)
+            dfg_targets[i] = new_d;
+    release_dfg(*d, dfg_targets, n_targets, mapped_dfgs, fifo_ctr);
+    *d = new_d;
+}
+
 /**
  * Displays the Simulator's command list
  */
@@ -65,6 +125,7 @@ int main(int argc, char *argv[])
     int ***placed = NULL, quit = 0, fifo_ctr = 0, fifo_ptr1 = -1, fifo_ptr2 = -1, vectorwidth = 1, dfg_targets_idx = 0;
     char line[MAX_COMMAND_SIZE], command[MAX_COMMAND_SIZE], arg[MAX_COMMAND_SIZE], default_dfg_string[11];
     char constraints_file[MAX_COMMAND_SIZE] = "constraints.json";
+    dse_constraints *constraints = NULL; // parsed constraints file (the default one is parsed on first use)
     strncpy(default_dfg_string, "kernel.dfg\0", 11);
     memset(line, 0, MAX_COMMAND_SIZE);
     memset(command, 0, MAX_COMMAND_SIZE);
@@ -78,19 +139,28 @@ int main(int argc, char *argv[])
         // Imports
         {"import_dfg", "\t\timports a dfg file (.dfg or .dot)."},
         {"import_cgra", "\t\timports a cgra architecture file."},
-        //{"import_constraints", "\timports a HW DSE constraints file (.json)."},
+        {"import_constraints", "\timports a HW DSE constraints file (.json)."},
+        {"optimize_dfg", "\t\toptimizes the dfg for the imported cgra before mapping. Arguments: passes to run (fold, reassoc, fuse, strength, cse, dce or all, Default: all, i.e. every pass but fold) [interleave=<partial accumulators>]."},
+        {"unroll_dfg", "\t\tunrolls the dfg, replicating the loop body. Argument: <unrolling factor>."},
+        {"route_dfg", "\t\tinserts route-through (ROUTE) nodes on the long and high-fanout edges of the dfg. Arguments: [span=<cycles> (Default: 4)] [fanout=<outputs> (Default: 4)] (0 disables a limit)."},
 
         // Initial Design Point (Co-DSE)
         //{"generate_idp", "\t\tgenerates an initial architectural design point, based on the imported DFGs and the constraints file."},
 
         // Mapping
-        {"place_and_route", "\tmaps the dfg to the cgra, with a heuristic-based algorithm."},
+        {"place_and_route", "\tmaps the dfg to the cgra, with a heuristic-based algorithm. Arguments: <mapper> [budget=<time>[us|ms|s]] [expansions=<n>]."},
+        {"warm_remap", "\tremaps the dfg starting from a previous mapping, keeping every node that is still legal. Arguments: <mapping result index (0 - 9) or JSON file> [mapper]."},
+        {"mapping_cache", "\tsets the persistent mapping cache directory. Argument: <directory>, 'on' ($XDG_CACHE_HOME/midas), 'off' or 'clear' (Default: off)."},
+        {"multicast_routing", "\troutes each value as a tree shared by its consumers, instead of one route per consumer. Argument: 'on' or 'off' (Default: off)."},
+        {"ii_prover", "\t\tbefore the heuristic mappers, skips the IIs that the exact model proves infeasible (dfgs of up to 48 nodes). Argument: 'on' or 'off' (Default: off)."},
+        {"serve", "\t\t\tserves mapping requests from local clients (JSON over a Unix domain socket), keeping the imported CGRAs and DFGs resident. Arguments: <socket path> [worker threads (Default: 4)]."},
 
         // Displays
         {"display_dfg", "\t\tdisplays the dfg."},
         {"display_cgra", "\t\tdisplays the cgra."},
         {"display_arch", "\t\tdisplays the cgra's interconnect structure."},
         {"pr_summary", "\t\tdisplays the summary of the place and route."},
+        {"pr_stats", "\t\tdisplays the mapper counters and phase timers. Arguments: 'reset', 'timers on', 'timers off' (Default: off), 'trace on', 'trace off' or 'trace <file>' (Chrome trace JSON)."},
         //{"display_by_cycle", "\tdisplays the cgra, cycle by cycle."},
         //{"display_animation", "\tdisplays the cgra as a dataflow animation."},
         {"display_IOs", "\t\tdisplays the cgra IO Streams."},
@@ -105,12 +175,18 @@ int main(int argc, char *argv[])
         //{"resource_cost", "\t\tdisplays the resource cost function."},
         {"resource_analysis", "\tdisplays the analyses regarding resources and utilization."},
         {"turn_off_unused", "\tturns off all unused PEs."},
-        //{"parallelize_mapping", "\tmaps as many copies of the DFG as possible to the mapped device."},
-        //{"store_mapping", "\t\tstores the mapped device in a result FIFO, within the program."},
-        //{"load_mapping", "\t\tloads a mapped device from the result FIFO onto the current device template. Argument: Mapping Result Index (0 - 9)."},
+        {"parallelize_mapping", "\tmaps as many copies of the DFG as possible to the mapped device."},
+        {"comap", "\t\tmaps all imported DFGs together onto the cgra, sharing its PEs. Arguments: <mapper> [II target of DFG 1] [II target of DFG 2] ... [budget=<time>[us|ms|s]] [expansions=<n>]."},
+        {"unroll_search", "\tmaps the dfg unrolled 1, 2, 4, ... times and keeps the unrolling factor with the highest throughput. Arguments: <mapper> [maximum unrolling factor (Default: 8)] [budget=<time>[us|ms|s]] [expansions=<n>]."},
+        {"store_mapping", "\t\tstores the mapped device in a result FIFO, within the program."},
+        {"load_mapping", "\t\tloads a mapped device from the result FIFO onto the current device template. Argument: Mapping Result Index (0 - 9)."},
         {"auto_prune", "\t\tautomatically prunes the device, according to the mapped kernel. Argument: Number of devices to include (0 - 9, or 'all', Default: 1)."},
+        {"pareto_dse", "\t\texplores devices for the imported DFGs and exports the area/power/II Pareto front. Argument: output file (.csv or .json, Default: pareto.csv)."},
         //{"aggressive_prune", "\tapplies aggressive optimization strategies to prune the device model for the imported kernels."},
         {"export_mapping", "\texports the mapping results to a JSON file."},
+        {"export_bitstream", "\texports the mapping results to a binary configuration bitstream (.mbs)."},
+        {"import_bitstream", "\tloads a mapping from a binary configuration bitstream onto the current device template. Argument: bitstream file."},
+        {"diff_bitstream", "\tcompares the configuration records of two bitstreams. Arguments: <file 1> <file 2>."},
         //{"set_arch_vector_width", "\tsets the vector width of the architecture. Argument: <n> = Vector Width (Default: 1)."},
         //{"export_arch", "\t\texports the CGRA architecture to a JSON file."},
         //{"export_all", "\t\tperforms all exports simultaneously, assuming the default arguments"},
@@ -181,6 +257,7 @@ int main(int argc, char *argv[])
                             delete_dfg(d, 1); */
                         if (template != NULL)
                             delete_cgra(template);
+                        delete_dse_constraints(constraints);
 
                         quit = 1;
                         found = 1;
@@ -281,7 +358,139 @@ int main(int argc, char *argv[])
                         if (strlen(arg) > 0)
                         {
                             strncpy(constraints_file, arg, MAX_COMMAND_SIZE - 1);
+                            delete_dse_constraints(constraints);
+                            constraints = load_dse_constraints(constraints_file);
+                        }
+                    }
+
+                    // Optimize the DFG (the optimized DFG replaces the current one)
+                    else if (!strcmp(command, "optimize_dfg"))
+                    {
+                        dfg_pass_stats pass_stats[DFG_N_PASSES] = {0};
+                        dfg_target_op target_ops[OP_MAX + 1] = {{NULL, 0}};
+                        int passes, interleave = 1, n_interleaved = 0, n_target_ops = 0, max_consts, supported;
+                        char *opt = strstr(arg, "interleave=");
+                        dfg *optimized;
+
+                        if (d == NULL)
+                        {
+                            printf("No valid DFG imported.\n");
+                            found = 1;
+                            continue;
                         }
+                        if (opt != NULL)
+                        {
+                            if (sscanf(opt + 11, "%d", &interleave) != 1 || interleave < 1)
+                            {
+                                printf("Invalid number of partial accumulators.\n");
+                                found = 1;
+                                continue;
+                            }
+                            memset(opt, ' ', strcspn(opt, " \t"));
+                        }
+                        passes = parse_dfg_passes(arg);
+                        if (passes < 0)
+                        {
+                            printf("Invalid pass. Use fold, reassoc, fuse, strength, cse, dce or all.\n");
+                            found = 1;
+                            continue;
+                        }
+                        // Operations of the device, and how many constants each can read (RF read ports to the FU inputs)
+                        for (int op = 0; template != NULL && op < OP_MAX; op++)
+                        {
+                            if (get_operation(op) == NULL)
+                                continue;
+                            for (i = 0, max_consts = 0, supported = 0; i < get_cgra_L(template); i++)
+                            {
+                                for (int j = 0; j < get_cgra_C(template); j++)
+                                {
+                                    if (!peHasFunct(template, i, j, op))
+                                        continue;
+                                    supported = 1;
+                                    if (getNRFRPMuxIn(template, i, j) > max_consts)
+                                        max_consts = getNRFRPMuxIn(template, i, j);
+                                }
+                            }
+                            if (supported)
+                            {
+                                target_ops[n_target_ops].op = get_operation(op);
+                                target_ops[n_target_ops++].max_consts = max_consts;
+                            }
+                        }
+                        optimized = optimize_dfg(d, passes, interleave, template != NULL ? target_ops : NULL, pass_stats, &n_interleaved);
+                        if (optimized == NULL)
+                        {
+                            printf("Could not optimize the DFG (instruction ids must be 1..N).\n");
+                            found = 1;
+                            continue;
+                        }
+                        print_dfg_pass_stats(pass_stats);
+                        if (interleave > 1)
+                            printf("%d accumulator(s) split into %d partial accumulators.\n", n_interleaved, interleave);
+                        printf("DFG: %d -> %d nodes, %d -> %d constants.\n", get_dfg_size(d), get_dfg_size(optimized), get_dfg_n_consts(d), get_dfg_n_consts(optimized));
+
+                        replace_current_dfg(&d, optimized, &c, placed, dfg_targets, dfg_targets_idx, mapped_dfgs, fifo_ctr);
+                    }
+
+                    // Replace the DFG by the loop body unrolled U times
+                    else if (!strcmp(command, "unroll_dfg"))
+                    {
+                        int U;
+                        dfg *unrolled;
+
+                        if (d == NULL)
+                        {
+                            printf("No valid DFG imported.\n");
+                            found = 1;
+                            continue;
+                        }
+                        if (sscanf(arg, "%d", &U) != 1 || U < 1)
+                        {
+                            printf("Invalid unrolling factor.\n");
+                            found = 1;
+                            continue;
+                        }
+                        unrolled = unroll_dfg(d, U);
+                        printf("DFG: %d -> %d nodes, %d -> %d constants.\n", get_dfg_size(d), get_dfg_size(unrolled), get_dfg_n_consts(d), get_dfg_n_consts(unrolled));
+
+                        replace_current_dfg(&d, unrolled, &c, placed, dfg_targets, dfg_targets_idx, mapped_dfgs, fifo_ctr);
+                    }
+
+                    // Make the routing of long and high-fanout edges explicit, with ROUTE nodes (the new DFG replaces the current one)
+                    else if (!strcmp(command, "route_dfg"))
+                    {
+                        int max_span = ROUTE_DEFAULT_SPAN, max_fanout = ROUTE_DEFAULT_FANOUT, n_routes = 0, *schedule = NULL;
+                        char *opt;
+                        dfg *routed;
+
+                        if (d == NULL)
+                        {
+                            printf("No valid DFG imported.\n");
+                            found = 1;
+                            continue;
+                        }
+                        if (((opt = strstr(arg, "span=")) != NULL && (sscanf(opt + 5, "%d", &max_span) != 1 || max_span < 0)) ||
+                            ((opt = strstr(arg, "fanout=")) != NULL && (sscanf(opt + 7, "%d", &max_fanout) != 1 || max_fanout < 0)))
+                        {
+                            printf("Invalid span or fanout limit.\n");
+                            found = 1;
+                            continue;
+                        }
+                        // Spans are measured on the schedule the mappers start from (the ASAP schedule without a CGRA)
+                        if (template != NULL)
+                            schedule = rasMixedScheduling(template, d);
+                        routed = insert_route_nodes(d, schedule, max_span, max_fanout, &n_routes);
+                        free(schedule);
+                        if (routed == NULL)
+                        {
+                            printf("Could not insert route nodes (instruction ids must be 1..N).\n");
+                            found = 1;
+                            continue;
+                        }
+                        printf("%d route node(s) inserted.\n", n_routes);
+                        printf("DFG: %d -> %d nodes, %d -> %d constants.\n", get_dfg_size(d), get_dfg_size(routed), get_dfg_n_consts(d), get_dfg_n_consts(routed));
+
+                        replace_current_dfg(&d, routed, &c, placed, dfg_targets, dfg_targets_idx, mapped_dfgs, fifo_ctr);
                     }
 
                     /*************************************************************
@@ -297,7 +506,9 @@ int main(int argc, char *argv[])
                         }
                         if (template != NULL)
                             delete_cgra(template);
-                        template = generateInitialDesignPoint(dfg_targets, dfg_targets_idx, constraints_file);
+                        if (constraints == NULL)
+                            constraints = load_dse_constraints(constraints_file);
+                        template = generateInitialDesignPoint(dfg_targets, dfg_targets_idx, constraints);
                     }
                     /*************************************************************
                      * Mapping
@@ -312,6 +523,15 @@ int main(int argc, char *argv[])
                             found = 1;
                             continue;
                         }
+                        double budget_seconds;
+                        uint64_t budget_max_expansions;
+                        mapping_budget budget;
+                        if (parse_mapping_budget(strchr(arg, ' '), &budget_seconds, &budget_max_expansions) < 0)
+                        {
+                            printf("Invalid mapping budget. Use budget=<time>[us|ms|s] and/or expansions=<n>.\n");
+                            found = 1;
+                            continue;
+                        }
 
                         if (c != NULL)
                             delete_cgra(c);
@@ -331,7 +551,148 @@ int main(int argc, char *argv[])
                         for (i = 0; i < get_dfg_size(d); i++)
                             (*placed)[i] = (int *)calloc(5, sizeof(int)); // [placed?, line & column, first_slice, last_slice, pipeline-rescheduled]
                         int fm = 1;
+                        start_mapping_budget(&budget, budget_seconds, budget_max_expansions);
                         c = HandOfGod(template, d, placed, &fm, mapper, INFINITY, 1);
+                        if (mapping_budget_active())
+                        {
+                            print_budget_report();
+                            if (mapping_budget_expired())
+                            {
+                                if (c != NULL)
+                                    printf("Returning the best mapping found within the budget (II = %d).\n", get_n_cgra_slices(c));
+                                else
+                                    printf("No legal mapping was found within the budget.\n");
+                            }
+                        }
+                        stop_mapping_budget();
+                    }
+
+                    // Remap the DFG, starting from a previous mapping (result FIFO or JSON mapping results)
+                    else if (!strcmp(command, "warm_remap"))
+                    {
+                        char prior_src[MAX_COMMAND_SIZE];
+                        int **hints = NULL, priorII = 0, warm_mapper = 0, idx;
+
+                        if (d == NULL || placed == NULL || template == NULL)
+                        {
+                            printf("No valid DFG imported.\n");
+                            found = 1;
+                            continue;
+                        }
+                        if (sscanf(arg, "%99s %d", prior_src, &warm_mapper) < 1)
+                        {
+                            printf("No previous mapping provided.\n");
+                            found = 1;
+                            continue;
+                        }
+
+                        if (strspn(prior_src, "0123456789") == strlen(prior_src))
+                        {
+                            idx = atoi(prior_src);
+                            if (result_fifo != NULL && ((idx < RESULT_FIFO_SIZE && fifo_ctr >= RESULT_FIFO_SIZE) || idx < fifo_ptr2))
+                            {
+                                hints = getPlacementHints(result_fifo[idx], d);
+                                priorII = get_n_cgra_slices(result_fifo[idx]);
+                                if (warm_mapper == 0)
+                                    warm_mapper = get_mapping(result_fifo[idx]);
+                            }
+                        }
+                        else
+                            hints = import_mapping_hints(prior_src, d, get_cgra_C(template), &priorII);
+
+                        if (hints == NULL)
+                        {
+                            printf("Could not load the previous mapping.\n");
+                            found = 1;
+                            continue;
+                        }
+
+                        if (c != NULL)
+                            delete_cgra(c);
+                        if (placed[0] != NULL)
+                        {
+                            for (int k = 0; k < get_dfg_size(d); k++)
+                                free(placed[0][k]);
+                            free(placed[0]);
+                        }
+                        *placed = (int **)calloc(get_dfg_size(d), sizeof(int *));
+                        for (i = 0; i < get_dfg_size(d); i++)
+                            (*placed)[i] = (int *)calloc(5, sizeof(int));
+                        c = HandOfGodWarmStart(template, d, placed, hints, priorII, warm_mapper, INFINITY, 1);
+                        deletePlacementHints(hints, d);
+                    }
+
+                    // Configure the persistent mapping cache
+                    else if (!strcmp(command, "mapping_cache"))
+                    {
+                        if (arg[0] == '\0')
+                        {
+                            if (get_mapping_cache_dir() != NULL)
+                                printf("Mapping cache directory: %s\n", get_mapping_cache_dir());
+                            else
+                                printf("Mapping cache is disabled.\n");
+                        }
+                        else if (!strcmp(arg, "off"))
+                        {
+                            set_mapping_cache_dir(NULL);
+                            printf("Mapping cache disabled.\n");
+                        }
+                        else if (!strcmp(arg, "on"))
+                        {
+                            set_mapping_cache_dir(get_default_mapping_cache_dir());
+                            if (get_mapping_cache_dir() != NULL)
+                                printf("Mapping cache directory: %s\n", get_mapping_cache_dir());
+                            else
+                                printf("Neither XDG_CACHE_HOME nor HOME is set. Give the cache directory.\n");
+                        }
+                        else if (!strcmp(arg, "clear"))
+                        {
+                            i = clear_mapping_cache();
+                            if (i < 0)
+                                printf("No mapping cache to clear.\n");
+                            else
+                                printf("Removed %d mapping cache entries.\n", i);
+                        }
+                        else
+                        {
+                            set_mapping_cache_dir(arg);
+                            printf("Mapping cache directory: %s\n", arg);
+                        }
+                    }
+
+                    // Share the routes of a value between its consumers
+                    else if (!strcmp(command, "multicast_routing"))
+                    {
+                        if (!strcmp(arg, "on"))
+                            set_multicast_routing(1);
+                        else if (!strcmp(arg, "off"))
+                            set_multicast_routing(0);
+                        else if (arg[0] != '\0')
+                            printf("Invalid argument. Use 'on' or 'off'.\n");
+                        printf("Multicast routing is %s.\n", get_multicast_routing() ? "enabled" : "disabled");
+                    }
+
+                    // Prove IIs infeasible with the exact model before the heuristic mappers
+                    else if (!strcmp(command, "ii_prover"))
+                    {
+                        if (!strcmp(arg, "on"))
+                            set_ii_prover(1);
+                        else if (!strcmp(arg, "off"))
+                            set_ii_prover(0);
+                        else if (arg[0] != '\0')
+                            printf("Invalid argument. Use 'on' or 'off'.\n");
+                        printf("The II prover is %s.\n", get_ii_prover() ? "enabled" : "disabled");
+                    }
+
+                    // Serve mapping requests over a Unix domain socket, until a shutdown request
+                    else if (!strcmp(command, "serve"))
+                    {
+                        char socket_path[MAX_COMMAND_SIZE];
+                        int n_workers = SERVER_DEFAULT_WORKERS;
+                        if (sscanf(arg, "%199s %d", socket_path, &n_workers) < 1)
+                            printf("No socket path given.\n");
+                        else
+                            run_mapping_server(socket_path, n_workers);
                     }
 
                     /*************************************************************
@@ -360,6 +721,36 @@ int main(int argc, char *argv[])
                     }
 
                     // Display the Summary of the Place and Route
+                    else if (!strcmp(command, "pr_stats"))
+                    {
+                        if (arg[0] == '\0')
+                            print_stats();
+                        else if (!strcmp(arg, "reset"))
+                        {
+                            reset_stats();
+                            printf("Mapper statistics cleared.\n");
+                        }
+                        else if (!strcmp(arg, "timers on") || !strcmp(arg, "timers off"))
+                        {
+                            set_stats_timers(!strcmp(arg, "timers on"));
+                            printf("Phase timers %s.\n", get_stats_timers() ? "enabled" : "disabled");
+                        }
+                        else if (!strcmp(arg, "trace on"))
+                        {
+                            set_stats_tracing(1);
+                            printf("Tracing %s.\n", get_stats_tracing() ? "enabled" : "could not be enabled");
+                        }
+                        else if (!strcmp(arg, "trace off"))
+                        {
+                            set_stats_tracing(0);
+                            printf("Tracing disabled.\n");
+                        }
+                        else if (!strncmp(arg, "trace ", 6))
+                            export_stats_trace(arg + 6);
+                        else
+                            printf("Invalid argument. Use 'reset', 'timers on', 'timers off', 'trace on', 'trace off' or 'trace <file>'.\n");
+                    }
+
                     else if (!strcmp(command, "pr_summary"))
                     {
                         if (d == NULL || placed == NULL)
@@ -400,6 +791,112 @@ int main(int argc, char *argv[])
                             c = parallelize_mapping(c, d, placed, 1);
                     }
 
+                    // Map all imported DFGs onto one device (the merged DFG becomes the current DFG)
+                    else if (!strcmp(command, "comap"))
+                    {
+                        int ii_targets[5] = {0}, copies[5], comap_mapper, n, pos;
+                        int **comap_placed = NULL;
+                        dfg *combined = NULL;
+                        cgra *comapped;
+                        char *p = arg;
+
+                        if (dfg_targets_idx <= 0 || template == NULL)
+                        {
+                            printf("No valid DFG or CGRA imported.\n");
+                            found = 1;
+                            continue;
+                        }
+                        if (sscanf(p, "%d%n", &comap_mapper, &pos) != 1)
+                        {
+                            printf("No mapper provided.\n");
+                            found = 1;
+                            continue;
+                        }
+                        p += pos;
+                        for (n = 0; n < dfg_targets_idx && sscanf(p, "%d%n", &ii_targets[n], &pos) == 1; n++)
+                            p += pos;
+                        double budget_seconds;
+                        uint64_t budget_max_expansions;
+                        mapping_budget budget;
+                        if (parse_mapping_budget(p, &budget_seconds, &budget_max_expansions) < 0)
+                        {
+                            printf("Invalid II targets or mapping budget.\n");
+                            found = 1;
+                            continue;
+                        }
+
+                        start_mapping_budget(&budget, budget_seconds, budget_max_expansions);
+                        comapped = comap_kernels(template, dfg_targets, dfg_targets_idx, ii_targets, comap_mapper, INFINITY, &combined, &comap_placed, copies, 1);
+                        if (mapping_budget_active())
+                            print_budget_report();
+                        stop_mapping_budget();
+                        if (comapped == NULL)
+                        {
+                            printf("Could not co-map the imported DFGs.\n");
+                            found = 1;
+                            continue;
+                        }
+
+                        // The imported DFGs are kept: the merged DFG only replaces the current one
+                        discard_current_mapping(&c, placed, d);
+                        release_dfg(d, dfg_targets, dfg_targets_idx, mapped_dfgs, fifo_ctr);
+                        d = combined;
+                        *placed = comap_placed;
+                        c = comapped;
+                    }
+
+                    // Map the DFG with several unrolling factors (the best unrolled DFG becomes the current DFG)
+                    else if (!strcmp(command, "unroll_search"))
+                    {
+                        int search_mapper, maxU = 8, best_U, pos;
+                        int **unrolled_placed = NULL;
+                        dfg *unrolled = NULL;
+                        cgra *mapped;
+                        char *p = arg;
+
+                        if (d == NULL || template == NULL)
+                        {
+                            printf("No valid DFG or CGRA imported.\n");
+                            found = 1;
+                            continue;
+                        }
+                        if (sscanf(p, "%d%n", &search_mapper, &pos) != 1)
+                        {
+                            printf("No mapper provided.\n");
+                            found = 1;
+                            continue;
+                        }
+                        p += pos;
+                        if (sscanf(p, "%d%n", &maxU, &pos) == 1)
+                            p += pos;
+                        double budget_seconds;
+                        uint64_t budget_max_expansions;
+                        mapping_budget budget;
+                        if (maxU < 1 || parse_mapping_budget(p, &budget_seconds, &budget_max_expansions) < 0)
+                        {
+                            printf("Invalid unrolling factor or mapping budget.\n");
+                            found = 1;
+                            continue;
+                        }
+
+                        start_mapping_budget(&budget, budget_seconds, budget_max_expansions);
+                        mapped = unroll_search(template, d, maxU, search_mapper, &unrolled, &unrolled_placed, &best_U, 1);
+                        if (mapping_budget_active())
+                            print_budget_report();
+                        stop_mapping_budget();
+                        if (mapped == NULL)
+                        {
+                            printf("Could not map the DFG with any unrolling factor.\n");
+                            found = 1;
+                            continue;
+                        }
+                        printf("Best unrolling factor: %d (II = %d).\n", best_U, get_n_cgra_slices(mapped));
+
+                        replace_current_dfg(&d, unrolled, &c, placed, dfg_targets, dfg_targets_idx, mapped_dfgs, fifo_ctr);
+                        *placed = unrolled_placed;
+                        c = mapped;
+                    }
+
                     else if (!strcmp(command, "store_mapping"))
                     {
                         if (c != NULL)
@@ -455,6 +952,7 @@ int main(int argc, char *argv[])
                         {
                             // Pruning Info: [conns removed, registers removed, PEs removed, SPs removed, output registers, fu_ops, rf ports, fu inputs]
                             int Nprune, pruning_info[] = {0, 0, 0, 0, 0, 0, 0, 0};
+                            float pruning_savings[2]; // estimated area, power
                             if (!strcmp(arg, "all"))
                                 Nprune = RESULT_FIFO_SIZE > fifo_ctr ? fifo_ptr2 : RESULT_FIFO_SIZE;
                             else if (atoi(arg) >= 0 && atoi(arg) < RESULT_FIFO_SIZE && strlen(arg) > 0)
@@ -463,12 +961,12 @@ int main(int argc, char *argv[])
                                 Nprune = 1;
 
                             if (fifo_ctr == 0){
-                                auto_prune(result_fifo, dfg_targets, template, dfg_targets_idx, pruning_info);
+                                auto_prune(result_fifo, dfg_targets, template, dfg_targets_idx, pruning_info, pruning_savings);
                             }
                             else
                             {
                                 // auto_prune_single(c, template, d, *placed);
-                                auto_prune(result_fifo, mapped_dfgs, template, Nprune, pruning_info);
+                                auto_prune(result_fifo, mapped_dfgs, template, Nprune, pruning_info, pruning_savings);
                             }
 
                             printf("\033[1;33mPruning Results:\033[0;0m\n");
@@ -480,6 +978,8 @@ int main(int argc, char *argv[])
                             printf("\tFU Operations Removed: \033[1;34m%d\033[0;0m\n", pruning_info[5]);
                             printf("\tPEs removed: \033[1;34m%d\033[0;0m\n", pruning_info[2]);
                             printf("\tStreaming I/O Ports Removed: \033[1;34m%d\033[0;0m\n", pruning_info[3]);
+                            printf("\tEstimated Area Reduction: \033[1;34m%.2f um^2\033[0;0m\n", pruning_savings[0]);
+                            printf("\tEstimated Power Reduction: \033[1;34m%.2f uW\033[0;0m\n", pruning_savings[1]);
                         }
                     }
 
@@ -495,7 +995,21 @@ int main(int argc, char *argv[])
                             {
                                 result_fifo = (cgra **)calloc(RESULT_FIFO_SIZE, sizeof(cgra *));
                             }
-                            template = aggressiveOpt(template, result_fifo, dfg_targets, dfg_targets_idx, arg, constraints_file);
+                            if (constraints == NULL)
+                                constraints = load_dse_constraints(constraints_file);
+                            template = aggressiveOpt(template, result_fifo, dfg_targets, dfg_targets_idx, arg, constraints);
+                        }
+                    }
+
+                    else if (!strcmp(command, "pareto_dse"))
+                    {
+                        if (dfg_targets_idx <= 0)
+                            printf("No DFGs imported.\n");
+                        else
+                        {
+                            if (constraints == NULL)
+                                constraints = load_dse_constraints(constraints_file);
+                            paretoDSE(template, dfg_targets, dfg_targets_idx, constraints, strlen(arg) > 0 ? arg : "pareto.csv");
                         }
                     }
 
@@ -728,6 +1242,62 @@ int main(int argc, char *argv[])
                         }
                     }
 
+                    else if (!strcmp(command, "export_bitstream"))
+                    {
+                        if (c == NULL)
+                        {
+                            printf("No valid CGRA imported!\n");
+                        }
+                        else if (d == NULL)
+                        {
+                            printf("No valid DFG imported!\n");
+                        }
+                        else
+                        {
+                            if (strlen(arg) > 1)
+                                exportBitstream(c, d, placed, arg, vectorwidth);
+                            else
+                                exportBitstream(c, d, placed, "mapping_results", vectorwidth);
+                        }
+                    }
+
+                    else if (!strcmp(command, "import_bitstream"))
+                    {
+                        if (template == NULL)
+                        {
+                            printf("CGRA not yet imported.\n");
+                        }
+                        else if (d == NULL || placed == NULL)
+                        {
+                            printf("No valid DFG imported.\n");
+                        }
+                        else
+                        {
+                            if (placed[0] == NULL)
+                            {
+                                *placed = (int **)calloc(get_dfg_size(d), sizeof(int *));
+                                for (i = 0; i < get_dfg_size(d); i++)
+                                    (*placed)[i] = (int *)calloc(5, sizeof(int));
+                            }
+                            cgra *loaded = importBitstream(template, d, *placed, arg);
+                            if (loaded != NULL)
+                            {
+                                if (c != NULL)
+                                    delete_cgra(c);
+                                c = loaded;
+                            }
+                        }
+                    }
+
+                    else if (!strcmp(command, "diff_bitstream"))
+                    {
+                        char file1[MAX_COMMAND_SIZE] = {0}, file2[MAX_COMMAND_SIZE] = {0};
+                        if (sscanf(arg, "%199s %199s", file1, file2) != 2)
+                            printf("Usage: diff_bitstream <file 1> <file 2>\n");
+                        else
+                            diffBitstreams(file1, file2, 1);
+                    }
+
                     else if (!strcmp(command, "export_arch"))
                     {
                         int export_ii;
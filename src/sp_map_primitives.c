@@ -31,7 +31,8 @@ int __spatial__routeToInput(cgra *fs, dfg_instr *target, int i1, int j1, dfg_ins
 {
 
     int V = get_cgra_L(fs) * get_cgra_C(fs), src = i1 * get_cgra_C(fs) + j1, dest = i2 * get_cgra_C(fs) + j2, f_score, g_score, v;
-    int id = get_instr_id(target), iid = get_instr_id(input), i_prev, j_prev, i, j, *neighbours;
+    int id = get_instr_id(target), iid = get_instr_id(input), i_prev, j_prev, i, j, n_neighbours;
+    const pe_neighbour *neighbours;
     int dist[V]; // g-score (actual cost from start)
     int pred[V]; // Predecessor array for path reconstruction
 
@@ -71,12 +72,12 @@ int __spatial__routeToInput(cgra *fs, dfg_instr *target, int i1, int j1, dfg_ins
         i_prev = u / get_cgra_C(fs);
         j_prev = u % get_cgra_C(fs);
 
-        neighbours = getPENeighbours(fs, i_prev, j_prev);
+        neighbours = getPENeighbourList(fs, i_prev, j_prev, &n_neighbours);
 
-        for (int k = 1; k <= neighbours[0]; k++)
+        for (int k = 0; k < n_neighbours; k++)
         {
 
-            v = neighbours[k];
+            v = neighbours[k].pos;
             i = v / get_cgra_C(fs);
             j = v % get_cgra_C(fs);
 
@@ -110,7 +111,6 @@ int __spatial__routeToInput(cgra *fs, dfg_instr *target, int i1, int j1, dfg_ins
                 }
             }
         }
-        free(neighbours);
         freeMinHeapNode(minHeapNode);
     }
 
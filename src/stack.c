@@ -27,6 +27,17 @@ void deleteStack(stack* s)
     }
 }
  
+// function to empty a stack, growing it if it can't hold the given capacity
+void resetStack(stack* s, unsigned capacity)
+{
+    if (capacity > s->capacity) {
+        free(s->array);
+        s->array = (Item*)malloc(capacity * sizeof(Item));
+        s->capacity = capacity;
+    }
+    s->top = -1;
+}
+
 unsigned getStackSize(stack* s)
 {
     return s->capacity;
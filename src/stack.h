@@ -10,6 +10,7 @@ typedef struct _stack stack;
 
 stack* createStack(unsigned capacity);
 void deleteStack(stack* s);
+void resetStack(stack* s, unsigned capacity);
 unsigned getStackSize(stack* s);
 Item* isFull(stack*);
 Item* isEmpty(stack*);
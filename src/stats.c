@@ -0,0 +1,181 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <omp.h>
+#include "stats.h"
+
+typedef struct
+{
+    int phase;
+    int tid;
+    double ts;
+    double dur;
+} trace_event;
+
+uint64_t stat_counters[N_STATS];
+int stats_timers = 0;
+
+static uint64_t phase_ns[N_PHASES], phase_calls[N_PHASES];
+static trace_event *trace_events = NULL;
+static uint64_t n_trace_events = 0, n_dropped_events = 0;
+static double trace_epoch = 0;
+static int tracing = 0;
+
+static const char *counter_names[N_STATS] = {
+    "placeOp calls",
+    "routeOp calls",
+    "unmapOp calls",
+    "routeInTime DFS nodes expanded",
+    "routes grafted onto a route tree",
+    "backtracks",
+    "localized searches",
+    "II increments",
+    "annealer moves accepted",
+    "annealer moves rejected",
+    "device slice copies",
+};
+
+static const char *phase_names[N_PHASES] = {
+    "mapping",
+    "scheduling",
+    "placeOp",
+    "routeOp",
+    "unmapOp",
+    "localized_search",
+};
+
+double stats_timer_begin(void)
+{
+    return omp_get_wtime();
+}
+
+/**************************************************************************************
+ * stats_timer_end
+ * Accumulates the time elapsed since t0 in the phase timer. If tracing is enabled, the
+ * interval is also recorded as a trace event (events beyond the buffer size are dropped).
+ *************************************************************************************/
+void stats_timer_end(stat_phase p, double t0)
+{
+    double t1 = omp_get_wtime();
+    uint64_t idx;
+
+    __atomic_fetch_add(&phase_ns[p], (uint64_t)((t1 - t0) * 1e9), __ATOMIC_RELAXED);
+    __atomic_fetch_add(&phase_calls[p], 1, __ATOMIC_RELAXED);
+
+    if (!tracing)
+        return;
+    idx = __atomic_fetch_add(&n_trace_events, 1, __ATOMIC_RELAXED);
+    if (idx >= STATS_MAX_TRACE_EVENTS)
+    {
+        __atomic_fetch_add(&n_dropped_events, 1, __ATOMIC_RELAXED);
+        return;
+    }
+    trace_events[idx].phase = p;
+    trace_events[idx].tid = omp_get_thread_num();
+    trace_events[idx].ts = t0 - trace_epoch;
+    trace_events[idx].dur = t1 - t0;
+}
+
+void reset_stats(void)
+{
+    memset(stat_counters, 0, sizeof(stat_counters));
+    memset(phase_ns, 0, sizeof(phase_ns));
+    memset(phase_calls, 0, sizeof(phase_calls));
+    n_trace_events = 0;
+    n_dropped_events = 0;
+    trace_epoch = omp_get_wtime();
+}
+
+void print_stats(void)
+{
+    int k;
+
+    printf("|---------------------- MAPPER STATISTICS ----------------------|\n");
+    for (k = 0; k < N_STATS; k++)
+        printf("| %-34s | %24llu |\n", counter_names[k], (unsigned long long)stat_counters[k]);
+    printf("|---------------------------------------------------------------|\n");
+    printf("| %-16s | %10s | %12s | %14s |\n", "Phase", "Calls", "Total (ms)", "Avg (us)");
+    for (k = 0; k < N_PHASES; k++)
+        printf("| %-16s | %10llu | %12.3lf | %14.3lf |\n", phase_names[k], (unsigned long long)phase_calls[k],
+               phase_ns[k] / 1e6, phase_calls[k] ? phase_ns[k] / 1e3 / phase_calls[k] : 0.0);
+    printf("|---------------------------------------------------------------|\n");
+    if (!stats_timers)
+        printf("Phase timers are off ('pr_stats timers on' to enable them).\n");
+    if (tracing)
+        printf("Tracing enabled: %llu events recorded, %llu dropped.\n",
+               (unsigned long long)(n_trace_events - n_dropped_events), (unsigned long long)n_dropped_events);
+}
+
+/**************************************************************************************
+ * set_stats_timers
+ * Enables/disables the phase timers. Disabling them also disables tracing.
+ *************************************************************************************/
+void set_stats_timers(int enable)
+{
+    stats_timers = enable;
+    if (!enable)
+        tracing = 0;
+}
+
+int get_stats_timers(void)
+{
+    return stats_timers;
+}
+
+/**************************************************************************************
+ * set_stats_tracing
+ * Enables/disables the recording of trace events. Enabling clears the trace buffer and
+ * turns the phase timers on, as events are recorded when a phase ends.
+ *************************************************************************************/
+void set_stats_tracing(int enable)
+{
+    if (enable && trace_events == NULL)
+        trace_events = (trace_event *)malloc(STATS_MAX_TRACE_EVENTS * sizeof(trace_event));
+    if (enable)
+    {
+        n_trace_events = 0;
+        n_dropped_events = 0;
+        trace_epoch = omp_get_wtime();
+    }
+    tracing = enable && trace_events != NULL;
+    if (tracing)
+        stats_timers = 1;
+}
+
+int get_stats_tracing(void)
+{
+    return tracing;
+}
+
+/**************************************************************************************
+ * export_stats_trace
+ * Writes the recorded events in the Chrome trace_event JSON format (complete events,
+ * timestamps in microseconds), followed by a counter event with the current counters.
+ * Return values: success ? 0 : -1
+ *************************************************************************************/
+int export_stats_trace(const char *filename)
+{
+    uint64_t k, n = n_trace_events < STATS_MAX_TRACE_EVENTS ? n_trace_events : STATS_MAX_TRACE_EVENTS;
+    FILE *f = fopen(filename, "w");
+    int c;
+
+    if (f == NULL)
+    {
+        printf("ERROR: Could not open '%s'.\n", filename);
+        return -1;
+    }
+
+    fprintf(f, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+    for (k = 0; trace_events != NULL && k < n; k++)
+        fprintf(f, "{\"name\": \"%s\", \"cat\": \"midas\", \"ph\": \"X\", \"ts\": %.3lf, \"dur\": %.3lf, \"pid\": 1, \"tid\": %d},\n",
+                phase_names[trace_events[k].phase], trace_events[k].ts * 1e6, trace_events[k].dur * 1e6, trace_events[k].tid);
+    fprintf(f, "{\"name\": \"counters\", \"ph\": \"C\", \"ts\": %.3lf, \"pid\": 1, \"args\": {",
+            (omp_get_wtime() - trace_epoch) * 1e6);
+    for (c = 0; c < N_STATS; c++)
+        fprintf(f, "%s\"%s\": %llu", c ? ", " : "", counter_names[c], (unsigned long long)stat_counters[c]);
+    fprintf(f, "}}\n]}\n");
+
+    fclose(f);
+    printf("Trace file generated!\n");
+    return 0;
+}
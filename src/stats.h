@@ -0,0 +1,76 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdint.h>
+
+/**********************************************************************************************
+ * Mapper Instrumentation
+ * Event counters and per-phase timers, updated from the mapping hot paths. Counters and timer
+ * totals are updated atomically (relaxed), so they can be used from OpenMP regions. Timed
+ * phases are only timed while the phase timers are enabled (off by default, so that the hot
+ * paths do not read the clock), and can also be recorded as Chrome trace events
+ * (chrome://tracing, Perfetto), while tracing is enabled. Building with -DMIDAS_NO_STATS
+ * compiles every probe out.
+ *********************************************************************************************/
+
+#define STATS_MAX_TRACE_EVENTS (1 << 20)
+
+typedef enum
+{
+    STAT_PLACE_OP,
+    STAT_ROUTE_OP,
+    STAT_UNMAP_OP,
+    STAT_ROUTE_DFS_NODES,
+    STAT_ROUTE_TREE_GRAFTS,
+    STAT_BACKTRACKS,
+    STAT_LOCALIZED_SEARCH,
+    STAT_II_INCREMENTS,
+    STAT_SA_ACCEPTED,
+    STAT_SA_REJECTED,
+    STAT_DEVICE_COPIES,
+    N_STATS
+} stat_counter;
+
+typedef enum
+{
+    PHASE_MAPPING,
+    PHASE_SCHEDULING,
+    PHASE_PLACE,
+    PHASE_ROUTE,
+    PHASE_UNMAP,
+    PHASE_LOCALIZED_SEARCH,
+    N_PHASES
+} stat_phase;
+
+extern uint64_t stat_counters[N_STATS];
+extern int stats_timers;
+
+#ifndef MIDAS_NO_STATS
+#define STAT_INC(c) __atomic_fetch_add(&stat_counters[c], 1, __ATOMIC_RELAXED)
+#define STAT_ADD(c, n) __atomic_fetch_add(&stat_counters[c], (uint64_t)(n), __ATOMIC_RELAXED)
+// A timer started while the phase timers are off holds 0 and is not accumulated
+#define STAT_TIMER_BEGIN() (stats_timers ? stats_timer_begin() : 0.0)
+#define STAT_TIMER_END(p, t0)          \
+    do                                 \
+    {                                  \
+        if ((t0) > 0.0)                \
+            stats_timer_end(p, t0);    \
+    } while (0)
+#else
+#define STAT_INC(c) ((void)0)
+#define STAT_ADD(c, n) ((void)0)
+#define STAT_TIMER_BEGIN() 0.0
+#define STAT_TIMER_END(p, t0) ((void)(t0))
+#endif
+
+double stats_timer_begin(void);
+void stats_timer_end(stat_phase p, double t0);
+void reset_stats(void);
+void print_stats(void);
+void set_stats_timers(int enable);
+int get_stats_timers(void);
+void set_stats_tracing(int enable);
+int get_stats_tracing(void);
+int export_stats_trace(const char *filename);
+
+#endif